@@ -1,4 +1,10 @@
 #include "args.h"
+#include "kill.h"
+#include "pipeline.h"
+#include "usage.h"
+#include "forest.h"
+#include "history.h"
+#include "snapshot.h"
 #include "utils.h"
 #include "version.h"
 #include <errno.h>
@@ -53,14 +59,72 @@ void print_usage(const char *program_name) {
   printf("  --pid <n>             Explain a specific PID\n");
   printf("  -p, --port <n>        Explain port usage\n");
   printf("  -a, --all             List all running processes\n");
+  printf("      --by-user         Summarise processes, memory and sockets per user\n");
+  printf("      --sort <col>      Order --by-user by a column: user, uid, procs,\n"
+         "                        zombies, sockets, vsz or rss (default rss); or\n"
+         "                        --tree siblings by pid, name, descendants,\n"
+         "                        subtree-rss, subtree-vsz or subtree-sockets\n");
+  printf("      --record <file>   Sample all processes into a fixed-size ring file\n"
+         "                        until interrupted\n");
+  printf("      --interval <sec>  Seconds between --record samples (default %d) or\n"
+         "                        --publish-shm snapshots (default %d)\n",
+         HISTORY_DEFAULT_INTERVAL, SNAPSHOT_DEFAULT_INTERVAL);
+  printf("      --max-size <MiB>  Size of a new --record file (default %d) or\n"
+         "                        --publish-shm segment (default %d)\n",
+         HISTORY_DEFAULT_MAX_MB, SNAPSHOT_DEFAULT_MAX_MB);
+  printf("      --replay <file>   Print the samples held in a --record file\n");
+  printf("      --history <pid>   With --replay, only samples of this PID\n");
+  printf("      --wait-listen <n> Block until a TCP listener or UDP socket is bound\n"
+         "                        to port <n>\n");
+  printf("      --wait-free <n>   Block until nothing is bound to port <n>\n");
+  printf("      --timeout <ms>    Give up waiting after <ms> (default %d, 0 = never)\n",
+         WAIT_DEFAULT_TIMEOUT_MS);
+  printf("      --check <cond>    Exit 0 if a socket matches <cond>, 1 if not, %d if\n"
+         "                        <cond> is invalid or sockets cannot be read;\n"
+         "                        prints nothing. <cond> is port=<n> plus any of\n"
+         "                        state=, proto=, user=, pid=, name= (comma-separated)\n",
+         CHECK_EXIT_ERROR);
+  printf("      --ephemeral       Show ephemeral port use per destination, with\n"
+         "                        TIME_WAIT counts and how full the range is\n");
+  printf("      --calibrate       Time each socket table backend on this host and\n"
+         "                        save the fastest per operation for later runs\n");
+  printf("      --serve-stdio     Answer queries read from stdin, one JSON object\n"
+         "                        per line ({\"port\":n}, {\"pid\":n}, {\"bound\":n},\n"
+         "                        {\"check\":\"...\"}), one JSON line per answer\n");
+  printf("      --publish-shm <name>\n"
+         "                        Keep a snapshot of all processes and sockets in\n"
+         "                        shared memory <name> until interrupted\n");
+  printf("      --from-shm <name> Answer --pid, --port or --all from the snapshot\n"
+         "                        published in <name> instead of the system\n");
   printf("  -s, --short           One-line summary\n");
-  printf("  -t, --tree            Show full process ancestry tree\n");
+  printf("  -t, --tree            Show the ancestry and descendants of --pid, or\n"
+         "                        every process as a forest (--all), with the\n"
+         "                        memory and sockets of each subtree\n");
   printf("  -j, --json            Output result as JSON\n");
+  printf("      --csv             Output result as CSV (--all, --by-user, --port,\n"
+         "                        --replay, --ephemeral)\n");
+  printf("      --tsv             Output result as TSV (--all, --by-user, --port,\n"
+         "                        --replay, --ephemeral)\n");
+  printf("      --format <fmt>    Output format: json, csv, tsv or cbor (binary)\n");
+  printf("      --jobs <n>        With --all, read processes on <n> threads while\n"
+         "                        formatting; with --by-user, read them on <n>\n"
+         "                        threads; with --port, scan socket owners on\n"
+         "                        <n> threads (1-%d)\n", PIPELINE_MAX_JOBS);
+  printf("      --unordered       With --all --jobs, print processes as they are read\n");
   printf("  -w, --warnings        Show only warnings\n");
+  printf("      --tcp-info        With --port, show RTT, retransmits, congestion\n"
+         "                        window and socket memory per TCP connection\n");
+  printf("      --group-by <key>  With --port, count connections per pid, state,\n"
+         "                        remote or remote-subnet instead of listing them\n");
   printf("  -n, --no-color        Disable colorized output\n");
   printf(
       "  -e, --env             Show only environment variables for the process\n");
   printf("  -i, --interactive     Enable interactive mode (kill process with 'k')\n");
+  printf("      --signal <sig>    Send <sig> (e.g. TERM, HUP, 9) to every process on\n"
+         "                        the port, or to the PID, and report the outcome\n");
+  printf("      --subtree         With --signal --pid, include all descendants\n");
+  printf("      --grace <ms>      Wait up to <ms> for exit after SIGTERM before\n"
+         "                        sending SIGKILL (default %d)\n", KILL_DEFAULT_GRACE_MS);
   printf("  -v, --version         Show version information\n");
   printf("  -h, --help            Show this help message\n");
   printf("\n");
@@ -69,7 +133,27 @@ void print_usage(const char *program_name) {
   printf("  %s --pid 1234 --tree\n", program_name);
   printf("  %s --all --short\n", program_name);
   printf("  %s --port 3000 --json\n", program_name);
+  printf("  %s --port 443 --tcp-info --json\n", program_name);
+  printf("  %s --port 443 --group-by remote-subnet\n", program_name);
   printf("  %s --pid 5678 --env\n", program_name);
+  printf("  %s --all --csv\n", program_name);
+  printf("  %s --all --json --jobs 4\n", program_name);
+  printf("  %s --by-user --sort sockets\n", program_name);
+  printf("  %s --all --tree --sort subtree-rss\n", program_name);
+  printf("  %s --record /var/lib/wir/history --interval 30\n", program_name);
+  printf("  %s --replay /var/lib/wir/history --history 1234\n", program_name);
+  printf("  %s --wait-listen 8080 --timeout 10000 && curl localhost:8080\n",
+         program_name);
+  printf("  %s --check port=8080,state=LISTEN,user=app || restart-app\n",
+         program_name);
+  printf("  %s --ephemeral --json\n", program_name);
+  printf("  %s --calibrate\n", program_name);
+  printf("  coproc %s --serve-stdio --jobs 4\n", program_name);
+  printf("  %s --publish-shm /wir --interval 2 &\n", program_name);
+  printf("  %s --from-shm /wir --port 8080 --json\n", program_name);
+  printf("  %s --port 443 --format cbor > port.cbor\n", program_name);
+  printf("  %s --port 8080 --signal TERM\n", program_name);
+  printf("  %s --pid 1234 --subtree --signal TERM --grace 500\n", program_name);
   printf("\n");
 }
 
@@ -124,23 +208,52 @@ static int parse_int(const char *str, int *out) {
  * - --port, -p <n>: Analyze processes using specific port
  * - --all, -a: List all running processes
  * - --short, -s: One-line summary output
- * - --tree, -t: Show full process ancestry tree
+ * - --tree, -t: Show process ancestry and descendants, or the whole forest
  * - --json, -j: Output in JSON format
+ * - --format <json|csv|tsv|cbor>: Select a machine-readable output format
+ * - --csv: Output as CSV
+ * - --tsv: Output as TSV
+ * - --by-user: Per-user resource summary
+ * - --sort <column>: Order of the --by-user summary or of --tree siblings
+ * - --record <file>: Record samples into a ring file
+ * - --interval <sec>: Seconds between recorded samples or published snapshots
+ * - --max-size <MiB>: Size of a new ring file or shared-memory segment
+ * - --replay <file>: Print the samples in a ring file
+ * - --history <pid>: Only replay samples of one PID
+ * - --wait-listen <n>: Wait until port n is bound
+ * - --wait-free <n>: Wait until port n is free
+ * - --timeout <ms>: Limit on --wait-listen/--wait-free
+ * - --check <cond>: Test a port condition (exit status only)
+ * - --ephemeral: Ephemeral port use per destination
+ * - --calibrate: Time the socket backends and save the fastest
+ * - --serve-stdio: Answer NDJSON queries from stdin until EOF
+ * - --publish-shm <name>: Publish snapshots into shared memory
+ * - --from-shm <name>: Answer from a published snapshot
+ * - --jobs <n>: Pipelined --all scan / work-stealing --port scan on n threads
+ * - --unordered: Pipelined rows in completion order
  * - --warnings, -w: Show only warnings
+ * - --tcp-info: TCP internals per connection
+ * - --group-by <key>: Connection counts per pid, state, remote or remote-subnet
  * - --no-color, -n: Disable colorized output
  * - --env, -e: Show environment variables
  * - --interactive, -i: Enable interactive mode
+ * - --signal <sig>: Signal every owner of the port (or the PID)
+ * - --subtree: Include descendants of --pid in --signal
+ * - --grace <ms>: Grace period between SIGTERM and SIGKILL
  *
+ * @param ctx Context errors are reported to
  * @param argc Argument count from main()
  * @param argv Argument vector from main()
  * @param args Pointer to cli_args_t structure to populate with parsed arguments
  * @return 0 on success, -1 on error (invalid argument, missing value, or parse failure)
  */
-int parse_args(const int argc, char **argv, cli_args_t *args) {
+int parse_args(const wir_ctx_t *ctx, const int argc, char **argv, cli_args_t *args) {
   memset(args, 0, sizeof(*args));
   args->mode = MODE_NONE;
   args->port = -1;
   args->pid = -1;
+  args->grace_ms = -1;
+  args->timeout_ms = -1;
 
   /* No arguments - show help */
   if (argc < 2) {
@@ -163,21 +276,191 @@ int parse_args(const int argc, char **argv, cli_args_t *args) {
     if (strcmp(arg, "--all") == 0 || strcmp(arg, "-a") == 0) {
       if (args->mode == MODE_NONE) {
         args->mode = MODE_ALL;
+      } else if (args->mode == MODE_USERS) {
+        print_error(ctx, "Cannot combine --by-user with --all, --port or --pid");
+        return -1;
+      } else if (args->mode == MODE_RECORD || args->mode == MODE_REPLAY) {
+        print_error(ctx, "Cannot combine --record or --replay with another mode");
+        return -1;
+      } else if (args->mode == MODE_WAIT) {
+        print_error(ctx, "Cannot combine --wait-listen or --wait-free with another mode");
+        return -1;
+      } else if (args->mode == MODE_CHECK) {
+        print_error(ctx, "Cannot combine --check with another mode");
+        return -1;
+      } else if (args->mode == MODE_EPHEMERAL) {
+        print_error(ctx, "Cannot combine --ephemeral with another mode");
+        return -1;
+      } else if (args->mode == MODE_CALIBRATE) {
+        print_error(ctx, "Cannot combine --calibrate with another mode");
+        return -1;
+      } else if (args->mode == MODE_SERVE) {
+        print_error(ctx, "Cannot combine --serve-stdio with another mode");
+        return -1;
+      } else if (args->mode == MODE_PUBLISH) {
+        print_error(ctx, "Cannot combine --publish-shm with another mode");
+        return -1;
+      }
+    } else if (strcmp(arg, "--by-user") == 0) {
+      args->by_user = true;
+      if (args->mode == MODE_NONE) {
+        args->mode = MODE_USERS;
+      }
+    } else if (strcmp(arg, "--record") == 0 || strcmp(arg, "--replay") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "%s requires an argument", arg);
+        return -1;
+      }
+
+      const bool record = strcmp(arg, "--record") == 0;
+      if (record) {
+        args->record_path = argv[++i];
+      } else {
+        args->replay_path = argv[++i];
+      }
+      if (args->mode == MODE_NONE) {
+        args->mode = record ? MODE_RECORD : MODE_REPLAY;
+      }
+    } else if (strcmp(arg, "--wait-listen") == 0 || strcmp(arg, "--wait-free") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "%s requires an argument", arg);
+        return -1;
+      }
+
+      int port;
+      if (parse_int(argv[++i], &port) < 0 || port < 1 || port > 65535) {
+        print_error(ctx, "Invalid port number: %s (expected 1-65535)", argv[i]);
+        return -1;
       }
+      if (args->wait_port > 0) {
+        print_error(ctx, "Only one of --wait-listen or --wait-free can be given");
+        return -1;
+      }
+
+      args->wait_port = port;
+      args->wait_free = strcmp(arg, "--wait-free") == 0;
+      if (args->mode == MODE_NONE) {
+        args->mode = MODE_WAIT;
+      }
+    } else if (strcmp(arg, "--check") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--check requires an argument");
+        return -1;
+      }
+      if (args->has_check) {
+        print_error(ctx, "--check can only be given once");
+        return -1;
+      }
+      if (check_parse(ctx, argv[++i], &args->check) < 0) {
+        return -1;
+      }
+
+      args->has_check = true;
+      if (args->mode == MODE_NONE) {
+        args->mode = MODE_CHECK;
+      }
+    } else if (strcmp(arg, "--ephemeral") == 0) {
+      args->ephemeral = true;
+      if (args->mode == MODE_NONE) {
+        args->mode = MODE_EPHEMERAL;
+      }
+    } else if (strcmp(arg, "--calibrate") == 0) {
+      args->calibrate = true;
+      if (args->mode == MODE_NONE) {
+        args->mode = MODE_CALIBRATE;
+      }
+    } else if (strcmp(arg, "--publish-shm") == 0 || strcmp(arg, "--from-shm") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "%s requires an argument", arg);
+        return -1;
+      }
+
+      if (strcmp(arg, "--from-shm") == 0) {
+        args->from_shm = argv[++i];
+      } else {
+        args->publish_name = argv[++i];
+        if (args->mode == MODE_NONE) {
+          args->mode = MODE_PUBLISH;
+        }
+      }
+    } else if (strcmp(arg, "--serve-stdio") == 0) {
+      args->serve_stdio = true;
+      if (args->mode == MODE_NONE) {
+        args->mode = MODE_SERVE;
+      }
+    } else if (strcmp(arg, "--timeout") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--timeout requires an argument");
+        return -1;
+      }
+
+      int timeout_ms;
+      if (parse_int(argv[++i], &timeout_ms) < 0 || timeout_ms < 0) {
+        print_error(ctx, "Invalid timeout: %s (expected milliseconds)", argv[i]);
+        return -1;
+      }
+
+      args->timeout_ms = timeout_ms;
+    } else if (strcmp(arg, "--interval") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--interval requires an argument");
+        return -1;
+      }
+
+      int interval;
+      if (parse_int(argv[++i], &interval) < 0 || interval < 1) {
+        print_error(ctx, "Invalid interval: %s (expected seconds)", argv[i]);
+        return -1;
+      }
+
+      args->interval = interval;
+    } else if (strcmp(arg, "--max-size") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--max-size requires an argument");
+        return -1;
+      }
+
+      int max_mb;
+      if (parse_int(argv[++i], &max_mb) < 0 || max_mb < 1) {
+        print_error(ctx, "Invalid size: %s (expected MiB)", argv[i]);
+        return -1;
+      }
+
+      args->max_mb = max_mb;
+    } else if (strcmp(arg, "--history") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--history requires an argument");
+        return -1;
+      }
+
+      int pid;
+      if (parse_int(argv[++i], &pid) < 0 || pid < 1) {
+        print_error(ctx, "Invalid PID: %s", argv[i]);
+        return -1;
+      }
+
+      args->history_pid = pid;
+    } else if (strcmp(arg, "--sort") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--sort requires an argument");
+        return -1;
+      }
+
+      args->sort_key = argv[++i];
     } else if (strcmp(arg, "--port") == 0 || strcmp(arg, "-p") == 0) {
       if (i + 1 >= argc) {
-        print_error("--port requires an argument");
+        print_error(ctx, "--port requires an argument");
         return -1;
       }
 
       int port;
       if (parse_int(argv[++i], &port) < 0) {
-        print_error("Invalid port number: %s", argv[i]);
+        print_error(ctx, "Invalid port number: %s", argv[i]);
         return -1;
       }
 
       if (port < 1 || port > 65535) {
-        print_error("Port must be between 1 and 65535");
+        print_error(ctx, "Port must be between 1 and 65535");
         return -1;
       }
 
@@ -187,18 +470,18 @@ int parse_args(const int argc, char **argv, cli_args_t *args) {
       }
     } else if (strcmp(arg, "--pid") == 0) {
       if (i + 1 >= argc) {
-        print_error("--pid requires an argument");
+        print_error(ctx, "--pid requires an argument");
         return -1;
       }
 
       int pid;
       if (parse_int(argv[++i], &pid) < 0) {
-        print_error("Invalid PID: %s", argv[i]);
+        print_error(ctx, "Invalid PID: %s", argv[i]);
         return -1;
       }
 
       if (pid < 1) {
-        print_error("PID must be positive");
+        print_error(ctx, "PID must be positive");
         return -1;
       }
 
@@ -212,6 +495,58 @@ int parse_args(const int argc, char **argv, cli_args_t *args) {
       args->show_tree = true;
     } else if (strcmp(arg, "--json") == 0 || strcmp(arg, "-j") == 0) {
       args->json_output = true;
+    } else if (strcmp(arg, "--format") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--format requires an argument");
+        return -1;
+      }
+
+      const char *format = argv[++i];
+      if (strcmp(format, "json") == 0) {
+        args->json_output = true;
+      } else if (strcmp(format, "csv") == 0) {
+        args->csv_output = true;
+      } else if (strcmp(format, "tsv") == 0) {
+        args->tsv_output = true;
+      } else if (strcmp(format, "cbor") == 0) {
+        args->cbor_output = true;
+      } else {
+        print_error(ctx, "Unknown format: %s (expected json, csv, tsv or cbor)", format);
+        return -1;
+      }
+    } else if (strcmp(arg, "--csv") == 0) {
+      args->csv_output = true;
+    } else if (strcmp(arg, "--tsv") == 0) {
+      args->tsv_output = true;
+    } else if (strcmp(arg, "--jobs") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--jobs requires an argument");
+        return -1;
+      }
+
+      int jobs;
+      if (parse_int(argv[++i], &jobs) < 0 || jobs < 1 || jobs > PIPELINE_MAX_JOBS) {
+        print_error(ctx, "Invalid job count: %s (expected 1-%d)", argv[i], PIPELINE_MAX_JOBS);
+        return -1;
+      }
+
+      args->jobs = jobs;
+    } else if (strcmp(arg, "--unordered") == 0) {
+      args->unordered = true;
+    } else if (strcmp(arg, "--tcp-info") == 0) {
+      args->tcp_info = true;
+    } else if (strcmp(arg, "--group-by") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--group-by requires an argument");
+        return -1;
+      }
+
+      args->group_by = group_by_parse(argv[++i]);
+      if (args->group_by == GROUP_BY_NONE) {
+        print_error(ctx, "Unknown --group-by key: %s (expected pid, state, remote or "
+                    "remote-subnet)", argv[i]);
+        return -1;
+      }
     } else if (strcmp(arg, "--warnings") == 0 || strcmp(arg, "-w") == 0) {
       args->warnings_only = true;
     } else if (strcmp(arg, "--no-color") == 0 || strcmp(arg, "-n") == 0) {
@@ -220,8 +555,36 @@ int parse_args(const int argc, char **argv, cli_args_t *args) {
       args->show_env = true;
     } else if (strcmp(arg, "--interactive") == 0 || strcmp(arg, "-i") == 0) {
       args->interactive = true;
+    } else if (strcmp(arg, "--grace") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--grace requires an argument");
+        return -1;
+      }
+
+      int grace_ms;
+      if (parse_int(argv[++i], &grace_ms) < 0 || grace_ms < 0) {
+        print_error(ctx, "Invalid grace period: %s (expected milliseconds)", argv[i]);
+        return -1;
+      }
+
+      args->grace_ms = grace_ms;
+    } else if (strcmp(arg, "--signal") == 0) {
+      if (i + 1 >= argc) {
+        print_error(ctx, "--signal requires an argument");
+        return -1;
+      }
+
+      const int sig = kill_parse_signal(argv[++i]);
+      if (sig < 0) {
+        print_error(ctx, "Unknown signal: %s", argv[i]);
+        return -1;
+      }
+
+      args->signal = sig;
+    } else if (strcmp(arg, "--subtree") == 0) {
+      args->subtree = true;
     } else {
-      print_error("Unknown option: %s", arg);
+      print_error(ctx, "Unknown option: %s", arg);
       return -1;
     }
   }
@@ -238,36 +601,145 @@ int parse_args(const int argc, char **argv, cli_args_t *args) {
  * valid but cannot be used together.
  *
  * Validation rules enforced:
- * - Mode requirement: Must specify --port, --pid, or --all (unless help/version)
+ * - Mode requirement: Must specify --port, --pid, --all or --by-user (unless
+ *   help/version)
  * - Mode exclusivity: Cannot combine --port and --pid together
  * - Mode exclusivity: Cannot combine --all with --port or --pid
+ * - Mode exclusivity: Cannot combine --by-user with --all, --port or --pid
+ * - Mode exclusivity: --record and --replay cannot be combined with each
+ *   other or with any other mode
  * - Output format limit: Cannot use multiple output formats simultaneously
- *   (--short, --json, --tree, --env are mutually exclusive)
+ *   (--short, --json, --csv, --tsv, --format are mutually exclusive)
+ * - View exclusivity: --tree and --env cannot be combined with each other
+ *   or with --short (they can be encoded as JSON or CBOR)
  * - Context validation: --env requires --pid mode
- * - Context validation: --tree requires --pid mode
+ * - Context validation: --tree requires --pid or --all mode
  * - Context validation: --warnings requires --port mode
+ * - Context validation: --tcp-info requires --port mode (not --signal)
+ * - Context validation: --group-by requires --port mode and replaces the
+ *   per-connection views (--warnings, --tcp-info, --signal, --interactive)
+ * - Context validation: --csv/--tsv require --all, --by-user, --port,
+ *   --replay or --ephemeral mode
+ * - Context validation: --jobs requires --all, --by-user, --port,
+ *   --serve-stdio or --publish-shm;
+ *   --unordered requires --jobs with --all (not --tree)
+ * - Context validation: --sort requires --by-user or --tree and a known
+ *   column of that view
+ * - Context validation: --from-shm requires --pid, --port or --all and
+ *   none of the views that read the live system (--env, --pid --tree,
+ *   --tcp-info, --group-by, --signal, --interactive, --jobs)
+ * - Context validation: --interval and --max-size require --record or
+ *   --publish-shm;
+ *   --history requires --replay
+ * - Compatibility: --record prints nothing, so takes no output format
+ * - Compatibility: --wait-listen/--wait-free are a mode of their own and
+ *   print text, --short or --json only; --timeout requires one of them
+ * - Compatibility: --check is a mode of its own and prints nothing, so
+ *   takes no output format or view
+ * - Compatibility: --ephemeral is a mode of its own
+ * - Compatibility: --calibrate is a mode of its own and prints text or
+ *   --json only
+ * - Compatibility: --serve-stdio is a mode of its own and answers in
+ *   NDJSON, so takes no output format or view
+ * - Compatibility: --publish-shm is a mode of its own and prints nothing,
+ *   so takes no output format
  * - Context validation: --interactive requires --pid or --port mode
- * - Compatibility: --interactive cannot be used with --json
+ * - Compatibility: --interactive cannot be used with --json, --csv, --tsv
+ *   or --format cbor
+ * - Context validation: --signal requires --pid or --port mode
+ * - Compatibility: --signal only prints its own summary (normal or --json)
+ *   and cannot be combined with --interactive or the other views
+ * - Context validation: --subtree requires --signal and --pid
+ * - Context validation: --grace requires --interactive or --signal
  *
+ * @param ctx Context errors are reported to
  * @param args Pointer to cli_args_t structure containing parsed arguments
  * @return 0 if arguments are valid and consistent, -1 if validation fails
  */
-int validate_args(const cli_args_t *args) {
+int validate_args(const wir_ctx_t *ctx, const cli_args_t *args) {
   /* Must have either --port, --pid, or --all (unless showing help) */
   if (args->mode == MODE_NONE) {
-    print_error("Must specify either --port, --pid, or --all");
+    print_error(ctx, "Must specify either --port, --pid, --all, --by-user, --record, "
+                "--replay, --wait-listen, --wait-free, --check, --ephemeral, "
+                "--calibrate, --serve-stdio or --publish-shm");
     return -1;
   }
 
   /* Can't have both --port and --pid */
   if (args->port != -1 && args->pid != -1) {
-    print_error("Cannot specify both --port and --pid");
+    print_error(ctx, "Cannot specify both --port and --pid");
     return -1;
   }
 
   /* Can't combine --all with --port or --pid */
   if (args->mode == MODE_ALL && (args->port != -1 || args->pid != -1)) {
-    print_error("Cannot combine --all with --port or --pid");
+    print_error(ctx, "Cannot combine --all with --port or --pid");
+    return -1;
+  }
+
+  /* --by-user is its own mode */
+  if (args->by_user && (args->mode != MODE_USERS || args->port != -1 || args->pid != -1)) {
+    print_error(ctx, "Cannot combine --by-user with --all, --port or --pid");
+    return -1;
+  }
+
+  /* --record/--replay are modes of their own */
+  if ((args->record_path && args->mode != MODE_RECORD) ||
+      (args->replay_path && args->mode != MODE_REPLAY) ||
+      ((args->record_path || args->replay_path) &&
+       (args->port != -1 || args->pid != -1 || args->by_user))) {
+    print_error(ctx, "Cannot combine --record or --replay with another mode");
+    return -1;
+  }
+
+  /* --wait-listen/--wait-free are a mode of their own */
+  if (args->wait_port > 0 &&
+      (args->mode != MODE_WAIT || args->port != -1 || args->pid != -1 || args->by_user ||
+       args->record_path || args->replay_path)) {
+    print_error(ctx, "Cannot combine --wait-listen or --wait-free with another mode");
+    return -1;
+  }
+
+  /* --check is a mode of its own */
+  if (args->has_check &&
+      (args->mode != MODE_CHECK || args->port != -1 || args->pid != -1 || args->by_user ||
+       args->record_path || args->replay_path || args->wait_port > 0)) {
+    print_error(ctx, "Cannot combine --check with another mode");
+    return -1;
+  }
+
+  /* --ephemeral is a mode of its own */
+  if (args->ephemeral &&
+      (args->mode != MODE_EPHEMERAL || args->port != -1 || args->pid != -1 || args->by_user ||
+       args->record_path || args->replay_path || args->wait_port > 0 || args->has_check)) {
+    print_error(ctx, "Cannot combine --ephemeral with another mode");
+    return -1;
+  }
+
+  /* --calibrate is a mode of its own */
+  if (args->calibrate &&
+      (args->mode != MODE_CALIBRATE || args->port != -1 || args->pid != -1 || args->by_user ||
+       args->record_path || args->replay_path || args->wait_port > 0 || args->has_check ||
+       args->ephemeral)) {
+    print_error(ctx, "Cannot combine --calibrate with another mode");
+    return -1;
+  }
+
+  /* --serve-stdio is a mode of its own */
+  if (args->serve_stdio &&
+      (args->mode != MODE_SERVE || args->port != -1 || args->pid != -1 || args->by_user ||
+       args->record_path || args->replay_path || args->wait_port > 0 || args->has_check ||
+       args->ephemeral || args->calibrate)) {
+    print_error(ctx, "Cannot combine --serve-stdio with another mode");
+    return -1;
+  }
+
+  /* --publish-shm is a mode of its own */
+  if (args->publish_name &&
+      (args->mode != MODE_PUBLISH || args->port != -1 || args->pid != -1 || args->by_user ||
+       args->record_path || args->replay_path || args->wait_port > 0 || args->has_check ||
+       args->ephemeral || args->calibrate || args->serve_stdio || args->from_shm)) {
+    print_error(ctx, "Cannot combine --publish-shm with another mode");
     return -1;
   }
 
@@ -277,46 +749,217 @@ int validate_args(const cli_args_t *args) {
     output_formats++;
   if (args->json_output)
     output_formats++;
-  if (args->show_tree)
+  if (args->csv_output)
+    output_formats++;
+  if (args->tsv_output)
     output_formats++;
-  if (args->show_env)
+  if (args->cbor_output)
     output_formats++;
 
   if (output_formats > 1) {
-    print_error("Cannot specify multiple output formats (--short, --json, "
-                "--tree, --env)");
+    print_error(ctx, "Cannot specify multiple output formats (--short, --json, "
+                "--csv, --tsv, --format)");
+    return -1;
+  }
+
+  /* --tree and --env select different results; --short has no form for them */
+  if (args->show_tree && args->show_env) {
+    print_error(ctx, "Cannot combine --tree and --env");
+    return -1;
+  }
+
+  if (args->short_output && (args->show_tree || args->show_env)) {
+    print_error(ctx, "--short cannot be combined with --tree or --env");
     return -1;
   }
 
   /* --env only makes sense with --pid */
   if (args->show_env && args->mode != MODE_PID) {
-    print_error("--env can only be used with --pid");
+    print_error(ctx, "--env can only be used with --pid");
     return -1;
   }
 
-  /* --tree only makes sense with --pid */
-  if (args->show_tree && args->mode != MODE_PID) {
-    print_error("--tree can only be used with --pid");
+  /* --tree shows one process's family (--pid) or every process (--all) */
+  if (args->show_tree && args->mode != MODE_PID && args->mode != MODE_ALL) {
+    print_error(ctx, "--tree can only be used with --pid or --all");
     return -1;
   }
 
   /* --warnings only make sense with --port */
   if (args->warnings_only && args->mode != MODE_PORT) {
-    print_error("--warnings can only be used with --port");
+    print_error(ctx, "--warnings can only be used with --port");
+    return -1;
+  }
+
+  /* --tcp-info extends the port report */
+  if (args->tcp_info && (args->mode != MODE_PORT || args->signal)) {
+    print_error(ctx, "--tcp-info can only be used with --port");
+    return -1;
+  }
+
+  /* --group-by replaces the per-connection port report */
+  if (args->group_by != GROUP_BY_NONE && args->mode != MODE_PORT) {
+    print_error(ctx, "--group-by can only be used with --port");
+    return -1;
+  }
+  if (args->group_by != GROUP_BY_NONE &&
+      (args->warnings_only || args->tcp_info || args->signal || args->interactive)) {
+    print_error(ctx, "--group-by cannot be combined with --warnings, --tcp-info, --signal "
+                "or --interactive");
+    return -1;
+  }
+
+  /* --csv/--tsv cover the list-shaped results */
+  if ((args->csv_output || args->tsv_output) && args->mode != MODE_ALL &&
+      args->mode != MODE_USERS && args->mode != MODE_PORT && args->mode != MODE_REPLAY &&
+      args->mode != MODE_EPHEMERAL) {
+    print_error(ctx, "--csv and --tsv can only be used with --all, --by-user, --port, "
+                "--replay or --ephemeral");
+    return -1;
+  }
+
+  /* Threaded scans exist for --all/--by-user (pipeline) and --port (socket owners) */
+  if (args->jobs > 0 && args->mode != MODE_ALL && args->mode != MODE_USERS &&
+      args->mode != MODE_PORT && args->mode != MODE_SERVE && args->mode != MODE_PUBLISH) {
+    print_error(ctx, "--jobs can only be used with --all, --by-user, --port, --serve-stdio or "
+                "--publish-shm");
+    return -1;
+  }
+  if (args->unordered && (args->jobs == 0 || args->mode != MODE_ALL || args->show_tree)) {
+    print_error(ctx, "--unordered can only be used with --all --jobs (not --tree)");
+    return -1;
+  }
+
+  /* A snapshot holds processes and sockets, not what the live-only views read */
+  if (args->from_shm && args->mode != MODE_PID && args->mode != MODE_PORT &&
+      args->mode != MODE_ALL) {
+    print_error(ctx, "--from-shm can only be used with --pid, --port or --all");
+    return -1;
+  }
+  if (args->from_shm && (args->show_env || (args->show_tree && args->mode == MODE_PID) ||
+                         args->tcp_info || args->group_by != GROUP_BY_NONE ||
+                         args->signal || args->interactive || args->jobs > 0)) {
+    print_error(ctx, "--from-shm cannot be combined with --env, --pid --tree, --tcp-info, "
+                "--group-by, --signal, --interactive or --jobs");
+    return -1;
+  }
+
+  /* Recorder settings, replay filter */
+  if ((args->interval > 0 || args->max_mb > 0) && args->mode != MODE_RECORD &&
+      args->mode != MODE_PUBLISH) {
+    print_error(ctx, "--interval and --max-size can only be used with --record or --publish-shm");
+    return -1;
+  }
+  if (args->history_pid > 0 && args->mode != MODE_REPLAY) {
+    print_error(ctx, "--history can only be used with --replay");
+    return -1;
+  }
+  if (args->mode == MODE_RECORD && output_formats > 0) {
+    print_error(ctx, "--record does not print results; output formats do not apply");
+    return -1;
+  }
+
+  /* Port waits report a single outcome */
+  if (args->mode == MODE_WAIT && args->cbor_output) {
+    print_error(ctx, "--wait-listen and --wait-free print text, --short or --json only");
+    return -1;
+  }
+  if (args->mode == MODE_CALIBRATE && output_formats > 0 && !args->json_output) {
+    print_error(ctx, "--calibrate prints text or --json only");
+    return -1;
+  }
+  if (args->mode == MODE_CHECK && output_formats > 0) {
+    print_error(ctx, "--check does not print results; output formats do not apply");
+    return -1;
+  }
+  if (args->mode == MODE_PUBLISH && output_formats > 0) {
+    print_error(ctx, "--publish-shm does not print results; output formats do not apply");
+    return -1;
+  }
+  if (args->mode == MODE_SERVE && output_formats > 0) {
+    print_error(ctx, "--serve-stdio answers in NDJSON; output formats do not apply");
+    return -1;
+  }
+  if (args->timeout_ms >= 0 && args->mode != MODE_WAIT) {
+    print_error(ctx, "--timeout can only be used with --wait-listen or --wait-free");
+    return -1;
+  }
+
+  /* --sort orders the per-user summary, or the siblings of a tree */
+  if (args->sort_key && args->mode != MODE_USERS && !args->show_tree) {
+    print_error(ctx, "--sort can only be used with --by-user or --tree");
+    return -1;
+  }
+  if (args->sort_key && args->mode == MODE_USERS && usage_sort_field(args->sort_key) < 0) {
+    print_error(ctx, "Unknown sort column: %s (expected user, uid, procs, zombies, "
+                "sockets, vsz or rss)", args->sort_key);
+    return -1;
+  }
+  if (args->sort_key && args->show_tree && forest_sort_field(args->sort_key) < 0) {
+    print_error(ctx, "Unknown sort column: %s (expected pid, name, descendants, subtree-rss, "
+                "subtree-vsz, subtree-sockets, rss, vsz or sockets)", args->sort_key);
     return -1;
   }
 
   /* --interactive only makes sense with --pid or --port */
   if (args->interactive && args->mode != MODE_PID && args->mode != MODE_PORT) {
-    print_error("--interactive can only be used with --pid or --port");
+    print_error(ctx, "--interactive can only be used with --pid or --port");
     return -1;
   }
 
-  /* --interactive doesn't work with JSON output */
+  /* --interactive doesn't work with machine-readable output */
   if (args->interactive && args->json_output) {
-    print_error("--interactive cannot be used with --json");
+    print_error(ctx, "--interactive cannot be used with --json");
+    return -1;
+  }
+  if (args->interactive && (args->csv_output || args->tsv_output ||
+                            args->cbor_output)) {
+    print_error(ctx, "--interactive cannot be used with --csv, --tsv or --format cbor");
+    return -1;
+  }
+
+  /* --signal replaces the normal report with a per-PID outcome summary */
+  if (args->signal && args->mode != MODE_PID && args->mode != MODE_PORT) {
+    print_error(ctx, "--signal can only be used with --pid or --port");
+    return -1;
+  }
+  if (args->signal && (args->interactive || args->show_tree || args->show_env ||
+                       args->warnings_only || args->short_output ||
+                       args->csv_output || args->tsv_output || args->cbor_output)) {
+    print_error(ctx, "--signal can only be combined with --json");
+    return -1;
+  }
+
+  if (args->subtree && (!args->signal || args->mode != MODE_PID)) {
+    print_error(ctx, "--subtree can only be used with --signal and --pid");
+    return -1;
+  }
+
+  /* --grace only affects kills */
+  if (args->grace_ms >= 0 && !args->interactive && !args->signal) {
+    print_error(ctx, "--grace can only be used with --interactive or --signal");
     return -1;
   }
 
   return 0;
 }
+
+/**
+ * Resolve the SIGTERM grace period for kills
+ *
+ * @param args Pointer to parsed arguments
+ * @return The --grace value, or KILL_DEFAULT_GRACE_MS when not given
+ */
+int args_grace_ms(const cli_args_t *args) {
+  return args->grace_ms >= 0 ? args->grace_ms : KILL_DEFAULT_GRACE_MS;
+}
+
+/**
+ * Resolve the --wait-listen/--wait-free timeout
+ *
+ * @param args Pointer to parsed arguments
+ * @return The --timeout value, or WAIT_DEFAULT_TIMEOUT_MS when not given
+ */
+int args_timeout_ms(const cli_args_t *args) {
+  return args->timeout_ms >= 0 ? args->timeout_ms : WAIT_DEFAULT_TIMEOUT_MS;
+}
@@ -1,9 +1,14 @@
 #ifndef ARGS_H
 #define ARGS_H
 
+#include "check.h"
+#include "group.h"
 #include <stdbool.h>
 #include <sys/types.h>
 
+/* Default --timeout for --wait-listen/--wait-free, in milliseconds */
+#define WAIT_DEFAULT_TIMEOUT_MS 30000
+
 /**
  * Operation mode enumeration - defines what operation the user wants to perform
  *
@@ -15,6 +20,15 @@
  * - MODE_PORT: Inspect network connections on a specific port (--port)
  * - MODE_PID: Inspect a specific process by PID (--pid)
  * - MODE_ALL: List all running processes (--all)
+ * - MODE_USERS: Summarise processes per user (--by-user)
+ * - MODE_RECORD: Sample the process table into a ring file (--record)
+ * - MODE_REPLAY: Read samples back from a ring file (--replay)
+ * - MODE_WAIT: Block until a port is bound or free (--wait-listen, --wait-free)
+ * - MODE_CHECK: Test a port condition, exit status only (--check)
+ * - MODE_EPHEMERAL: Ephemeral port exhaustion analysis (--ephemeral)
+ * - MODE_CALIBRATE: Time the socket backends and save the fastest (--calibrate)
+ * - MODE_SERVE: Answer NDJSON queries read from stdin (--serve-stdio)
+ * - MODE_PUBLISH: Keep a snapshot in shared memory (--publish-shm)
  * - MODE_HELP: Display help/usage information (--help)
  * - MODE_VERSION: Display version information (--version)
  */
@@ -23,6 +37,15 @@ typedef enum {
     MODE_PORT,      /* Inspect a port */
     MODE_PID,       /* Inspect a PID */
     MODE_ALL,       /* List all processes */
+    MODE_USERS,     /* Per-user summary */
+    MODE_RECORD,    /* Record samples */
+    MODE_REPLAY,    /* Replay samples */
+    MODE_WAIT,      /* Wait for a port */
+    MODE_CHECK,     /* Probe a port condition */
+    MODE_EPHEMERAL, /* Ephemeral port use */
+    MODE_CALIBRATE, /* Time socket backends */
+    MODE_SERVE,     /* Query server on stdio */
+    MODE_PUBLISH,   /* Publish snapshots */
     MODE_HELP,      /* Show help */
     MODE_VERSION    /* Show version */
 } operation_mode_t;
@@ -32,21 +55,55 @@ typedef enum {
  *
  * Contains all parsed and validated command-line arguments. Populated by
  * parse_args() and validated by validate_args(). Used throughout the
- * application to determine behavior and output formatting.
+ * application to determine behavior and output formatting. Library callers
+ * only see it as the opaque wir_args_t of src/wir.h (see wir_args_parse()).
  *
  * Fields:
  * - mode: Primary operation mode (port/pid/all/help/version)
  * - port: Target port number (valid when mode == MODE_PORT)
  * - pid: Target process ID (valid when mode == MODE_PID)
  * - short_output: Enable one-line output format
- * - show_tree: Display process ancestry tree
+ * - show_tree: Display process ancestry and descendants (--pid) or the whole
+ *   process forest (--all), with subtree totals
  * - json_output: Output in JSON format
+ * - csv_output: Output as comma-separated values with a header row
+ * - tsv_output: Output as tab-separated values with a header row
+ * - cbor_output: Output as CBOR (binary, same schema as JSON)
  * - warnings_only: Show only security warnings (port mode only)
+ * - tcp_info: Report TCP internals per connection (port mode only)
+ * - group_by: Count the port's connections per group instead of listing
+ *   them (port mode only, GROUP_BY_NONE = list)
  * - no_color: Disable colored output
  * - show_env: Display environment variables (pid mode only)
  * - interactive: Enable interactive mode with kill prompt
+ * - grace_ms: Milliseconds to wait after SIGTERM before SIGKILL (-1 = default)
+ * - signal: Signal to send to every owner of the port or the PID (0 = none)
+ * - subtree: With --signal and --pid, also signal every descendant of the PID
+ * - jobs: Scanner threads for the pipelined --all scan (0 = sequential scan)
+ * - unordered: Emit pipelined --all rows as they complete instead of in PID order
+ * - by_user: --by-user was given (detects clashes with the other modes)
+ * - sort_key: Column to order the --by-user summary, or --tree siblings, by
+ *   (NULL = default)
+ * - record_path: Ring file to record into (valid when mode == MODE_RECORD)
+ * - replay_path: Ring file to read (valid when mode == MODE_REPLAY)
+ * - interval: Seconds between samples when recording or publishing (0 = default)
+ * - max_mb: Size of a new ring file or shared-memory segment in MiB (0 = default)
+ * - history_pid: Only replay samples of this PID (0 = all)
+ * - wait_port: Port to wait on (valid when mode == MODE_WAIT)
+ * - wait_free: Wait for the port to be released rather than bound
+ * - timeout_ms: Give up waiting after this many milliseconds (-1 = default,
+ *   0 = never)
+ * - has_check: --check was given
+ * - check: Parsed --check condition (valid when has_check)
+ * - ephemeral: --ephemeral was given (detects clashes with the other modes)
+ * - calibrate: --calibrate was given (detects clashes with the other modes)
+ * - serve_stdio: --serve-stdio was given (detects clashes with the other modes)
+ * - publish_name: Shared-memory segment to publish into (valid when
+ *   mode == MODE_PUBLISH)
+ * - from_shm: Shared-memory segment to answer --pid, --port or --all from
+ *   (NULL = query the system)
  */
-typedef struct {
+typedef struct wir_args {
     operation_mode_t mode;
 
     /* Target values */
@@ -57,10 +114,37 @@ typedef struct {
     bool short_output;  /* --short */
     bool show_tree;     /* --tree */
     bool json_output;   /* --json */
+    bool csv_output;    /* --csv */
+    bool tsv_output;    /* --tsv */
+    bool cbor_output;   /* --format cbor */
     bool warnings_only; /* --warnings */
+    bool tcp_info;      /* --tcp-info */
+    group_by_t group_by; /* --group-by <key> */
     bool no_color;      /* --no-color */
     bool show_env;      /* --env */
     bool interactive;   /* --interactive */
+    int grace_ms;       /* --grace <ms> */
+    int signal;         /* --signal <sig> */
+    bool subtree;       /* --subtree */
+    int jobs;           /* --jobs <n> */
+    bool unordered;     /* --unordered */
+    bool by_user;       /* --by-user */
+    const char *sort_key; /* --sort <column> */
+    const char *record_path; /* --record <file> */
+    const char *replay_path; /* --replay <file> */
+    int interval;       /* --interval <sec> */
+    int max_mb;         /* --max-size <MiB> */
+    pid_t history_pid;  /* --history <pid> */
+    int wait_port;      /* --wait-listen <n> / --wait-free <n> */
+    bool wait_free;     /* --wait-free */
+    int timeout_ms;     /* --timeout <ms> */
+    bool has_check;     /* --check */
+    port_check_t check; /* --check <cond> */
+    bool ephemeral;     /* --ephemeral */
+    bool calibrate;     /* --calibrate */
+    bool serve_stdio;   /* --serve-stdio */
+    const char *publish_name; /* --publish-shm <name> */
+    const char *from_shm; /* --from-shm <name> */
 } cli_args_t;
 
 /**
@@ -68,12 +152,13 @@ typedef struct {
  *
  * See src/args.c for detailed documentation.
  *
+ * @param ctx Context errors are reported to
  * @param argc Argument count from main()
  * @param argv Argument vector from main()
  * @param args Pointer to cli_args_t structure to populate
  * @return 0 on success, -1 on error (invalid argument, missing value, or parse failure)
  */
-int parse_args(int argc, char **argv, cli_args_t *args);
+int parse_args(const wir_ctx_t *ctx, int argc, char **argv, cli_args_t *args);
 
 /**
  * Print usage/help message to standard output
@@ -99,9 +184,30 @@ void print_version(void);
  *
  * See src/args.c for detailed documentation.
  *
+ * @param ctx Context errors are reported to
  * @param args Pointer to cli_args_t structure containing parsed arguments
  * @return 0 if arguments are valid and consistent, -1 if validation fails
  */
-int validate_args(const cli_args_t *args);
+int validate_args(const wir_ctx_t *ctx, const cli_args_t *args);
+
+/**
+ * Resolve the SIGTERM grace period for kills
+ *
+ * See src/args.c for detailed documentation.
+ *
+ * @param args Pointer to parsed arguments
+ * @return Grace period in milliseconds
+ */
+int args_grace_ms(const cli_args_t *args);
+
+/**
+ * Resolve the --wait-listen/--wait-free timeout
+ *
+ * See src/args.c for detailed documentation.
+ *
+ * @param args Pointer to parsed arguments
+ * @return Timeout in milliseconds (0 = wait forever)
+ */
+int args_timeout_ms(const cli_args_t *args);
 
 #endif /* ARGS_H */
@@ -0,0 +1,640 @@
+#include "backend.h"
+#include "utils.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Timed runs per backend and operation; the fastest one counts */
+#define CALIBRATE_RUNS 5
+
+/* Port the port operations are timed on: rarely bound, so nothing cuts a walk short */
+#define CALIBRATE_PORT 1
+
+/* First line of the state file */
+#define STATE_HEADER "# wir socket backends, written by wir --calibrate"
+
+/* Operation names (state file, --calibrate), indexed by backend_op_t */
+static const char *const op_names[] = {
+    [BACKEND_OP_PORT_PROBE] = "port-probe",
+    [BACKEND_OP_PORT_SCAN] = "port-scan",
+    [BACKEND_OP_TABLE_WALK] = "table-walk",
+};
+
+#ifdef __linux__
+
+/**
+ * Dump sockets through NETLINK_SOCK_DIAG (netlink backend)
+ *
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param low Lowest local port to report (0 = any)
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if sock_diag is unavailable
+ */
+static int netlink_dump(int family, int protocol, unsigned int states, int low, int high,
+                        sockdiag_fn fn, void *ctx) {
+    return sockdiag_dump_range(family, protocol, states, 0, low, high, fn, ctx);
+}
+
+/**
+ * sock_diag callback that ignores the socket (capability probe)
+ */
+static bool ignore_socket(void *ctx, const sockdiag_socket_t *sock) {
+    (void)ctx;
+    (void)sock;
+    return false;
+}
+
+/**
+ * Test whether sock_diag answers (TCP and UDP diag modules loaded, allowed)
+ *
+ * @return true if both protocols can be dumped
+ */
+static bool netlink_probe(void) {
+    return sockdiag_dump_range(AF_INET, IPPROTO_TCP, SOCKDIAG_STATE(SOCKDIAG_LISTEN), 0,
+                               CALIBRATE_PORT, CALIBRATE_PORT, ignore_socket, NULL) == 0 &&
+           sockdiag_dump_range(AF_INET, IPPROTO_UDP, SOCKDIAG_ALL_STATES, 0,
+                               CALIBRATE_PORT, CALIBRATE_PORT, ignore_socket, NULL) == 0;
+}
+
+/**
+ * Decode a /proc/net address column into network-order bytes
+ *
+ * The kernel prints each 32-bit word of the address as hex in host byte
+ * order, so storing the words back as native integers restores the bytes.
+ *
+ * @param hex Address column (8 hex digits for IPv4, 32 for IPv6)
+ * @param addr Output: 16 bytes, of which 4 are used for IPv4
+ * @return void
+ */
+void backend_procfs_addr(const char *hex, uint8_t addr[16]) {
+    memset(addr, 0, 16);
+
+    const size_t words = strlen(hex) / 8;
+    for (size_t w = 0; w < words && w < 4; w++) {
+        char word_hex[9];
+        memcpy(word_hex, hex + w * 8, 8);
+        word_hex[8] = '\0';
+
+        const uint32_t word = (uint32_t)strtoul(word_hex, NULL, 16);
+        memcpy(addr + w * 4, &word, sizeof(word));
+    }
+}
+
+/**
+ * Dump sockets by parsing /proc/net/{tcp,tcp6,udp,udp6} (procfs backend)
+ *
+ * Every row is read; the port and state are checked first so rows that do
+ * not match are never fully parsed. The queue columns become rqueue and
+ * wqueue; a listener's backlog is not in the table (wqueue is 0).
+ *
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param low Lowest local port to report (0 = any)
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if the table cannot be read
+ */
+static int procfs_dump(int family, int protocol, unsigned int states, int low, int high,
+                       sockdiag_fn fn, void *ctx) {
+    const bool udp = protocol == IPPROTO_UDP;
+    const bool v6 = family == AF_INET6;
+    char filename[32];
+    snprintf(filename, sizeof(filename), "/proc/net/%s%s", udp ? "udp" : "tcp", v6 ? "6" : "");
+
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    char line[512];
+    /* Skip header line */
+    if (!fgets(line, sizeof(line), fp)) {
+        fclose(fp);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        int local_port, state;
+        if (sscanf(line, "%*d: %*[0-9A-Fa-f]:%x %*[0-9A-Fa-f]:%*x %x", &local_port,
+                   &state) != 2 ||
+            !(states & SOCKDIAG_STATE(state)) ||
+            (low > 0 && (local_port < low || local_port > high))) {
+            continue;
+        }
+
+        char local_hex[33], remote_hex[33];
+        sockdiag_socket_t sock;
+        memset(&sock, 0, sizeof(sock));
+        if (sscanf(line, "%*d: %32[0-9A-Fa-f]:%*x %32[0-9A-Fa-f]:%x %*x %x:%x %*x:%*x %*x %u %*d %lu",
+                   local_hex, remote_hex, &sock.remote_port, &sock.wqueue, &sock.rqueue,
+                   &sock.uid, &sock.inode) != 7) {
+            continue;
+        }
+
+        sock.family = family;
+        sock.protocol = protocol;
+        sock.state = state;
+        sock.local_port = local_port;
+        backend_procfs_addr(local_hex, sock.local_addr);
+        backend_procfs_addr(remote_hex, sock.remote_addr);
+
+        if (!fn(ctx, &sock)) {
+            break;
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Test whether the /proc/net tables can be read
+ *
+ * @return true if /proc/net/tcp is readable
+ */
+static bool procfs_probe(void) {
+    return access("/proc/net/tcp", R_OK) == 0;
+}
+
+/* Registered backends, in fallback order */
+static const socket_backend_t backends[] = {
+    { "netlink", "NETLINK_SOCK_DIAG dumps, port and state filtered in the kernel",
+      true, netlink_probe, netlink_dump },
+    { "procfs", "/proc/net/{tcp,tcp6,udp,udp6} text tables",
+      false, procfs_probe, procfs_dump },
+};
+#define BACKEND_COUNT ((int)(sizeof(backends) / sizeof(backends[0])))
+
+/* Backend each operation uses until --calibrate says otherwise */
+static const char *const default_backends[] = {
+    [BACKEND_OP_PORT_PROBE] = "netlink",
+    [BACKEND_OP_PORT_SCAN] = "procfs",
+    [BACKEND_OP_TABLE_WALK] = "netlink",
+};
+
+#else
+
+/* No alternative socket sources: the platform layer reads them one way (lsof) */
+static const socket_backend_t backends[1];
+#define BACKEND_COUNT 0
+
+static const char *const default_backends[BACKEND_OP_COUNT];
+
+#endif
+
+/**
+ * Backend selection, made once per process
+ *
+ * Fields:
+ * - once: Guards the probes and the default choices
+ * - state_once: Guards the state file read (see backend_load_state())
+ * - available: Probe result per registered backend
+ * - chosen: Backend per operation (NULL if none is available)
+ */
+static struct {
+    pthread_once_t once;
+    pthread_once_t state_once;
+    bool available[BACKEND_MAX];
+    const socket_backend_t *chosen[BACKEND_OP_COUNT];
+} selection = { PTHREAD_ONCE_INIT, PTHREAD_ONCE_INIT, { false }, { NULL } };
+
+/**
+ * Number of backends registered on this platform
+ *
+ * @return Backend count (0 where the platform has a single hard-wired source)
+ */
+int backend_count(void) {
+    return BACKEND_COUNT;
+}
+
+/**
+ * Get a registered backend
+ *
+ * @param index 0 to backend_count() - 1
+ * @return Backend
+ */
+const socket_backend_t *backend_get(int index) {
+    return &backends[index];
+}
+
+/**
+ * Name an operation as written in the state file
+ *
+ * @param op Operation
+ * @return Name (e.g. "port-probe")
+ */
+const char *backend_op_name(backend_op_t op) {
+    return op_names[op];
+}
+
+/**
+ * Find an available backend by name
+ *
+ * @param name Backend name
+ * @return Backend, or NULL if there is none by that name or it did not probe
+ */
+static const socket_backend_t *find_available(const char *name) {
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (selection.available[i] && strcmp(backends[i].name, name) == 0) {
+            return &backends[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Identify the running kernel, which a calibration is only valid for
+ *
+ * @param kernel Output buffer
+ * @param size Size of kernel
+ * @return void
+ */
+static void kernel_release(char *kernel, size_t size) {
+    struct utsname uts;
+    snprintf(kernel, size, "%s", uname(&uts) == 0 ? uts.release : "unknown");
+}
+
+/**
+ * Apply the choices of the state file, if it was written on this kernel
+ *
+ * Lines are "kernel <release>" and "<operation> <backend>"; anything else
+ * is ignored, as are choices naming a backend that did not probe.
+ *
+ * @return void
+ */
+static void load_state_file(void) {
+    char path[512];
+    if (backend_state_path(path, sizeof(path)) < 0) {
+        return;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return;
+    }
+
+    char kernel[128];
+    kernel_release(kernel, sizeof(kernel));
+
+    const socket_backend_t *chosen[BACKEND_OP_COUNT] = { NULL };
+    bool same_kernel = false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        char key[64], value[128];
+        if (sscanf(line, "%63s %127s", key, value) != 2 || key[0] == '#') {
+            continue;
+        }
+        if (strcmp(key, "kernel") == 0) {
+            same_kernel = strcmp(value, kernel) == 0;
+            continue;
+        }
+        for (int op = 0; op < BACKEND_OP_COUNT; op++) {
+            if (strcmp(key, op_names[op]) == 0) {
+                chosen[op] = find_available(value);
+            }
+        }
+    }
+    fclose(fp);
+
+    if (!same_kernel) {
+        return;
+    }
+    for (int op = 0; op < BACKEND_OP_COUNT; op++) {
+        if (chosen[op]) {
+            selection.chosen[op] = chosen[op];
+        }
+    }
+}
+
+/**
+ * Probe the backends and pick the default one per operation (pthread_once routine)
+ *
+ * @return void
+ */
+static void select_backends(void) {
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        selection.available[i] = backends[i].probe();
+    }
+
+    for (int op = 0; op < BACKEND_OP_COUNT; op++) {
+        selection.chosen[op] = default_backends[op] ? find_available(default_backends[op])
+                                                    : NULL;
+        for (int i = 0; i < BACKEND_COUNT && !selection.chosen[op]; i++) {
+            if (selection.available[i]) {
+                selection.chosen[op] = &backends[i];
+            }
+        }
+    }
+}
+
+/**
+ * Use the backends --calibrate saved for this host
+ *
+ * Off by default: a process embedding libwir keeps default_backends[] and
+ * never reads the user's state file on its own; the wir command turns it
+ * on before its first query. The file is read once per process and a
+ * calibration from another kernel is ignored. Call before the first socket
+ * query so that every query sees the same choice.
+ *
+ * @return void
+ */
+void backend_load_state(void) {
+    pthread_once(&selection.once, select_backends);
+    pthread_once(&selection.state_once, load_state_file);
+}
+
+/**
+ * Get the backend an operation uses
+ *
+ * The backends are probed on the first call in the process; the choice
+ * holds from then on (see backend_load_state() for calibrated choices).
+ *
+ * @param op Operation
+ * @return Backend, or NULL if none works on this host
+ */
+const socket_backend_t *backend_for(backend_op_t op) {
+    pthread_once(&selection.once, select_backends);
+    return selection.chosen[op];
+}
+
+/**
+ * Dump in progress for backend_dump(): remembers whether any socket was delivered
+ */
+typedef struct {
+    sockdiag_fn fn;
+    void *ctx;
+    bool delivered;
+} backend_dump_t;
+
+/**
+ * Forward one socket to the caller's callback
+ */
+static bool forward_socket(void *ctx, const sockdiag_socket_t *sock) {
+    backend_dump_t *dump = ctx;
+    dump->delivered = true;
+    return dump->fn(dump->ctx, sock);
+}
+
+/**
+ * Dump sockets through the backend chosen for an operation
+ *
+ * If that backend fails before delivering any socket, the other available
+ * backends are tried in registry order, so a choice that stops working
+ * (e.g. a diag module unloaded since calibration) degrades to the next
+ * source rather than to an error.
+ *
+ * @param op Operation the dump serves
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param low Lowest local port to report (0 = any)
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket; returning false ends the dump
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if no backend could be read
+ */
+int backend_dump(backend_op_t op, int family, int protocol, unsigned int states, int low,
+                 int high, sockdiag_fn fn, void *ctx) {
+    const socket_backend_t *chosen = backend_for(op);
+    if (!chosen) {
+        return -1;
+    }
+
+    backend_dump_t dump = { fn, ctx, false };
+    if (chosen->dump(family, protocol, states, low, high, forward_socket, &dump) == 0) {
+        return 0;
+    }
+    if (dump.delivered) {
+        return -1;
+    }
+
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (selection.available[i] && &backends[i] != chosen &&
+            backends[i].dump(family, protocol, states, low, high, fn, ctx) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Count sockets during a timed run
+ */
+static bool count_socket(void *ctx, const sockdiag_socket_t *sock) {
+    (void)sock;
+    (*(long *)ctx)++;
+    return true;
+}
+
+/**
+ * Stop at the first socket during a timed probe
+ */
+static bool stop_at_socket(void *ctx, const sockdiag_socket_t *sock) {
+    (void)sock;
+    *(bool *)ctx = true;
+    return false;
+}
+
+/**
+ * Run the workload of one operation once on one backend
+ *
+ * Each workload is what the operation's callers ask for: TCP listeners and
+ * UDP sockets on one port up to the first match (port-probe), every socket
+ * on one port (port-scan), every socket (table-walk).
+ *
+ * @param backend Backend to run on
+ * @param op Operation to run
+ * @return void
+ */
+static void run_workload(const socket_backend_t *backend, backend_op_t op) {
+    static const struct {
+        int family;
+        int protocol;
+    } tables[] = {
+        {AF_INET, IPPROTO_TCP}, {AF_INET6, IPPROTO_TCP},
+        {AF_INET, IPPROTO_UDP}, {AF_INET6, IPPROTO_UDP},
+    };
+    long sockets = 0;
+    bool found = false;
+
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        const bool tcp = tables[t].protocol == IPPROTO_TCP;
+        switch (op) {
+            case BACKEND_OP_PORT_PROBE:
+                if (!found) {
+                    backend->dump(tables[t].family, tables[t].protocol,
+                                  tcp ? SOCKDIAG_STATE(SOCKDIAG_LISTEN) : SOCKDIAG_ALL_STATES,
+                                  CALIBRATE_PORT, CALIBRATE_PORT, stop_at_socket, &found);
+                }
+                break;
+            case BACKEND_OP_PORT_SCAN:
+                backend->dump(tables[t].family, tables[t].protocol, SOCKDIAG_ALL_STATES,
+                              CALIBRATE_PORT, CALIBRATE_PORT, count_socket, &sockets);
+                break;
+            case BACKEND_OP_TABLE_WALK:
+            case BACKEND_OP_COUNT:
+                backend->dump(tables[t].family, tables[t].protocol, SOCKDIAG_ALL_STATES,
+                              0, 0, count_socket, &sockets);
+                break;
+        }
+    }
+}
+
+/**
+ * Time every available backend on every operation
+ *
+ * Each workload runs CALIBRATE_RUNS times per backend and the fastest run
+ * counts, which filters out the first run's cold caches and scheduler noise.
+ * The fastest backend of each operation is marked chosen. Backends that
+ * did not probe are listed as unavailable.
+ *
+ * @param timings Output rows, one per operation and backend
+ * @param max Capacity of timings
+ * @return Number of rows written
+ */
+int backend_calibrate(backend_timing_t *timings, int max) {
+    pthread_once(&selection.once, select_backends);
+
+    int n = 0;
+    for (int op = 0; op < BACKEND_OP_COUNT; op++) {
+        backend_timing_t *fastest = NULL;
+
+        for (int i = 0; i < BACKEND_COUNT && n < max; i++) {
+            backend_timing_t *t = &timings[n++];
+            memset(t, 0, sizeof(*t));
+            t->op = (backend_op_t)op;
+            t->backend = &backends[i];
+            t->available = selection.available[i];
+            if (!t->available) {
+                continue;
+            }
+
+            for (int run = 0; run < CALIBRATE_RUNS; run++) {
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                run_workload(&backends[i], (backend_op_t)op);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                const long usec = (end.tv_sec - start.tv_sec) * 1000000L +
+                                  (end.tv_nsec - start.tv_nsec) / 1000;
+                if (run == 0 || usec < t->usec) {
+                    t->usec = usec;
+                }
+            }
+
+            if (!fastest || t->usec < fastest->usec) {
+                fastest = t;
+            }
+        }
+
+        if (fastest) {
+            fastest->chosen = true;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Path of the state file holding the calibrated choices
+ *
+ * $XDG_STATE_HOME/wir/backends, or ~/.local/state/wir/backends.
+ *
+ * @param path Output buffer
+ * @param size Size of path
+ * @return 0 on success, -1 if neither XDG_STATE_HOME nor HOME is set
+ */
+int backend_state_path(char *path, size_t size) {
+    const char *state_home = getenv("XDG_STATE_HOME");
+    const char *home = getenv("HOME");
+
+    if (state_home && state_home[0]) {
+        snprintf(path, size, "%s/wir/backends", state_home);
+    } else if (home && home[0]) {
+        snprintf(path, size, "%s/.local/state/wir/backends", home);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Create every missing directory above a file
+ *
+ * @param path File path
+ * @return 0 on success, -1 on error (errno set)
+ */
+static int make_parent_dirs(const char *path) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", path);
+
+    for (char *slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+            return -1;
+        }
+        *slash = '/';
+    }
+    return 0;
+}
+
+/**
+ * Write the chosen backends to the state file
+ *
+ * The file is written next to its final name and renamed into place, so a
+ * process starting meanwhile reads either the old choices or the new ones.
+ *
+ * @param ctx Context errors are reported to
+ * @param timings Rows from backend_calibrate()
+ * @param count Number of rows
+ * @param path State file (see backend_state_path())
+ * @return 0 on success, -1 on error (message printed)
+ */
+int backend_save(const wir_ctx_t *ctx, const backend_timing_t *timings, int count,
+                 const char *path) {
+    if (make_parent_dirs(path) < 0) {
+        print_error(ctx, "Cannot create the directory for %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        print_error(ctx, "Cannot write %s: %s", tmp, strerror(errno));
+        return -1;
+    }
+
+    char kernel[128];
+    kernel_release(kernel, sizeof(kernel));
+    fprintf(fp, "%s\n", STATE_HEADER);
+    fprintf(fp, "kernel %s\n", kernel);
+    for (int i = 0; i < count; i++) {
+        if (timings[i].chosen) {
+            fprintf(fp, "%s %s\n", op_names[timings[i].op], timings[i].backend->name);
+        }
+    }
+
+    if (fclose(fp) != 0 || rename(tmp, path) < 0) {
+        print_error(ctx, "Cannot write %s: %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
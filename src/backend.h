@@ -0,0 +1,102 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sockdiag.h"
+
+/* Context errors are reported to (see src/context.h) */
+typedef struct wir_ctx wir_ctx_t;
+
+/* Most socket table backends a platform registers */
+#define BACKEND_MAX 4
+
+/**
+ * Socket table operations, each with its own backend choice
+ *
+ * Backends differ in how their cost grows with what is asked: sock_diag
+ * filters by port and state in the kernel, /proc/net always formats every
+ * socket as text. Which one wins depends on the question and on the host,
+ * so the choice is made per operation.
+ */
+typedef enum {
+    BACKEND_OP_PORT_PROBE = 0, /* Yes/no questions about one port (--check, --wait-*) */
+    BACKEND_OP_PORT_SCAN,      /* Every socket on one port (--port) */
+    BACKEND_OP_TABLE_WALK,     /* Every socket (--by-user, --ephemeral) */
+    BACKEND_OP_COUNT
+} backend_op_t;
+
+/**
+ * A source of socket tables
+ *
+ * Every backend delivers sockets as sockdiag_socket_t records, so callers
+ * are written once for all of them.
+ *
+ * Fields:
+ * - name: Name used in the state file and by --calibrate
+ * - description: One-line description for --calibrate
+ * - listen_backlog: wqueue of a listener is its backlog (otherwise 0)
+ * - probe: Test whether the backend works on this host
+ * - dump: Report the sockets of one family and protocol in the given
+ *   states whose local port is in low..high (low 0 = any port); returns
+ *   0 on success, -1 if the backend cannot be read. No extension
+ *   attributes (tcp_info, meminfo) are delivered.
+ */
+typedef struct {
+    const char *name;
+    const char *description;
+    bool listen_backlog;
+    bool (*probe)(void);
+    int (*dump)(int family, int protocol, unsigned int states, int low, int high,
+                sockdiag_fn fn, void *ctx);
+} socket_backend_t;
+
+/**
+ * Timing of one backend for one operation, as measured by --calibrate
+ *
+ * Fields:
+ * - op: Operation timed
+ * - backend: Backend timed
+ * - available: The backend probed as working (usec is 0 otherwise)
+ * - usec: Fastest of the timed runs, in microseconds
+ * - chosen: The backend is now the choice for the operation
+ */
+typedef struct {
+    backend_op_t op;
+    const socket_backend_t *backend;
+    bool available;
+    long usec;
+    bool chosen;
+} backend_timing_t;
+
+/**
+ * Backend registry functions
+ *
+ * See src/backend.c for detailed documentation of each function.
+ */
+int backend_count(void);
+const socket_backend_t *backend_get(int index);
+const char *backend_op_name(backend_op_t op);
+const socket_backend_t *backend_for(backend_op_t op);
+void backend_load_state(void);
+int backend_dump(backend_op_t op, int family, int protocol, unsigned int states, int low,
+                 int high, sockdiag_fn fn, void *ctx);
+int backend_calibrate(backend_timing_t *timings, int max);
+int backend_state_path(char *path, size_t size);
+int backend_save(const wir_ctx_t *ctx, const backend_timing_t *timings, int count,
+                 const char *path);
+
+#ifdef __linux__
+/**
+ * Decode a /proc/net address column into network-order bytes
+ *
+ * See src/backend.c for detailed documentation.
+ *
+ * @param hex Address column (8 hex digits for IPv4, 32 for IPv6)
+ * @param addr Output: 16 bytes, of which 4 are used for IPv4
+ */
+void backend_procfs_addr(const char *hex, uint8_t addr[16]);
+#endif
+
+#endif /* BACKEND_H */
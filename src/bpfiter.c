@@ -0,0 +1,561 @@
+#include "bpfiter.h"
+#include <errno.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "utils.h"
+
+/* The running kernel's type information */
+#define BTF_VMLINUX_PATH "/sys/kernel/btf/vmlinux"
+
+/* Bytes read from the iterator per read() call */
+#define BPFITER_READ_BYTES 65536
+
+/* Inode of the initial PID namespace (PROC_PID_INIT_INO in linux/proc_ns.h) */
+#define BPFITER_INIT_PID_NS_INO 0xEFFFFFFCUL
+
+/**
+ * One record written by the iterator program
+ *
+ * Both values are stored as 64-bit words so the layout needs no padding
+ * and reads the same on either byte order.
+ */
+typedef struct {
+    uint64_t inode;
+    uint64_t pid;
+} bpfiter_record_t;
+
+/**
+ * The kernel's BTF, indexed by type id
+ *
+ * Fields:
+ * - data: Whole file (header, types, strings)
+ * - strings, strings_len: String section
+ * - types: types[id] points at the btf_type of that id (id 0 is void)
+ * - count: Number of ids, including void
+ */
+typedef struct {
+    uint8_t *data;
+    const char *strings;
+    uint32_t strings_len;
+    const struct btf_type **types;
+    uint32_t count;
+} btf_t;
+
+/**
+ * Where the program finds what it reads, in the running kernel
+ *
+ * Fields:
+ * - attach_btf_id: Id of the bpf_iter_task_file function
+ * - task_tgid: Offset of tgid in struct task_struct
+ * - file_inode: Offset of f_inode in struct file
+ * - inode_mode: Offset of i_mode in struct inode
+ * - inode_ino, inode_ino_size: Offset and size of i_ino in struct inode
+ */
+typedef struct {
+    uint32_t attach_btf_id;
+    uint32_t task_tgid;
+    uint32_t file_inode;
+    uint32_t inode_mode;
+    uint32_t inode_ino;
+    uint32_t inode_ino_size;
+} kernel_layout_t;
+
+/* Iterator link, loaded on first use and kept for the life of the process */
+static struct {
+    pthread_once_t once;
+    int link_fd;
+    int error;
+} iterator = { PTHREAD_ONCE_INIT, -1, 0 };
+
+/**
+ * Issue a bpf() system call
+ */
+static int sys_bpf(int cmd, union bpf_attr *attr) {
+    return (int)syscall(SYS_bpf, cmd, attr, sizeof(*attr));
+}
+
+/**
+ * Size of one btf_type record including the data that follows it
+ *
+ * @param t Type record
+ * @return Size in bytes, 0 for an unknown kind
+ */
+static size_t btf_type_size(const struct btf_type *t) {
+    const size_t base = sizeof(*t);
+    const uint32_t vlen = BTF_INFO_VLEN(t->info);
+
+    switch (BTF_INFO_KIND(t->info)) {
+        case BTF_KIND_INT: return base + sizeof(uint32_t);
+        case BTF_KIND_ARRAY: return base + sizeof(struct btf_array);
+        case BTF_KIND_STRUCT:
+        case BTF_KIND_UNION: return base + vlen * sizeof(struct btf_member);
+        case BTF_KIND_ENUM: return base + vlen * sizeof(struct btf_enum);
+        case BTF_KIND_FUNC_PROTO: return base + vlen * sizeof(struct btf_param);
+        case BTF_KIND_VAR: return base + sizeof(struct btf_var);
+        case BTF_KIND_DATASEC: return base + vlen * sizeof(struct btf_var_secinfo);
+        case BTF_KIND_DECL_TAG: return base + sizeof(struct btf_decl_tag);
+        case BTF_KIND_ENUM64: return base + vlen * sizeof(struct btf_enum64);
+        case BTF_KIND_PTR:
+        case BTF_KIND_FWD:
+        case BTF_KIND_TYPEDEF:
+        case BTF_KIND_VOLATILE:
+        case BTF_KIND_CONST:
+        case BTF_KIND_RESTRICT:
+        case BTF_KIND_FUNC:
+        case BTF_KIND_FLOAT:
+        case BTF_KIND_TYPE_TAG: return base;
+        default: return 0;
+    }
+}
+
+/**
+ * Free BTF loaded by btf_load()
+ */
+static void btf_free(btf_t *btf) {
+    free(btf->types);
+    free(btf->data);
+    memset(btf, 0, sizeof(*btf));
+}
+
+/**
+ * Read the kernel's BTF and index its types
+ *
+ * @param btf Output (free with btf_free())
+ * @return 0 on success, -1 if there is no usable BTF (errno set)
+ */
+static int btf_load(btf_t *btf) {
+    memset(btf, 0, sizeof(*btf));
+
+    const int fd = open(BTF_VMLINUX_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* sysfs reports the real size of the BTF blob */
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct btf_header)) {
+        close(fd);
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    btf->data = counted_malloc((size_t)st.st_size);
+    if (!btf->data) {
+        close(fd);
+        return -1;
+    }
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        const ssize_t n = read(fd, btf->data + got, (size_t)st.st_size - got);
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    close(fd);
+
+    const struct btf_header *hdr = (const struct btf_header *)btf->data;
+    if (got != (size_t)st.st_size || hdr->magic != BTF_MAGIC ||
+        (uint64_t)hdr->hdr_len + hdr->type_off + hdr->type_len > got ||
+        (uint64_t)hdr->hdr_len + hdr->str_off + hdr->str_len > got) {
+        free(btf->data);
+        btf->data = NULL;
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    const uint8_t *types = btf->data + hdr->hdr_len + hdr->type_off;
+    btf->strings = (const char *)btf->data + hdr->hdr_len + hdr->str_off;
+    btf->strings_len = hdr->str_len;
+
+    /* Ids are assigned in order, starting at 1 (0 is void) */
+    uint32_t capacity = 65536;
+    btf->types = counted_malloc(capacity * sizeof(*btf->types));
+    if (!btf->types) {
+        btf_free(btf);
+        return -1;
+    }
+    btf->types[0] = NULL;
+    btf->count = 1;
+    for (uint32_t pos = 0; pos + sizeof(struct btf_type) <= hdr->type_len;) {
+        const struct btf_type *t = (const struct btf_type *)(types + pos);
+        const size_t size = btf_type_size(t);
+        if (size == 0 || pos + size > hdr->type_len) {
+            break;
+        }
+
+        if (btf->count >= capacity) {
+            capacity *= 2;
+            const struct btf_type **grown =
+                counted_realloc(btf->types, capacity * sizeof(*btf->types));
+            if (!grown) {
+                btf_free(btf);
+                return -1;
+            }
+            btf->types = grown;
+        }
+        btf->types[btf->count++] = t;
+        pos += (uint32_t)size;
+    }
+
+    return 0;
+}
+
+/**
+ * Name of a type or member
+ */
+static const char *btf_name(const btf_t *btf, uint32_t name_off) {
+    return name_off < btf->strings_len ? btf->strings + name_off : "";
+}
+
+/**
+ * Find a named type of a given kind
+ *
+ * @param btf Kernel BTF
+ * @param kind BTF_KIND_*
+ * @param name Type name
+ * @return Type id, 0 if there is none
+ */
+static uint32_t btf_find(const btf_t *btf, unsigned int kind, const char *name) {
+    for (uint32_t id = 1; id < btf->count; id++) {
+        const struct btf_type *t = btf->types[id];
+        if (BTF_INFO_KIND(t->info) == kind && strcmp(btf_name(btf, t->name_off), name) == 0) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Follow typedefs and qualifiers to the underlying type
+ *
+ * @param btf Kernel BTF
+ * @param id Type id
+ * @return Underlying type, NULL for void or an invalid id
+ */
+static const struct btf_type *btf_resolve(const btf_t *btf, uint32_t id) {
+    for (int depth = 0; depth < 32 && id > 0 && id < btf->count; depth++) {
+        const struct btf_type *t = btf->types[id];
+        switch (BTF_INFO_KIND(t->info)) {
+            case BTF_KIND_TYPEDEF:
+            case BTF_KIND_VOLATILE:
+            case BTF_KIND_CONST:
+            case BTF_KIND_RESTRICT:
+            case BTF_KIND_TYPE_TAG:
+                id = t->type;
+                break;
+            default:
+                return t;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find a member of a struct, looking inside anonymous structs and unions
+ *
+ * @param btf Kernel BTF
+ * @param type Struct or union
+ * @param name Member name
+ * @param offset Output: byte offset of the member
+ * @param size Output: size of the member (0 for a pointer-free aggregate)
+ * @return 0 if found, -1 otherwise (bitfields are not accepted)
+ */
+static int btf_member(const btf_t *btf, const struct btf_type *type, const char *name,
+                      uint32_t *offset, uint32_t *size) {
+    const struct btf_member *m = (const struct btf_member *)(type + 1);
+    const bool kflag = BTF_INFO_KFLAG(type->info);
+
+    for (uint32_t i = 0; i < BTF_INFO_VLEN(type->info); i++) {
+        const uint32_t bits = kflag ? BTF_MEMBER_BIT_OFFSET(m[i].offset) : m[i].offset;
+        const struct btf_type *mt = btf_resolve(btf, m[i].type);
+        if (!mt || (kflag && BTF_MEMBER_BITFIELD_SIZE(m[i].offset) != 0) || bits % 8 != 0) {
+            continue;
+        }
+
+        const unsigned int kind = BTF_INFO_KIND(mt->info);
+        if (m[i].name_off == 0 && (kind == BTF_KIND_STRUCT || kind == BTF_KIND_UNION)) {
+            if (btf_member(btf, mt, name, offset, size) == 0) {
+                *offset += bits / 8;
+                return 0;
+            }
+        } else if (strcmp(btf_name(btf, m[i].name_off), name) == 0) {
+            *offset = bits / 8;
+            *size = kind == BTF_KIND_PTR ? (uint32_t)sizeof(void *) : mt->size;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Find a member of a named struct with the expected size
+ *
+ * @return 0 if found with one of the sizes, -1 otherwise
+ */
+static int struct_member(const btf_t *btf, const char *type, const char *name,
+                         uint32_t min_size, uint32_t max_size, uint32_t *offset,
+                         uint32_t *size) {
+    const uint32_t id = btf_find(btf, BTF_KIND_STRUCT, type);
+    if (id == 0 || btf_member(btf, btf->types[id], name, offset, size) < 0) {
+        return -1;
+    }
+    return *size >= min_size && *size <= max_size ? 0 : -1;
+}
+
+/**
+ * Look up everything the program depends on in the kernel's BTF
+ *
+ * @param layout Output
+ * @return 0 on success, -1 if the kernel lacks the iterator or BTF
+ */
+static int kernel_layout(kernel_layout_t *layout) {
+    btf_t btf;
+    if (btf_load(&btf) < 0) {
+        return -1;
+    }
+
+    uint32_t size;
+    layout->attach_btf_id = btf_find(&btf, BTF_KIND_FUNC, "bpf_iter_task_file");
+    const int result =
+        layout->attach_btf_id == 0 ||
+        struct_member(&btf, "task_struct", "tgid", 4, 4, &layout->task_tgid, &size) < 0 ||
+        struct_member(&btf, "file", "f_inode", 8, 8, &layout->file_inode, &size) < 0 ||
+        struct_member(&btf, "inode", "i_mode", 2, 2, &layout->inode_mode, &size) < 0 ||
+        struct_member(&btf, "inode", "i_ino", 4, 8, &layout->inode_ino,
+                      &layout->inode_ino_size) < 0
+            ? -1
+            : 0;
+
+    btf_free(&btf);
+    if (result < 0) {
+        errno = ENOENT;
+    }
+    return result;
+}
+
+/* Instruction encoding (include/uapi/linux/bpf.h) */
+#define INSN(c, dst, src, o, i) \
+    ((struct bpf_insn){ .code = (c), .dst_reg = (dst), .src_reg = (src), .off = (o), .imm = (i) })
+#define LDX(size, dst, src, o)   INSN(BPF_LDX | BPF_MEM | (size), dst, src, o, 0)
+#define STX(size, dst, src, o)   INSN(BPF_STX | BPF_MEM | (size), dst, src, o, 0)
+#define MOV_REG(dst, src)        INSN(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0)
+#define MOV_IMM(dst, imm)        INSN(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm)
+#define ALU_IMM(op, dst, imm)    INSN(BPF_ALU64 | (op) | BPF_K, dst, 0, 0, imm)
+#define JMP_IMM(op, dst, imm, o) INSN(BPF_JMP | (op) | BPF_K, dst, 0, o, imm)
+#define CALL(helper)             INSN(BPF_JMP | BPF_CALL, 0, 0, 0, helper)
+#define EXIT()                   INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+/* Index of the final "return 0" in the program; jumps are relative to the next insn */
+#define PROG_OUT 20
+#define TO_OUT(at) (PROG_OUT - (at) - 1)
+
+/**
+ * Check that wir runs in the initial PID namespace
+ *
+ * The iterator reports task->tgid, the PID in the initial namespace. In a
+ * container with its own PID namespace those PIDs would not exist (or name
+ * other processes), so the iterator is only used where they are the PIDs
+ * wir itself sees.
+ *
+ * @return true if /proc/self/ns/pid is the initial PID namespace
+ */
+static bool in_init_pid_ns(void) {
+    struct stat st;
+    return stat("/proc/self/ns/pid", &st) == 0 && st.st_ino == BPFITER_INIT_PID_NS_INO;
+}
+
+/**
+ * Load the task_file iterator and attach it
+ *
+ * The program runs once per open file of every process, and writes
+ * { inode, tgid } for socket files only:
+ *
+ *     if (!ctx->file || !ctx->task || !ctx->file->f_inode) return 0;
+ *     if ((inode->i_mode & S_IFMT) != S_IFSOCK) return 0;
+ *     record = { inode->i_ino, task->tgid };
+ *     bpf_seq_write(ctx->meta->seq, &record, sizeof(record));
+ *
+ * It is assembled here rather than compiled, with the struct offsets of
+ * the running kernel taken from its BTF, so no BPF toolchain or library is
+ * needed to build or run wir. The verifier sees the typed context of the
+ * iterator and turns the field loads into fault-safe kernel reads.
+ *
+ * Outside the initial PID namespace nothing is loaded (EOPNOTSUPP), see
+ * in_init_pid_ns().
+ *
+ * @return void (pthread_once routine; sets iterator.link_fd or iterator.error)
+ */
+static void load_iterator(void) {
+    if (!in_init_pid_ns()) {
+        iterator.error = EOPNOTSUPP;
+        return;
+    }
+
+    kernel_layout_t layout;
+    if (kernel_layout(&layout) < 0) {
+        iterator.error = errno;
+        return;
+    }
+
+    const int ino_size = layout.inode_ino_size == 8 ? BPF_DW : BPF_W;
+    const struct bpf_insn prog[] = {
+        /* 0 */ MOV_REG(BPF_REG_6, BPF_REG_1),
+        /* 1 */ LDX(BPF_DW, BPF_REG_7, BPF_REG_6, 24),                /* ctx->file */
+        /* 2 */ JMP_IMM(BPF_JEQ, BPF_REG_7, 0, TO_OUT(2)),
+        /* 3 */ LDX(BPF_DW, BPF_REG_8, BPF_REG_6, 8),                 /* ctx->task */
+        /* 4 */ JMP_IMM(BPF_JEQ, BPF_REG_8, 0, TO_OUT(4)),
+        /* 5 */ LDX(BPF_DW, BPF_REG_2, BPF_REG_7, (int16_t)layout.file_inode),
+        /* 6 */ JMP_IMM(BPF_JEQ, BPF_REG_2, 0, TO_OUT(6)),
+        /* 7 */ LDX(BPF_H, BPF_REG_3, BPF_REG_2, (int16_t)layout.inode_mode),
+        /* 8 */ ALU_IMM(BPF_AND, BPF_REG_3, S_IFMT),
+        /* 9 */ JMP_IMM(BPF_JNE, BPF_REG_3, S_IFSOCK, TO_OUT(9)),
+        /* 10 */ LDX(ino_size, BPF_REG_4, BPF_REG_2, (int16_t)layout.inode_ino),
+        /* 11 */ LDX(BPF_W, BPF_REG_9, BPF_REG_8, (int16_t)layout.task_tgid),
+        /* 12 */ STX(BPF_DW, BPF_REG_10, BPF_REG_4, -16),
+        /* 13 */ STX(BPF_DW, BPF_REG_10, BPF_REG_9, -8),
+        /* 14 */ LDX(BPF_DW, BPF_REG_1, BPF_REG_6, 0),                /* ctx->meta */
+        /* 15 */ LDX(BPF_DW, BPF_REG_1, BPF_REG_1, 0),                /* meta->seq */
+        /* 16 */ MOV_REG(BPF_REG_2, BPF_REG_10),
+        /* 17 */ ALU_IMM(BPF_ADD, BPF_REG_2, -16),
+        /* 18 */ MOV_IMM(BPF_REG_3, (int32_t)sizeof(bpfiter_record_t)),
+        /* 19 */ CALL(BPF_FUNC_seq_write),
+        /* 20 */ MOV_IMM(BPF_REG_0, 0),
+        /* 21 */ EXIT(),
+    };
+
+    /* Offsets beyond a 16-bit displacement cannot be encoded */
+    if (layout.file_inode > INT16_MAX || layout.inode_mode > INT16_MAX ||
+        layout.inode_ino > INT16_MAX || layout.task_tgid > INT16_MAX) {
+        iterator.error = ERANGE;
+        return;
+    }
+
+    static const char license[] = "GPL";
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_TRACING;
+    attr.expected_attach_type = BPF_TRACE_ITER;
+    attr.attach_btf_id = layout.attach_btf_id;
+    attr.insns = (uint64_t)(uintptr_t)prog;
+    attr.insn_cnt = (uint32_t)(sizeof(prog) / sizeof(prog[0]));
+    attr.license = (uint64_t)(uintptr_t)license;
+    memcpy(attr.prog_name, "wir_sock_fds", sizeof("wir_sock_fds"));
+
+    const int prog_fd = sys_bpf(BPF_PROG_LOAD, &attr);
+    if (prog_fd < 0) {
+        iterator.error = errno;
+        return;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = (uint32_t)prog_fd;
+    attr.link_create.attach_type = BPF_TRACE_ITER;
+    iterator.link_fd = sys_bpf(BPF_LINK_CREATE, &attr);
+    iterator.error = iterator.link_fd < 0 ? errno : 0;
+
+    /* The link holds the program */
+    close(prog_fd);
+}
+
+/**
+ * Report every socket fd of every process in one kernel-side pass (Linux)
+ *
+ * Resolving socket owners through /proc means a readlink() per fd of every
+ * process, which dominates on hosts with millions of fds. A BPF task_file
+ * iterator walks the fd tables inside the kernel instead, and hands over
+ * only the socket fds, 16 bytes each, through one read() stream.
+ *
+ * Needs a kernel with BTF and BPF iterators (5.8 or later) and the
+ * privilege to load tracing programs (root, or CAP_BPF and CAP_PERFMON).
+ * The program is loaded on the first call and kept for the life of the
+ * process; when it cannot be loaded every call fails fast with the same
+ * error, and callers use the /proc walk instead. PIDs are those of the
+ * initial PID namespace, so the iterator is only loaded when wir runs in
+ * that namespace; inside a container with its own PID namespace the /proc
+ * walk reports the PIDs the container sees.
+ *
+ * Threads sharing their process's fd table are skipped by the kernel, so
+ * each fd is reported once, for its thread group. A socket open on several
+ * fds of a process is reported once per fd.
+ *
+ * @param fn Callback invoked once per socket fd
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if the iterator is unavailable or failed (errno
+ *         set); fn may have been called before a failure
+ */
+int bpfiter_socket_fds(bpfiter_socket_fn fn, void *ctx) {
+    pthread_once(&iterator.once, load_iterator);
+    if (iterator.link_fd < 0) {
+        errno = iterator.error;
+        return -1;
+    }
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.iter_create.link_fd = (uint32_t)iterator.link_fd;
+    const int fd = sys_bpf(BPF_ITER_CREATE, &attr);
+    if (fd < 0) {
+        return -1;
+    }
+
+    union {
+        bpfiter_record_t records[BPFITER_READ_BYTES / sizeof(bpfiter_record_t)];
+        char bytes[BPFITER_READ_BYTES];
+    } buf;
+    size_t pending = 0;
+    int result = 0;
+
+    for (;;) {
+        const ssize_t n = read(fd, buf.bytes + pending, sizeof(buf.bytes) - pending);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            result = n < 0 ? -1 : 0;
+            break;
+        }
+
+        const size_t bytes = pending + (size_t)n;
+        const size_t whole = bytes / sizeof(bpfiter_record_t);
+        for (size_t i = 0; i < whole; i++) {
+            fn(ctx, (pid_t)buf.records[i].pid, (unsigned long)buf.records[i].inode);
+        }
+
+        /* Keep a record cut by the read boundary for the next read */
+        pending = bytes - whole * sizeof(bpfiter_record_t);
+        memmove(buf.bytes, buf.bytes + whole * sizeof(bpfiter_record_t), pending);
+    }
+
+    const int saved = errno;
+    close(fd);
+    errno = saved;
+    return result;
+}
+
+#else /* !__linux__ */
+
+/**
+ * Report every socket fd of every process (not available on this platform)
+ *
+ * @return -1 with errno ENOSYS
+ */
+int bpfiter_socket_fds(bpfiter_socket_fn fn, void *ctx) {
+    (void)fn;
+    (void)ctx;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef BPFITER_H
+#define BPFITER_H
+
+#include <sys/types.h>
+
+/**
+ * Callback receiving one socket held by a process
+ *
+ * @param ctx Caller context
+ * @param pid Process (thread group) holding the socket
+ * @param inode Socket inode, as in the "socket:[inode]" fd link
+ */
+typedef void (*bpfiter_socket_fn)(void *ctx, pid_t pid, unsigned long inode);
+
+/**
+ * Report every socket fd of every process in one kernel-side pass
+ *
+ * See src/bpfiter.c for detailed documentation.
+ *
+ * @param fn Callback invoked once per socket fd
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if the iterator is unavailable or failed (errno
+ *         set); fn may have been called before a failure
+ */
+int bpfiter_socket_fds(bpfiter_socket_fn fn, void *ctx);
+
+#endif /* BPFITER_H */
@@ -0,0 +1,203 @@
+#include "cbor.h"
+#include <stdbool.h>
+
+/* CBOR major types (RFC 8949 section 3.1) */
+#define CBOR_UINT    0
+#define CBOR_NEGINT  1
+#define CBOR_BYTES   2
+#define CBOR_TEXT    3
+#define CBOR_ARRAY   4
+#define CBOR_MAP     5
+#define CBOR_SIMPLE  7
+
+/* Additional-information value for indefinite lengths and the break code */
+#define CBOR_INDEFINITE 31
+
+/**
+ * Write an item head: major type plus argument in the shortest encoding
+ *
+ * Arguments below 24 are packed into the initial byte; larger ones follow it
+ * as a 1, 2, 4 or 8 byte big-endian integer.
+ *
+ * @param w Writer to append to
+ * @param major Major type (0-7)
+ * @param value Argument (integer value, length or count)
+ * @return void
+ */
+static void cbor_put_head(writer_t *w, unsigned major, unsigned long long value) {
+    unsigned char head[9];
+    size_t len;
+
+    if (value < 24) {
+        head[0] = (unsigned char)(major << 5 | value);
+        len = 1;
+    } else if (value <= 0xFF) {
+        head[0] = (unsigned char)(major << 5 | 24);
+        len = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = (unsigned char)(major << 5 | 25);
+        len = 3;
+    } else if (value <= 0xFFFFFFFFULL) {
+        head[0] = (unsigned char)(major << 5 | 26);
+        len = 5;
+    } else {
+        head[0] = (unsigned char)(major << 5 | 27);
+        len = 9;
+    }
+
+    for (size_t i = len - 1; i > 0; i--) {
+        head[i] = (unsigned char)(value & 0xFF);
+        value >>= 8;
+    }
+
+    writer_write(w, head, len);
+}
+
+/**
+ * Check whether a byte string is well-formed UTF-8
+ *
+ * Rejects overlong encodings, surrogates and code points above U+10FFFF, the
+ * same rules strict CBOR decoders apply to text strings.
+ *
+ * @param s Bytes to check
+ * @param n Number of bytes
+ * @return true if s is valid UTF-8
+ */
+static bool is_valid_utf8(const unsigned char *s, size_t n) {
+    size_t i = 0;
+
+    while (i < n) {
+        const unsigned char c = s[i];
+        size_t extra;
+        unsigned long cp;
+
+        if (c < 0x80) {
+            i++;
+            continue;
+        } else if (c >= 0xC2 && c <= 0xDF) {
+            extra = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            extra = 2;
+            cp = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            extra = 3;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+
+        if (i + extra >= n) {
+            return false;
+        }
+        for (size_t k = 1; k <= extra; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = cp << 6 | (s[i + k] & 0x3F);
+        }
+
+        if ((extra == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) ||
+            (extra == 3 && (cp < 0x10000 || cp > 0x10FFFF))) {
+            return false;
+        }
+        i += extra + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Encode an unsigned integer (major type 0)
+ *
+ * @param w Writer to append to
+ * @param value Value to encode
+ * @return void
+ */
+void cbor_put_uint(writer_t *w, unsigned long long value) {
+    cbor_put_head(w, CBOR_UINT, value);
+}
+
+/**
+ * Encode a signed integer (major type 0 or 1)
+ *
+ * Negative values are encoded as major type 1 with argument -1 - value.
+ *
+ * @param w Writer to append to
+ * @param value Value to encode
+ * @return void
+ */
+void cbor_put_int(writer_t *w, long long value) {
+    if (value < 0) {
+        cbor_put_head(w, CBOR_NEGINT, (unsigned long long)(-1 - value));
+    } else {
+        cbor_put_head(w, CBOR_UINT, (unsigned long long)value);
+    }
+}
+
+/**
+ * Encode a string (major type 3, or 2 when not valid UTF-8)
+ *
+ * Process names, command lines and environment strings are arbitrary bytes
+ * on Linux. Valid UTF-8 is emitted as a text string; anything else is
+ * emitted unchanged as a byte string rather than being mangled, so decoders
+ * must accept either type for string-valued fields. NULL encodes as "".
+ *
+ * @param w Writer to append to
+ * @param s String to encode
+ * @return void
+ */
+void cbor_put_text(writer_t *w, const char *s) {
+    const size_t n = s ? strlen(s) : 0;
+    const bool utf8 = is_valid_utf8((const unsigned char *)s, n);
+
+    cbor_put_head(w, utf8 ? CBOR_TEXT : CBOR_BYTES, n);
+    if (n > 0) {
+        writer_write(w, s, n);
+    }
+}
+
+/**
+ * Start a definite-length array (major type 4)
+ *
+ * @param w Writer to append to
+ * @param items Number of items that will follow
+ * @return void
+ */
+void cbor_put_array(writer_t *w, size_t items) {
+    cbor_put_head(w, CBOR_ARRAY, items);
+}
+
+/**
+ * Start a definite-length map (major type 5)
+ *
+ * @param w Writer to append to
+ * @param pairs Number of key/value pairs that will follow
+ * @return void
+ */
+void cbor_put_map(writer_t *w, size_t pairs) {
+    cbor_put_head(w, CBOR_MAP, pairs);
+}
+
+/**
+ * Start an indefinite-length array (major type 4)
+ *
+ * For streams whose length is not known up front; the items are terminated
+ * with cbor_put_break().
+ *
+ * @param w Writer to append to
+ * @return void
+ */
+void cbor_put_array_indefinite(writer_t *w) {
+    writer_putc(w, (char)(CBOR_ARRAY << 5 | CBOR_INDEFINITE));
+}
+
+/**
+ * End an indefinite-length item (the "break" stop code)
+ *
+ * @param w Writer to append to
+ * @return void
+ */
+void cbor_put_break(writer_t *w) {
+    writer_putc(w, (char)(CBOR_SIMPLE << 5 | CBOR_INDEFINITE));
+}
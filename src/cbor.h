@@ -0,0 +1,26 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stddef.h>
+#include "writer.h"
+
+/**
+ * Minimal CBOR (RFC 8949) encoder
+ *
+ * Encodes the handful of item types wir's results need - unsigned and
+ * negative integers, text strings, arrays and maps - directly into a
+ * writer_t. Maps and arrays use definite lengths, so callers announce the
+ * number of members before writing them; streamed lists whose length is not
+ * known yet use an indefinite-length array closed by a break.
+ *
+ * See src/cbor.c for detailed documentation of each function.
+ */
+void cbor_put_uint(writer_t *w, unsigned long long value);
+void cbor_put_int(writer_t *w, long long value);
+void cbor_put_text(writer_t *w, const char *s);
+void cbor_put_array(writer_t *w, size_t items);
+void cbor_put_map(writer_t *w, size_t pairs);
+void cbor_put_array_indefinite(writer_t *w);
+void cbor_put_break(writer_t *w);
+
+#endif /* CBOR_H */
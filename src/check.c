@@ -0,0 +1,321 @@
+#include "check.h"
+#include "platform.h"
+#include "utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pwd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* TCP state names accepted by state= (as printed in port reports) */
+static const char *const check_states[] = {
+    "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT",
+    "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING",
+};
+
+/* Protocol names accepted by proto= */
+static const char *const check_protocols[] = { "TCP", "TCP6", "UDP", "UDP6" };
+
+/**
+ * Parse a non-negative decimal number
+ *
+ * @param str Input string
+ * @param max Largest accepted value
+ * @param out Parsed value
+ * @return 0 on success, -1 if str is not a number in [0, max]
+ */
+static int parse_number(const char *str, long max, long *out) {
+    if (!isdigit((unsigned char)*str)) {
+        return -1;
+    }
+
+    char *end;
+    errno = 0;
+    const long val = strtol(str, &end, 10);
+    if (errno != 0 || *end != '\0' || val > max) {
+        return -1;
+    }
+
+    *out = val;
+    return 0;
+}
+
+/**
+ * Copy a value into a fixed buffer in upper case, if it is one of the names
+ *
+ * @param value Value as given (case-insensitive)
+ * @param names Accepted names
+ * @param count Number of names
+ * @param out Output buffer (at least as large as the longest name)
+ * @return 0 if value names one of them, -1 otherwise
+ */
+static int match_name(const char *value, const char *const *names, size_t count, char *out) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(value, names[i]) == 0) {
+            strcpy(out, names[i]);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parse a --check condition
+ *
+ * The condition is a comma-separated list of key=value pairs; port= is
+ * required, every other key narrows which socket counts as a match:
+ *
+ * - port=N: socket bound to local port N
+ * - state=NAME: TCP state (LISTEN, ESTABLISHED, ...); UDP sockets never match
+ * - proto=NAME: tcp, tcp6, udp or udp6
+ * - user=NAME|UID: socket owned by this user
+ * - pid=N: socket held by this process
+ * - name=NAME: socket held by a process with this name
+ *
+ * User names are resolved here, once, so a probe fails fast on a typo
+ * instead of reporting "no match".
+ *
+ * @param ctx Context errors are reported to
+ * @param spec Comma-separated key=value list
+ * @param check Output condition
+ * @return 0 on success, -1 on error (message printed)
+ */
+int check_parse(const wir_ctx_t *ctx, const char *spec, port_check_t *check) {
+    memset(check, 0, sizeof(*check));
+    check->port = -1;
+    check->uid = -1;
+    check->pid = -1;
+
+    char *copy = counted_strdup(spec);
+    if (!copy) {
+        print_error(ctx, "Cannot parse --check condition: %s", strerror(errno));
+        return -1;
+    }
+    int result = 0;
+
+    for (char *save = NULL, *item = strtok_r(copy, ",", &save); item && result == 0;
+         item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        if (!value || value == item || value[1] == '\0') {
+            print_error(ctx, "Invalid --check condition: %s (expected key=value)", item);
+            result = -1;
+            break;
+        }
+        *value++ = '\0';
+
+        long number;
+        if (strcmp(item, "port") == 0) {
+            if (parse_number(value, 65535, &number) < 0 || number < 1) {
+                print_error(ctx, "Invalid port number: %s (expected 1-65535)", value);
+                result = -1;
+            } else {
+                check->port = (int)number;
+            }
+        } else if (strcmp(item, "state") == 0) {
+            if (match_name(value, check_states, sizeof(check_states) / sizeof(check_states[0]),
+                           check->state) < 0) {
+                print_error(ctx, "Unknown TCP state: %s (expected LISTEN, ESTABLISHED, "
+                            "TIME_WAIT, CLOSE_WAIT, ...)", value);
+                result = -1;
+            }
+        } else if (strcmp(item, "proto") == 0) {
+            if (match_name(value, check_protocols,
+                           sizeof(check_protocols) / sizeof(check_protocols[0]),
+                           check->protocol) < 0) {
+                print_error(ctx, "Unknown protocol: %s (expected tcp, tcp6, udp or udp6)", value);
+                result = -1;
+            }
+        } else if (strcmp(item, "user") == 0) {
+            if (parse_number(value, INT_MAX, &number) == 0) {
+                check->uid = (int)number;
+            } else {
+                struct passwd pwd;
+                struct passwd *pw = NULL;
+                char pwbuf[1024];
+                if (getpwnam_r(value, &pwd, pwbuf, sizeof(pwbuf), &pw) != 0 || !pw) {
+                    print_error(ctx, "Unknown user: %s", value);
+                    result = -1;
+                } else {
+                    check->uid = (int)pw->pw_uid;
+                }
+            }
+        } else if (strcmp(item, "pid") == 0) {
+            if (parse_number(value, INT_MAX, &number) < 0 || number < 1) {
+                print_error(ctx, "Invalid PID: %s", value);
+                result = -1;
+            } else {
+                check->pid = (pid_t)number;
+            }
+        } else if (strcmp(item, "name") == 0) {
+            snprintf(check->name, sizeof(check->name), "%s", value);
+        } else {
+            print_error(ctx, "Unknown --check key: %s (expected port, state, proto, user, "
+                        "pid or name)", item);
+            result = -1;
+        }
+    }
+
+    free(copy);
+
+    if (result == 0 && check->port < 0) {
+        print_error(ctx, "--check requires port=<n>");
+        result = -1;
+    }
+    if (result == 0 && check->state[0] && str_starts_with(check->protocol, "UDP")) {
+        print_error(ctx, "--check state= only applies to TCP sockets");
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * Probe in progress for check_run()
+ *
+ * Fields:
+ * - check: Condition being tested
+ * - candidates: PIDs of processes called check->name, listed on first use
+ *   (NULL until then)
+ * - candidate_count: Number of candidates
+ * - matched: Set once a socket satisfies the condition
+ * - failed: The candidates could not be listed (out of memory)
+ */
+typedef struct {
+    const port_check_t *check;
+    pid_t *candidates;
+    int candidate_count;
+    bool matched;
+    bool failed;
+} check_probe_t;
+
+/**
+ * List the processes whose name matches the condition's name=
+ *
+ * Only the name is read per process, and only once per probe: a port
+ * has few sockets, but every one of them is tested against this list.
+ *
+ * @param probe Probe to fill in
+ * @return 0 on success, -1 if memory is exhausted (probe->failed set)
+ */
+static int list_candidates(check_probe_t *probe) {
+    pid_t *pids = NULL;
+    int count = 0;
+
+    probe->candidates = counted_malloc(sizeof(pid_t));
+    probe->candidate_count = 0;
+    if (!probe->candidates) {
+        probe->failed = true;
+        return -1;
+    }
+    if (platform_list_pids(&pids, &count) < 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        process_info_t info;
+        if (platform_get_process_fields(pids[i], &info, PROC_SRC_STAT) == 0 &&
+            strcmp(info.name, probe->check->name) == 0) {
+            pid_t *grown = counted_realloc(probe->candidates,
+                                           (size_t)(probe->candidate_count + 1) * sizeof(pid_t));
+            if (!grown) {
+                probe->failed = true;
+                free(pids);
+                return -1;
+            }
+            probe->candidates = grown;
+            probe->candidates[probe->candidate_count++] = pids[i];
+        }
+    }
+
+    free(pids);
+    return 0;
+}
+
+/**
+ * Test whether a process called name= holds a socket
+ *
+ * @param probe Probe in progress
+ * @param sock Socket to test
+ * @return true if one of the named processes holds it
+ */
+static bool held_by_name(check_probe_t *probe, const port_socket_t *sock) {
+    if (sock->pid >= 0) {
+        process_info_t info;
+        return platform_get_process_fields(sock->pid, &info, PROC_SRC_STAT) == 0 &&
+               strcmp(info.name, probe->check->name) == 0;
+    }
+
+    if (!probe->candidates && list_candidates(probe) < 0) {
+        return false;
+    }
+    for (int i = 0; i < probe->candidate_count; i++) {
+        if (platform_process_has_socket(probe->candidates[i], sock)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Socket callback: test one socket against the whole condition
+ *
+ * Cheap tests on the socket itself come first; the process tests, which
+ * read /proc, only run for sockets that passed them.
+ *
+ * @param ctx check_probe_t
+ * @param sock Socket bound to the port
+ * @return false once a socket matched or the probe failed (ends the walk)
+ */
+static bool test_socket(void *ctx, const port_socket_t *sock) {
+    check_probe_t *probe = ctx;
+    const port_check_t *check = probe->check;
+
+    if (check->protocol[0] && strcmp(sock->protocol, check->protocol) != 0) {
+        return true;
+    }
+    if (check->uid >= 0 && sock->uid != check->uid) {
+        return true;
+    }
+    if (check->pid > 0 && !platform_process_has_socket(check->pid, sock)) {
+        return true;
+    }
+    if (check->name[0] && !held_by_name(probe, sock)) {
+        return !probe->failed;
+    }
+
+    probe->matched = true;
+    return false;
+}
+
+/**
+ * Test whether some socket satisfies a --check condition
+ *
+ * Meant for health probes that run every few seconds on busy hosts, so it
+ * does as little as the condition allows. Sockets are walked one at a time
+ * (with the port and state filtered in the kernel where sock_diag is
+ * available) and the walk ends at the first match. Nothing is resolved to
+ * an owning process unless pid= or name= asks for it, and then only the
+ * sockets that already passed the other constraints are looked up. user=
+ * compares the UID the socket belongs to, which needs no lookup at all.
+ *
+ * @param check Parsed condition
+ * @return 1 if a socket matches, 0 if none does, -1 if sockets cannot be read
+ */
+int check_run(const port_check_t *check) {
+    check_probe_t probe = { check, NULL, 0, false, false };
+
+    const int result = platform_for_each_port_socket(check->port,
+                                                     check->state[0] ? check->state : NULL,
+                                                     test_socket, &probe);
+    free(probe.candidates);
+
+    if (probe.failed) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (result < 0) {
+        return -1;
+    }
+    return probe.matched ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "platform.h"
+#include <sys/types.h>
+
+/* Context errors are reported to (see src/context.h) */
+typedef struct wir_ctx wir_ctx_t;
+
+/* Exit status of --check when the condition is malformed or the sockets
+ * cannot be read, so a probe can tell a broken check from "no match" (1) */
+#define CHECK_EXIT_ERROR 2
+
+/**
+ * A parsed --check condition
+ *
+ * Every constraint that is set must hold for one and the same socket.
+ *
+ * Fields:
+ * - port: Port the socket is bound to (required)
+ * - state: TCP state name (LISTEN, ESTABLISHED, ...), empty for any
+ * - protocol: Protocol name (TCP, TCP6, UDP, UDP6), empty for any
+ * - uid: UID that owns the socket (-1 for any)
+ * - pid: Process that must hold the socket (-1 for any)
+ * - name: Name of a process that must hold the socket, empty for any
+ */
+typedef struct {
+    int port;
+    char state[16];
+    char protocol[8];
+    int uid;
+    pid_t pid;
+    char name[MAX_PROCESS_NAME];
+} port_check_t;
+
+/**
+ * Parse a --check condition ("port=8080,state=LISTEN,user=app")
+ *
+ * See src/check.c for detailed documentation.
+ *
+ * @param ctx Context errors are reported to
+ * @param spec Comma-separated key=value list
+ * @param check Output condition
+ * @return 0 on success, -1 on error (message printed)
+ */
+int check_parse(const wir_ctx_t *ctx, const char *spec, port_check_t *check);
+
+/**
+ * Test whether some socket satisfies a --check condition
+ *
+ * See src/check.c for detailed documentation.
+ *
+ * @param check Parsed condition
+ * @return 1 if a socket matches, 0 if none does, -1 if sockets cannot be read
+ */
+int check_run(const port_check_t *check);
+
+#endif /* CHECK_H */
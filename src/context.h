@@ -0,0 +1,43 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "platform.h"
+#include "snapshot.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * State of one libwir context (opaque in src/wir.h)
+ *
+ * Everything a query depends on is kept here instead of in globals, so
+ * contexts used on different threads never see each other's settings.
+ * Caches that are safe to share (the UID cache, the boot time) are shared
+ * by all contexts and stay warm across queries.
+ *
+ * Fields:
+ * - out: Stream reports are written to
+ * - colors: Use ANSI colors in text reports
+ * - err: Stream errors and warnings are written to
+ * - err_colors: Use ANSI colors in errors and warnings
+ * - platform: Settings for platform queries (scan threads, TCP internals)
+ * - cancelled: Set by wir_ctx_cancel() to end a running --record,
+ *   --publish-shm or --serve-stdio; lock-free, so it may be set from a
+ *   signal handler
+ * - snapshot: Published snapshot that answers process and port lookups
+ *   instead of the platform layer. Only set on the per-run copy wir_run()
+ *   makes for --from-shm; NULL on contexts from wir_ctx_new()
+ */
+struct wir_ctx {
+    FILE *out;
+    bool colors;
+    FILE *err;
+    bool err_colors;
+    platform_options_t platform;
+    atomic_bool cancelled;
+    const snapshot_t *snapshot;
+};
+
+typedef struct wir_ctx wir_ctx_t;
+
+#endif /* CONTEXT_H */
@@ -0,0 +1,268 @@
+#include "ephemeral.h"
+#include "utils.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/* Initial number of hash slots (power of two) */
+#define EPHEMERAL_MIN_SLOTS 64
+
+/**
+ * Number of bytes of an address that belong to its family
+ *
+ * @param family AF_INET or AF_INET6
+ * @return 4 or 16
+ */
+static size_t addr_len(int family) {
+    return family == AF_INET6 ? 16 : 4;
+}
+
+/**
+ * Hash a destination (FNV-1a over family, address and port)
+ *
+ * @param family Address family
+ * @param addr Address bytes
+ * @param port Remote port
+ * @return 32-bit hash
+ */
+static uint32_t hash_dest(int family, const uint8_t *addr, int port) {
+    uint32_t h = 2166136261u;
+    h = (h ^ (uint32_t)family) * 16777619u;
+    for (size_t i = 0; i < addr_len(family); i++) {
+        h = (h ^ addr[i]) * 16777619u;
+    }
+    h = (h ^ (uint32_t)(port & 0xff)) * 16777619u;
+    h = (h ^ (uint32_t)(port >> 8)) * 16777619u;
+    return h;
+}
+
+/**
+ * Find the slot holding a destination, or the empty slot where it would go
+ *
+ * @param table Ephemeral table
+ * @param family Address family
+ * @param addr Address bytes
+ * @param port Remote port
+ * @return Slot index
+ */
+static size_t find_slot(const ephemeral_table_t *table, int family, const uint8_t *addr,
+                        int port) {
+    size_t i = hash_dest(family, addr, port) & (table->slot_count - 1);
+    while (table->used[i]) {
+        const ephemeral_slot_t *s = &table->slots[i];
+        if (s->family == family && s->port == port &&
+            memcmp(s->addr, addr, addr_len(family)) == 0) {
+            break;
+        }
+        i = (i + 1) & (table->slot_count - 1);
+    }
+    return i;
+}
+
+/**
+ * Resize the table to hold at least `entries` destinations at half load
+ *
+ * @param table Ephemeral table
+ * @param entries Number of entries the table must accommodate
+ * @return 0 on success, -1 if memory is exhausted (table unchanged)
+ */
+static int reserve(ephemeral_table_t *table, size_t entries) {
+    size_t slot_count = EPHEMERAL_MIN_SLOTS;
+    while (slot_count < entries * 2) {
+        slot_count *= 2;
+    }
+    if (slot_count <= table->slot_count) {
+        return 0;
+    }
+
+    ephemeral_slot_t *slots = counted_malloc(slot_count * sizeof(ephemeral_slot_t));
+    bool *used = counted_calloc(slot_count, sizeof(bool));
+    if (!slots || !used) {
+        free(slots);
+        free(used);
+        return -1;
+    }
+
+    ephemeral_slot_t *old_slots = table->slots;
+    bool *old_used = table->used;
+    const size_t old_count = table->slot_count;
+
+    table->slots = slots;
+    table->used = used;
+    table->slot_count = slot_count;
+
+    for (size_t i = 0; i < old_count; i++) {
+        if (old_used[i]) {
+            const ephemeral_slot_t *s = &old_slots[i];
+            const size_t j = find_slot(table, s->family, s->addr, s->port);
+            table->slots[j] = *s;
+            table->used[j] = true;
+        }
+    }
+
+    free(old_slots);
+    free(old_used);
+    return 0;
+}
+
+/**
+ * Express a count as a whole percentage of the range size
+ *
+ * @param table Ephemeral table
+ * @param count Ports or connections
+ * @return Percentage, rounded down
+ */
+static int range_pct(const ephemeral_table_t *table, int count) {
+    const long size = (long)table->summary.high - table->summary.low + 1;
+    return (int)((long)count * 100 / size);
+}
+
+/**
+ * Initialize an empty ephemeral table
+ *
+ * @param table Table to initialize
+ * @param low First port of the ephemeral range
+ * @param high Last port of the ephemeral range
+ * @return 0 on success, -1 if memory is exhausted (free the table either way)
+ */
+int ephemeral_table_init(ephemeral_table_t *table, int low, int high) {
+    memset(table, 0, sizeof(*table));
+    table->summary.low = low;
+    table->summary.high = high;
+    return reserve(table, EPHEMERAL_MIN_SLOTS / 2);
+}
+
+/**
+ * Count one TCP socket
+ *
+ * Its local port is marked in use; if it is connected (has a remote port)
+ * it is also counted against its destination by state. Sockets outside the
+ * range are ignored, so the walk may or may not filter by port. The record
+ * can be reused as soon as this returns. Once the table has failed to grow,
+ * sockets are no longer counted.
+ *
+ * @param table Ephemeral table
+ * @param ep Socket
+ * @return void
+ */
+void ephemeral_add_endpoint(ephemeral_table_t *table, const tcp_endpoint_t *ep) {
+    ephemeral_summary_t *sum = &table->summary;
+    if (table->failed || ep->local_port < sum->low || ep->local_port > sum->high) {
+        return;
+    }
+
+    uint64_t *word = &table->ports[ep->local_port / 64];
+    const uint64_t bit = UINT64_C(1) << (ep->local_port % 64);
+    if (!(*word & bit)) {
+        *word |= bit;
+        sum->ports_in_use++;
+    }
+
+    if (ep->remote_port == 0) {
+        return;
+    }
+
+    size_t i = find_slot(table, ep->family, ep->remote_addr, ep->remote_port);
+    if (!table->used[i]) {
+        if (reserve(table, table->count + 1) < 0) {
+            table->failed = true;
+            return;
+        }
+        i = find_slot(table, ep->family, ep->remote_addr, ep->remote_port);
+
+        ephemeral_slot_t *s = &table->slots[i];
+        memset(s, 0, sizeof(*s));
+        s->family = ep->family;
+        memcpy(s->addr, ep->remote_addr, addr_len(ep->family));
+        s->port = ep->remote_port;
+        table->used[i] = true;
+        table->count++;
+    }
+
+    ephemeral_slot_t *s = &table->slots[i];
+    sum->connections++;
+    if (strcmp(ep->state, "ESTABLISHED") == 0) {
+        s->established++;
+        sum->established++;
+    } else if (strcmp(ep->state, "TIME_WAIT") == 0) {
+        s->time_wait++;
+        sum->time_wait++;
+    } else {
+        s->other++;
+        sum->other++;
+    }
+}
+
+/**
+ * Order destinations by connection count, largest first, then by address
+ */
+static int compare_dests(const void *a, const void *b) {
+    const ephemeral_dest_t *x = a;
+    const ephemeral_dest_t *y = b;
+    if (x->connections != y->connections) {
+        return (y->connections > x->connections) - (y->connections < x->connections);
+    }
+    const int by_addr = strcmp(x->destination, y->destination);
+    return by_addr != 0 ? by_addr : x->port - y->port;
+}
+
+/**
+ * Extract the destinations as an array, busiest first
+ *
+ * Addresses are formatted here, once per destination, and the summary's
+ * utilisation is filled in.
+ *
+ * @param table Ephemeral table
+ * @param dests Output: array of destinations (caller must free)
+ * @return Number of destinations, or -1 if memory ran out while the table
+ *         was filled or now (errno ENOMEM)
+ */
+int ephemeral_table_list(ephemeral_table_t *table, ephemeral_dest_t **dests) {
+    const size_t count = table->count;
+    *dests = table->failed ? NULL
+                           : counted_malloc((count > 0 ? count : 1) * sizeof(ephemeral_dest_t));
+    if (!*dests) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < table->slot_count; i++) {
+        if (table->used[i]) {
+            const ephemeral_slot_t *s = &table->slots[i];
+            ephemeral_dest_t *d = &(*dests)[n++];
+
+            inet_ntop(s->family, s->addr, d->destination, sizeof(d->destination));
+            d->port = s->port;
+            d->established = s->established;
+            d->time_wait = s->time_wait;
+            d->other = s->other;
+            d->connections = s->established + s->time_wait + s->other;
+            d->used_pct = range_pct(table, d->connections);
+        }
+    }
+
+    table->summary.used_pct = range_pct(table, table->summary.ports_in_use);
+
+    qsort(*dests, n, sizeof(ephemeral_dest_t), compare_dests);
+    return (int)n;
+}
+
+/**
+ * Release an ephemeral table
+ *
+ * @param table Table to free
+ * @return void
+ */
+void ephemeral_table_free(ephemeral_table_t *table) {
+    free(table->slots);
+    free(table->used);
+    table->slots = NULL;
+    table->used = NULL;
+    table->slot_count = 0;
+    table->count = 0;
+}
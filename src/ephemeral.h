@@ -0,0 +1,98 @@
+#ifndef EPHEMERAL_H
+#define EPHEMERAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+/* Longest destination address as text (an IPv6 address) */
+#define EPHEMERAL_ADDR_SIZE 46
+
+/* Utilisation (percent of the range) from which a destination is flagged */
+#define EPHEMERAL_WARN_PCT 80
+
+/**
+ * Ephemeral port use towards one destination
+ *
+ * Fields:
+ * - destination: Remote address as text (filled in by ephemeral_table_list())
+ * - port: Remote port
+ * - connections: Sockets in the range connected to this destination
+ * - established, time_wait, other: Those sockets by TCP state
+ * - used_pct: connections as a percentage of the range size
+ */
+typedef struct {
+    char destination[EPHEMERAL_ADDR_SIZE];
+    int port;
+    int connections;
+    int established;
+    int time_wait;
+    int other;
+    int used_pct;
+} ephemeral_dest_t;
+
+/**
+ * Ephemeral port use across the whole range
+ *
+ * Fields:
+ * - low, high: The range (ip_local_port_range)
+ * - ports_in_use: Distinct local ports in the range held by some socket
+ * - used_pct: ports_in_use as a percentage of the range size
+ * - connections, established, time_wait, other: Connected sockets in the
+ *   range, by TCP state (listeners are not counted)
+ */
+typedef struct {
+    int low;
+    int high;
+    int ports_in_use;
+    int used_pct;
+    int connections;
+    int established;
+    int time_wait;
+    int other;
+} ephemeral_summary_t;
+
+/**
+ * Hash slot of the per-destination table (address kept as bytes)
+ */
+typedef struct {
+    int family;
+    uint8_t addr[16];
+    int port;
+    int established;
+    int time_wait;
+    int other;
+} ephemeral_slot_t;
+
+/**
+ * Ephemeral port accumulator
+ *
+ * Sockets are added one at a time as they are dumped: a bitmap of the local
+ * ports seen, plus an open-addressing hash table (linear probing,
+ * power-of-two size, kept at most half full) of state counters keyed by
+ * destination. Memory is bounded by the number of destinations, not
+ * sockets. If the table cannot grow, failed is set, later sockets are
+ * dropped and ephemeral_table_list() fails.
+ */
+typedef struct {
+    ephemeral_summary_t summary;
+    uint64_t ports[65536 / 64];
+    ephemeral_slot_t *slots;
+    bool *used;
+    size_t slot_count;
+    size_t count;
+    bool failed;
+} ephemeral_table_t;
+
+/**
+ * Ephemeral table functions
+ *
+ * See src/ephemeral.c for detailed documentation of each function.
+ */
+int ephemeral_table_init(ephemeral_table_t *table, int low, int high);
+void ephemeral_add_endpoint(ephemeral_table_t *table, const tcp_endpoint_t *ep);
+int ephemeral_table_list(ephemeral_table_t *table, ephemeral_dest_t **dests);
+void ephemeral_table_free(ephemeral_table_t *table);
+
+#endif /* EPHEMERAL_H */
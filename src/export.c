@@ -0,0 +1,115 @@
+#include "export.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Copy one process into its public form
+ *
+ * @param proc Process from the platform layer
+ * @param out Output: public record
+ * @return void
+ */
+void export_process(const process_info_t *proc, wir_process_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->pid = proc->pid;
+    out->ppid = proc->ppid;
+    out->uid = proc->uid;
+    out->state = proc->state;
+    out->vsz = proc->vsz;
+    out->rss = proc->rss;
+    out->start_time = (int64_t)proc->start_time;
+    snprintf(out->name, sizeof(out->name), "%s", proc->name);
+    snprintf(out->username, sizeof(out->username), "%s", proc->username);
+    snprintf(out->cmdline, sizeof(out->cmdline), "%s", proc->cmdline);
+}
+
+/**
+ * Copy a process array into a newly allocated public array
+ *
+ * @param procs Processes from the platform layer
+ * @param count Number of processes
+ * @param out Output: public array (caller must free)
+ * @return 0 on success, -1 if memory is exhausted
+ */
+int export_processes(const process_info_t *procs, int count, wir_process_t **out) {
+    wir_process_t *list = counted_malloc((size_t)(count > 0 ? count : 1) * sizeof(*list));
+    if (!list) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        export_process(&procs[i], &list[i]);
+    }
+    *out = list;
+    return 0;
+}
+
+/**
+ * Copy a connection array into a newly allocated public array
+ *
+ * As in the platform layer's arrays, the owner lists are stored behind the
+ * records, so the caller releases everything with a single free().
+ *
+ * @param conns Connections from the platform layer
+ * @param count Number of connections
+ * @param out Output: public array (caller must free)
+ * @return 0 on success, -1 if memory is exhausted
+ */
+int export_connections(const connection_info_t *conns, int count, wir_connection_t **out) {
+    size_t owners = 0;
+    for (int i = 0; i < count; i++) {
+        owners += (size_t)conns[i].owner_count;
+    }
+
+    const size_t records = (size_t)(count > 0 ? count : 1) * sizeof(wir_connection_t);
+    wir_connection_t *list = counted_malloc(records + owners * sizeof(pid_t));
+    if (!list) {
+        return -1;
+    }
+
+    /* wir_connection_t is at least int-aligned, so the tail is too */
+    pid_t *tail = (pid_t *)((char *)list + records);
+    for (int i = 0; i < count; i++) {
+        const connection_info_t *conn = &conns[i];
+        wir_connection_t *pub = &list[i];
+
+        memset(pub, 0, sizeof(*pub));
+        snprintf(pub->protocol, sizeof(pub->protocol), "%s", conn->protocol);
+        snprintf(pub->state, sizeof(pub->state), "%s", conn->state);
+        snprintf(pub->local_addr, sizeof(pub->local_addr), "%s", conn->local_addr);
+        pub->local_port = conn->local_port;
+        snprintf(pub->remote_addr, sizeof(pub->remote_addr), "%s", conn->remote_addr);
+        pub->remote_port = conn->remote_port;
+        pub->pid = conn->pid;
+        pub->rx_queue = conn->rx_queue;
+        pub->tx_queue = conn->tx_queue;
+        pub->backlog = conn->backlog;
+        pub->has_tcp_info = conn->has_tcp_info;
+
+        const tcp_internals_t *tcp = &conn->tcp;
+        pub->tcp = (wir_tcp_info_t){
+            .rtt_us = tcp->rtt_us,
+            .rttvar_us = tcp->rttvar_us,
+            .retransmits = tcp->retransmits,
+            .total_retrans = tcp->total_retrans,
+            .snd_cwnd = tcp->snd_cwnd,
+            .unacked = tcp->unacked,
+            .rmem_alloc = tcp->rmem_alloc,
+            .rcvbuf = tcp->rcvbuf,
+            .wmem_alloc = tcp->wmem_alloc,
+            .sndbuf = tcp->sndbuf,
+            .wmem_queued = tcp->wmem_queued,
+            .drops = tcp->drops,
+        };
+
+        if (conn->owner_count > 0) {
+            memcpy(tail, conn->owners, (size_t)conn->owner_count * sizeof(pid_t));
+            pub->owners = tail;
+            pub->owner_count = conn->owner_count;
+            tail += conn->owner_count;
+        }
+    }
+
+    *out = list;
+    return 0;
+}
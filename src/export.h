@@ -0,0 +1,21 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "platform.h"
+#include "wir.h"
+
+/**
+ * Conversion of the platform layer's records to the public structures of
+ * src/wir.h
+ *
+ * The platform types change with the scanners; the public ones are fixed
+ * for a WIR_ABI_VERSION, so every array handed to a libwir caller goes
+ * through here.
+ *
+ * See src/export.c for detailed documentation of each function.
+ */
+void export_process(const process_info_t *proc, wir_process_t *out);
+int export_processes(const process_info_t *procs, int count, wir_process_t **out);
+int export_connections(const connection_info_t *conns, int count, wir_connection_t **out);
+
+#endif /* EXPORT_H */
@@ -0,0 +1,289 @@
+#include "fields.h"
+#include "utils.h"
+#include <stdio.h>
+
+#define FIELD_DESC_ENTRY(id, key, header, type, source, group, getter) \
+    [id] = { key, header, type, source, group },
+
+static const field_desc_t process_fields[] = { PROCESS_FIELDS(FIELD_DESC_ENTRY) };
+static const field_desc_t connection_fields[] = { CONNECTION_FIELDS(FIELD_DESC_ENTRY) };
+static const field_desc_t user_fields[] = { USER_FIELDS(FIELD_DESC_ENTRY) };
+static const field_desc_t history_fields[] = { HISTORY_FIELDS(FIELD_DESC_ENTRY) };
+static const field_desc_t group_fields[] = { GROUP_FIELDS(FIELD_DESC_ENTRY) };
+static const field_desc_t ephemeral_fields[] = { EPHEMERAL_FIELDS(FIELD_DESC_ENTRY) };
+static const field_desc_t forest_fields[] = { FOREST_FIELDS(FIELD_DESC_ENTRY) };
+
+#define FIELD_GET_CASE(id, key, header, type, source, group, getter) \
+    case id: getter; break;
+
+/**
+ * Extract one field from a process_info_t record
+ *
+ * Generated from PROCESS_FIELDS: each field's getter becomes one case.
+ * Derived strings (e.g. uptime) are rendered into the scratch buffer.
+ *
+ * @param record Pointer to a process_info_t
+ * @param field Field id (process_field_t)
+ * @param scratch Buffer for derived string values
+ * @param scratch_size Size of scratch buffer
+ * @return The field value
+ */
+static field_value_t process_field_get(const void *record, int field,
+                                       char *scratch, size_t scratch_size) {
+    const process_info_t *p = record;
+    field_value_t v = {0};
+
+    switch ((process_field_t)field) {
+        PROCESS_FIELDS(FIELD_GET_CASE)
+        case PF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+/**
+ * Extract one field from a connection_info_t record
+ *
+ * Generated from CONNECTION_FIELDS, see process_field_get().
+ *
+ * @param record Pointer to a connection_info_t
+ * @param field Field id (connection_field_t)
+ * @param scratch Buffer for derived string values (unused)
+ * @param scratch_size Size of scratch buffer (unused)
+ * @return The field value
+ */
+static field_value_t connection_field_get(const void *record, int field,
+                                          char *scratch, size_t scratch_size) {
+    const connection_info_t *c = record;
+    field_value_t v = {0};
+    (void)scratch;
+    (void)scratch_size;
+
+    switch ((connection_field_t)field) {
+        CONNECTION_FIELDS(FIELD_GET_CASE)
+        case CF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+/**
+ * Extract one field from a user_usage_t record
+ *
+ * Generated from USER_FIELDS, see process_field_get().
+ *
+ * @param record Pointer to a user_usage_t
+ * @param field Field id (user_field_t)
+ * @param scratch Buffer for derived string values (unused)
+ * @param scratch_size Size of scratch buffer (unused)
+ * @return The field value
+ */
+static field_value_t user_field_get(const void *record, int field,
+                                    char *scratch, size_t scratch_size) {
+    const user_usage_t *u = record;
+    field_value_t v = {0};
+    (void)scratch;
+    (void)scratch_size;
+
+    switch ((user_field_t)field) {
+        USER_FIELDS(FIELD_GET_CASE)
+        case UF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+/**
+ * Extract one field from a history_record_t record
+ *
+ * Generated from HISTORY_FIELDS, see process_field_get(). The sample time
+ * is also rendered as local date and time into the scratch buffer.
+ *
+ * @param record Pointer to a history_record_t
+ * @param field Field id (history_field_t)
+ * @param scratch Buffer for derived string values
+ * @param scratch_size Size of scratch buffer
+ * @return The field value
+ */
+static field_value_t history_field_get(const void *record, int field,
+                                       char *scratch, size_t scratch_size) {
+    const history_record_t *h = record;
+    field_value_t v = {0};
+
+    switch ((history_field_t)field) {
+        HISTORY_FIELDS(FIELD_GET_CASE)
+        case HF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+/**
+ * Extract one field from a conn_group_t record
+ *
+ * Generated from GROUP_FIELDS, see process_field_get().
+ *
+ * @param record Pointer to a conn_group_t
+ * @param field Field id (group_field_t)
+ * @param scratch Buffer for derived string values (unused)
+ * @param scratch_size Size of scratch buffer (unused)
+ * @return The field value
+ */
+static field_value_t group_field_get(const void *record, int field,
+                                     char *scratch, size_t scratch_size) {
+    const conn_group_t *g = record;
+    field_value_t v = {0};
+    (void)scratch;
+    (void)scratch_size;
+
+    switch ((group_field_t)field) {
+        GROUP_FIELDS(FIELD_GET_CASE)
+        case GF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+/**
+ * Extract one field from an ephemeral_dest_t record
+ *
+ * Generated from EPHEMERAL_FIELDS, see process_field_get().
+ *
+ * @param record Pointer to an ephemeral_dest_t
+ * @param field Field id (ephemeral_field_t)
+ * @param scratch Buffer for derived string values (unused)
+ * @param scratch_size Size of scratch buffer (unused)
+ * @return The field value
+ */
+static field_value_t ephemeral_field_get(const void *record, int field,
+                                         char *scratch, size_t scratch_size) {
+    const ephemeral_dest_t *d = record;
+    field_value_t v = {0};
+    (void)scratch;
+    (void)scratch_size;
+
+    switch ((ephemeral_field_t)field) {
+        EPHEMERAL_FIELDS(FIELD_GET_CASE)
+        case EF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+/**
+ * Extract one field from a forest_node_t record
+ *
+ * Generated from FOREST_FIELDS, see process_field_get().
+ *
+ * @param record Pointer to a forest_node_t
+ * @param field Field id (forest_field_t)
+ * @param scratch Buffer for derived string values (unused)
+ * @param scratch_size Size of scratch buffer (unused)
+ * @return The field value
+ */
+static field_value_t forest_field_get(const void *record, int field,
+                                      char *scratch, size_t scratch_size) {
+    const forest_node_t *n = record;
+    field_value_t v = {0};
+    (void)scratch;
+    (void)scratch_size;
+
+    switch ((forest_field_t)field) {
+        FOREST_FIELDS(FIELD_GET_CASE)
+        case FF_COUNT:
+            break;
+    }
+
+    return v;
+}
+
+const field_schema_t process_schema = {
+    process_fields, PF_COUNT, process_field_get
+};
+
+const field_schema_t connection_schema = {
+    connection_fields, CF_COUNT, connection_field_get
+};
+
+const field_schema_t user_schema = {
+    user_fields, UF_COUNT, user_field_get
+};
+
+const field_schema_t history_schema = {
+    history_fields, HF_COUNT, history_field_get
+};
+
+const field_schema_t group_schema = {
+    group_fields, GF_COUNT, group_field_get
+};
+
+const field_schema_t ephemeral_schema = {
+    ephemeral_fields, EF_COUNT, ephemeral_field_get
+};
+
+const field_schema_t forest_schema = {
+    forest_fields, FF_COUNT, forest_field_get
+};
+
+/**
+ * Render one field of a record as text
+ *
+ * String fields are returned as-is (no copy); numeric and character fields
+ * are formatted into the caller's buffer, which also serves as scratch space
+ * for derived string values.
+ *
+ * @param schema Schema describing the record type
+ * @param field Field id within the schema
+ * @param record Pointer to the record
+ * @param buf Output/scratch buffer
+ * @param size Size of buf
+ * @return Pointer to the rendered text (either into the record or buf)
+ */
+const char *field_format(const field_schema_t *schema, int field, const void *record,
+                         char *buf, size_t size) {
+    const field_value_t v = schema->get(record, field, buf, size);
+
+    switch (schema->fields[field].type) {
+        case FIELD_INT:
+            snprintf(buf, size, "%lld", v.i);
+            return buf;
+        case FIELD_UINT:
+            snprintf(buf, size, "%llu", v.u);
+            return buf;
+        case FIELD_CHAR:
+            snprintf(buf, size, "%c", v.c);
+            return buf;
+        case FIELD_STR:
+            return v.s ? v.s : "";
+    }
+
+    return "";
+}
+
+/**
+ * Compute the platform sources required by a layout
+ *
+ * ORs together the source bits of every field referenced by the layout, so
+ * callers can ask the platform layer to read only what will be printed.
+ *
+ * @param schema Schema the layout refers to
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @return Bitmask of PROC_SRC_* / CONN_SRC_* flags
+ */
+unsigned int field_layout_sources(const field_schema_t *schema,
+                                  const field_layout_t *layout, size_t count) {
+    unsigned int sources = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        sources |= schema->fields[layout[i].field].source;
+    }
+
+    return sources;
+}
@@ -0,0 +1,231 @@
+#ifndef FIELDS_H
+#define FIELDS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "platform.h"
+#include "usage.h"
+#include "history.h"
+#include "group.h"
+#include "ephemeral.h"
+#include "forest.h"
+
+/**
+ * Field value types
+ *
+ * Every formatter switches on this to decide how a value is rendered
+ * (quoted or not in JSON, integer or text in the tabular formats).
+ */
+typedef enum {
+    FIELD_INT,      /* Signed integer (pid, uid, ports, timestamps) */
+    FIELD_UINT,     /* Unsigned integer (memory sizes) */
+    FIELD_CHAR,     /* Single character (process state code) */
+    FIELD_STR       /* NUL-terminated string */
+} field_type_t;
+
+/**
+ * A single field value extracted from a record
+ *
+ * Only the member matching the field's type is meaningful.
+ */
+typedef struct {
+    long long i;
+    unsigned long long u;
+    char c;
+    const char *s;
+} field_value_t;
+
+/**
+ * Field descriptor
+ *
+ * Fields:
+ * - key: Name used in JSON (and any other keyed format)
+ * - header: Column heading used by tabular formats
+ * - type: Value type (see field_type_t)
+ * - source: PROC_SRC_* / CONN_SRC_* bits the platform layer must read to populate it
+ * - group: Name of the nested JSON object the field belongs to, or NULL
+ */
+typedef struct {
+    const char *key;
+    const char *header;
+    field_type_t type;
+    unsigned int source;
+    const char *group;
+} field_desc_t;
+
+/**
+ * Field tables
+ *
+ * Each table is an X-macro: X(id, key, header, type, source, group, getter).
+ * The getter is a statement that stores the value of the field into `v`
+ * given the record (`p` for processes, `c` for connections, `u` for per-user
+ * totals, `h` for recorded samples, `g` for connection groups, `d` for
+ * ephemeral destinations, `n` for process forest nodes) and a scratch
+ * buffer (`scratch`, `scratch_size`) for derived string values.
+ *
+ * Adding a field means adding one line here; every formatter picks it up
+ * through the layouts in src/output.c, and the platform layer reads only
+ * the sources the selected layout asks for.
+ */
+#define PROCESS_FIELDS(X) \
+    X(PF_PID,        "pid",        "PID",     FIELD_INT,  PROC_SRC_STAT,    NULL,     v.i = p->pid) \
+    X(PF_PPID,       "ppid",       "PPID",    FIELD_INT,  PROC_SRC_STAT,    NULL,     v.i = p->ppid) \
+    X(PF_NAME,       "name",       "NAME",    FIELD_STR,  PROC_SRC_STAT,    NULL,     v.s = p->name) \
+    X(PF_USER,       "user",       "USER",    FIELD_STR,  PROC_SRC_USER,    NULL,     v.s = p->username) \
+    X(PF_UID,        "uid",        "UID",     FIELD_INT,  PROC_SRC_STATUS,  NULL,     v.i = p->uid) \
+    X(PF_STATE,      "state",      "S",       FIELD_CHAR, PROC_SRC_STAT,    NULL,     v.c = p->state) \
+    X(PF_STATE_NAME, "state_name", "STATE",   FIELD_STR,  PROC_SRC_STAT,    NULL,     v.s = get_state_name(p->state)) \
+    X(PF_START_TIME, "start_time", "START",   FIELD_INT,  PROC_SRC_START,   NULL,     v.i = (long long)p->start_time) \
+    X(PF_UPTIME,     "uptime",     "UPTIME",  FIELD_STR,  PROC_SRC_START,   NULL,     v.s = (format_uptime(p->start_time, scratch, scratch_size), scratch)) \
+    X(PF_CMDLINE,    "cmdline",    "COMMAND", FIELD_STR,  PROC_SRC_CMDLINE, NULL,     v.s = p->cmdline) \
+    X(PF_VSZ,        "vsz_kb",     "VSZ",     FIELD_UINT, PROC_SRC_STATUS,  "memory", v.u = p->vsz) \
+    X(PF_RSS,        "rss_kb",     "RSS",     FIELD_UINT, PROC_SRC_STATUS,  "memory", v.u = p->rss)
+
+#define CONNECTION_FIELDS(X) \
+    X(CF_PROTOCOL,      "protocol",       "PROTO",       FIELD_STR,  CONN_SRC_NET,  NULL,            v.s = c->protocol) \
+    X(CF_STATE,         "state",          "STATE",       FIELD_STR,  CONN_SRC_NET,  NULL,            v.s = c->state) \
+    X(CF_LOCAL_ADDR,    "local_address",  "LOCAL",       FIELD_STR,  CONN_SRC_NET,  NULL,            v.s = c->local_addr) \
+    X(CF_LOCAL_PORT,    "local_port",     "LPORT",       FIELD_INT,  CONN_SRC_NET,  NULL,            v.i = c->local_port) \
+    X(CF_REMOTE_ADDR,   "remote_address", "REMOTE",      FIELD_STR,  CONN_SRC_NET,  NULL,            v.s = c->remote_addr) \
+    X(CF_REMOTE_PORT,   "remote_port",    "RPORT",       FIELD_INT,  CONN_SRC_NET,  NULL,            v.i = c->remote_port) \
+    X(CF_RX_QUEUE,      "rx_queue",       "RECV-Q",      FIELD_UINT, CONN_SRC_NET,  NULL,            v.u = c->rx_queue) \
+    X(CF_TX_QUEUE,      "tx_queue",       "SEND-Q",      FIELD_UINT, CONN_SRC_NET,  NULL,            v.u = c->tx_queue) \
+    X(CF_BACKLOG,       "backlog",        "BACKLOG",     FIELD_INT,  CONN_SRC_DIAG, NULL,            v.i = c->backlog) \
+    X(CF_PID,           "pid",            "PID",         FIELD_INT,  CONN_SRC_NET,  NULL,            v.i = c->pid) \
+    X(CF_OWNERS,        "owner_count",    "OWNERS",      FIELD_INT,  CONN_SRC_NET,  NULL,            v.i = c->owner_count) \
+    X(CF_RTT,           "rtt_us",         "RTT",         FIELD_UINT, CONN_SRC_DIAG, "tcp_info",      v.u = c->tcp.rtt_us) \
+    X(CF_RTT_VAR,       "rttvar_us",      "RTTVAR",      FIELD_UINT, CONN_SRC_DIAG, "tcp_info",      v.u = c->tcp.rttvar_us) \
+    X(CF_RETRANSMITS,   "retransmits",    "RETRANS",     FIELD_UINT, CONN_SRC_DIAG, "tcp_info",      v.u = c->tcp.retransmits) \
+    X(CF_TOTAL_RETRANS, "total_retrans",  "TOT-RETRANS", FIELD_UINT, CONN_SRC_DIAG, "tcp_info",      v.u = c->tcp.total_retrans) \
+    X(CF_CWND,          "snd_cwnd",       "CWND",        FIELD_UINT, CONN_SRC_DIAG, "tcp_info",      v.u = c->tcp.snd_cwnd) \
+    X(CF_UNACKED,       "unacked",        "UNACKED",     FIELD_UINT, CONN_SRC_DIAG, "tcp_info",      v.u = c->tcp.unacked) \
+    X(CF_RMEM_ALLOC,    "rmem_alloc",     "RMEM",        FIELD_UINT, CONN_SRC_DIAG, "socket_memory", v.u = c->tcp.rmem_alloc) \
+    X(CF_RCVBUF,        "rcvbuf",         "RCVBUF",      FIELD_UINT, CONN_SRC_DIAG, "socket_memory", v.u = c->tcp.rcvbuf) \
+    X(CF_WMEM_ALLOC,    "wmem_alloc",     "WMEM",        FIELD_UINT, CONN_SRC_DIAG, "socket_memory", v.u = c->tcp.wmem_alloc) \
+    X(CF_SNDBUF,        "sndbuf",         "SNDBUF",      FIELD_UINT, CONN_SRC_DIAG, "socket_memory", v.u = c->tcp.sndbuf) \
+    X(CF_WMEM_QUEUED,   "wmem_queued",    "WQUEUED",     FIELD_UINT, CONN_SRC_DIAG, "socket_memory", v.u = c->tcp.wmem_queued) \
+    X(CF_DROPS,         "drops",          "DROPS",       FIELD_UINT, CONN_SRC_DIAG, "socket_memory", v.u = c->tcp.drops)
+
+#define USER_FIELDS(X) \
+    X(UF_USER,      "user",      "USER",    FIELD_STR,  PROC_SRC_USER,   NULL,     v.s = u->username) \
+    X(UF_UID,       "uid",       "UID",     FIELD_INT,  PROC_SRC_STATUS, NULL,     v.i = u->uid) \
+    X(UF_PROCESSES, "processes", "PROCS",   FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = u->processes) \
+    X(UF_ZOMBIES,   "zombies",   "ZOMBIES", FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = u->zombies) \
+    X(UF_SOCKETS,   "sockets",   "SOCKETS", FIELD_INT,  CONN_SRC_NET,    NULL,     v.i = u->sockets) \
+    X(UF_VSZ,       "vsz_kb",    "VSZ",     FIELD_UINT, PROC_SRC_STATUS, "memory", v.u = u->vsz) \
+    X(UF_RSS,       "rss_kb",    "RSS",     FIELD_UINT, PROC_SRC_STATUS, "memory", v.u = u->rss)
+
+#define HISTORY_FIELDS(X) \
+    X(HF_TIME,       "time",       "EPOCH",   FIELD_INT,  HISTORY_SOURCES, NULL,     v.i = h->time) \
+    X(HF_TIMESTAMP,  "timestamp",  "TIME",    FIELD_STR,  HISTORY_SOURCES, NULL,     v.s = (format_timestamp((time_t)h->time, scratch, scratch_size), scratch)) \
+    X(HF_PID,        "pid",        "PID",     FIELD_INT,  HISTORY_SOURCES, NULL,     v.i = h->pid) \
+    X(HF_PPID,       "ppid",       "PPID",    FIELD_INT,  HISTORY_SOURCES, NULL,     v.i = h->ppid) \
+    X(HF_NAME,       "name",       "NAME",    FIELD_STR,  HISTORY_SOURCES, NULL,     v.s = h->name) \
+    X(HF_UID,        "uid",        "UID",     FIELD_INT,  HISTORY_SOURCES, NULL,     v.i = h->uid) \
+    X(HF_STATE,      "state",      "S",       FIELD_CHAR, HISTORY_SOURCES, NULL,     v.c = h->state) \
+    X(HF_START_TIME, "start_time", "START",   FIELD_INT,  HISTORY_SOURCES, NULL,     v.i = h->start_time) \
+    X(HF_VSZ,        "vsz_kb",     "VSZ",     FIELD_UINT, HISTORY_SOURCES, "memory", v.u = h->vsz) \
+    X(HF_RSS,        "rss_kb",     "RSS",     FIELD_UINT, HISTORY_SOURCES, "memory", v.u = h->rss)
+
+#define GROUP_FIELDS(X) \
+    X(GF_GROUP,       "group",       "GROUP",   FIELD_STR,  CONN_SRC_NET, NULL, v.s = g->key) \
+    X(GF_PID,         "pid",         "PID",     FIELD_INT,  CONN_SRC_NET, NULL, v.i = g->pid) \
+    X(GF_NAME,        "name",        "NAME",    FIELD_STR,  CONN_SRC_NET, NULL, v.s = g->name) \
+    X(GF_CONNECTIONS, "connections", "CONNS",   FIELD_INT,  CONN_SRC_NET, NULL, v.i = g->connections)
+
+#define EPHEMERAL_FIELDS(X) \
+    X(EF_DESTINATION, "destination", "DESTINATION", FIELD_STR, CONN_SRC_NET, NULL, v.s = d->destination) \
+    X(EF_PORT,        "port",        "PORT",        FIELD_INT, CONN_SRC_NET, NULL, v.i = d->port) \
+    X(EF_CONNECTIONS, "connections", "CONNS",       FIELD_INT, CONN_SRC_NET, NULL, v.i = d->connections) \
+    X(EF_ESTABLISHED, "established", "ESTAB",       FIELD_INT, CONN_SRC_NET, NULL, v.i = d->established) \
+    X(EF_TIME_WAIT,   "time_wait",   "TIME_WAIT",   FIELD_INT, CONN_SRC_NET, NULL, v.i = d->time_wait) \
+    X(EF_OTHER,       "other",       "OTHER",       FIELD_INT, CONN_SRC_NET, NULL, v.i = d->other) \
+    X(EF_USED_PCT,    "used_pct",    "USED%",       FIELD_INT, CONN_SRC_NET, NULL, v.i = d->used_pct)
+
+#define FOREST_FIELDS(X) \
+    X(FF_PID,             "pid",             "PID",             FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = n->info->pid) \
+    X(FF_PPID,            "ppid",            "PPID",            FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = n->info->ppid) \
+    X(FF_DEPTH,           "depth",           "DEPTH",           FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = n->depth) \
+    X(FF_NAME,            "name",            "NAME",            FIELD_STR,  PROC_SRC_STAT,   NULL,     v.s = n->info->name) \
+    X(FF_USER,            "user",            "USER",            FIELD_STR,  PROC_SRC_USER,   NULL,     v.s = n->info->username) \
+    X(FF_SOCKETS,         "sockets",         "SOCKETS",         FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = n->sockets) \
+    X(FF_VSZ,             "vsz_kb",          "VSZ",             FIELD_UINT, PROC_SRC_STATUS, "memory", v.u = n->info->vsz) \
+    X(FF_RSS,             "rss_kb",          "RSS",             FIELD_UINT, PROC_SRC_STATUS, "memory", v.u = n->info->rss) \
+    X(FF_DESCENDANTS,     "descendants",     "DESCENDANTS",     FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = n->descendants) \
+    X(FF_SUBTREE_SOCKETS, "subtree_sockets", "SUBTREE-SOCKETS", FIELD_INT,  PROC_SRC_STAT,   NULL,     v.i = n->subtree_sockets) \
+    X(FF_SUBTREE_VSZ,     "subtree_vsz_kb",  "SUBTREE-VSZ",     FIELD_UINT, PROC_SRC_STATUS, NULL,     v.u = n->subtree_vsz) \
+    X(FF_SUBTREE_RSS,     "subtree_rss_kb",  "SUBTREE-RSS",     FIELD_UINT, PROC_SRC_STATUS, NULL,     v.u = n->subtree_rss)
+
+#define FIELD_ENUM_ENTRY(id, key, header, type, source, group, getter) id,
+
+typedef enum { PROCESS_FIELDS(FIELD_ENUM_ENTRY) PF_COUNT } process_field_t;
+typedef enum { CONNECTION_FIELDS(FIELD_ENUM_ENTRY) CF_COUNT } connection_field_t;
+typedef enum { USER_FIELDS(FIELD_ENUM_ENTRY) UF_COUNT } user_field_t;
+typedef enum { HISTORY_FIELDS(FIELD_ENUM_ENTRY) HF_COUNT } history_field_t;
+typedef enum { GROUP_FIELDS(FIELD_ENUM_ENTRY) GF_COUNT } group_field_t;
+typedef enum { EPHEMERAL_FIELDS(FIELD_ENUM_ENTRY) EF_COUNT } ephemeral_field_t;
+typedef enum { FOREST_FIELDS(FIELD_ENUM_ENTRY) FF_COUNT } forest_field_t;
+
+/**
+ * Field schema - a descriptor table plus the accessor for one record type
+ */
+typedef struct {
+    const field_desc_t *fields;
+    int count;
+    field_value_t (*get)(const void *record, int field, char *scratch, size_t scratch_size);
+} field_schema_t;
+
+extern const field_schema_t process_schema;
+extern const field_schema_t connection_schema;
+extern const field_schema_t user_schema;
+extern const field_schema_t history_schema;
+extern const field_schema_t group_schema;
+extern const field_schema_t ephemeral_schema;
+extern const field_schema_t forest_schema;
+
+/**
+ * Field layout - how one field is placed by a particular output format
+ *
+ * Formats are arrays of layouts over a schema. The same generic emitters
+ * render every format, so a layout only describes decoration:
+ *
+ * - field: Field id within the schema
+ * - label: Pretty-format label printed as "  <label>: " (NULL for none)
+ * - label_color: Color of the label (NULL for plain)
+ * - prefix / suffix: Literal text around the value
+ * - fallback: Text printed instead of an empty string value
+ * - color: Color of the value itself
+ * - width: Minimum (left-aligned) column width, 0 for none
+ * - precision: Maximum number of characters printed, 0 for unlimited
+ * - optional: Skip the entry entirely when the value is empty
+ */
+typedef struct {
+    int field;
+    const char *label;
+    const char *label_color;
+    const char *prefix;
+    const char *suffix;
+    const char *fallback;
+    const char *color;
+    int width;
+    int precision;
+    bool optional;
+} field_layout_t;
+
+/**
+ * Render one field of a record as text
+ *
+ * See src/fields.c for detailed documentation.
+ */
+const char *field_format(const field_schema_t *schema, int field, const void *record,
+                         char *buf, size_t size);
+
+/**
+ * Compute the platform sources required by a layout
+ *
+ * See src/fields.c for detailed documentation.
+ */
+unsigned int field_layout_sources(const field_schema_t *schema,
+                                  const field_layout_t *layout, size_t count);
+
+#endif /* FIELDS_H */
@@ -0,0 +1,325 @@
+#include "forest.h"
+#include "fields.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/**
+ * Compare two processes by PID for qsort()
+ *
+ * @param a First process_info_t
+ * @param b Second process_info_t
+ * @return <0, 0 or >0 as for qsort()
+ */
+static int compare_by_pid(const void *a, const void *b) {
+    const pid_t x = ((const process_info_t *)a)->pid;
+    const pid_t y = ((const process_info_t *)b)->pid;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Find the index of a PID in the snapshot (binary search)
+ *
+ * @param forest Forest (procs sorted by PID)
+ * @param pid Process ID
+ * @return Index into forest->procs and forest->nodes, -1 if absent
+ */
+static int index_of(const process_forest_t *forest, pid_t pid) {
+    int low = 0;
+    int high = forest->count - 1;
+
+    while (low <= high) {
+        const int mid = low + (high - low) / 2;
+        if (forest->procs[mid].pid == pid) {
+            return mid;
+        }
+        if (forest->procs[mid].pid < pid) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Start a forest from one process snapshot
+ *
+ * Takes ownership of the snapshot, sorts it by PID and links each process
+ * to its parent. A process whose parent is not in the snapshot (PID 1,
+ * kernel threads' kthreadd, or a parent that exited mid-scan) becomes a
+ * root. Add sockets with forest_add_socket(), then call forest_finish().
+ *
+ * The records must have been read with at least FOREST_PROCESS_SOURCES.
+ *
+ * @param forest Forest to initialize
+ * @param procs Process snapshot (freed by forest_free(), even on failure)
+ * @param count Number of processes
+ * @return 0 on success, -1 if memory is exhausted (free the forest)
+ */
+int forest_build(process_forest_t *forest, process_info_t *procs, int count) {
+    memset(forest, 0, sizeof(*forest));
+
+    if (count > 0) {
+        qsort(procs, (size_t)count, sizeof(process_info_t), compare_by_pid);
+    }
+
+    forest->procs = procs;
+    forest->count = count;
+    forest->nodes = counted_calloc((size_t)(count > 0 ? count : 1), sizeof(forest_node_t));
+    if (!forest->nodes) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        forest_node_t *node = &forest->nodes[i];
+        node->info = &procs[i];
+
+        const int parent = procs[i].ppid != procs[i].pid ? index_of(forest, procs[i].ppid) : -1;
+        node->parent = parent >= 0 ? &forest->nodes[parent] : NULL;
+    }
+    return 0;
+}
+
+/**
+ * Count one socket held by a process
+ *
+ * A socket shared by several processes (e.g. a listener inherited by
+ * prefork workers) is counted once for each of them.
+ *
+ * @param forest Forest being built
+ * @param pid Process holding the socket
+ * @return void
+ */
+void forest_add_socket(process_forest_t *forest, pid_t pid) {
+    forest_node_t *node = forest_find(forest, pid);
+    if (node) {
+        node->sockets++;
+    }
+}
+
+/**
+ * Compare two forest nodes on one column
+ *
+ * Identity columns (pid, ppid, depth, name, user) sort ascending, counts
+ * and sizes descending (largest first, which is what triage wants); ties
+ * fall back to ascending PID so the order is stable across runs.
+ *
+ * @param a First node
+ * @param b Second node
+ * @param field Column (forest_field_t)
+ * @return <0, 0 or >0 as for qsort()
+ */
+static int compare_on(const forest_node_t *a, const forest_node_t *b, int field) {
+    const field_value_t va = forest_schema.get(a, field, NULL, 0);
+    const field_value_t vb = forest_schema.get(b, field, NULL, 0);
+    int cmp = 0;
+
+    switch (forest_schema.fields[field].type) {
+        case FIELD_INT:
+            cmp = field == FF_PID || field == FF_PPID || field == FF_DEPTH
+                      ? (va.i > vb.i) - (va.i < vb.i)
+                      : (vb.i > va.i) - (vb.i < va.i);
+            break;
+        case FIELD_UINT:
+            cmp = (vb.u > va.u) - (vb.u < va.u);
+            break;
+        case FIELD_CHAR:
+            cmp = (va.c > vb.c) - (va.c < vb.c);
+            break;
+        case FIELD_STR:
+            cmp = strcmp(va.s ? va.s : "", vb.s ? vb.s : "");
+            break;
+    }
+
+    return cmp != 0 ? cmp : (a->info->pid > b->info->pid) - (a->info->pid < b->info->pid);
+}
+
+/* One qsort() comparator per column (over forest_node_t pointers), generated from FOREST_FIELDS */
+#define FOREST_COMPARATOR(id, key, header, type, source, group, getter)         \
+    static int compare_##id(const void *a, const void *b) {                     \
+        return compare_on(*(forest_node_t *const *)a, *(forest_node_t *const *)b, id); \
+    }
+FOREST_FIELDS(FOREST_COMPARATOR)
+
+#define FOREST_COMPARATOR_ENTRY(id, key, header, type, source, group, getter) \
+    [id] = compare_##id,
+
+static int (*const comparators[])(const void *, const void *) = {
+    FOREST_FIELDS(FOREST_COMPARATOR_ENTRY)
+};
+
+/**
+ * Resolve a --sort column name for the process forest
+ *
+ * Accepts a column's JSON key or its table heading, in any case, so
+ * "subtree-rss", "SUBTREE-RSS" and "subtree_rss_kb" all select the
+ * resident memory of the whole subtree.
+ *
+ * @param name Column key or heading (e.g. "subtree-rss", "descendants", "pid")
+ * @return Field id (forest_field_t), or -1 if there is no such column
+ */
+int forest_sort_field(const char *name) {
+    for (int f = 0; f < forest_schema.count; f++) {
+        if (strcasecmp(name, forest_schema.fields[f].key) == 0 ||
+            strcasecmp(name, forest_schema.fields[f].header) == 0) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Link the children, roll up the subtree totals and order the forest
+ *
+ * Everything works on flat arrays, with no per-node allocation:
+ *
+ * 1. Child lists: a counting pass sizes each node's run in one shared
+ *    pointer array (roots first), a second pass fills the runs.
+ * 2. Totals: a breadth-first walk from the roots lists every node after its
+ *    parent; walking that index array backwards visits children before
+ *    parents (post-order), so one pass adds each node's totals into its
+ *    parent and every subtree is complete by the time its root is reached.
+ * 3. Order: roots and each run of siblings are sorted on sort_field (which
+ *    may be a subtree total, hence after step 2), then an explicit-stack
+ *    depth-first walk fills forest->order for display.
+ *
+ * Processes that cannot be reached from a root (only possible if a
+ * reparenting race made the snapshot's parent links loop) are left out of
+ * forest->order.
+ *
+ * @param forest Forest from forest_build() with its sockets added
+ * @param sort_field Column siblings are ordered by (forest_field_t)
+ * @return 0 on success, -1 if memory is exhausted (free the forest)
+ */
+int forest_finish(process_forest_t *forest, int sort_field) {
+    const int count = forest->count;
+    forest_node_t *nodes = forest->nodes;
+
+    forest->links = counted_malloc((size_t)(count > 0 ? count : 1) * sizeof(forest_node_t *));
+    forest->order = counted_malloc((size_t)(count > 0 ? count : 1) * sizeof(forest_node_t *));
+    if (!forest->links || !forest->order) {
+        return -1;
+    }
+
+    /* 1. Child runs: size, place, fill */
+    for (int i = 0; i < count; i++) {
+        if (nodes[i].parent) {
+            nodes[i].parent->child_count++;
+        } else {
+            forest->root_count++;
+        }
+    }
+
+    forest->roots = forest->links;
+    int next = forest->root_count;
+    for (int i = 0; i < count; i++) {
+        nodes[i].children = forest->links + next;
+        next += nodes[i].child_count;
+        nodes[i].child_count = 0;
+    }
+
+    int roots = 0;
+    for (int i = 0; i < count; i++) {
+        forest_node_t *parent = nodes[i].parent;
+        if (parent) {
+            parent->children[parent->child_count++] = &nodes[i];
+        } else {
+            forest->roots[roots++] = &nodes[i];
+        }
+    }
+
+    /* 2. Breadth-first index, then one backwards (post-order) pass */
+    forest_node_t **order = forest->order;
+    int reached = 0;
+    for (int r = 0; r < forest->root_count; r++) {
+        order[reached++] = forest->roots[r];
+    }
+    for (int head = 0; head < reached; head++) {
+        forest_node_t *node = order[head];
+        for (int c = 0; c < node->child_count; c++) {
+            node->children[c]->depth = node->depth + 1;
+            order[reached++] = node->children[c];
+        }
+    }
+
+    for (int k = reached - 1; k >= 0; k--) {
+        forest_node_t *node = order[k];
+        node->subtree_sockets += node->sockets;
+        node->subtree_vsz += node->info->vsz;
+        node->subtree_rss += node->info->rss;
+
+        forest_node_t *parent = node->parent;
+        if (parent) {
+            parent->descendants += node->descendants + 1;
+            parent->subtree_sockets += node->subtree_sockets;
+            parent->subtree_vsz += node->subtree_vsz;
+            parent->subtree_rss += node->subtree_rss;
+        }
+    }
+
+    /* 3. Sort siblings, then lay the trees out depth-first */
+    int (*const compare)(const void *, const void *) = comparators[sort_field];
+    qsort(forest->roots, (size_t)forest->root_count, sizeof(forest_node_t *), compare);
+    for (int i = 0; i < count; i++) {
+        if (nodes[i].child_count > 1) {
+            qsort(nodes[i].children, (size_t)nodes[i].child_count, sizeof(forest_node_t *),
+                  compare);
+        }
+    }
+
+    /* The stack never holds more nodes than were reached */
+    forest_node_t **stack = counted_malloc((size_t)(reached > 0 ? reached : 1) *
+                                           sizeof(forest_node_t *));
+    if (!stack) {
+        return -1;
+    }
+    int top = 0;
+    for (int r = forest->root_count - 1; r >= 0; r--) {
+        forest->roots[r]->last = r == forest->root_count - 1;
+        stack[top++] = forest->roots[r];
+    }
+
+    forest->order_count = 0;
+    while (top > 0) {
+        forest_node_t *node = stack[--top];
+        node->position = forest->order_count;
+        order[forest->order_count++] = node;
+
+        for (int c = node->child_count - 1; c >= 0; c--) {
+            node->children[c]->last = c == node->child_count - 1;
+            stack[top++] = node->children[c];
+        }
+    }
+
+    free(stack);
+    return 0;
+}
+
+/**
+ * Find the node of a process
+ *
+ * @param forest Forest
+ * @param pid Process ID
+ * @return Node, or NULL if the process is not in the snapshot
+ */
+forest_node_t *forest_find(const process_forest_t *forest, pid_t pid) {
+    const int i = index_of(forest, pid);
+    return i >= 0 ? &forest->nodes[i] : NULL;
+}
+
+/**
+ * Release a forest and the process snapshot it owns
+ *
+ * @param forest Forest to free
+ * @return void
+ */
+void forest_free(process_forest_t *forest) {
+    free(forest->procs);
+    free(forest->nodes);
+    free(forest->links);
+    free(forest->order);
+    memset(forest, 0, sizeof(*forest));
+}
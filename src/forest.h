@@ -0,0 +1,83 @@
+#ifndef FOREST_H
+#define FOREST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "platform.h"
+
+/* Process sources the forest needs (parent, name, user and memory) */
+#define FOREST_PROCESS_SOURCES (PROC_SRC_STAT | PROC_SRC_STATUS | PROC_SRC_USER)
+
+/**
+ * One process in the forest, with the totals of the subtree it roots
+ *
+ * Fields:
+ * - info: The process (points into process_forest_t.procs)
+ * - parent: Parent node, NULL for a root (no parent in the snapshot)
+ * - children: Child nodes, in sort order (a run of process_forest_t.links)
+ * - child_count: Number of children
+ * - depth: Distance from the root of its tree (roots are 0)
+ * - position: Index in process_forest_t.order; the subtree is the
+ *   descendants + 1 entries starting there
+ * - last: Last of its siblings in sort order (drawing the tree needs it)
+ * - sockets: TCP/UDP sockets the process holds
+ * - descendants: Number of processes below it
+ * - subtree_sockets, subtree_vsz, subtree_rss: Sockets and memory (KB) of
+ *   the process and all of its descendants
+ */
+typedef struct forest_node {
+    const process_info_t *info;
+    struct forest_node *parent;
+    struct forest_node **children;
+    int child_count;
+    int depth;
+    int position;
+    bool last;
+    int sockets;
+    int descendants;
+    int subtree_sockets;
+    unsigned long subtree_vsz;
+    unsigned long subtree_rss;
+} forest_node_t;
+
+/**
+ * Every process of one scan, linked into trees
+ *
+ * All nodes live in one flat array parallel to the process snapshot (sorted
+ * by PID, so a node is found by binary search); child lists are runs of a
+ * single pointer array, and order holds the nodes depth-first, parents
+ * before children, siblings in sort order.
+ */
+typedef struct {
+    process_info_t *procs;
+    forest_node_t *nodes;
+    int count;
+    forest_node_t **links;
+    forest_node_t **roots;
+    int root_count;
+    forest_node_t **order;
+    int order_count;
+} process_forest_t;
+
+/**
+ * Forest functions
+ *
+ * See src/forest.c for detailed documentation of each function.
+ */
+int forest_build(process_forest_t *forest, process_info_t *procs, int count);
+void forest_add_socket(process_forest_t *forest, pid_t pid);
+int forest_finish(process_forest_t *forest, int sort_field);
+forest_node_t *forest_find(const process_forest_t *forest, pid_t pid);
+void forest_free(process_forest_t *forest);
+
+/**
+ * Resolve a --sort column name for the process forest
+ *
+ * See src/forest.c for detailed documentation.
+ *
+ * @param name Column key or heading (e.g. "subtree-rss", "descendants", "pid")
+ * @return Field id (forest_field_t), or -1 if there is no such column
+ */
+int forest_sort_field(const char *name);
+
+#endif /* FOREST_H */
@@ -0,0 +1,286 @@
+#include "group.h"
+#include "utils.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/* Initial number of hash slots (power of two) */
+#define GROUP_MIN_SLOTS 64
+
+/* --group-by names, indexed by group_by_t */
+static const char *const group_by_names[] = {
+    [GROUP_BY_NONE] = "none",
+    [GROUP_BY_PID] = "pid",
+    [GROUP_BY_STATE] = "state",
+    [GROUP_BY_REMOTE] = "remote",
+    [GROUP_BY_REMOTE_SUBNET] = "remote-subnet",
+};
+
+/**
+ * Hash a group key (FNV-1a)
+ *
+ * @param key NUL-terminated key
+ * @return 32-bit hash
+ */
+static uint32_t hash_key(const char *key) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)key; *c; c++) {
+        h = (h ^ *c) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Find the slot holding a key, or the empty slot where it would go
+ *
+ * @param table Group table
+ * @param key Group key
+ * @return Slot index
+ */
+static size_t find_slot(const group_table_t *table, const char *key) {
+    size_t i = hash_key(key) & (table->slot_count - 1);
+    while (table->used[i] && strcmp(table->slots[i].key, key) != 0) {
+        i = (i + 1) & (table->slot_count - 1);
+    }
+    return i;
+}
+
+/**
+ * Resize the table to hold at least `entries` groups at half load
+ *
+ * @param table Group table
+ * @param entries Number of entries the table must accommodate
+ * @return 0 on success, -1 if memory is exhausted (table unchanged)
+ */
+static int reserve(group_table_t *table, size_t entries) {
+    size_t slot_count = GROUP_MIN_SLOTS;
+    while (slot_count < entries * 2) {
+        slot_count *= 2;
+    }
+    if (slot_count <= table->slot_count) {
+        return 0;
+    }
+
+    group_table_t grown = {
+        .by = table->by,
+        .slots = counted_malloc(slot_count * sizeof(conn_group_t)),
+        .used = counted_calloc(slot_count, sizeof(bool)),
+        .slot_count = slot_count,
+        .count = table->count,
+    };
+    if (!grown.slots || !grown.used) {
+        free(grown.slots);
+        free(grown.used);
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->slot_count; i++) {
+        if (table->used[i]) {
+            const size_t j = find_slot(&grown, table->slots[i].key);
+            grown.slots[j] = table->slots[i];
+            grown.used[j] = true;
+        }
+    }
+
+    free(table->slots);
+    free(table->used);
+    *table = grown;
+    return 0;
+}
+
+/**
+ * Write the remote subnet of an address: /24 for IPv4, /64 for IPv6
+ *
+ * Text that is not an address (lsof's "*") is used as is.
+ *
+ * @param addr Remote address as text
+ * @param key Output buffer
+ * @param size Size of key
+ * @return void
+ */
+static void subnet_key(const char *addr, char *key, size_t size) {
+    unsigned char bytes[16];
+    char text[INET6_ADDRSTRLEN];
+
+    if (inet_pton(AF_INET, addr, bytes) == 1) {
+        bytes[3] = 0;
+        inet_ntop(AF_INET, bytes, text, sizeof(text));
+        snprintf(key, size, "%s/24", text);
+    } else if (inet_pton(AF_INET6, addr, bytes) == 1) {
+        memset(bytes + 8, 0, 8);
+        inet_ntop(AF_INET6, bytes, text, sizeof(text));
+        snprintf(key, size, "%s/64", text);
+    } else {
+        snprintf(key, size, "%s", addr);
+    }
+}
+
+/**
+ * Initialize an empty group table
+ *
+ * @param table Table to initialize (free with group_table_free() either way)
+ * @param by What connections are grouped by
+ * @return 0 on success, -1 if memory is exhausted
+ */
+int group_table_init(group_table_t *table, group_by_t by) {
+    memset(table, 0, sizeof(*table));
+    table->by = by;
+    return reserve(table, GROUP_MIN_SLOTS / 2);
+}
+
+/**
+ * Count one connection in its group
+ *
+ * The record can be reused for the next connection as soon as this returns.
+ * Once the table has failed to grow, connections are no longer counted.
+ * When grouping by remote address or subnet, sockets without a peer
+ * (listeners and unconnected UDP sockets, remote port 0) all go to the
+ * GROUP_KEY_LISTENING group rather than to their wildcard address, which
+ * would otherwise show up as a 0.0.0.0/24 or ::/64 "subnet".
+ *
+ * @param table Group table
+ * @param conn Connection to count
+ * @return void
+ */
+void group_add_connection(group_table_t *table, const connection_info_t *conn) {
+    char key[GROUP_KEY_SIZE];
+
+    if (table->failed) {
+        return;
+    }
+
+    switch (table->by) {
+        case GROUP_BY_PID:
+            if (conn->pid > 0) {
+                snprintf(key, sizeof(key), "%d", (int)conn->pid);
+            } else {
+                strcpy(key, "-");
+            }
+            break;
+        case GROUP_BY_STATE:
+            snprintf(key, sizeof(key), "%s", conn->state);
+            break;
+        case GROUP_BY_REMOTE:
+        case GROUP_BY_REMOTE_SUBNET:
+            if (conn->remote_port == 0) {
+                strcpy(key, GROUP_KEY_LISTENING);
+            } else if (table->by == GROUP_BY_REMOTE) {
+                snprintf(key, sizeof(key), "%s", conn->remote_addr);
+            } else {
+                subnet_key(conn->remote_addr, key, sizeof(key));
+            }
+            break;
+        case GROUP_BY_NONE:
+        default:
+            strcpy(key, "-");
+            break;
+    }
+
+    size_t i = find_slot(table, key);
+    if (!table->used[i]) {
+        if (reserve(table, table->count + 1) < 0) {
+            table->failed = true;
+            return;
+        }
+        i = find_slot(table, key);
+
+        conn_group_t *g = &table->slots[i];
+        memset(g, 0, sizeof(*g));
+        strcpy(g->key, key);
+        g->pid = table->by == GROUP_BY_PID && conn->pid > 0 ? conn->pid : -1;
+        table->used[i] = true;
+        table->count++;
+    }
+    table->slots[i].connections++;
+}
+
+/**
+ * Order groups by connection count, largest first, then by key
+ */
+static int compare_groups(const void *a, const void *b) {
+    const conn_group_t *x = a;
+    const conn_group_t *y = b;
+    if (x->connections != y->connections) {
+        return (y->connections > x->connections) - (y->connections < x->connections);
+    }
+    return strcmp(x->key, y->key);
+}
+
+/**
+ * Extract the groups as an array, largest first
+ *
+ * Process names of PID groups are resolved here, once per process rather
+ * than once per connection.
+ *
+ * @param table Group table
+ * @param groups Output: array of groups (caller must free)
+ * @return Number of groups, or -1 if memory ran out while the table was
+ *         filled or now (errno ENOMEM)
+ */
+int group_table_list(const group_table_t *table, conn_group_t **groups) {
+    const size_t count = table->count;
+    *groups = table->failed ? NULL
+                            : counted_malloc((count > 0 ? count : 1) * sizeof(conn_group_t));
+    if (!*groups) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < table->slot_count; i++) {
+        if (table->used[i]) {
+            conn_group_t *g = &(*groups)[n++];
+            *g = table->slots[i];
+
+            process_info_t info;
+            if (g->pid > 0 && platform_get_process_fields(g->pid, &info, PROC_SRC_STAT) == 0) {
+                snprintf(g->name, sizeof(g->name), "%s", info.name);
+            }
+        }
+    }
+
+    qsort(*groups, n, sizeof(conn_group_t), compare_groups);
+    return (int)n;
+}
+
+/**
+ * Release a group table
+ *
+ * @param table Table to free
+ * @return void
+ */
+void group_table_free(group_table_t *table) {
+    free(table->slots);
+    free(table->used);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * Resolve a --group-by name
+ *
+ * @param name pid, state, remote or remote-subnet
+ * @return Grouping, or GROUP_BY_NONE if there is no such grouping
+ */
+group_by_t group_by_parse(const char *name) {
+    for (int by = GROUP_BY_PID; by <= GROUP_BY_REMOTE_SUBNET; by++) {
+        if (strcmp(name, group_by_names[by]) == 0) {
+            return (group_by_t)by;
+        }
+    }
+    return GROUP_BY_NONE;
+}
+
+/**
+ * Name a grouping as written on the command line
+ *
+ * @param by Grouping
+ * @return Name (e.g. "remote-subnet")
+ */
+const char *group_by_name(group_by_t by) {
+    return group_by_names[by];
+}
@@ -0,0 +1,90 @@
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "platform.h"
+
+/* Longest group key: an IPv6 subnet ("<address>/64") */
+#define GROUP_KEY_SIZE 64
+
+/* Remote group of listeners and unconnected UDP sockets (no peer) */
+#define GROUP_KEY_LISTENING "(listening)"
+
+/**
+ * What --group-by aggregates the connections on a port by
+ */
+typedef enum {
+    GROUP_BY_NONE = 0,      /* No grouping: one entry per connection */
+    GROUP_BY_PID,           /* Owning process */
+    GROUP_BY_STATE,         /* TCP state ("-" for UDP) */
+    GROUP_BY_REMOTE,        /* Remote address (GROUP_KEY_LISTENING without a peer) */
+    GROUP_BY_REMOTE_SUBNET  /* Remote /24 (IPv4) or /64 (IPv6), as above */
+} group_by_t;
+
+/**
+ * Connection count of one group
+ *
+ * Fields:
+ * - key: Group value as text (PID, state, address or subnet, or
+ *   GROUP_KEY_LISTENING)
+ * - pid: Owning process (GROUP_BY_PID only, -1 if unknown)
+ * - name: Name of that process (filled in by group_table_list())
+ * - connections: Number of connections in the group
+ */
+typedef struct {
+    char key[GROUP_KEY_SIZE];
+    pid_t pid;
+    char name[MAX_PROCESS_NAME];
+    int connections;
+} conn_group_t;
+
+/**
+ * Per-group accumulator
+ *
+ * Open-addressing hash table (linear probing, power-of-two size, kept at
+ * most half full) of conn_group_t keyed by the group text. Connections are
+ * added one at a time as the port is scanned, so no per-connection record
+ * is kept. If the table cannot grow, failed is set, later connections are
+ * dropped and group_table_list() fails.
+ */
+typedef struct {
+    group_by_t by;
+    conn_group_t *slots;
+    bool *used;
+    size_t slot_count;
+    size_t count;
+    bool failed;
+} group_table_t;
+
+/**
+ * Group table functions
+ *
+ * See src/group.c for detailed documentation of each function.
+ */
+int group_table_init(group_table_t *table, group_by_t by);
+void group_add_connection(group_table_t *table, const connection_info_t *conn);
+int group_table_list(const group_table_t *table, conn_group_t **groups);
+void group_table_free(group_table_t *table);
+
+/**
+ * Resolve a --group-by name
+ *
+ * See src/group.c for detailed documentation.
+ *
+ * @param name pid, state, remote or remote-subnet
+ * @return Grouping, or GROUP_BY_NONE if there is no such grouping
+ */
+group_by_t group_by_parse(const char *name);
+
+/**
+ * Name a grouping as written on the command line
+ *
+ * See src/group.c for detailed documentation.
+ *
+ * @param by Grouping
+ * @return Name (e.g. "remote-subnet")
+ */
+const char *group_by_name(group_by_t by);
+
+#endif /* GROUP_H */
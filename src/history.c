@@ -0,0 +1,287 @@
+#include "history.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(history_record_t) == 64, "history records must stay 64 bytes");
+_Static_assert(sizeof(history_header_t) == 64, "history header must stay 64 bytes");
+
+/**
+ * Check that a mapped header describes a ring file of the given size
+ *
+ * The capacity comes from the file, so it is bounded by the file size
+ * before it is multiplied; a corrupt capacity must not wrap the product
+ * into a size that matches.
+ *
+ * @param header Header at the start of the file
+ * @param file_size Size of the file in bytes
+ * @return true if the file is a complete ring file of this version
+ */
+static bool header_valid(const history_header_t *header, size_t file_size) {
+    if (file_size < sizeof(history_header_t)) {
+        return false;
+    }
+    const size_t max_capacity = (file_size - sizeof(history_header_t)) / sizeof(history_record_t);
+    return memcmp(header->magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) == 0 &&
+           header->version == HISTORY_VERSION &&
+           header->record_size == sizeof(history_record_t) &&
+           header->capacity > 0 &&
+           header->capacity <= max_capacity &&
+           file_size == sizeof(history_header_t) +
+                        (size_t)header->capacity * sizeof(history_record_t);
+}
+
+/**
+ * Map a whole ring file and point the ring at its header and records
+ *
+ * @param fd Open file
+ * @param size File size
+ * @param writable Map for writing (recorder) or read-only (replay)
+ * @param ring Output ring
+ * @return 0 on success, -1 if mmap fails
+ */
+static int map_ring(int fd, size_t size, bool writable, history_ring_t *ring) {
+    void *map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                     MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    ring->header = map;
+    ring->records = (history_record_t *)((char *)map + sizeof(history_header_t));
+    ring->map_size = size;
+    return 0;
+}
+
+/**
+ * Open a ring file for recording, creating and preallocating it if needed
+ *
+ * A new (missing or empty) file is sized to hold as many records as fit in
+ * max_bytes and its blocks are allocated up front, so disk use is fixed from
+ * the first sample and recording cannot fail later on a full disk. An
+ * existing ring file is resumed with its own capacity, keeping its history.
+ * Anything else is refused rather than overwritten.
+ *
+ * The file is locked (flock) for the life of the process so two recorders
+ * cannot interleave records; readers do not lock. A new file is created
+ * with mode 0600: it holds every process's command line and owner, so
+ * only the recording user (and root) may read it.
+ *
+ * @param path Ring file path
+ * @param max_bytes Size of a new file in bytes (header included)
+ * @param interval Sampling interval, stored in a new file's header
+ * @param ring Output ring
+ * @return 0 on success, -1 on error (errno set; EEXIST for a foreign file,
+ *         EWOULDBLOCK if another recorder holds the file)
+ */
+int history_create(const char *path, size_t max_bytes, int interval, history_ring_t *ring) {
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        const int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (st.st_size > 0) {
+        history_header_t header;
+        if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            !header_valid(&header, (size_t)st.st_size)) {
+            close(fd);
+            errno = EEXIST;
+            return -1;
+        }
+    } else {
+        uint64_t capacity = 1;
+        if (max_bytes > sizeof(history_header_t) + sizeof(history_record_t)) {
+            capacity = (max_bytes - sizeof(history_header_t)) / sizeof(history_record_t);
+        }
+        const size_t size = sizeof(history_header_t) + capacity * sizeof(history_record_t);
+
+#ifdef __linux__
+        const int err = posix_fallocate(fd, 0, (off_t)size);
+        if (err != 0 && err != EOPNOTSUPP && err != EINVAL) {
+            close(fd);
+            errno = err;
+            return -1;
+        }
+#endif
+        if (ftruncate(fd, (off_t)size) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        history_header_t header = {
+            .version = HISTORY_VERSION,
+            .record_size = sizeof(history_record_t),
+            .capacity = capacity,
+            .created = (int64_t)time(NULL),
+            .interval = (uint32_t)interval,
+        };
+        memcpy(header.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+        if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            close(fd);
+            return -1;
+        }
+        st.st_size = (off_t)size;
+    }
+
+    /* The mapping keeps the file open; the lock lives as long as the fd */
+    if (map_ring(fd, (size_t)st.st_size, true, ring) < 0) {
+        close(fd);
+        return -1;
+    }
+    ring->fd = fd;
+    return 0;
+}
+
+/**
+ * Open a ring file for reading
+ *
+ * Maps the file read-only. Nothing is parsed: after the header check the
+ * records are used in place.
+ *
+ * @param path Ring file path
+ * @param ring Output ring
+ * @return 0 on success, -1 on error (errno set; EINVAL if not a ring file)
+ */
+int history_open(const char *path, history_ring_t *ring) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if ((size_t)st.st_size < sizeof(history_header_t) ||
+        map_ring(fd, (size_t)st.st_size, false, ring) < 0) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    close(fd);
+    ring->fd = -1;
+
+    if (!header_valid(ring->header, ring->map_size)) {
+        munmap(ring->header, ring->map_size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Append one process sample to the ring (recorder only)
+ *
+ * Overwrites the oldest record once the ring is full. The slot is claimed
+ * before it is touched and published after, with fences ordering the two
+ * counter updates around the record write (a seqlock over the whole ring):
+ * a concurrent reader either sees the complete record or learns from
+ * `claimed` that it may have been overwritten.
+ *
+ * @param ring Ring opened with history_create()
+ * @param info Process read with at least HISTORY_SOURCES
+ * @param time Sample time (seconds since epoch)
+ * @return void
+ */
+void history_append(history_ring_t *ring, const process_info_t *info, int64_t time) {
+    history_header_t *header = ring->header;
+    const uint64_t n = atomic_load_explicit(&header->written, memory_order_relaxed);
+
+    atomic_store_explicit(&header->claimed, n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    history_record_t *r = &ring->records[n % header->capacity];
+    memset(r, 0, sizeof(*r));
+    r->time = time;
+    r->start_time = (int64_t)info->start_time;
+    r->vsz = info->vsz;
+    r->rss = info->rss;
+    r->pid = (int32_t)info->pid;
+    r->ppid = (int32_t)info->ppid;
+    r->uid = (int32_t)info->uid;
+    r->state = info->state;
+    snprintf(r->name, sizeof(r->name), "%.*s", (int)sizeof(r->name) - 1, info->name);
+
+    atomic_store_explicit(&header->written, n + 1, memory_order_release);
+}
+
+/**
+ * Get the indices of the records currently held by the ring
+ *
+ * @param ring Open ring
+ * @param first Output: index of the oldest record
+ * @param end Output: index one past the newest record
+ * @return void
+ */
+void history_range(const history_ring_t *ring, uint64_t *first, uint64_t *end) {
+    const uint64_t capacity = ring->header->capacity;
+
+    *end = atomic_load_explicit(&ring->header->written, memory_order_acquire);
+    *first = *end > capacity ? *end - capacity : 0;
+}
+
+/**
+ * Copy one record out of the ring
+ *
+ * The copy is checked against `claimed` afterwards: if the recorder has
+ * since claimed the slot for a newer record, the copy may be torn and is
+ * rejected. Only the oldest records of a ring being written can be lost this
+ * way; they are skipped, not misreported.
+ *
+ * @param ring Open ring
+ * @param index Record index from history_range()
+ * @param record Output: copy of the record
+ * @return true if the copy is intact, false if it was overwritten meanwhile
+ */
+bool history_read(const history_ring_t *ring, uint64_t index, history_record_t *record) {
+    const uint64_t capacity = ring->header->capacity;
+
+    memcpy(record, &ring->records[index % capacity], sizeof(*record));
+    atomic_thread_fence(memory_order_acquire);
+
+    const uint64_t claimed = atomic_load_explicit(&ring->header->claimed, memory_order_relaxed);
+    return index + capacity >= claimed;
+}
+
+/**
+ * Unmap a ring file and, for a recorder, flush it and release the lock
+ *
+ * @param ring Ring to close
+ * @return void
+ */
+void history_close(history_ring_t *ring) {
+    if (ring->header) {
+        if (ring->fd >= 0) {
+            msync(ring->header, ring->map_size, MS_SYNC);
+        }
+        munmap(ring->header, ring->map_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
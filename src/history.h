@@ -0,0 +1,100 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+/* File signature and layout version */
+#define HISTORY_MAGIC "WIRHIST"
+#define HISTORY_VERSION 1
+
+/* Default ring size for a new file (--max-size), in MiB */
+#define HISTORY_DEFAULT_MAX_MB 16
+
+/* Default sampling interval (--interval), in seconds */
+#define HISTORY_DEFAULT_INTERVAL 10
+
+/* Process sources read for every sample */
+#define HISTORY_SOURCES (PROC_SRC_STAT | PROC_SRC_START | PROC_SRC_STATUS)
+
+/**
+ * One sampled process, exactly as stored in the ring file
+ *
+ * Fixed 64-byte records in native byte order, so the replay side reads them
+ * straight out of the mapping. The name is truncated to the kernel's comm
+ * length (15 characters).
+ *
+ * Fields:
+ * - time: Sample time (seconds since epoch); all records of one sample share it
+ * - start_time: Process start time (seconds since epoch), tells PID reuse apart
+ * - vsz, rss: Memory in kilobytes
+ * - pid, ppid, uid: Process identity
+ * - state: Process state character
+ * - name: Process name (NUL-terminated)
+ */
+typedef struct {
+    int64_t time;
+    int64_t start_time;
+    uint64_t vsz;
+    uint64_t rss;
+    int32_t pid;
+    int32_t ppid;
+    int32_t uid;
+    char state;
+    char reserved[3];
+    char name[16];
+} history_record_t;
+
+/**
+ * Ring file header (first 64 bytes of the file)
+ *
+ * Records are numbered from 0 for the life of the file; record n lives in
+ * slot n % capacity. `claimed` is bumped before a slot is overwritten and
+ * `written` after it is complete, so a reader can detect records that were
+ * overwritten while it was copying them (see history_read()).
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    int64_t created;
+    uint32_t interval;
+    uint32_t reserved;
+    _Atomic uint64_t claimed;
+    _Atomic uint64_t written;
+    char pad[8];
+} history_header_t;
+
+/**
+ * Open ring file
+ *
+ * Fields:
+ * - header: Mapped header
+ * - records: Mapped record slots (header->capacity of them)
+ * - map_size: Size of the mapping
+ * - fd: Locked file descriptor of a recorder, -1 for a reader
+ */
+typedef struct {
+    history_header_t *header;
+    history_record_t *records;
+    size_t map_size;
+    int fd;
+} history_ring_t;
+
+/**
+ * Ring file functions
+ *
+ * See src/history.c for detailed documentation of each function.
+ */
+int history_create(const char *path, size_t max_bytes, int interval, history_ring_t *ring);
+int history_open(const char *path, history_ring_t *ring);
+void history_append(history_ring_t *ring, const process_info_t *info, int64_t time);
+void history_range(const history_ring_t *ring, uint64_t *first, uint64_t *end);
+bool history_read(const history_ring_t *ring, uint64_t index, history_record_t *record);
+void history_close(history_ring_t *ring);
+
+#endif /* HISTORY_H */
@@ -0,0 +1,487 @@
+#include "kill.h"
+#include "platform.h"
+#include "utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#endif
+
+/* pidfds need Linux 5.3+ headers; everything else probes with kill(pid, 0) */
+#if defined(__linux__) && defined(SYS_pidfd_open) && defined(SYS_pidfd_send_signal)
+#define HAVE_PIDFD 1
+#endif
+
+/* Probe interval for the kill(pid, 0) fallback */
+#define KILL_PROBE_INTERVAL_MS 5
+
+/* Exit notifications collected per epoll_wait() call */
+#define KILL_EPOLL_BATCH 64
+
+/*
+ * A process to signal and wait on.
+ *
+ * With pidfd set, signals and exit notification go through the pidfd, which
+ * refers to one specific process and can never be redirected to a recycled
+ * PID. Without it (macOS, pre-5.3 kernels) the PID is used directly.
+ */
+typedef struct {
+    pid_t pid;
+    int pidfd;  /* -1 when pidfds are unavailable */
+} proc_handle_t;
+
+/* Signals accepted by name for --signal */
+static const struct {
+    const char *name;
+    int sig;
+} signal_names[] = {
+    { "HUP",  SIGHUP  },
+    { "INT",  SIGINT  },
+    { "QUIT", SIGQUIT },
+    { "KILL", SIGKILL },
+    { "USR1", SIGUSR1 },
+    { "USR2", SIGUSR2 },
+    { "TERM", SIGTERM },
+    { "CONT", SIGCONT },
+    { "STOP", SIGSTOP },
+    { "TSTP", SIGTSTP },
+};
+
+/**
+ * Read the monotonic clock in milliseconds
+ *
+ * @return Milliseconds since an arbitrary fixed point
+ */
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Open a handle on a process
+ *
+ * @param pid Process ID
+ * @param h Output: handle (pidfd is -1 if pidfds are unavailable)
+ * @return 0 on success, -1 if the process does not exist
+ */
+static int handle_open(pid_t pid, proc_handle_t *h) {
+    h->pid = pid;
+    h->pidfd = -1;
+
+#ifdef HAVE_PIDFD
+    h->pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (h->pidfd < 0 && errno == ESRCH) {
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * Close a process handle
+ *
+ * @param h Process handle
+ * @return void
+ */
+static void handle_close(proc_handle_t *h) {
+    if (h->pidfd >= 0) {
+        close(h->pidfd);
+        h->pidfd = -1;
+    }
+}
+
+/**
+ * Send a signal through a process handle
+ *
+ * @param h Process handle
+ * @param sig Signal number
+ * @return 0 on success, -1 on error (errno set)
+ */
+static int handle_signal(const proc_handle_t *h, int sig) {
+#ifdef HAVE_PIDFD
+    if (h->pidfd >= 0) {
+        return (int)syscall(SYS_pidfd_send_signal, h->pidfd, sig, NULL, 0);
+    }
+#endif
+    return kill(h->pid, sig);
+}
+
+/**
+ * Check that a PID still belongs to the process the caller inspected
+ *
+ * Compares the current start time of the PID with the one recorded when the
+ * process was displayed. Once a pidfd is open the answer cannot change, so
+ * checking after pidfd_open() makes the whole kill race-free.
+ *
+ * @param pid Process ID
+ * @param start_time Expected start time (0 skips the check)
+ * @return false only if the PID provably belongs to another process
+ */
+static bool is_same_process(pid_t pid, time_t start_time) {
+    if (start_time == 0) {
+        return true;
+    }
+
+    process_info_t info;
+    if (platform_get_process_fields(pid, &info, PROC_SRC_START) < 0) {
+        /* Gone: the signal itself will report ESRCH */
+        return true;
+    }
+
+    return info.start_time == start_time;
+}
+
+/**
+ * Record a failed signal on a target
+ *
+ * @param t Target
+ * @param err errno from the failed call
+ * @return void
+ */
+static void set_failure(kill_target_t *t, int err) {
+    switch (err) {
+        case ESRCH: t->outcome = KILL_GONE; break;
+        case EPERM: t->outcome = KILL_DENIED; break;
+        default:    t->outcome = KILL_FAILED; break;
+    }
+    t->error = err;
+}
+
+/**
+ * Whether a signal is expected to end the process
+ *
+ * Only these signals are waited on; HUP, USR1 and friends are routinely used
+ * for reloads and log rotation, so their targets are reported as signalled.
+ */
+static bool signal_terminates(int sig) {
+    return sig == SIGTERM || sig == SIGINT || sig == SIGQUIT || sig == SIGKILL;
+}
+
+/**
+ * Whether a process that ignores a signal should be SIGKILLed
+ */
+static bool signal_escalates(int sig) {
+    return sig == SIGTERM || sig == SIGINT || sig == SIGQUIT;
+}
+
+/**
+ * Wait for every target still marked KILL_RUNNING to exit
+ *
+ * On Linux all pidfds are registered with one epoll instance, so a single
+ * epoll_wait() covers any number of processes and each exit is timestamped
+ * as it happens. Targets without a pidfd (or all of them, if epoll is not
+ * available) are probed with kill(pid, 0) every KILL_PROBE_INTERVAL_MS.
+ *
+ * Targets that exit are set to exited_as; the rest stay KILL_RUNNING.
+ *
+ * @param targets Targets
+ * @param handles Handles, parallel to targets
+ * @param count Number of targets
+ * @param timeout_ms Maximum time to wait
+ * @param exited_as Outcome to record for targets that exit
+ * @param started Time the first signal was sent (now_ms())
+ * @return void
+ */
+static void wait_for_exits(kill_target_t *targets, const proc_handle_t *handles, int count,
+                           int timeout_ms, kill_outcome_t exited_as, long started) {
+    const long deadline = now_ms() + timeout_ms;
+    int pending = 0;
+    int epfd = -1;
+
+#ifdef __linux__
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+
+    for (int i = 0; i < count; i++) {
+        if (targets[i].outcome != KILL_RUNNING) {
+            continue;
+        }
+        pending++;
+
+#ifdef __linux__
+        if (epfd >= 0 && handles[i].pidfd >= 0) {
+            struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, handles[i].pidfd, &ev) < 0) {
+                close(epfd);
+                epfd = -1;
+            }
+        }
+#endif
+    }
+
+    while (pending > 0) {
+        /* Probe whatever epoll is not watching */
+        bool probing = false;
+        for (int i = 0; i < count; i++) {
+            if (targets[i].outcome != KILL_RUNNING ||
+                (epfd >= 0 && handles[i].pidfd >= 0)) {
+                continue;
+            }
+
+            if (kill(handles[i].pid, 0) < 0 && errno == ESRCH) {
+                targets[i].outcome = exited_as;
+                targets[i].elapsed_ms = now_ms() - started;
+                pending--;
+            } else {
+                probing = true;
+            }
+        }
+
+        long remaining = deadline - now_ms();
+        if (pending == 0 || remaining <= 0) {
+            break;
+        }
+        if (probing && remaining > KILL_PROBE_INTERVAL_MS) {
+            remaining = KILL_PROBE_INTERVAL_MS;
+        }
+
+#ifdef __linux__
+        if (epfd >= 0) {
+            struct epoll_event events[KILL_EPOLL_BATCH];
+            const int ready = epoll_wait(epfd, events, KILL_EPOLL_BATCH, (int)remaining);
+
+            for (int e = 0; e < ready; e++) {
+                const int i = (int)events[e].data.u32;
+                /* A pidfd stays readable after exit; stop watching it */
+                epoll_ctl(epfd, EPOLL_CTL_DEL, handles[i].pidfd, NULL);
+                targets[i].outcome = exited_as;
+                targets[i].elapsed_ms = now_ms() - started;
+                pending--;
+            }
+            continue;
+        }
+#endif
+
+        usleep((useconds_t)remaining * 1000);
+    }
+
+    if (epfd >= 0) {
+        close(epfd);
+    }
+}
+
+/**
+ * Signal a set of processes and wait for them concurrently
+ *
+ * Every target is opened (as a pidfd on Linux), checked against its recorded
+ * start time and sent sig before any waiting starts, so all processes shut
+ * down in parallel. Targets whose PID now belongs to a different process are
+ * skipped as KILL_REPLACED.
+ *
+ * For TERM, INT, QUIT and KILL the processes are then waited on together
+ * (see wait_for_exits()). Targets of TERM, INT or QUIT still alive after
+ * grace_ms are sent SIGKILL and given KILL_ESCALATION_WAIT_MS more. Other
+ * signals are not expected to end the process and are reported as
+ * KILL_SIGNALLED as soon as they are delivered.
+ *
+ * @param targets Processes to signal; outcome, elapsed_ms and error are filled in
+ * @param count Number of targets
+ * @param sig Signal to send
+ * @param grace_ms How long to wait for exit before escalating to SIGKILL
+ * @return 0 if every target was signalled or already gone, -1 otherwise (all
+ *         targets are KILL_FAILED with error ENOMEM if memory is exhausted)
+ */
+int kill_processes(kill_target_t *targets, int count, int sig, int grace_ms) {
+    if (count <= 0) {
+        return 0;
+    }
+
+    proc_handle_t *handles = counted_malloc((size_t)count * sizeof(proc_handle_t));
+    if (!handles) {
+        /* Nothing was signalled: report every target as failed */
+        for (int i = 0; i < count; i++) {
+            targets[i].elapsed_ms = 0;
+            set_failure(&targets[i], ENOMEM);
+        }
+        return -1;
+    }
+    const bool wait_exit = signal_terminates(sig);
+    const long started = now_ms();
+    int pending = 0;
+
+    for (int i = 0; i < count; i++) {
+        kill_target_t *t = &targets[i];
+        t->elapsed_ms = 0;
+        t->error = 0;
+
+        if (handle_open(t->pid, &handles[i]) < 0) {
+            t->outcome = KILL_GONE;
+        } else if (!is_same_process(t->pid, t->start_time)) {
+            t->outcome = KILL_REPLACED;
+        } else if (handle_signal(&handles[i], sig) < 0) {
+            set_failure(t, errno);
+        } else if (wait_exit) {
+            t->outcome = KILL_RUNNING;
+            pending++;
+        } else {
+            t->outcome = KILL_SIGNALLED;
+        }
+    }
+
+    if (pending > 0) {
+        wait_for_exits(targets, handles, count,
+                       sig == SIGKILL ? KILL_ESCALATION_WAIT_MS : grace_ms,
+                       KILL_EXITED, started);
+
+        if (signal_escalates(sig)) {
+            int escalated = 0;
+            for (int i = 0; i < count; i++) {
+                kill_target_t *t = &targets[i];
+                if (t->outcome != KILL_RUNNING) {
+                    continue;
+                }
+
+                if (handle_signal(&handles[i], SIGKILL) == 0) {
+                    escalated++;
+                } else if (errno == ESRCH) {
+                    /* Exited between the timeout and SIGKILL */
+                    t->outcome = KILL_EXITED;
+                    t->elapsed_ms = now_ms() - started;
+                } else {
+                    set_failure(t, errno);
+                }
+            }
+
+            if (escalated > 0) {
+                wait_for_exits(targets, handles, count, KILL_ESCALATION_WAIT_MS,
+                               KILL_ESCALATED, started);
+            }
+        }
+    }
+
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        kill_target_t *t = &targets[i];
+        handle_close(&handles[i]);
+
+        if (t->outcome == KILL_RUNNING) {
+            t->elapsed_ms = now_ms() - started;
+        }
+        if (!kill_outcome_ok(t->outcome)) {
+            result = -1;
+        }
+    }
+
+    free(handles);
+    return result;
+}
+
+/**
+ * Terminate a process, waiting for it to exit and escalating to SIGKILL
+ *
+ * Sends SIGTERM and waits up to grace_ms for the process to actually exit,
+ * returning as soon as it does. If it is still alive after the grace period
+ * it is sent SIGKILL and given KILL_ESCALATION_WAIT_MS to disappear.
+ *
+ * On Linux the process is addressed through a pidfd opened before anything
+ * is sent; after opening it the start time is compared with the caller's,
+ * so a PID that was recycled since the process was inspected is never
+ * signalled. Elsewhere the same checks are made on the bare PID.
+ *
+ * @param pid Process ID to terminate
+ * @param start_time Start time of the process the caller inspected (0 to skip the check)
+ * @param grace_ms How long to wait for exit before sending SIGKILL
+ * @param elapsed_ms Output: milliseconds from the first signal until the outcome (may be NULL)
+ * @return Outcome of the termination attempt (errno is set for KILL_FAILED)
+ */
+kill_outcome_t kill_process_gracefully(pid_t pid, time_t start_time, int grace_ms,
+                                       long *elapsed_ms) {
+    kill_target_t target = { .pid = pid, .start_time = start_time };
+
+    kill_processes(&target, 1, SIGTERM, grace_ms);
+
+    if (elapsed_ms) {
+        *elapsed_ms = target.elapsed_ms;
+    }
+    errno = target.error;
+    return target.outcome;
+}
+
+/**
+ * Human-readable description of a kill outcome
+ *
+ * @param outcome Outcome to describe
+ * @return Pointer to a static string
+ */
+const char *kill_outcome_name(kill_outcome_t outcome) {
+    switch (outcome) {
+        case KILL_EXITED:    return "exited";
+        case KILL_ESCALATED: return "killed (SIGKILL)";
+        case KILL_SIGNALLED: return "signalled";
+        case KILL_RUNNING:   return "still running";
+        case KILL_GONE:      return "already gone";
+        case KILL_REPLACED:  return "PID reused, skipped";
+        case KILL_DENIED:    return "permission denied";
+        case KILL_FAILED:    return "failed";
+    }
+    return "unknown";
+}
+
+/**
+ * Whether an outcome means the request was carried out
+ *
+ * A process that had already exited counts as handled; one that is still
+ * running, was skipped because its PID was reused, or could not be signalled
+ * does not.
+ *
+ * @param outcome Outcome to check
+ * @return true for KILL_EXITED, KILL_ESCALATED, KILL_SIGNALLED and KILL_GONE
+ */
+bool kill_outcome_ok(kill_outcome_t outcome) {
+    return outcome == KILL_EXITED || outcome == KILL_ESCALATED ||
+           outcome == KILL_SIGNALLED || outcome == KILL_GONE;
+}
+
+/**
+ * Parse a signal given on the command line
+ *
+ * Accepts a name with or without the SIG prefix, in any case (TERM, sigterm,
+ * SIGKILL), or a signal number.
+ *
+ * @param name Signal name or number
+ * @return Signal number, or -1 if not recognised
+ */
+int kill_parse_signal(const char *name) {
+    if (isdigit((unsigned char)name[0])) {
+        char *end;
+        const long sig = strtol(name, &end, 10);
+        return (*end == '\0' && sig > 0 && sig < NSIG) ? (int)sig : -1;
+    }
+
+    if (strncasecmp(name, "SIG", 3) == 0) {
+        name += 3;
+    }
+
+    for (size_t i = 0; i < sizeof(signal_names) / sizeof(signal_names[0]); i++) {
+        if (strcasecmp(name, signal_names[i].name) == 0) {
+            return signal_names[i].sig;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Short name of a signal, without the SIG prefix
+ *
+ * @param sig Signal number
+ * @return Name such as "TERM", or NULL for signals without a known name
+ */
+const char *kill_signal_name(int sig) {
+    for (size_t i = 0; i < sizeof(signal_names) / sizeof(signal_names[0]); i++) {
+        if (signal_names[i].sig == sig) {
+            return signal_names[i].name;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,110 @@
+#ifndef KILL_H
+#define KILL_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+
+/* Default time a process is given to exit after SIGTERM before SIGKILL */
+#define KILL_DEFAULT_GRACE_MS 3000
+
+/* Time allowed for a process to disappear after SIGKILL */
+#define KILL_ESCALATION_WAIT_MS 1000
+
+/**
+ * Outcome of signalling a process
+ *
+ * - KILL_EXITED: The process exited within the grace period
+ * - KILL_ESCALATED: The process outlived the grace period and was SIGKILLed
+ * - KILL_SIGNALLED: A non-terminating signal was delivered (no exit expected)
+ * - KILL_RUNNING: The process was signalled but is still running
+ * - KILL_GONE: The process no longer existed when signalled
+ * - KILL_REPLACED: The PID now belongs to a different process (PID reuse);
+ *   nothing was signalled
+ * - KILL_DENIED: Permission denied
+ * - KILL_FAILED: Any other error (errno is preserved)
+ */
+typedef enum {
+    KILL_EXITED,
+    KILL_ESCALATED,
+    KILL_SIGNALLED,
+    KILL_RUNNING,
+    KILL_GONE,
+    KILL_REPLACED,
+    KILL_DENIED,
+    KILL_FAILED
+} kill_outcome_t;
+
+/**
+ * One process to signal in a bulk operation
+ *
+ * Fields:
+ * - pid: Process ID (input)
+ * - start_time: Start time of the process the caller inspected, 0 to skip
+ *   the PID-reuse check (input)
+ * - outcome: What happened to the process (output)
+ * - elapsed_ms: Milliseconds from the first signal until the outcome (output)
+ * - error: errno for KILL_FAILED (output)
+ */
+typedef struct {
+    pid_t pid;
+    time_t start_time;
+    kill_outcome_t outcome;
+    long elapsed_ms;
+    int error;
+} kill_target_t;
+
+/**
+ * Signal a set of processes and wait for them concurrently
+ *
+ * See src/kill.c for detailed documentation.
+ *
+ * @param targets Processes to signal; outcome fields are filled in
+ * @param count Number of targets
+ * @param sig Signal to send
+ * @param grace_ms How long to wait for exit before escalating to SIGKILL
+ * @return 0 if every target was signalled or already gone, -1 otherwise
+ */
+int kill_processes(kill_target_t *targets, int count, int sig, int grace_ms);
+
+/**
+ * Terminate a process, waiting for it to exit and escalating to SIGKILL
+ *
+ * See src/kill.c for detailed documentation.
+ *
+ * @param pid Process ID to terminate
+ * @param start_time Start time of the process the caller inspected (0 to skip the check)
+ * @param grace_ms How long to wait for exit before sending SIGKILL
+ * @param elapsed_ms Output: milliseconds from the first signal until the outcome (may be NULL)
+ * @return Outcome of the termination attempt
+ */
+kill_outcome_t kill_process_gracefully(pid_t pid, time_t start_time, int grace_ms,
+                                       long *elapsed_ms);
+
+/**
+ * Human-readable description of a kill outcome
+ *
+ * @param outcome Outcome to describe
+ * @return Pointer to a static string
+ */
+const char *kill_outcome_name(kill_outcome_t outcome);
+
+/**
+ * Whether an outcome means the request was carried out
+ *
+ * See src/kill.c for detailed documentation.
+ *
+ * @param outcome Outcome to check
+ * @return true if the process was signalled, exited or was already gone
+ */
+bool kill_outcome_ok(kill_outcome_t outcome);
+
+/**
+ * Signal name helpers
+ *
+ * See src/kill.c for detailed documentation.
+ */
+int kill_parse_signal(const char *name);
+const char *kill_signal_name(int sig);
+
+#endif /* KILL_H */
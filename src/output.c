@@ -1,163 +1,858 @@
 #include "output.h"
 #include "utils.h"
+#include "fields.h"
+#include "writer.h"
+#include "cbor.h"
+#include "kill.h"
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
-static void print_json_string(const char *value) {
-    putchar('"');
+/**
+ * Print a string as a JSON string literal
+ *
+ * Runs of characters that need no escaping are written with a single
+ * fwrite(); only quotes, backslashes and control characters are escaped
+ * one by one.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param value String to print (NULL prints "")
+ * @return void
+ */
+static void print_json_string(const wir_ctx_t *ctx, const char *value) {
+    fputc('"', ctx->out);
 
     if (value) {
-        for (const unsigned char *p = (const unsigned char *)value; *p; p++) {
+        const unsigned char *run = (const unsigned char *)value;
+        const unsigned char *p;
+
+        for (p = run; *p; p++) {
+            if (*p >= 0x20 && *p != '"' && *p != '\\') {
+                continue;
+            }
+
+            fwrite(run, 1, (size_t)(p - run), ctx->out);
+            run = p + 1;
+
             switch (*p) {
                 case '"':
-                    printf("\\\"");
+                    fputs("\\\"", ctx->out);
                     break;
                 case '\\':
-                    printf("\\\\");
+                    fputs("\\\\", ctx->out);
                     break;
                 case '\b':
-                    printf("\\b");
+                    fputs("\\b", ctx->out);
                     break;
                 case '\f':
-                    printf("\\f");
+                    fputs("\\f", ctx->out);
                     break;
                 case '\n':
-                    printf("\\n");
+                    fputs("\\n", ctx->out);
                     break;
                 case '\r':
-                    printf("\\r");
+                    fputs("\\r", ctx->out);
                     break;
                 case '\t':
-                    printf("\\t");
+                    fputs("\\t", ctx->out);
                     break;
                 default:
-                    if (*p < 0x20) {
-                        printf("\\u%04x", *p);
-                    } else {
-                        putchar(*p);
-                    }
+                    fprintf(ctx->out, "\\u%04x", *p);
                     break;
             }
         }
+
+        fwrite(run, 1, (size_t)(p - run), ctx->out);
     }
 
-    putchar('"');
+    fputc('"', ctx->out);
 }
 
+/* ============================================================================
+ * FIELD LAYOUTS
+ *
+ * Every format is a layout over the field tables in src/fields.h. The
+ * emitters below render any layout, so formats differ only in decoration.
+ * ============================================================================ */
+
+#define LAYOUT_LEN(layout) (sizeof(layout) / sizeof((layout)[0]))
+
+/* --pid: pretty format */
+static const field_layout_t process_normal_layout[] = {
+    { .field = PF_PID,        .label = "PID",         .label_color = COLOR_CYAN, .suffix = "\n" },
+    { .field = PF_NAME,       .label = "Name",        .label_color = COLOR_CYAN, .suffix = "\n" },
+    { .field = PF_USER,       .label = "User",        .label_color = COLOR_CYAN, .suffix = " " },
+    { .field = PF_UID,        .prefix = "(UID: ",     .suffix = ")\n" },
+    { .field = PF_PPID,       .label = "Parent PID",  .label_color = COLOR_CYAN, .suffix = "\n" },
+    { .field = PF_STATE_NAME, .label = "State",       .label_color = COLOR_CYAN, .suffix = " " },
+    { .field = PF_STATE,      .prefix = "(",          .suffix = ")\n" },
+    { .field = PF_UPTIME,     .label = "Running for", .label_color = COLOR_CYAN, .suffix = "\n" },
+    { .field = PF_CMDLINE,    .label = "Command",     .label_color = COLOR_CYAN, .suffix = "\n",
+      .optional = true },
+    { .field = PF_VSZ,        .label = "Memory",      .label_color = COLOR_CYAN,
+      .prefix = "VSZ=", .suffix = " KB, " },
+    { .field = PF_RSS,        .prefix = "RSS=",       .suffix = " KB\n" },
+};
+
+/* --pid --short */
+static const field_layout_t process_short_layout[] = {
+    { .field = PF_PID,     .prefix = "PID ", .suffix = ": " },
+    { .field = PF_NAME },
+    { .field = PF_PPID,    .prefix = "[",    .suffix = "]" },
+    { .field = PF_USER,    .prefix = " by " },
+    { .field = PF_CMDLINE, .prefix = " - ",  .suffix = "\n", .fallback = "(no cmdline)" },
+};
+
+/* --pid --json */
+static const field_layout_t process_json_layout[] = {
+    { .field = PF_PID }, { .field = PF_NAME }, { .field = PF_PPID },
+    { .field = PF_USER }, { .field = PF_UID }, { .field = PF_STATE },
+    { .field = PF_STATE_NAME }, { .field = PF_START_TIME }, { .field = PF_UPTIME },
+    { .field = PF_CMDLINE }, { .field = PF_VSZ }, { .field = PF_RSS },
+};
+
+/* --tree: one ancestry line, and the JSON node */
+static const field_layout_t tree_node_layout[] = {
+    { .field = PF_NAME, .color = COLOR_GREEN },
+    { .field = PF_PID,  .prefix = "[", .suffix = "]" },
+    { .field = PF_USER, .prefix = " (", .suffix = ")", .optional = true },
+};
+
+static const field_layout_t tree_json_layout[] = {
+    { .field = PF_PID }, { .field = PF_NAME }, { .field = PF_USER },
+};
+
+/* --tree: one forest line with its subtree totals */
+static const field_layout_t forest_node_layout[] = {
+    { .field = FF_NAME,            .color = COLOR_GREEN },
+    { .field = FF_PID,             .prefix = "[", .suffix = "]" },
+    { .field = FF_USER,            .prefix = " (", .suffix = ")", .optional = true },
+    { .field = FF_DESCENDANTS,     .prefix = "  subtree: ", .suffix = " descendants, " },
+    { .field = FF_SUBTREE_RSS,     .prefix = "RSS ", .suffix = " KB, " },
+    { .field = FF_SUBTREE_VSZ,     .prefix = "VSZ ", .suffix = " KB, " },
+    { .field = FF_SUBTREE_SOCKETS, .suffix = " sockets" },
+};
+
+/* --tree --json: a forest node (children are nested separately) */
+static const field_layout_t forest_json_layout[] = {
+    { .field = FF_PID }, { .field = FF_PPID }, { .field = FF_NAME }, { .field = FF_USER },
+    { .field = FF_SOCKETS }, { .field = FF_VSZ }, { .field = FF_RSS },
+    { .field = FF_DESCENDANTS }, { .field = FF_SUBTREE_SOCKETS },
+    { .field = FF_SUBTREE_VSZ }, { .field = FF_SUBTREE_RSS },
+};
+
+/* --all --tree --csv/--tsv: one row per process, depth-first */
+static const field_layout_t forest_delimited_layout[] = {
+    { .field = FF_PID }, { .field = FF_PPID }, { .field = FF_DEPTH }, { .field = FF_NAME },
+    { .field = FF_USER }, { .field = FF_SOCKETS }, { .field = FF_VSZ }, { .field = FF_RSS },
+    { .field = FF_DESCENDANTS }, { .field = FF_SUBTREE_SOCKETS },
+    { .field = FF_SUBTREE_VSZ }, { .field = FF_SUBTREE_RSS },
+};
+
+/* --pid --tree --json: totals added to the target of the ancestry tree */
+static const field_layout_t forest_subtree_layout[] = {
+    { .field = FF_DESCENDANTS }, { .field = FF_SUBTREE_SOCKETS },
+    { .field = FF_SUBTREE_VSZ }, { .field = FF_SUBTREE_RSS },
+};
+
+/* --port: connection endpoint, remote peer and owning process */
+static const field_layout_t connection_normal_layout[] = {
+    { .field = CF_PROTOCOL,   .label = "Protocol", .suffix = "\n" },
+    { .field = CF_STATE,      .label = "State",    .suffix = "\n" },
+    { .field = CF_LOCAL_ADDR, .label = "Local",    .suffix = ":", .fallback = "*" },
+    { .field = CF_LOCAL_PORT, .suffix = "\n" },
+};
+
+static const field_layout_t connection_remote_layout[] = {
+    { .field = CF_REMOTE_ADDR, .label = "Remote", .suffix = ":" },
+    { .field = CF_REMOTE_PORT, .suffix = "\n" },
+};
+
+static const field_layout_t connection_queue_layout[] = {
+    { .field = CF_RX_QUEUE, .label = "Queues", .prefix = "recv ", .suffix = ", " },
+    { .field = CF_TX_QUEUE, .prefix = "send ", .suffix = "\n" },
+};
+
+/* TCP listener: rx_queue is the accept queue, measured against the backlog */
+static const field_layout_t connection_accept_layout[] = {
+    { .field = CF_RX_QUEUE, .label = "Accept queue", .suffix = " of " },
+    { .field = CF_BACKLOG,  .suffix = "\n" },
+};
+
+/* --port --tcp-info: TCP internals, when the platform could read them */
+static const field_layout_t connection_tcp_info_layout[] = {
+    { .field = CF_RTT,           .label = "TCP",    .prefix = "rtt ",    .suffix = " us" },
+    { .field = CF_RTT_VAR,       .prefix = " (var ", .suffix = "), " },
+    { .field = CF_CWND,          .prefix = "cwnd ",  .suffix = ", " },
+    { .field = CF_UNACKED,       .prefix = "unacked ", .suffix = ", " },
+    { .field = CF_RETRANSMITS,   .prefix = "retrans ", .suffix = "/" },
+    { .field = CF_TOTAL_RETRANS, .suffix = " total\n" },
+    { .field = CF_RMEM_ALLOC,    .label = "Socket memory", .prefix = "recv " },
+    { .field = CF_RCVBUF,        .prefix = "/",      .suffix = ", " },
+    { .field = CF_WMEM_ALLOC,    .prefix = "send " },
+    { .field = CF_SNDBUF,        .prefix = "/",      .suffix = ", " },
+    { .field = CF_WMEM_QUEUED,   .prefix = "queued ", .suffix = ", " },
+    { .field = CF_DROPS,         .prefix = "drops ", .suffix = "\n" },
+};
+
+static const field_layout_t port_process_normal_layout[] = {
+    { .field = PF_NAME,    .label = "Process", .label_color = COLOR_GREEN, .suffix = " " },
+    { .field = PF_PID,     .prefix = "(PID: ", .suffix = ")\n" },
+    { .field = PF_USER,    .label = "User",    .suffix = "\n" },
+    { .field = PF_CMDLINE, .label = "Command", .suffix = "\n", .optional = true },
+};
+
+/* --port --short: "<name>[<pid>] by <user> (<state>, Recv-Q <n>, Send-Q <n>)" */
+static const field_layout_t port_process_short_layout[] = {
+    { .field = PF_NAME },
+    { .field = PF_PID,  .prefix = "[", .suffix = "]" },
+    { .field = PF_USER, .prefix = " by " },
+};
+
+static const field_layout_t connection_short_layout[] = {
+    { .field = CF_STATE,    .prefix = " (" },
+    { .field = CF_RX_QUEUE, .prefix = ", Recv-Q " },
+    { .field = CF_TX_QUEUE, .prefix = ", Send-Q ", .suffix = ")\n" },
+};
+
+/* --port --json */
+static const field_layout_t connection_json_layout[] = {
+    { .field = CF_PROTOCOL }, { .field = CF_STATE },
+    { .field = CF_LOCAL_ADDR }, { .field = CF_LOCAL_PORT },
+    { .field = CF_REMOTE_ADDR }, { .field = CF_REMOTE_PORT },
+    { .field = CF_RX_QUEUE }, { .field = CF_TX_QUEUE }, { .field = CF_BACKLOG },
+    { .field = CF_OWNERS },
+};
+
+static const field_layout_t connection_tcp_info_json_layout[] = {
+    { .field = CF_RTT }, { .field = CF_RTT_VAR }, { .field = CF_RETRANSMITS },
+    { .field = CF_TOTAL_RETRANS }, { .field = CF_CWND }, { .field = CF_UNACKED },
+    { .field = CF_RMEM_ALLOC }, { .field = CF_RCVBUF }, { .field = CF_WMEM_ALLOC },
+    { .field = CF_SNDBUF }, { .field = CF_WMEM_QUEUED }, { .field = CF_DROPS },
+};
+
+static const field_layout_t port_process_json_layout[] = {
+    { .field = PF_PID }, { .field = PF_NAME }, { .field = PF_USER }, { .field = PF_CMDLINE },
+};
+
+/* --all: table, short and JSON */
+static const field_layout_t process_table_layout[] = {
+    { .field = PF_PID,     .width = 8,  .suffix = " " },
+    { .field = PF_PPID,    .width = 8,  .suffix = " " },
+    { .field = PF_NAME,    .width = 20, .precision = 20, .color = COLOR_GREEN, .suffix = " " },
+    { .field = PF_USER,    .width = 12, .precision = 12, .color = COLOR_CYAN,  .suffix = " " },
+    { .field = PF_CMDLINE, .precision = 60, .suffix = "\n", .fallback = "(no cmdline)" },
+};
+
+static const field_layout_t process_list_short_layout[] = {
+    { .field = PF_PID,  .suffix = ": " },
+    { .field = PF_NAME, .suffix = " by " },
+    { .field = PF_USER, .suffix = "\n" },
+};
+
+static const field_layout_t process_list_json_layout[] = {
+    { .field = PF_PID }, { .field = PF_PPID }, { .field = PF_NAME },
+    { .field = PF_USER }, { .field = PF_UID }, { .field = PF_STATE },
+    { .field = PF_STATE_NAME }, { .field = PF_START_TIME }, { .field = PF_UPTIME },
+    { .field = PF_CMDLINE }, { .field = PF_VSZ }, { .field = PF_RSS },
+};
+
+/* --csv / --tsv: raw values only, no derived display strings */
+static const field_layout_t process_delimited_layout[] = {
+    { .field = PF_PID }, { .field = PF_PPID }, { .field = PF_NAME },
+    { .field = PF_USER }, { .field = PF_UID }, { .field = PF_STATE },
+    { .field = PF_START_TIME }, { .field = PF_CMDLINE },
+    { .field = PF_VSZ }, { .field = PF_RSS },
+};
+
+static const field_layout_t connection_delimited_layout[] = {
+    { .field = CF_PROTOCOL }, { .field = CF_STATE },
+    { .field = CF_LOCAL_ADDR }, { .field = CF_LOCAL_PORT },
+    { .field = CF_REMOTE_ADDR }, { .field = CF_REMOTE_PORT },
+    { .field = CF_RX_QUEUE }, { .field = CF_TX_QUEUE }, { .field = CF_BACKLOG },
+    { .field = CF_PID }, { .field = CF_OWNERS },
+};
+
+static const field_layout_t port_process_delimited_layout[] = {
+    { .field = PF_NAME }, { .field = PF_USER }, { .field = PF_UID }, { .field = PF_CMDLINE },
+};
+
+/* --by-user: table, short and JSON/CBOR/CSV */
+static const field_layout_t user_table_layout[] = {
+    { .field = UF_USER,      .width = 16, .precision = 16, .color = COLOR_CYAN, .suffix = " " },
+    { .field = UF_UID,       .width = 8,  .suffix = " " },
+    { .field = UF_PROCESSES, .width = 7,  .suffix = " " },
+    { .field = UF_ZOMBIES,   .width = 7,  .suffix = " " },
+    { .field = UF_SOCKETS,   .width = 8,  .suffix = " " },
+    { .field = UF_VSZ,       .width = 12, .suffix = " " },
+    { .field = UF_RSS,       .width = 12, .suffix = "\n" },
+};
+
+static const field_layout_t user_short_layout[] = {
+    { .field = UF_USER,      .suffix = ": " },
+    { .field = UF_PROCESSES, .suffix = " processes, " },
+    { .field = UF_RSS,       .prefix = "RSS ", .suffix = " KB, " },
+    { .field = UF_SOCKETS,   .suffix = " sockets\n" },
+};
+
+static const field_layout_t user_json_layout[] = {
+    { .field = UF_USER }, { .field = UF_UID }, { .field = UF_PROCESSES },
+    { .field = UF_ZOMBIES }, { .field = UF_SOCKETS },
+    { .field = UF_VSZ }, { .field = UF_RSS },
+};
+
+/* --replay: table, short and JSON/CBOR/CSV */
+static const field_layout_t history_table_layout[] = {
+    { .field = HF_TIMESTAMP, .width = 19, .suffix = " " },
+    { .field = HF_PID,       .width = 8,  .suffix = " " },
+    { .field = HF_NAME,      .width = 16, .color = COLOR_GREEN, .suffix = " " },
+    { .field = HF_STATE,     .width = 1,  .suffix = " " },
+    { .field = HF_RSS,       .width = 10, .suffix = " " },
+    { .field = HF_VSZ,       .width = 12, .suffix = "\n" },
+};
+
+static const field_layout_t history_short_layout[] = {
+    { .field = HF_TIMESTAMP, .suffix = " " },
+    { .field = HF_NAME },
+    { .field = HF_PID,       .prefix = "[", .suffix = "] " },
+    { .field = HF_STATE,     .suffix = " " },
+    { .field = HF_RSS,       .prefix = "RSS ", .suffix = " KB\n" },
+};
+
+static const field_layout_t history_json_layout[] = {
+    { .field = HF_TIME }, { .field = HF_TIMESTAMP }, { .field = HF_PID },
+    { .field = HF_PPID }, { .field = HF_NAME }, { .field = HF_UID },
+    { .field = HF_STATE }, { .field = HF_START_TIME },
+    { .field = HF_VSZ }, { .field = HF_RSS },
+};
+
+/* --port --group-by: table, short and JSON/CBOR/CSV (by PID, or by any other key) */
+static const field_layout_t group_pid_table_layout[] = {
+    { .field = GF_PID,         .width = 8,  .suffix = " " },
+    { .field = GF_NAME,        .width = 16, .precision = 16, .color = COLOR_GREEN, .suffix = " " },
+    { .field = GF_CONNECTIONS, .suffix = "\n" },
+};
+
+static const field_layout_t group_pid_short_layout[] = {
+    { .field = GF_PID },
+    { .field = GF_NAME,        .prefix = " (", .suffix = ")", .optional = true },
+    { .field = GF_CONNECTIONS, .prefix = ": ", .suffix = " connections\n" },
+};
+
+static const field_layout_t group_pid_json_layout[] = {
+    { .field = GF_PID }, { .field = GF_NAME }, { .field = GF_CONNECTIONS },
+};
+
+static const field_layout_t group_table_layout[] = {
+    { .field = GF_GROUP,       .width = 40, .color = COLOR_CYAN, .suffix = " " },
+    { .field = GF_CONNECTIONS, .suffix = "\n" },
+};
+
+static const field_layout_t group_short_layout[] = {
+    { .field = GF_GROUP },
+    { .field = GF_CONNECTIONS, .prefix = ": ", .suffix = " connections\n" },
+};
+
+static const field_layout_t group_json_layout[] = {
+    { .field = GF_GROUP }, { .field = GF_CONNECTIONS },
+};
+
+/* --ephemeral: table, short and JSON/CBOR/CSV */
+static const field_layout_t ephemeral_table_layout[] = {
+    { .field = EF_DESTINATION, .width = 40, .color = COLOR_CYAN, .suffix = " " },
+    { .field = EF_PORT,        .width = 6,  .suffix = " " },
+    { .field = EF_CONNECTIONS, .width = 6,  .suffix = " " },
+    { .field = EF_ESTABLISHED, .width = 6,  .suffix = " " },
+    { .field = EF_TIME_WAIT,   .width = 9,  .suffix = " " },
+    { .field = EF_OTHER,       .width = 6,  .suffix = " " },
+    { .field = EF_USED_PCT,    .suffix = "\n" },
+};
+
+static const field_layout_t ephemeral_short_layout[] = {
+    { .field = EF_DESTINATION },
+    { .field = EF_PORT,        .prefix = " port " },
+    { .field = EF_CONNECTIONS, .prefix = ": ", .suffix = " connections (" },
+    { .field = EF_TIME_WAIT,   .suffix = " TIME_WAIT, " },
+    { .field = EF_USED_PCT,    .suffix = "% of range)\n" },
+};
+
+static const field_layout_t ephemeral_json_layout[] = {
+    { .field = EF_DESTINATION }, { .field = EF_PORT }, { .field = EF_CONNECTIONS },
+    { .field = EF_ESTABLISHED }, { .field = EF_TIME_WAIT }, { .field = EF_OTHER },
+    { .field = EF_USED_PCT },
+};
+
+static const field_layout_t history_delimited_layout[] = {
+    { .field = HF_TIME }, { .field = HF_PID }, { .field = HF_PPID },
+    { .field = HF_NAME }, { .field = HF_UID }, { .field = HF_STATE },
+    { .field = HF_START_TIME }, { .field = HF_VSZ }, { .field = HF_RSS },
+};
+
+/* ============================================================================
+ * LAYOUT EMITTERS
+ * ============================================================================ */
+
 /**
- * Output process info in normal (pretty) format
+ * Print a layout for one record as text
+ *
+ * Renders each field of the layout in order: optional colored label, prefix,
+ * value (padded/truncated/colored per the layout), suffix. This single
+ * routine produces the pretty, short, table-row and tree-line formats.
  *
- * Displays detailed process information in a human-readable, colored format.
- * Shows all available process details including PID, name, user, parent process,
- * state, uptime, command line, and memory usage.
+ * @param ctx Context holding the report stream and color setting
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @param record Pointer to the record (process_info_t or connection_info_t)
+ * @return void
+ */
+static void emit_text(const wir_ctx_t *ctx, const field_schema_t *schema,
+                      const field_layout_t *layout, size_t count, const void *record) {
+    char buf[128];
+
+    for (size_t i = 0; i < count; i++) {
+        const field_layout_t *l = &layout[i];
+        const char *text = field_format(schema, l->field, record, buf, sizeof(buf));
+
+        if (!*text) {
+            if (l->optional) {
+                continue;
+            }
+            if (l->fallback) {
+                text = l->fallback;
+            }
+        }
+
+        if (l->label) {
+            print_color(ctx, l->label_color, "  %s: ", l->label);
+        }
+        if (l->prefix) {
+            fputs(l->prefix, ctx->out);
+        }
+        print_color(ctx, l->color, "%-*.*s", l->width,
+                    l->precision > 0 ? l->precision : INT_MAX, text);
+        if (l->suffix) {
+            fputs(l->suffix, ctx->out);
+        }
+    }
+}
+
+/**
+ * Print the header and separator rows of a table layout
  *
- * Output includes:
- * - PID and process name
- * - User information (username and UID)
- * - Parent process ID
- * - Process state with human-readable name
- * - Running time (uptime since process start)
- * - Full command line (if available)
- * - Memory usage (VSZ and RSS in KB)
+ * Column headings come from the field descriptors; each separator is as wide
+ * as its column (or its heading for unpadded columns).
  *
- * @param info Pointer to process_info_t structure containing process details
+ * @param ctx Context holding the report stream and color setting
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts (table columns)
+ * @param count Number of entries in layout
  * @return void
  */
-static void output_process_normal(const process_info_t *info) {
-    print_color(COLOR_BOLD, "Process Information\n");
-    print_color(COLOR_CYAN, "  PID: ");
-    printf("%d\n", info->pid);
+static void emit_table_header(const wir_ctx_t *ctx, const field_schema_t *schema,
+                              const field_layout_t *layout, size_t count) {
+    char rule[256];
+    size_t used = 0;
 
-    print_color(COLOR_CYAN, "  Name: ");
-    printf("%s\n", info->name);
+    for (size_t i = 0; i < count; i++) {
+        const char *header = schema->fields[layout[i].field].header;
+        const bool last = i == count - 1;
+        int width = layout[i].width > 0 ? layout[i].width : (int)strlen(header);
 
-    print_color(COLOR_CYAN, "  User: ");
-    printf("%s (UID: %d)\n", info->username, info->uid);
+        fprintf(ctx->out, "%-*s%s", layout[i].width, header, last ? "\n" : " ");
 
-    print_color(COLOR_CYAN, "  Parent PID: ");
-    printf("%d\n", info->ppid);
+        for (int w = 0; w < width && used < sizeof(rule) - 2; w++) {
+            rule[used++] = '-';
+        }
+        rule[used++] = last ? '\n' : ' ';
+    }
+    rule[used] = '\0';
 
-    print_color(COLOR_CYAN, "  State: ");
-    printf("%s (%c)\n", get_state_name(info->state), info->state);
+    print_color(ctx, COLOR_BOLD, "%s", rule);
+}
 
-    print_color(COLOR_CYAN, "  Running for: ");
-    char uptime_buf[128];
-    format_uptime(info->start_time, uptime_buf, sizeof(uptime_buf));
-    printf("%s\n", uptime_buf);
+/**
+ * Check whether two field descriptors belong to the same nested group
+ *
+ * @param a Group name or NULL
+ * @param b Group name or NULL
+ * @return true if both are NULL or name the same group
+ */
+static bool same_group(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
 
-    if (info->cmdline[0]) {
-        print_color(COLOR_CYAN, "  Command: ");
-        printf("%s\n", info->cmdline);
+static void print_indent(const wir_ctx_t *ctx, int indent) {
+    for (int i = 0; i < indent; i++) {
+        fputc(' ', ctx->out);
     }
+}
 
-    print_color(COLOR_CYAN, "  Memory: ");
-    printf("VSZ=%lu KB, RSS=%lu KB\n", info->vsz, info->rss);
+/**
+ * Print one field value as JSON
+ *
+ * @param ctx Context holding the report stream
+ * @param type Type of the field
+ * @param v Value read by the schema getter
+ * @return void
+ */
+static void print_json_value(const wir_ctx_t *ctx, field_type_t type, field_value_t v) {
+    switch (type) {
+        case FIELD_INT:
+            fprintf(ctx->out, "%lld", v.i);
+            break;
+        case FIELD_UINT:
+            fprintf(ctx->out, "%llu", v.u);
+            break;
+        case FIELD_CHAR: {
+            const char text[2] = { v.c, '\0' };
+            print_json_string(ctx, text);
+            break;
+        }
+        case FIELD_STR:
+            print_json_string(ctx, v.s);
+            break;
+    }
 }
 
 /**
- * Output process info in a short (one-line) format
+ * Print the fields of a layout as JSON object members
  *
- * Displays concise process information in a single line, useful for quick
- * overview or when space is limited. Format: "PID <pid>: <name>[<ppid>] by <user> - <cmdline>"
+ * Emits `"key": value` pairs separated by ",\n", without the enclosing braces
+ * and without a trailing newline, so callers can append further members.
+ * Consecutive fields sharing a descriptor group are wrapped in a nested
+ * object named after the group (e.g. "memory").
  *
- * @param info Pointer to process_info_t structure containing process details
+ * @param ctx Context holding the report stream and color setting
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @param record Pointer to the record
+ * @param indent Indentation (in spaces) of the members
+ * @return void
+ */
+static void emit_json_members(const wir_ctx_t *ctx, const field_schema_t *schema,
+                              const field_layout_t *layout, size_t count,
+                              const void *record, int indent) {
+    char scratch[128];
+    const char *group = NULL;
+    bool need_sep = false;
+
+    for (size_t i = 0; i < count; i++) {
+        const field_desc_t *desc = &schema->fields[layout[i].field];
+
+        if (!same_group(desc->group, group)) {
+            if (group) {
+                fputc('\n', ctx->out);
+                print_indent(ctx, indent);
+                fputc('}', ctx->out);
+                need_sep = true;
+            }
+            group = desc->group;
+            if (group) {
+                if (need_sep) {
+                    fprintf(ctx->out, ",\n");
+                }
+                print_indent(ctx, indent);
+                fprintf(ctx->out, "\"%s\": {\n", group);
+                need_sep = false;
+            }
+        }
+
+        if (need_sep) {
+            fprintf(ctx->out, ",\n");
+        }
+        print_indent(ctx, group ? indent + 2 : indent);
+        fprintf(ctx->out, "\"%s\": ", desc->key);
+
+        print_json_value(ctx, desc->type,
+                         schema->get(record, layout[i].field, scratch, sizeof(scratch)));
+        need_sep = true;
+    }
+
+    if (group) {
+        fputc('\n', ctx->out);
+        print_indent(ctx, indent);
+        fputc('}', ctx->out);
+    }
+}
+
+/**
+ * Print the fields of a layout as compact JSON object members
+ *
+ * The single-line form of emit_json_members() (same keys and nesting, no
+ * whitespace), for responses that must fit on one line.
+ *
+ * @param ctx Context holding the report stream
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @param record Pointer to the record
  * @return void
  */
-static void output_process_short(const process_info_t *info) {
-    printf("PID %d: %s[%d] by %s - %s\n",
-           info->pid, info->name, info->ppid, info->username,
-           info->cmdline[0] ? info->cmdline : "(no cmdline)");
+static void emit_json_line_members(const wir_ctx_t *ctx, const field_schema_t *schema,
+                                   const field_layout_t *layout, size_t count,
+                                   const void *record) {
+    char scratch[128];
+    const char *group = NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        const field_desc_t *desc = &schema->fields[layout[i].field];
+        bool first = i == 0;
+
+        if (!same_group(desc->group, group)) {
+            if (group) {
+                fputc('}', ctx->out);
+            }
+            group = desc->group;
+            if (group) {
+                fprintf(ctx->out, "%s\"%s\":{", first ? "" : ",", group);
+                first = true;
+            }
+        }
+
+        fprintf(ctx->out, "%s\"%s\":", first ? "" : ",", desc->key);
+        print_json_value(ctx, desc->type,
+                         schema->get(record, layout[i].field, scratch, sizeof(scratch)));
+    }
+
+    if (group) {
+        fputc('}', ctx->out);
+    }
 }
 
 /**
- * Output process info in JSON format
+ * Write the header row of a delimited (CSV/TSV) layout
+ *
+ * Column names are the field keys, which never need quoting. No row
+ * terminator is written so callers can append further columns.
  *
- * Serializes process information as a JSON object for programmatic consumption.
- * Includes all process details in a structured format suitable for parsing,
- * logging, or integration with other tools.
+ * @param w Writer to append to
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts (columns)
+ * @param count Number of entries in layout
+ * @param sep Field separator (',' or '\t')
+ * @return void
+ */
+static void emit_delimited_header(writer_t *w, const field_schema_t *schema,
+                                  const field_layout_t *layout, size_t count, char sep) {
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            writer_putc(w, sep);
+        }
+        writer_puts(w, schema->fields[layout[i].field].key);
+    }
+}
+
+/**
+ * Write one record of a delimited (CSV/TSV) layout
  *
- * JSON structure includes:
- * - pid, name, ppid, user, uid
- * - state (character code) and state_name (human-readable)
- * - start_time (epoch timestamp) and uptime (formatted string)
- * - cmdline (full command line)
- * - memory object with vsz_kb and rss_kb
+ * Integers are formatted by the writer without printf; strings are quoted
+ * (CSV) or escaped (TSV) per the separator. A NULL record writes empty
+ * cells, keeping the column count fixed for rows with no owning process.
+ * No row terminator is written.
  *
- * @param info Pointer to process_info_t structure containing process details
+ * @param w Writer to append to
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts (columns)
+ * @param count Number of entries in layout
+ * @param record Pointer to the record, or NULL for empty cells
+ * @param sep Field separator (',' or '\t')
+ * @return void
+ */
+static void emit_delimited(writer_t *w, const field_schema_t *schema,
+                           const field_layout_t *layout, size_t count,
+                           const void *record, char sep) {
+    char scratch[128];
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            writer_putc(w, sep);
+        }
+        if (!record) {
+            continue;
+        }
+
+        const field_value_t v = schema->get(record, layout[i].field, scratch, sizeof(scratch));
+        switch (schema->fields[layout[i].field].type) {
+            case FIELD_INT:
+                writer_put_int(w, v.i);
+                break;
+            case FIELD_UINT:
+                writer_put_uint(w, v.u);
+                break;
+            case FIELD_CHAR: {
+                const char text[2] = { v.c, '\0' };
+                if (sep == ',') {
+                    writer_put_csv(w, text);
+                } else {
+                    writer_put_tsv(w, text);
+                }
+                break;
+            }
+            case FIELD_STR:
+                if (sep == ',') {
+                    writer_put_csv(w, v.s);
+                } else {
+                    writer_put_tsv(w, v.s);
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * Select the delimiter for the requested delimited format
+ *
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return ',' for --csv, '\t' for --tsv, '\0' when neither was requested
+ */
+static char delimited_separator(const cli_args_t *args) {
+    if (args->csv_output) {
+        return ',';
+    }
+    if (args->tsv_output) {
+        return '\t';
+    }
+    return '\0';
+}
+
+/**
+ * Count the top-level CBOR map members produced by a layout
+ *
+ * Fields outside a group are one member each; each run of fields sharing a
+ * group collapses into a single nested-map member.
+ *
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @return Number of map members emit_cbor_members() will write
+ */
+static size_t cbor_member_count(const field_schema_t *schema,
+                                const field_layout_t *layout, size_t count) {
+    size_t members = 0;
+    const char *group = NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *g = schema->fields[layout[i].field].group;
+        if (!g || !same_group(g, group)) {
+            members++;
+        }
+        group = g;
+    }
+
+    return members;
+}
+
+/**
+ * Write the fields of a layout as CBOR map members
+ *
+ * The CBOR counterpart of emit_json_members(): same keys, same nesting of
+ * grouped fields, but integers stay binary and strings need no escaping.
+ * The caller writes the enclosing map head (see cbor_member_count()).
+ *
+ * @param w Writer to append to
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @param record Pointer to the record
+ * @return void
+ */
+static void emit_cbor_members(writer_t *w, const field_schema_t *schema,
+                              const field_layout_t *layout, size_t count,
+                              const void *record) {
+    char scratch[128];
+    const char *group = NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        const field_desc_t *desc = &schema->fields[layout[i].field];
+
+        if (desc->group && !same_group(desc->group, group)) {
+            size_t run = 1;
+            while (i + run < count &&
+                   same_group(schema->fields[layout[i + run].field].group, desc->group)) {
+                run++;
+            }
+            cbor_put_text(w, desc->group);
+            cbor_put_map(w, run);
+        }
+        group = desc->group;
+
+        cbor_put_text(w, desc->key);
+
+        const field_value_t v = schema->get(record, layout[i].field, scratch, sizeof(scratch));
+        switch (desc->type) {
+            case FIELD_INT:
+                cbor_put_int(w, v.i);
+                break;
+            case FIELD_UINT:
+                cbor_put_uint(w, v.u);
+                break;
+            case FIELD_CHAR: {
+                const char text[2] = { v.c, '\0' };
+                cbor_put_text(w, text);
+                break;
+            }
+            case FIELD_STR:
+                cbor_put_text(w, v.s);
+                break;
+        }
+    }
+}
+
+/**
+ * Write a layout for one record as a complete CBOR map
+ *
+ * @param w Writer to append to
+ * @param schema Schema describing the record type
+ * @param layout Array of field layouts
+ * @param count Number of entries in layout
+ * @param record Pointer to the record
+ * @return void
+ */
+static void emit_cbor_map(writer_t *w, const field_schema_t *schema,
+                          const field_layout_t *layout, size_t count,
+                          const void *record) {
+    cbor_put_map(w, cbor_member_count(schema, layout, count));
+    emit_cbor_members(w, schema, layout, count, record);
+}
+
+/**
+ * Allocate a writer on the report stream for the binary/bulk formats
+ *
+ * The writer is too large for the stack; callers release it with
+ * output_writer_close(), which also flushes it.
+ *
+ * @param ctx Context holding the report stream
+ *
+ * @return Newly allocated writer, or NULL if memory is exhausted (message printed)
+ */
+static writer_t *output_writer_open(const wir_ctx_t *ctx) {
+    writer_t *w = counted_malloc(sizeof(*w));
+    if (!w) {
+        print_error(ctx, "Cannot write the report: %s", strerror(errno));
+        return NULL;
+    }
+    writer_init(w, ctx->out);
+    return w;
+}
+
+/**
+ * Flush and free a writer from output_writer_open()
+ *
+ * @param w Writer to close
  * @return void
  */
-static void output_process_json(const process_info_t *info) {
-    char uptime_buf[128];
-    format_uptime(info->start_time, uptime_buf, sizeof(uptime_buf));
-
-    printf("{\n");
-    printf("  \"pid\": %d,\n", info->pid);
-    printf("  \"name\": ");
-    print_json_string(info->name);
-    printf(",\n");
-    printf("  \"ppid\": %d,\n", info->ppid);
-    printf("  \"user\": ");
-    print_json_string(info->username);
-    printf(",\n");
-    printf("  \"uid\": %d,\n", info->uid);
-    printf("  \"state\": \"%c\",\n", info->state);
-    printf("  \"state_name\": ");
-    print_json_string(get_state_name(info->state));
-    printf(",\n");
-    printf("  \"start_time\": %ld,\n", (long)info->start_time);
-    printf("  \"uptime\": ");
-    print_json_string(uptime_buf);
-    printf(",\n");
-    printf("  \"cmdline\": ");
-    print_json_string(info->cmdline);
-    printf(",\n");
-    printf("  \"memory\": {\n");
-    printf("    \"vsz_kb\": %lu,\n", info->vsz);
-    printf("    \"rss_kb\": %lu\n", info->rss);
-    printf("  }\n");
-    printf("}\n");
+static void output_writer_close(writer_t *w) {
+    writer_flush(w);
+    free(w);
 }
 
+/* ============================================================================
+ * PROCESS OUTPUT
+ * ============================================================================ */
+
 /**
  * Output process information with format selection
  *
@@ -167,6 +862,7 @@ static void output_process_json(const process_info_t *info) {
  * flag is enabled.
  *
  * Format selection:
+ * - CBOR format if args->cbor_output is true
  * - JSON format if args->json_output is true
  * - Short (one-line) format if args->short_output is true
  * - Normal (pretty) format otherwise
@@ -174,17 +870,32 @@ static void output_process_json(const process_info_t *info) {
  * Interactive mode:
  * - If args->interactive is true and not JSON output, prompts user to kill process
  *
+ * @param ctx Context holding the report stream and color setting
  * @param info Pointer to process_info_t structure containing process details
  * @param args Pointer to cli_args_t structure containing output format flags
- * @return 0 on success
+ * @return 0 on success, -1 if memory is exhausted (message printed)
  */
-int output_process_info(const process_info_t *info, const cli_args_t *args) {
-    if (args->json_output) {
-        output_process_json(info);
+int output_process_info(const wir_ctx_t *ctx, const process_info_t *info, const cli_args_t *args) {
+    if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        emit_cbor_map(w, &process_schema, process_json_layout,
+                      LAYOUT_LEN(process_json_layout), info);
+        output_writer_close(w);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        emit_json_members(ctx, &process_schema, process_json_layout,
+                          LAYOUT_LEN(process_json_layout), info, 2);
+        fprintf(ctx->out, "\n}\n");
     } else if (args->short_output) {
-        output_process_short(info);
+        emit_text(ctx, &process_schema, process_short_layout,
+                  LAYOUT_LEN(process_short_layout), info);
     } else {
-        output_process_normal(info);
+        print_color(ctx, COLOR_BOLD, "Process Information\n");
+        emit_text(ctx, &process_schema, process_normal_layout,
+                  LAYOUT_LEN(process_normal_layout), info);
     }
 
     return 0;
@@ -209,38 +920,171 @@ int output_process_info(const process_info_t *info, const cli_args_t *args) {
  * - Colors process names in green
  * - Shows PID in brackets and username in parentheses
  *
+ * @param ctx Context holding the report stream and color setting
  * @param node Pointer to process_tree_node_t to print (NULL-safe)
  * @param depth Current depth level in tree (0 = root)
  * @param is_last Boolean indicating if this is the last child at current depth
  * @return void
  */
-static void print_tree_recursive(const process_tree_node_t *node, int depth, bool is_last) {
+static void print_tree_recursive(const wir_ctx_t *ctx, const process_tree_node_t *node, int depth,
+                                 bool is_last) {
     if (!node) {
         return;
     }
 
     /* Print indentation and tree characters */
     for (int i = 0; i < depth; i++) {
-        printf("  ");
+        fprintf(ctx->out, "  ");
     }
 
     if (depth > 0) {
-        printf("%s ", is_last ? "└─" : "├─");
+        fprintf(ctx->out, "%s ", is_last ? "└─" : "├─");
     }
 
     /* Print process info */
-    print_color(COLOR_GREEN, "%s", node->info.name);
-    printf("[%d]", node->info.pid);
+    emit_text(ctx, &process_schema, tree_node_layout, LAYOUT_LEN(tree_node_layout), &node->info);
+    fprintf(ctx->out, "\n");
 
-    if (node->info.username[0]) {
-        printf(" (%s)", node->info.username);
+    /* Print parent (going up the tree) */
+    if (node->parent) {
+        print_tree_recursive(ctx, node->parent, depth + 1, true);
     }
+}
 
-    printf("\n");
+/**
+ * Print part of a process forest in ASCII art format
+ *
+ * Prints forest->order[from] to forest->order[to - 1], one process per line
+ * with its subtree totals. The range is depth-first (parents before
+ * children), so each line's connectors follow from its depth, whether it
+ * is the last of its siblings and whether each of its ancestors was: an
+ * ancestor with siblings still to come keeps a "│" running down its column.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param forest Finished forest
+ * @param from First position in forest->order (drawn at the left margin)
+ * @param to One past the last position
+ * @return 0 on success, -1 if memory is exhausted (message printed)
+ */
+static int print_forest_text(const wir_ctx_t *ctx, const process_forest_t *forest,
+                             int from, int to) {
+    if (from >= to) {
+        return 0;
+    }
 
-    /* Print parent (going up the tree) */
-    if (node->parent) {
-        print_tree_recursive(node->parent, depth + 1, true);
+    const int base = forest->order[from]->depth;
+    bool *open = counted_malloc((size_t)(to - from + 1) * sizeof(bool));
+    if (!open) {
+        print_error(ctx, "Cannot draw the process tree: %s", strerror(errno));
+        return -1;
+    }
+
+    for (int k = from; k < to; k++) {
+        const forest_node_t *node = forest->order[k];
+        const int depth = node->depth - base;
+
+        for (int level = 1; level < depth; level++) {
+            fputs(open[level] ? "│  " : "   ", ctx->out);
+        }
+        if (depth > 0) {
+            fputs(node->last ? "└─ " : "├─ ", ctx->out);
+            open[depth] = !node->last;
+        }
+
+        emit_text(ctx, &forest_schema, forest_node_layout, LAYOUT_LEN(forest_node_layout), node);
+        fputc('\n', ctx->out);
+    }
+
+    free(open);
+    return 0;
+}
+
+/**
+ * Print part of a process forest as nested JSON objects
+ *
+ * Prints the subtrees starting at forest->order[from] up to order[to - 1]
+ * as a comma-separated run of objects, each with a "children" array when
+ * it has children. Works through the depth-first order without recursion:
+ * a node with children leaves its array open, and a leaf closes the array
+ * and object of every ancestor it was the last descendant of.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param forest Finished forest
+ * @param from First position in forest->order
+ * @param to One past the last position (the end of a subtree)
+ * @param indent Indentation of the top-level objects
+ * @return void
+ */
+static void emit_forest_json(const wir_ctx_t *ctx, const process_forest_t *forest,
+                             int from, int to, int indent) {
+    if (from >= to) {
+        return;
+    }
+
+    const int base = forest->order[from]->depth;
+
+    for (int k = from; k < to; k++) {
+        const forest_node_t *node = forest->order[k];
+        const int at = indent + (node->depth - base) * 4;
+
+        print_indent(ctx, at);
+        fprintf(ctx->out, "{\n");
+        emit_json_members(ctx, &forest_schema, forest_json_layout,
+                          LAYOUT_LEN(forest_json_layout), node, at + 2);
+
+        if (node->child_count > 0) {
+            fprintf(ctx->out, ",\n");
+            print_indent(ctx, at + 2);
+            fprintf(ctx->out, "\"children\": [\n");
+            continue;
+        }
+
+        fputc('\n', ctx->out);
+        print_indent(ctx, at);
+        fputc('}', ctx->out);
+
+        /* Close every subtree this leaf ends */
+        const forest_node_t *closed = node;
+        while (closed->depth > base && closed->last) {
+            closed = closed->parent;
+            const int up = indent + (closed->depth - base) * 4;
+            fputc('\n', ctx->out);
+            print_indent(ctx, up + 2);
+            fprintf(ctx->out, "]\n");
+            print_indent(ctx, up);
+            fputc('}', ctx->out);
+        }
+        fprintf(ctx->out, k + 1 < to ? ",\n" : "\n");
+    }
+}
+
+/**
+ * Append part of a process forest as CBOR maps
+ *
+ * Same shape as emit_forest_json(). CBOR arrays carry their length up
+ * front, so the depth-first order streams out directly: each map announces
+ * its "children" array and the children follow as the next items.
+ *
+ * @param w Writer to append to
+ * @param forest Finished forest
+ * @param from First position in forest->order
+ * @param to One past the last position (the end of a subtree)
+ * @return void
+ */
+static void emit_forest_cbor(writer_t *w, const process_forest_t *forest, int from, int to) {
+    for (int k = from; k < to; k++) {
+        const forest_node_t *node = forest->order[k];
+
+        cbor_put_map(w, cbor_member_count(&forest_schema, forest_json_layout,
+                                          LAYOUT_LEN(forest_json_layout)) +
+                            (node->child_count > 0 ? 1 : 0));
+        emit_cbor_members(w, &forest_schema, forest_json_layout,
+                          LAYOUT_LEN(forest_json_layout), node);
+
+        if (node->child_count > 0) {
+            cbor_put_text(w, "children");
+            cbor_put_array(w, (size_t)node->child_count);
+        }
     }
 }
 
@@ -253,46 +1097,100 @@ static void print_tree_recursive(const process_tree_node_t *node, int depth, boo
  *
  * JSON structure:
  * - Each node has: pid, name, user
+ * - The target (depth 0) also has its subtree totals and a "children"
+ *   array of its descendants when the forest is known
  * - If parent exists, includes "parent" key with nested parent object
  * - Proper indentation based on depth for readability
  *
+ * @param ctx Context holding the report stream and color setting
  * @param node Pointer to process_tree_node_t to serialize (NULL-safe)
+ * @param forest Forest holding the target's descendants, or NULL
+ * @param subtree Forest node of the target (depth 0 only), or NULL
  * @param depth Current depth level for indentation (0 = root)
  * @return void
  */
-static void output_tree_json_recursive(const process_tree_node_t *node, int depth) {
+static void output_tree_json_recursive(const wir_ctx_t *ctx, const process_tree_node_t *node,
+                                       const process_forest_t *forest,
+                                       const forest_node_t *subtree, int depth) {
     if (!node) {
         return;
     }
 
-    for (int i = 0; i < depth; i++) printf("  ");
-    printf("{\n");
+    /* The opening brace follows the "parent" key, so it is never indented */
+    fprintf(ctx->out, "{\n");
+
+    emit_json_members(ctx, &process_schema, tree_json_layout, LAYOUT_LEN(tree_json_layout),
+                      &node->info, (depth + 1) * 2);
+
+    if (subtree) {
+        fprintf(ctx->out, ",\n");
+        emit_json_members(ctx, &forest_schema, forest_subtree_layout,
+                          LAYOUT_LEN(forest_subtree_layout), subtree, 2);
+        if (subtree->child_count > 0) {
+            fprintf(ctx->out, ",\n  \"children\": [\n");
+            emit_forest_json(ctx, forest, subtree->position + 1,
+                             subtree->position + 1 + subtree->descendants, 4);
+            fprintf(ctx->out, "  ]");
+        }
+    }
 
-    for (int i = 0; i < depth + 1; i++) printf("  ");
-    printf("\"pid\": %d,\n", node->info.pid);
+    if (node->parent) {
+        fprintf(ctx->out, ",\n");
+        for (int i = 0; i < depth + 1; i++) fprintf(ctx->out, "  ");
+        fprintf(ctx->out, "\"parent\": ");
+        output_tree_json_recursive(ctx, node->parent, NULL, NULL, depth + 1);
+    }
+    fprintf(ctx->out, "\n");
 
-    for (int i = 0; i < depth + 1; i++) printf("  ");
-    printf("\"name\": ");
-    print_json_string(node->info.name);
-    printf(",\n");
+    for (int i = 0; i < depth; i++) fprintf(ctx->out, "  ");
+    fprintf(ctx->out, "}");
+    if (depth == 0) {
+        fprintf(ctx->out, "\n");
+    }
+}
 
-    for (int i = 0; i < depth + 1; i++) printf("  ");
-    printf("\"user\": ");
-    print_json_string(node->info.username);
+/**
+ * Output process tree in CBOR format recursively
+ *
+ * Same shape as the JSON tree: a map with pid, name and user, plus a nested
+ * "parent" map when the node has a parent; the target also carries its
+ * subtree totals and "children" when the forest is known.
+ *
+ * @param w Writer to append to
+ * @param node Pointer to process_tree_node_t to serialize
+ * @param forest Forest holding the target's descendants, or NULL
+ * @param subtree Forest node of the target (first call only), or NULL
+ * @return void
+ */
+static void output_tree_cbor_recursive(writer_t *w, const process_tree_node_t *node,
+                                       const process_forest_t *forest,
+                                       const forest_node_t *subtree) {
+    size_t members = cbor_member_count(&process_schema, tree_json_layout,
+                                       LAYOUT_LEN(tree_json_layout)) + (node->parent ? 1 : 0);
+    if (subtree) {
+        members += cbor_member_count(&forest_schema, forest_subtree_layout,
+                                     LAYOUT_LEN(forest_subtree_layout)) +
+                   (subtree->child_count > 0 ? 1 : 0);
+    }
 
-    if (node->parent) {
-        printf(",\n");
-        for (int i = 0; i < depth + 1; i++) printf("  ");
-        printf("\"parent\": ");
-        output_tree_json_recursive(node->parent, depth + 1);
-    } else {
-        printf("\n");
+    cbor_put_map(w, members);
+    emit_cbor_members(w, &process_schema, tree_json_layout,
+                      LAYOUT_LEN(tree_json_layout), &node->info);
+
+    if (subtree) {
+        emit_cbor_members(w, &forest_schema, forest_subtree_layout,
+                          LAYOUT_LEN(forest_subtree_layout), subtree);
+        if (subtree->child_count > 0) {
+            cbor_put_text(w, "children");
+            cbor_put_array(w, (size_t)subtree->child_count);
+            emit_forest_cbor(w, forest, subtree->position + 1,
+                             subtree->position + 1 + subtree->descendants);
+        }
     }
 
-    for (int i = 0; i < depth; i++) printf("  ");
-    printf("}");
-    if (depth == 0) {
-        printf("\n");
+    if (node->parent) {
+        cbor_put_text(w, "parent");
+        output_tree_cbor_recursive(w, node->parent, NULL, NULL);
     }
 }
 
@@ -303,25 +1201,122 @@ static void output_tree_json_recursive(const process_tree_node_t *node, int dept
  * lineage from the target process up to its root ancestor (typically init/PID 1).
  * Selects output format based on command-line arguments.
  *
+ * When the forest is given, the target's descendants follow, with the
+ * totals of every subtree (see output_process_forest()).
+ *
  * Format selection:
+ * - CBOR format if args->cbor_output is true
  * - JSON format if args->json_output is true
  * - ASCII tree format (with box-drawing characters) otherwise
  *
+ * @param ctx Context holding the report stream and color setting
  * @param tree Pointer to process_tree_node_t representing the target process (leaf of tree)
+ * @param forest Finished forest of the same scan, or NULL to show the ancestry only
  * @param args Pointer to cli_args_t structure containing output format flags
- * @return 0 on success, -1 if tree is NULL
+ * @return 0 on success, -1 if tree is NULL or memory is exhausted
  */
-int output_process_tree(const process_tree_node_t *tree, const cli_args_t *args) {
+int output_process_tree(const wir_ctx_t *ctx, const process_tree_node_t *tree,
+                        const process_forest_t *forest, const cli_args_t *args) {
     if (!tree) {
-        print_error("No process tree available");
+        print_error(ctx, "No process tree available");
         return -1;
     }
 
-    if (args->json_output) {
-        output_tree_json_recursive(tree, 0);
+    const forest_node_t *subtree = forest ? forest_find(forest, tree->info.pid) : NULL;
+
+    if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        output_tree_cbor_recursive(w, tree, forest, subtree);
+        output_writer_close(w);
+    } else if (args->json_output) {
+        output_tree_json_recursive(ctx, tree, forest, subtree, 0);
+    } else {
+        print_color(ctx, COLOR_BOLD, "Process Ancestry Tree\n");
+        print_tree_recursive(ctx, tree, 0, true);
+
+        if (subtree) {
+            fprintf(ctx->out, "\n");
+            print_color(ctx, COLOR_BOLD, "Subtree (%d processes)\n", subtree->descendants + 1);
+            if (print_forest_text(ctx, forest, subtree->position,
+                                  subtree->position + 1 + subtree->descendants) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Output the whole process forest with format selection
+ *
+ * Every process of the scan, under its parent, with the totals of the
+ * subtree it roots: descendants, sockets, VSZ and RSS. Roots are processes
+ * without a parent in the snapshot; roots and siblings come in the order
+ * chosen by --sort (PID by default).
+ *
+ * Format selection:
+ * - CSV/TSV format if args->csv_output or args->tsv_output is true (one
+ *   row per process, depth-first, with a depth column)
+ * - CBOR format if args->cbor_output is true
+ * - JSON format if args->json_output is true ("roots" with nested "children")
+ * - ASCII tree format (with box-drawing characters) otherwise
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param forest Finished forest
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if the forest is empty or memory is exhausted
+ */
+int output_process_forest(const wir_ctx_t *ctx, const process_forest_t *forest,
+                          const cli_args_t *args) {
+    if (forest->order_count == 0) {
+        print_error(ctx, "No processes found");
+        return -1;
+    }
+
+    const char sep = delimited_separator(args);
+
+    if (sep) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        emit_delimited_header(w, &forest_schema, forest_delimited_layout,
+                              LAYOUT_LEN(forest_delimited_layout), sep);
+        writer_putc(w, '\n');
+        for (int k = 0; k < forest->order_count; k++) {
+            emit_delimited(w, &forest_schema, forest_delimited_layout,
+                           LAYOUT_LEN(forest_delimited_layout), forest->order[k], sep);
+            writer_putc(w, '\n');
+        }
+        output_writer_close(w);
+    } else if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        cbor_put_map(w, 2);
+        cbor_put_text(w, "process_count");
+        cbor_put_int(w, forest->order_count);
+        cbor_put_text(w, "roots");
+        cbor_put_array(w, (size_t)forest->root_count);
+        emit_forest_cbor(w, forest, 0, forest->order_count);
+        output_writer_close(w);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"process_count\": %d,\n", forest->order_count);
+        fprintf(ctx->out, "  \"roots\": [\n");
+        emit_forest_json(ctx, forest, 0, forest->order_count, 4);
+        fprintf(ctx->out, "  ]\n");
+        fprintf(ctx->out, "}\n");
     } else {
-        print_color(COLOR_BOLD, "Process Ancestry Tree\n");
-        print_tree_recursive(tree, 0, true);
+        print_color(ctx, COLOR_BOLD, "Process Forest (%d processes)\n", forest->order_count);
+        if (print_forest_text(ctx, forest, 0, forest->order_count) < 0) {
+            return -1;
+        }
     }
 
     return 0;
@@ -343,42 +1338,57 @@ int output_process_tree(const process_tree_node_t *tree, const cli_args_t *args)
  * - Each variable with colored name (cyan) and value
  * - Temporarily modifies string to split at '=' for formatting
  *
- * JSON format:
+ * JSON/CBOR format:
  * - Array of environment variable strings
  * - Total count field
  *
+ * @param ctx Context holding the report stream and color setting
  * @param env_vars Array of environment variable strings (format: "NAME=value")
  * @param count Number of environment variables in array
  * @param args Pointer to cli_args_t structure containing output format flags
- * @return 0 on success
+ * @return 0 on success, -1 if memory is exhausted (message printed)
  */
-int output_process_env(char **env_vars, int count, const cli_args_t *args) {
-    if (args->json_output) {
-        printf("{\n");
-        printf("  \"environment\": [\n");
+int output_process_env(const wir_ctx_t *ctx, char **env_vars, int count, const cli_args_t *args) {
+    if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        cbor_put_map(w, 2);
+        cbor_put_text(w, "environment");
+        cbor_put_array(w, (size_t)count);
+        for (int i = 0; i < count; i++) {
+            cbor_put_text(w, env_vars[i]);
+        }
+        cbor_put_text(w, "count");
+        cbor_put_int(w, count);
+        output_writer_close(w);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"environment\": [\n");
         for (int i = 0; i < count; i++) {
-            printf("    ");
-            print_json_string(env_vars[i]);
+            fprintf(ctx->out, "    ");
+            print_json_string(ctx, env_vars[i]);
             if (i < count - 1) {
-                printf(",");
+                fprintf(ctx->out, ",");
             }
-            printf("\n");
+            fprintf(ctx->out, "\n");
         }
-        printf("  ],\n");
-        printf("  \"count\": %d\n", count);
-        printf("}\n");
+        fprintf(ctx->out, "  ],\n");
+        fprintf(ctx->out, "  \"count\": %d\n", count);
+        fprintf(ctx->out, "}\n");
     } else {
-        print_color(COLOR_BOLD, "Environment Variables (%d total)\n", count);
+        print_color(ctx, COLOR_BOLD, "Environment Variables (%d total)\n", count);
         for (int i = 0; i < count; i++) {
             /* Split variable into name and value */
             char *equals = strchr(env_vars[i], '=');
             if (equals) {
                 *equals = '\0';
-                print_color(COLOR_CYAN, "  %s", env_vars[i]);
-                printf("=%s\n", equals + 1);
+                print_color(ctx, COLOR_CYAN, "  %s", env_vars[i]);
+                fprintf(ctx->out, "=%s\n", equals + 1);
                 *equals = '='; /* Restore */
             } else {
-                printf("  %s\n", env_vars[i]);
+                fprintf(ctx->out, "  %s\n", env_vars[i]);
             }
         }
     }
@@ -390,6 +1400,26 @@ int output_process_env(char **env_vars, int count, const cli_args_t *args) {
  * PORT OUTPUT
  * ============================================================================ */
 
+/* Accept queue fill level, in percent of the backlog, that counts as overload */
+#define ACCEPT_QUEUE_WARN_PERCENT 80
+
+/**
+ * Check if a listener's accept queue is close to its backlog
+ *
+ * Connections that completed the handshake wait in the accept queue until
+ * the server calls accept(). Once the queue reaches the backlog, the kernel
+ * drops new handshakes, so a queue near the backlog means the service is not
+ * keeping up. Only TCP listeners with a known backlog are checked.
+ *
+ * @param conn Pointer to connection_info_t structure
+ * @return true if the accept queue is at least ACCEPT_QUEUE_WARN_PERCENT full
+ */
+static bool accept_queue_saturated(const connection_info_t *conn) {
+    return conn->backlog > 0 &&
+           (unsigned long)conn->rx_queue * 100 >=
+               (unsigned long)conn->backlog * ACCEPT_QUEUE_WARN_PERCENT;
+}
+
 /**
  * Check if connection has warning conditions
  *
@@ -420,6 +1450,141 @@ static bool has_warning(const connection_info_t *conn, const process_info_t *pro
     return false;
 }
 
+/* Owners listed one by one before the rest are only counted */
+#define OWNER_LIST_MAX 8
+
+/**
+ * Read a process shown for a socket
+ *
+ * With --from-shm the process comes from the published snapshot (which
+ * holds every field), so the port report makes no /proc reads either.
+ *
+ * @param ctx Context (the snapshot, if any)
+ * @param pid Process ID
+ * @param info Output process
+ * @param sources Bitmask of PROC_SRC_* flags the caller needs
+ * @return 0 on success, -1 if the process cannot be read
+ */
+static int lookup_process(const wir_ctx_t *ctx, pid_t pid, process_info_t *info,
+                          unsigned int sources) {
+    if (ctx->snapshot) {
+        return snapshot_get_process(ctx->snapshot, pid, info);
+    }
+    return platform_get_process_fields(pid, info, sources);
+}
+
+/**
+ * Owners of a shared socket, collapsed by parent
+ *
+ * Prefork servers (nginx, gunicorn, php-fpm) share their listening socket
+ * between a master and its workers; 65 owners read best as one master and
+ * 64 children.
+ *
+ * Fields:
+ * - parent: Process every owner descends from, or -1 if they share none
+ *   (or the socket has a single owner)
+ * - parent_owns: The parent holds the socket too (a prefork master)
+ * - children: Owners whose parent is parent
+ */
+typedef struct {
+    pid_t parent;
+    bool parent_owns;
+    int children;
+} owner_family_t;
+
+/**
+ * Find the parent the owners of a socket share, if any
+ *
+ * Either one owner is the parent of all the others, or every owner has
+ * the same parent. In the first case the parent is the parent of the
+ * first or the second owner, so only those two candidates are tried.
+ *
+ * @param ctx Context (the snapshot with --from-shm)
+ * @param conn Connection with two or more owners
+ * @return Family (parent -1 if the owners share no parent, or if memory is
+ *         exhausted: the owners are then listed without their family)
+ */
+static owner_family_t owner_family(const wir_ctx_t *ctx, const connection_info_t *conn) {
+    owner_family_t family = { -1, false, 0 };
+    if (conn->owner_count < 2) {
+        return family;
+    }
+
+    pid_t *ppids = counted_malloc((size_t)conn->owner_count * sizeof(pid_t));
+    if (!ppids) {
+        return family;
+    }
+    for (int i = 0; i < conn->owner_count; i++) {
+        process_info_t proc;
+        ppids[i] = lookup_process(ctx, conn->owners[i], &proc, PROC_SRC_STAT) == 0
+                       ? proc.ppid
+                       : -1;
+    }
+
+    for (int c = 0; c < 2 && family.parent < 0; c++) {
+        const pid_t candidate = ppids[c];
+        if (candidate <= 0) {
+            continue;
+        }
+
+        int children = 0;
+        bool owns = false;
+        for (int i = 0; i < conn->owner_count; i++) {
+            children += ppids[i] == candidate;
+            owns = owns || conn->owners[i] == candidate;
+        }
+        if (children == conn->owner_count - (owns ? 1 : 0)) {
+            family = (owner_family_t){ candidate, owns, children };
+        }
+    }
+
+    free(ppids);
+    return family;
+}
+
+/**
+ * Pick the owner whose details a report shows
+ *
+ * @param conn Connection
+ * @param family Owners' family from owner_family()
+ * @return The prefork master if it holds the socket, else conn->pid
+ */
+static pid_t shown_owner(const connection_info_t *conn, const owner_family_t *family) {
+    return family->parent_owns ? family->parent : conn->pid;
+}
+
+/**
+ * Print the "Owners" line of a socket held by several processes
+ *
+ * @param ctx Context holding the report stream
+ * @param conn Connection with two or more owners
+ * @param family Owners' family from owner_family()
+ * @return void
+ */
+static void output_owners_line(const wir_ctx_t *ctx, const connection_info_t *conn,
+                               const owner_family_t *family) {
+    fprintf(ctx->out, "  Owners: %d processes (", conn->owner_count);
+
+    if (family->parent_owns) {
+        fprintf(ctx->out, "PID %d and %d %s)\n", family->parent, family->children,
+                family->children == 1 ? "child" : "children");
+        return;
+    }
+    if (family->parent > 0) {
+        fprintf(ctx->out, "children of PID %d)\n", family->parent);
+        return;
+    }
+
+    fprintf(ctx->out, "PIDs");
+    for (int i = 0; i < conn->owner_count && i < OWNER_LIST_MAX; i++) {
+        fprintf(ctx->out, "%s %d", i > 0 ? "," : "", conn->owners[i]);
+    }
+    if (conn->owner_count > OWNER_LIST_MAX) {
+        fprintf(ctx->out, " and %d more", conn->owner_count - OWNER_LIST_MAX);
+    }
+    fprintf(ctx->out, ")\n");
+}
+
 /**
  * Output port info in normal (detailed) format
  *
@@ -430,49 +1595,77 @@ static bool has_warning(const connection_info_t *conn, const process_info_t *pro
  * For each connection shows:
  * - Protocol (TCP/UDP) and state
  * - Local and remote addresses with ports
- * - Process details (name, PID, user, command)
+ * - Queue depths; for a TCP listener, the accept queue against the backlog
+ * - TCP internals (RTT, congestion window, retransmits, socket memory) with
+ *   --tcp-info
+ * - Process details (name, PID, user, command); for a socket shared by
+ *   several processes, those of the prefork master if there is one, and
+ *   the owners collapsed by parent
  * - Security warnings if applicable (root on user port, zombie process)
+ * - Overload warning if the accept queue is close to the backlog
  *
+ * @param ctx Context holding the report stream and color setting
  * @param port Port number being queried
  * @param connections Array of connection_info_t structures
  * @param count Number of connections in array
  * @return void
  */
-static void output_port_normal(int port, const connection_info_t *connections, int count) {
-    print_color(COLOR_BOLD, "Port %d Connections (%d found)\n", port, count);
+static void output_port_normal(const wir_ctx_t *ctx, int port, const connection_info_t *connections,
+                               int count) {
+    /* has_warning() also needs uid and state */
+    const unsigned int sources = PROC_SRC_STATUS |
+        field_layout_sources(&process_schema, port_process_normal_layout,
+                             LAYOUT_LEN(port_process_normal_layout));
+
+    print_color(ctx, COLOR_BOLD, "Port %d Connections (%d found)\n", port, count);
 
     for (int i = 0; i < count; i++) {
         const connection_info_t *conn = &connections[i];
 
-        printf("\n");
-        print_color(COLOR_CYAN, "Connection #%d:\n", i + 1);
-        printf("  Protocol: %s\n", conn->protocol);
-        printf("  State: %s\n", conn->state);
-        printf("  Local: %s:%d\n", conn->local_addr[0] ? conn->local_addr : "*",
-               conn->local_port);
+        fprintf(ctx->out, "\n");
+        print_color(ctx, COLOR_CYAN, "Connection #%d:\n", i + 1);
+        emit_text(ctx, &connection_schema, connection_normal_layout,
+                  LAYOUT_LEN(connection_normal_layout), conn);
 
         if (conn->remote_port > 0) {
-            printf("  Remote: %s:%d\n", conn->remote_addr, conn->remote_port);
+            emit_text(ctx, &connection_schema, connection_remote_layout,
+                      LAYOUT_LEN(connection_remote_layout), conn);
+        }
+
+        if (conn->backlog > 0) {
+            emit_text(ctx, &connection_schema, connection_accept_layout,
+                      LAYOUT_LEN(connection_accept_layout), conn);
+            if (accept_queue_saturated(conn)) {
+                print_warning(ctx, "Accept queue nearly full: connections are not being "
+                              "accepted fast enough");
+            }
+        } else {
+            emit_text(ctx, &connection_schema, connection_queue_layout,
+                      LAYOUT_LEN(connection_queue_layout), conn);
+        }
+
+        if (conn->has_tcp_info) {
+            emit_text(ctx, &connection_schema, connection_tcp_info_layout,
+                      LAYOUT_LEN(connection_tcp_info_layout), conn);
         }
 
         if (conn->pid > 0) {
+            const owner_family_t family = owner_family(ctx, conn);
             process_info_t proc;
-            if (platform_get_process_info(conn->pid, &proc) == 0) {
-                print_color(COLOR_GREEN, "  Process: ");
-                printf("%s (PID: %d)\n", proc.name, proc.pid);
-                printf("  User: %s\n", proc.username);
-
-                if (proc.cmdline[0]) {
-                    printf("  Command: %s\n", proc.cmdline);
-                }
+            if (lookup_process(ctx, shown_owner(conn, &family), &proc, sources) == 0) {
+                emit_text(ctx, &process_schema, port_process_normal_layout,
+                          LAYOUT_LEN(port_process_normal_layout), &proc);
 
                 /* Show warning if applicable */
                 if (has_warning(conn, &proc)) {
-                    print_warning("Process running with elevated privileges (root)");
+                    print_warning(ctx, "Process running with elevated privileges (root)");
                 }
             }
+            if (conn->owner_count > 1) {
+                output_owners_line(ctx, conn, &family);
+            }
         } else {
-            printf("  Process: Unknown\n");
+            fprintf(ctx->out, "  Process: Unknown\n");
         }
     }
 }
@@ -481,25 +1674,43 @@ static void output_port_normal(int port, const connection_info_t *connections, i
  * Output port info in short (one-line per connection) format
  *
  * Displays concise information about port connections, one line per connection.
- * Format: "Port <port>: <process>[<pid>] by <user> (<state>)"
+ * Format: "Port <port>: <process>[<pid>] by <user> (<state>, Recv-Q <n>, Send-Q <n>)"
+ * A shared socket names its prefork master (or lowest owner) and counts the
+ * rest: "nginx[100] by root and 64 children (LISTEN, ...)".
  *
+ * @param ctx Context holding the report stream and color setting
  * @param port Port number being queried
  * @param connections Array of connection_info_t structures
  * @param count Number of connections in array
  * @return void
  */
-static void output_port_short(int port, const connection_info_t *connections, int count) {
+static void output_port_short(const wir_ctx_t *ctx, int port, const connection_info_t *connections,
+                              int count) {
+    const unsigned int sources =
+        field_layout_sources(&process_schema, port_process_short_layout,
+                             LAYOUT_LEN(port_process_short_layout));
+
     for (int i = 0; i < count; i++) {
         const connection_info_t *conn = &connections[i];
 
         if (conn->pid > 0) {
+            const owner_family_t family = owner_family(ctx, conn);
             process_info_t proc;
-            if (platform_get_process_info(conn->pid, &proc) == 0) {
-                printf("Port %d: %s[%d] by %s (%s)\n",
-                       port, proc.name, proc.pid, proc.username, conn->state);
+            if (lookup_process(ctx, shown_owner(conn, &family), &proc, sources) == 0) {
+                fprintf(ctx->out, "Port %d: ", port);
+                emit_text(ctx, &process_schema, port_process_short_layout,
+                          LAYOUT_LEN(port_process_short_layout), &proc);
+                if (conn->owner_count > 1) {
+                    const int others = conn->owner_count - 1;
+                    fprintf(ctx->out, " and %d %s", others,
+                            family.parent_owns ? (others == 1 ? "child" : "children")
+                                               : (others == 1 ? "other" : "others"));
+                }
+                emit_text(ctx, &connection_schema, connection_short_layout,
+                          LAYOUT_LEN(connection_short_layout), conn);
             }
         } else {
-            printf("Port %d: Unknown process (%s)\n", port, conn->state);
+            fprintf(ctx->out, "Port %d: Unknown process (%s)\n", port, conn->state);
         }
     }
 }
@@ -515,106 +1726,244 @@ static void output_port_short(int port, const connection_info_t *connections, in
  * - port: port number
  * - connection_count: total connections
  * - connections: array of connection objects
- *   Each connection includes: protocol, state, addresses, ports
- *   If process info available: nested process object with pid, name, user, cmdline
+ *   Each connection includes: protocol, state, addresses, ports, rx_queue,
+ *   tx_queue, backlog (0 unless a TCP listener), owner_count and "owners"
+ *   (every PID holding the socket, when known)
+ *   With --tcp-info, TCP connections also carry "tcp_info" (rtt_us,
+ *   rttvar_us, retransmits, total_retrans, snd_cwnd, unacked) and
+ *   "socket_memory" (rmem_alloc, rcvbuf, wmem_alloc, sndbuf, wmem_queued, drops)
+ *   If process info available: nested process object with pid, name, user,
+ *   cmdline (the prefork master of a shared socket if it holds the socket)
  *
+ * @param ctx Context holding the report stream and color setting
  * @param port Port number being queried
  * @param connections Array of connection_info_t structures
  * @param count Number of connections in array
  * @return void
  */
-static void output_port_json(int port, const connection_info_t *connections, int count) {
-    printf("{\n");
-    printf("  \"port\": %d,\n", port);
-    printf("  \"connection_count\": %d,\n", count);
-    printf("  \"connections\": [\n");
+static void output_port_json(const wir_ctx_t *ctx, int port, const connection_info_t *connections,
+                             int count) {
+    const unsigned int sources =
+        field_layout_sources(&process_schema, port_process_json_layout,
+                             LAYOUT_LEN(port_process_json_layout));
+
+    fprintf(ctx->out, "{\n");
+    fprintf(ctx->out, "  \"port\": %d,\n", port);
+    fprintf(ctx->out, "  \"connection_count\": %d,\n", count);
+    fprintf(ctx->out, "  \"connections\": [\n");
 
     for (int i = 0; i < count; i++) {
         const connection_info_t *conn = &connections[i];
 
-        printf("    {\n");
-        printf("      \"protocol\": ");
-        print_json_string(conn->protocol);
-        printf(",\n");
-        printf("      \"state\": ");
-        print_json_string(conn->state);
-        printf(",\n");
-        printf("      \"local_address\": ");
-        print_json_string(conn->local_addr);
-        printf(",\n");
-        printf("      \"local_port\": %d,\n", conn->local_port);
-        printf("      \"remote_address\": ");
-        print_json_string(conn->remote_addr);
-        printf(",\n");
-        printf("      \"remote_port\": %d", conn->remote_port);
+        fprintf(ctx->out, "    {\n");
+        emit_json_members(ctx, &connection_schema, connection_json_layout,
+                          LAYOUT_LEN(connection_json_layout), conn, 6);
+        if (conn->has_tcp_info) {
+            fprintf(ctx->out, ",\n");
+            emit_json_members(ctx, &connection_schema, connection_tcp_info_json_layout,
+                              LAYOUT_LEN(connection_tcp_info_json_layout), conn, 6);
+        }
+        if (conn->owner_count > 0) {
+            fprintf(ctx->out, ",\n      \"owners\": [");
+            for (int k = 0; k < conn->owner_count; k++) {
+                fprintf(ctx->out, "%s%d", k > 0 ? ", " : "", conn->owners[k]);
+            }
+            fprintf(ctx->out, "]");
+        }
 
         if (conn->pid > 0) {
+            const owner_family_t family = owner_family(ctx, conn);
             process_info_t proc;
-            if (platform_get_process_info(conn->pid, &proc) == 0) {
-                printf(",\n");
-                printf("      \"process\": {\n");
-                printf("        \"pid\": %d,\n", proc.pid);
-                printf("        \"name\": ");
-                print_json_string(proc.name);
-                printf(",\n");
-                printf("        \"user\": ");
-                print_json_string(proc.username);
-                printf(",\n");
-                printf("        \"cmdline\": ");
-                print_json_string(proc.cmdline);
-                printf("\n");
-                printf("      }\n");
+            if (lookup_process(ctx, shown_owner(conn, &family), &proc, sources) == 0) {
+                fprintf(ctx->out, ",\n");
+                fprintf(ctx->out, "      \"process\": {\n");
+                emit_json_members(ctx, &process_schema, port_process_json_layout,
+                                  LAYOUT_LEN(port_process_json_layout), &proc, 8);
+                fprintf(ctx->out, "\n");
+                fprintf(ctx->out, "      }\n");
             } else {
-                printf("\n");
+                fprintf(ctx->out, "\n");
             }
         } else {
-            printf("\n");
+            fprintf(ctx->out, "\n");
         }
 
-        printf("    }%s\n", i < count - 1 ? "," : "");
+        fprintf(ctx->out, "    }%s\n", i < count - 1 ? "," : "");
     }
 
-    printf("  ]\n");
-    printf("}\n");
+    fprintf(ctx->out, "  ]\n");
+    fprintf(ctx->out, "}\n");
+}
+
+/**
+ * Output port info in CSV/TSV format
+ *
+ * Writes a header row and one row per connection: the connection columns
+ * (with pid, the lowest owner, and owner_count) followed by the columns of
+ * that process (empty when the owner is unknown).
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param connections Array of connection_info_t structures
+ * @param count Number of connections in array
+ * @param sep Field separator (',' or '\t')
+ * @return 0 on success, -1 if memory is exhausted (message printed)
+ */
+static int output_port_delimited(const wir_ctx_t *ctx, const connection_info_t *connections,
+                                  int count, char sep) {
+    const unsigned int sources =
+        field_layout_sources(&process_schema, port_process_delimited_layout,
+                             LAYOUT_LEN(port_process_delimited_layout));
+    writer_t *w = output_writer_open(ctx);
+    if (!w) {
+        return -1;
+    }
+
+    emit_delimited_header(w, &connection_schema, connection_delimited_layout,
+                          LAYOUT_LEN(connection_delimited_layout), sep);
+    writer_putc(w, sep);
+    emit_delimited_header(w, &process_schema, port_process_delimited_layout,
+                          LAYOUT_LEN(port_process_delimited_layout), sep);
+    writer_putc(w, '\n');
+
+    for (int i = 0; i < count; i++) {
+        const connection_info_t *conn = &connections[i];
+        process_info_t proc;
+        const bool have_proc = conn->pid > 0 &&
+            lookup_process(ctx, conn->pid, &proc, sources) == 0;
+
+        emit_delimited(w, &connection_schema, connection_delimited_layout,
+                       LAYOUT_LEN(connection_delimited_layout), conn, sep);
+        writer_putc(w, sep);
+        emit_delimited(w, &process_schema, port_process_delimited_layout,
+                       LAYOUT_LEN(port_process_delimited_layout),
+                       have_proc ? &proc : NULL, sep);
+        writer_putc(w, '\n');
+    }
+
+    output_writer_close(w);
+    return 0;
+}
+
+/**
+ * Output port info in CBOR format
+ *
+ * Same shape and keys as the JSON output: a map with port, connection_count
+ * and a connections array; each connection map carries an "owners" array
+ * and a nested "process" map when the owners could be resolved.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param port Port number being queried
+ * @param connections Array of connection_info_t structures
+ * @param count Number of connections in array
+ * @return 0 on success, -1 if memory is exhausted (message printed)
+ */
+static int output_port_cbor(const wir_ctx_t *ctx, int port, const connection_info_t *connections,
+                            int count) {
+    const unsigned int sources =
+        field_layout_sources(&process_schema, port_process_json_layout,
+                             LAYOUT_LEN(port_process_json_layout));
+    writer_t *w = output_writer_open(ctx);
+    if (!w) {
+        return -1;
+    }
+
+    cbor_put_map(w, 3);
+    cbor_put_text(w, "port");
+    cbor_put_int(w, port);
+    cbor_put_text(w, "connection_count");
+    cbor_put_int(w, count);
+    cbor_put_text(w, "connections");
+    cbor_put_array(w, (size_t)count);
+
+    for (int i = 0; i < count; i++) {
+        const connection_info_t *conn = &connections[i];
+        const owner_family_t family = owner_family(ctx, conn);
+        process_info_t proc;
+        const bool have_proc = conn->pid > 0 &&
+            lookup_process(ctx, shown_owner(conn, &family), &proc, sources) == 0;
+
+        cbor_put_map(w, cbor_member_count(&connection_schema, connection_json_layout,
+                                          LAYOUT_LEN(connection_json_layout)) +
+                            (conn->has_tcp_info
+                                 ? cbor_member_count(&connection_schema,
+                                                     connection_tcp_info_json_layout,
+                                                     LAYOUT_LEN(connection_tcp_info_json_layout))
+                                 : 0) +
+                            (conn->owner_count > 0 ? 1 : 0) + (have_proc ? 1 : 0));
+        emit_cbor_members(w, &connection_schema, connection_json_layout,
+                          LAYOUT_LEN(connection_json_layout), conn);
+        if (conn->has_tcp_info) {
+            emit_cbor_members(w, &connection_schema, connection_tcp_info_json_layout,
+                              LAYOUT_LEN(connection_tcp_info_json_layout), conn);
+        }
+        if (conn->owner_count > 0) {
+            cbor_put_text(w, "owners");
+            cbor_put_array(w, (size_t)conn->owner_count);
+            for (int k = 0; k < conn->owner_count; k++) {
+                cbor_put_int(w, conn->owners[k]);
+            }
+        }
+
+        if (have_proc) {
+            cbor_put_text(w, "process");
+            emit_cbor_map(w, &process_schema, port_process_json_layout,
+                          LAYOUT_LEN(port_process_json_layout), &proc);
+        }
+    }
+
+    output_writer_close(w);
+    return 0;
 }
 
 /**
  * Output port info in warnings-only format
  *
- * Analyzes port connections for security concerns and displays only warnings.
- * If no issues found, displays success message. Useful for security auditing.
+ * Analyzes port connections for security and overload concerns and displays
+ * only warnings. If no issues found, displays success message. Useful for
+ * security auditing and for triaging a struggling service.
  *
  * Checks for:
  * - Processes running as root on non-system ports (>= 1024)
  * - Zombie processes holding ports
+ * - TCP listeners whose accept queue is close to the backlog (overload)
  * - Multiple processes listening on same port (potential conflict)
  *
+ * @param ctx Context holding the report stream and color setting
  * @param port Port number being queried
  * @param connections Array of connection_info_t structures
  * @param count Number of connections in array
  * @return void
  */
-static void output_port_warnings(int port, const connection_info_t *connections, int count) {
+static void output_port_warnings(const wir_ctx_t *ctx, int port,
+                                 const connection_info_t *connections, int count) {
     bool found_warning = false;
 
-    print_color(COLOR_BOLD, "Port %d - Security Warnings\n", port);
+    print_color(ctx, COLOR_BOLD, "Port %d - Warnings\n", port);
 
     for (int i = 0; i < count; i++) {
         const connection_info_t *conn = &connections[i];
 
+        if (accept_queue_saturated(conn)) {
+            found_warning = true;
+            print_warning(ctx, "Accept queue of %s listener on %s:%d is %u of backlog %d "
+                          "(PID %d): connections are not being accepted fast enough",
+                          conn->protocol, conn->local_addr, conn->local_port,
+                          conn->rx_queue, conn->backlog, conn->pid);
+        }
+
         if (conn->pid > 0) {
             process_info_t proc;
-            if (platform_get_process_info(conn->pid, &proc) == 0) {
+            if (lookup_process(ctx, conn->pid, &proc, PROC_SRC_ALL) == 0) {
                 if (has_warning(conn, &proc)) {
                     found_warning = true;
 
                     if (proc.uid == 0 && conn->local_port >= 1024) {
-                        print_warning("Process '%s' (PID %d) running as root on non-system port",
-                                    proc.name, proc.pid);
+                        print_warning(ctx, "Process '%s' (PID %d) running as root on "
+                                      "non-system port", proc.name, proc.pid);
                     }
 
                     if (proc.state == 'Z') {
-                        print_warning("Zombie process '%s' (PID %d) holding port",
+                        print_warning(ctx, "Zombie process '%s' (PID %d) holding port",
                                     proc.name, proc.pid);
                     }
                 }
@@ -625,11 +1974,11 @@ static void output_port_warnings(int port, const connection_info_t *connections,
     /* Check for multiple processes on same port */
     if (count > 1) {
         found_warning = true;
-        print_warning("Multiple processes (%d) listening on port %d", count, port);
+        print_warning(ctx, "Multiple processes (%d) listening on port %d", count, port);
     }
 
     if (!found_warning) {
-        print_success("No warnings found for port %d", port);
+        print_success(ctx, "No warnings found for port %d", port);
     }
 }
 
@@ -642,34 +1991,45 @@ static void output_port_warnings(int port, const connection_info_t *connections,
  *
  * Format selection priority:
  * 1. Warnings-only if args->warnings_only is true
- * 2. JSON if args->json_output is true
- * 3. Short if args->short_output is true
- * 4. Normal (detailed) format otherwise
+ * 2. CSV/TSV if args->csv_output or args->tsv_output is true
+ * 3. CBOR if args->cbor_output is true
+ * 4. JSON if args->json_output is true
+ * 5. Short if args->short_output is true
+ * 6. Normal (detailed) format otherwise
  *
  * Interactive mode:
  * - If args->interactive is true, prompts to kill first process on port
  *
+ * @param ctx Context holding the report stream and color setting
  * @param port Port number being queried
  * @param connections Array of connection_info_t structures
  * @param count Number of connections in array
  * @param args Pointer to cli_args_t structure containing output format flags
- * @return 0 on success, -1 if no connections found
+ * @return 0 on success, -1 if no connections found or memory is exhausted
  */
-int output_port_info(int port, const connection_info_t *connections,
+int output_port_info(const wir_ctx_t *ctx, int port, const connection_info_t *connections,
                      int count, const cli_args_t *args) {
     if (count == 0) {
-        print_error("No connections found on port %d", port);
+        print_error(ctx, "No connections found on port %d", port);
         return -1;
     }
 
     if (args->warnings_only) {
-        output_port_warnings(port, connections, count);
+        output_port_warnings(ctx, port, connections, count);
+    } else if (delimited_separator(args)) {
+        if (output_port_delimited(ctx, connections, count, delimited_separator(args)) < 0) {
+            return -1;
+        }
+    } else if (args->cbor_output) {
+        if (output_port_cbor(ctx, port, connections, count) < 0) {
+            return -1;
+        }
     } else if (args->json_output) {
-        output_port_json(port, connections, count);
+        output_port_json(ctx, port, connections, count);
     } else if (args->short_output) {
-        output_port_short(port, connections, count);
+        output_port_short(ctx, port, connections, count);
     } else {
-        output_port_normal(port, connections, count);
+        output_port_normal(ctx, port, connections, count);
     }
 
     /* Interactive mode - prompt to kill process(es) */
@@ -679,15 +2039,17 @@ int output_port_info(int port, const connection_info_t *connections,
         for (int i = 0; i < count; i++) {
             if (connections[i].pid > 0) {
                 process_info_t proc;
-                if (platform_get_process_info(connections[i].pid, &proc) == 0) {
-                    prompt_kill_process(proc.pid, proc.name);
+                if (lookup_process(ctx, connections[i].pid, &proc, PROC_SRC_ALL) == 0) {
+                    prompt_kill_process(ctx, proc.pid, proc.name, proc.start_time,
+                                        args_grace_ms(args));
                     found_killable = true;
                     break;
                 }
             }
         }
         if (!found_killable) {
-            print_warning("No killable process found on port %d (PID unavailable or access denied)", port);
+            print_warning(ctx, "No killable process found on port %d (PID unavailable or "
+                          "access denied)", port);
         }
     }
 
@@ -699,150 +2061,1099 @@ int output_port_info(int port, const connection_info_t *connections,
  * ============================================================================ */
 
 /**
- * Output process list in normal (table) format
+ * Start an --all process list
+ *
+ * Writes everything that precedes the rows for the selected format. When the
+ * number of rows is known up front (expected >= 0) the output is exactly the
+ * classic one; when streaming (expected < 0) the count moves to the end:
  *
- * Displays all processes in a formatted table with headers and aligned columns.
- * Shows PID, PPID, name, user, and command line. Includes header row with
- * column names and separator line. Total count displayed at bottom.
+ * - Normal: "Running Processes" header without "(N total)"; the total is
+ *   printed after the table either way
+ * - JSON: "process_count" follows the "processes" array
+ * - CBOR: "processes" is an indefinite-length array, followed by
+ *   "process_count"
+ * - Short, CSV, TSV: unaffected
  *
- * Table columns:
+ * Table columns (normal format):
  * - PID: Process ID (8 chars wide)
  * - PPID: Parent Process ID (8 chars wide)
  * - NAME: Process name (20 chars wide, colored green)
  * - USER: Username (12 chars wide, colored cyan)
  * - COMMAND: Command line (60 chars max)
  *
- * @param processes Array of process_info_t structures
- * @param count Number of processes in array
+ * @param s Stream state to initialize
+ * @param ctx Context holding the report stream and color setting
+ * @param expected Number of rows that will follow, or -1 if not known yet
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if memory is exhausted (message printed; do not
+ *         continue the stream)
+ */
+int output_process_list_begin(process_list_stream_t *s, const wir_ctx_t *ctx,
+                              int expected, const cli_args_t *args) {
+    s->ctx = ctx;
+    s->args = args;
+    s->writer = NULL;
+    s->sep = delimited_separator(args);
+    s->expected = expected;
+    s->count = 0;
+
+    if (s->sep) {
+        s->writer = output_writer_open(ctx);
+        if (!s->writer) {
+            return -1;
+        }
+        emit_delimited_header(s->writer, &process_schema, process_delimited_layout,
+                              LAYOUT_LEN(process_delimited_layout), s->sep);
+        writer_putc(s->writer, '\n');
+    } else if (args->cbor_output) {
+        s->writer = output_writer_open(ctx);
+        if (!s->writer) {
+            return -1;
+        }
+        cbor_put_map(s->writer, 2);
+        if (expected >= 0) {
+            cbor_put_text(s->writer, "process_count");
+            cbor_put_int(s->writer, expected);
+            cbor_put_text(s->writer, "processes");
+            cbor_put_array(s->writer, (size_t)expected);
+        } else {
+            cbor_put_text(s->writer, "processes");
+            cbor_put_array_indefinite(s->writer);
+        }
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        if (expected >= 0) {
+            fprintf(ctx->out, "  \"process_count\": %d,\n", expected);
+        }
+        fprintf(ctx->out, "  \"processes\": [\n");
+    } else if (!args->short_output) {
+        if (expected >= 0) {
+            print_color(ctx, COLOR_BOLD, "Running Processes (%d total)\n", expected);
+        } else {
+            print_color(ctx, COLOR_BOLD, "Running Processes\n");
+        }
+        fprintf(ctx->out, "\n");
+        emit_table_header(ctx, &process_schema, process_table_layout,
+                          LAYOUT_LEN(process_table_layout));
+    }
+    return 0;
+}
+
+/**
+ * Emit one process of an --all list
+ *
+ * CSV/TSV and CBOR rows go through the buffered writer; the text formats
+ * print directly. JSON separators are written before each row after the
+ * first, so no row needs to know whether it is the last one.
+ *
+ * @param s Stream state from output_process_list_begin()
+ * @param proc Process to emit
  * @return void
  */
-static void output_process_list_normal(const process_info_t *processes, int count) {
-    print_color(COLOR_BOLD, "Running Processes (%d total)\n", count);
-    printf("\n");
-    printf("%-8s %-8s %-20s %-12s %s\n", "PID", "PPID", "NAME", "USER", "COMMAND");
-    print_color(COLOR_BOLD, "%-8s %-8s %-20s %-12s %s\n",
-                "--------", "--------", "--------------------",
-                "------------", "-------");
+void output_process_list_row(process_list_stream_t *s, const process_info_t *proc) {
+    const wir_ctx_t *ctx = s->ctx;
+    const cli_args_t *args = s->args;
+
+    if (s->sep) {
+        emit_delimited(s->writer, &process_schema, process_delimited_layout,
+                       LAYOUT_LEN(process_delimited_layout), proc, s->sep);
+        writer_putc(s->writer, '\n');
+    } else if (args->cbor_output) {
+        emit_cbor_map(s->writer, &process_schema, process_list_json_layout,
+                      LAYOUT_LEN(process_list_json_layout), proc);
+    } else if (args->json_output) {
+        if (s->count > 0) {
+            fprintf(ctx->out, ",\n");
+        }
+        fprintf(ctx->out, "    {\n");
+        emit_json_members(ctx, &process_schema, process_list_json_layout,
+                          LAYOUT_LEN(process_list_json_layout), proc, 6);
+        fprintf(ctx->out, "\n");
+        fprintf(ctx->out, "    }");
+    } else if (args->short_output) {
+        emit_text(ctx, &process_schema, process_list_short_layout,
+                  LAYOUT_LEN(process_list_short_layout), proc);
+    } else {
+        emit_text(ctx, &process_schema, process_table_layout,
+                  LAYOUT_LEN(process_table_layout), proc);
+    }
 
-    for (int i = 0; i < count; i++) {
-        const process_info_t *proc = &processes[i];
+    s->count++;
+}
 
-        printf("%-8d %-8d ", proc->pid, proc->ppid);
-        print_color(COLOR_GREEN, "%-20.20s ", proc->name);
-        print_color(COLOR_CYAN, "%-12.12s ", proc->username);
-        printf("%.60s\n", proc->cmdline[0] ? proc->cmdline : "(no cmdline)");
+/**
+ * Finish an --all process list
+ *
+ * Writes whatever follows the rows (closing brackets, totals, the streamed
+ * count) and flushes and releases the writer, if any.
+ *
+ * @param s Stream state from output_process_list_begin()
+ * @return 0 on success, -1 if no rows were emitted
+ */
+int output_process_list_end(process_list_stream_t *s) {
+    const wir_ctx_t *ctx = s->ctx;
+    const cli_args_t *args = s->args;
+
+    if (s->sep) {
+        output_writer_close(s->writer);
+    } else if (args->cbor_output) {
+        if (s->expected < 0) {
+            cbor_put_break(s->writer);
+            cbor_put_text(s->writer, "process_count");
+            cbor_put_int(s->writer, s->count);
+        }
+        output_writer_close(s->writer);
+    } else if (args->json_output) {
+        if (s->count > 0) {
+            fprintf(ctx->out, "\n");
+        }
+        if (s->expected >= 0) {
+            fprintf(ctx->out, "  ]\n");
+        } else {
+            fprintf(ctx->out, "  ],\n");
+            fprintf(ctx->out, "  \"process_count\": %d\n", s->count);
+        }
+        fprintf(ctx->out, "}\n");
+    } else if (!args->short_output) {
+        fprintf(ctx->out, "\n");
+        print_color(ctx, COLOR_BOLD, "Total: %d processes\n", s->count);
     }
 
-    printf("\n");
-    print_color(COLOR_BOLD, "Total: %d processes\n", count);
+    s->writer = NULL;
+
+    if (s->count == 0) {
+        print_error(ctx, "No processes found");
+        return -1;
+    }
+    return 0;
 }
 
 /**
- * Output process list in short format (one per line)
+ * Output list of all processes with format selection
+ *
+ * Main entry point for displaying system-wide process list. Selects output
+ * format based on command-line arguments. Returns error if no processes found.
+ *
+ * Format selection:
+ * - CSV/TSV format if args->csv_output or args->tsv_output is true
+ * - CBOR format if args->cbor_output is true
+ * - JSON format if args->json_output is true
+ * - Short (one-line) format if args->short_output is true
+ * - Normal (table) format otherwise
  *
- * Displays minimal process information, one line per process.
- * Format: "<pid>: <name> by <user>"
+ * The rows are written through the same begin/row/end stream the pipelined
+ * scanner uses, with the count known up front.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param processes Array of process_info_t structures
  * @param count Number of processes in array
- * @return void
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if no processes found or memory is exhausted
  */
-static void output_process_list_short(const process_info_t *processes, int count) {
+int output_process_list(const wir_ctx_t *ctx, const process_info_t *processes, int count,
+                        const cli_args_t *args) {
+    if (count == 0) {
+        print_error(ctx, "No processes found");
+        return -1;
+    }
+
+    process_list_stream_t stream;
+    if (output_process_list_begin(&stream, ctx, count, args) < 0) {
+        return -1;
+    }
     for (int i = 0; i < count; i++) {
-        const process_info_t *proc = &processes[i];
-        printf("%d: %s by %s\n", proc->pid, proc->name, proc->username);
+        output_process_list_row(&stream, &processes[i]);
     }
+    return output_process_list_end(&stream);
 }
 
 /**
- * Output process list in JSON format
+ * Compute the process sources needed by the selected --all format
  *
- * Serializes all processes as a JSON object containing process count and array
- * of process objects. Each process object includes complete details like PID,
- * name, user, state, uptime, memory usage, etc.
+ * Lets the caller read only the /proc files backing the fields the chosen
+ * format prints (e.g. --short never needs cmdline or memory).
  *
- * JSON structure:
- * - process_count: total number of processes
- * - processes: array of process objects
- *   Each process includes: pid, ppid, name, user, uid, state, state_name,
- *   start_time, uptime, cmdline, memory (with vsz_kb and rss_kb)
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return Bitmask of PROC_SRC_* flags to pass to platform_get_all_processes()
+ */
+unsigned int output_process_list_sources(const cli_args_t *args) {
+    if (delimited_separator(args)) {
+        return field_layout_sources(&process_schema, process_delimited_layout,
+                                    LAYOUT_LEN(process_delimited_layout));
+    }
+    if (args->json_output || args->cbor_output) {
+        return field_layout_sources(&process_schema, process_list_json_layout,
+                                    LAYOUT_LEN(process_list_json_layout));
+    }
+    if (args->short_output) {
+        return field_layout_sources(&process_schema, process_list_short_layout,
+                                    LAYOUT_LEN(process_list_short_layout));
+    }
+    return field_layout_sources(&process_schema, process_table_layout,
+                                LAYOUT_LEN(process_table_layout));
+}
+
+/**
+ * Output connection counts per group for --port --group-by
  *
- * @param processes Array of process_info_t structures
- * @param count Number of processes in array
- * @return void
+ * One row per group, largest first as given. Connections owned by no
+ * visible process are counted under PID -1 when grouping by PID.
+ *
+ * Format selection:
+ * - CSV/TSV format if args->csv_output or args->tsv_output is true
+ * - CBOR format if args->cbor_output is true
+ * - JSON format if args->json_output is true
+ * - Short (one-line) format if args->short_output is true
+ * - Normal (table) format otherwise
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param port Port number the connections are on
+ * @param groups Array of groups, in display order
+ * @param count Number of groups in array
+ * @param args Pointer to cli_args_t structure containing the grouping and output flags
+ * @return 0 on success, -1 if there are no connections or memory is exhausted
  */
-static void output_process_list_json(const process_info_t *processes, int count) {
-    printf("{\n");
-    printf("  \"process_count\": %d,\n", count);
-    printf("  \"processes\": [\n");
+int output_port_groups(const wir_ctx_t *ctx, int port, const conn_group_t *groups, int count,
+                       const cli_args_t *args) {
+    if (count == 0) {
+        print_error(ctx, "No connections found on port %d", port);
+        return -1;
+    }
 
+    const bool by_pid = args->group_by == GROUP_BY_PID;
+    const field_layout_t *table = by_pid ? group_pid_table_layout : group_table_layout;
+    const size_t table_len = by_pid ? LAYOUT_LEN(group_pid_table_layout)
+                                    : LAYOUT_LEN(group_table_layout);
+    const field_layout_t *line = by_pid ? group_pid_short_layout : group_short_layout;
+    const size_t line_len = by_pid ? LAYOUT_LEN(group_pid_short_layout)
+                                   : LAYOUT_LEN(group_short_layout);
+    const field_layout_t *record = by_pid ? group_pid_json_layout : group_json_layout;
+    const size_t record_len = by_pid ? LAYOUT_LEN(group_pid_json_layout)
+                                     : LAYOUT_LEN(group_json_layout);
+
+    int connections = 0;
     for (int i = 0; i < count; i++) {
-        const process_info_t *proc = &processes[i];
-        char uptime_buf[128];
-        format_uptime(proc->start_time, uptime_buf, sizeof(uptime_buf));
-
-        printf("    {\n");
-        printf("      \"pid\": %d,\n", proc->pid);
-        printf("      \"ppid\": %d,\n", proc->ppid);
-        printf("      \"name\": ");
-        print_json_string(proc->name);
-        printf(",\n");
-        printf("      \"user\": ");
-        print_json_string(proc->username);
-        printf(",\n");
-        printf("      \"uid\": %d,\n", proc->uid);
-        printf("      \"state\": \"%c\",\n", proc->state);
-        printf("      \"state_name\": ");
-        print_json_string(get_state_name(proc->state));
-        printf(",\n");
-        printf("      \"start_time\": %ld,\n", (long)proc->start_time);
-        printf("      \"uptime\": ");
-        print_json_string(uptime_buf);
-        printf(",\n");
-        printf("      \"cmdline\": ");
-        print_json_string(proc->cmdline);
-        printf(",\n");
-        printf("      \"memory\": {\n");
-        printf("        \"vsz_kb\": %lu,\n", proc->vsz);
-        printf("        \"rss_kb\": %lu\n", proc->rss);
-        printf("      }\n");
-        printf("    }%s\n", i < count - 1 ? "," : "");
-    }
-
-    printf("  ]\n");
-    printf("}\n");
+        connections += groups[i].connections;
+    }
+
+    const char sep = delimited_separator(args);
+
+    if (sep) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        emit_delimited_header(w, &group_schema, record, record_len, sep);
+        writer_putc(w, '\n');
+        for (int i = 0; i < count; i++) {
+            emit_delimited(w, &group_schema, record, record_len, &groups[i], sep);
+            writer_putc(w, '\n');
+        }
+        output_writer_close(w);
+    } else if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        cbor_put_map(w, 5);
+        cbor_put_text(w, "port");
+        cbor_put_int(w, port);
+        cbor_put_text(w, "group_by");
+        cbor_put_text(w, group_by_name(args->group_by));
+        cbor_put_text(w, "connection_count");
+        cbor_put_int(w, connections);
+        cbor_put_text(w, "group_count");
+        cbor_put_int(w, count);
+        cbor_put_text(w, "groups");
+        cbor_put_array(w, (size_t)count);
+        for (int i = 0; i < count; i++) {
+            emit_cbor_map(w, &group_schema, record, record_len, &groups[i]);
+        }
+        output_writer_close(w);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"port\": %d,\n", port);
+        fprintf(ctx->out, "  \"group_by\": \"%s\",\n", group_by_name(args->group_by));
+        fprintf(ctx->out, "  \"connection_count\": %d,\n", connections);
+        fprintf(ctx->out, "  \"group_count\": %d,\n", count);
+        fprintf(ctx->out, "  \"groups\": [\n");
+        for (int i = 0; i < count; i++) {
+            fprintf(ctx->out, "    {\n");
+            emit_json_members(ctx, &group_schema, record, record_len, &groups[i], 6);
+            fprintf(ctx->out, "\n");
+            fprintf(ctx->out, "    }%s\n", i < count - 1 ? "," : "");
+        }
+        fprintf(ctx->out, "  ]\n");
+        fprintf(ctx->out, "}\n");
+    } else if (args->short_output) {
+        for (int i = 0; i < count; i++) {
+            emit_text(ctx, &group_schema, line, line_len, &groups[i]);
+        }
+    } else {
+        print_color(ctx, COLOR_BOLD, "Connections on port %d by %s (%d groups)\n", port,
+                    group_by_name(args->group_by), count);
+        fprintf(ctx->out, "\n");
+        emit_table_header(ctx, &group_schema, table, table_len);
+        for (int i = 0; i < count; i++) {
+            emit_text(ctx, &group_schema, table, table_len, &groups[i]);
+        }
+        fprintf(ctx->out, "\n");
+        print_color(ctx, COLOR_BOLD, "Total: %d connections\n", connections);
+    }
+
+    return 0;
 }
 
+/* ============================================================================
+ * EPHEMERAL PORT OUTPUT
+ * ============================================================================ */
+
 /**
- * Output list of all processes with format selection
+ * Output the --ephemeral port exhaustion report
  *
- * Main entry point for displaying system-wide process list. Selects output
- * format based on command-line arguments. Returns error if no processes found.
+ * A summary of the range, then one row per destination (remote address
+ * and port), busiest first as given. USED% is the share of the range taken
+ * by connections to that destination: the kernel only needs the 4-tuple
+ * to be unique, so it is one destination running out of local ports that
+ * makes connect() fail with EADDRNOTAVAIL, well before the range as a whole
+ * is full. The text report flags destinations from EPHEMERAL_WARN_PCT.
  *
  * Format selection:
+ * - CSV/TSV format if args->csv_output or args->tsv_output is true
+ *   (destinations only)
+ * - CBOR format if args->cbor_output is true
+ * - JSON format if args->json_output is true
+ * - Short (one-line) format if args->short_output is true
+ * - Normal format otherwise
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param summary Totals over the range
+ * @param dests Array of destinations, in display order
+ * @param count Number of destinations in array
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if memory is exhausted (message printed)
+ */
+int output_ephemeral(const wir_ctx_t *ctx, const ephemeral_summary_t *summary,
+                     const ephemeral_dest_t *dests, int count, const cli_args_t *args) {
+    const int range_size = summary->high - summary->low + 1;
+    const char sep = delimited_separator(args);
+
+    if (sep) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        emit_delimited_header(w, &ephemeral_schema, ephemeral_json_layout,
+                              LAYOUT_LEN(ephemeral_json_layout), sep);
+        writer_putc(w, '\n');
+        for (int i = 0; i < count; i++) {
+            emit_delimited(w, &ephemeral_schema, ephemeral_json_layout,
+                           LAYOUT_LEN(ephemeral_json_layout), &dests[i], sep);
+            writer_putc(w, '\n');
+        }
+        output_writer_close(w);
+    } else if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        cbor_put_map(w, 10);
+        cbor_put_text(w, "range_low");
+        cbor_put_int(w, summary->low);
+        cbor_put_text(w, "range_high");
+        cbor_put_int(w, summary->high);
+        cbor_put_text(w, "range_size");
+        cbor_put_int(w, range_size);
+        cbor_put_text(w, "ports_in_use");
+        cbor_put_int(w, summary->ports_in_use);
+        cbor_put_text(w, "used_pct");
+        cbor_put_int(w, summary->used_pct);
+        cbor_put_text(w, "connections");
+        cbor_put_int(w, summary->connections);
+        cbor_put_text(w, "established");
+        cbor_put_int(w, summary->established);
+        cbor_put_text(w, "time_wait");
+        cbor_put_int(w, summary->time_wait);
+        cbor_put_text(w, "other");
+        cbor_put_int(w, summary->other);
+        cbor_put_text(w, "destinations");
+        cbor_put_array(w, (size_t)count);
+        for (int i = 0; i < count; i++) {
+            emit_cbor_map(w, &ephemeral_schema, ephemeral_json_layout,
+                          LAYOUT_LEN(ephemeral_json_layout), &dests[i]);
+        }
+        output_writer_close(w);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"range_low\": %d,\n", summary->low);
+        fprintf(ctx->out, "  \"range_high\": %d,\n", summary->high);
+        fprintf(ctx->out, "  \"range_size\": %d,\n", range_size);
+        fprintf(ctx->out, "  \"ports_in_use\": %d,\n", summary->ports_in_use);
+        fprintf(ctx->out, "  \"used_pct\": %d,\n", summary->used_pct);
+        fprintf(ctx->out, "  \"connections\": %d,\n", summary->connections);
+        fprintf(ctx->out, "  \"established\": %d,\n", summary->established);
+        fprintf(ctx->out, "  \"time_wait\": %d,\n", summary->time_wait);
+        fprintf(ctx->out, "  \"other\": %d,\n", summary->other);
+        fprintf(ctx->out, "  \"destinations\": [\n");
+        for (int i = 0; i < count; i++) {
+            fprintf(ctx->out, "    {\n");
+            emit_json_members(ctx, &ephemeral_schema, ephemeral_json_layout,
+                              LAYOUT_LEN(ephemeral_json_layout), &dests[i], 6);
+            fprintf(ctx->out, "\n");
+            fprintf(ctx->out, "    }%s\n", i < count - 1 ? "," : "");
+        }
+        fprintf(ctx->out, "  ]\n");
+        fprintf(ctx->out, "}\n");
+    } else if (args->short_output) {
+        fprintf(ctx->out, "range %d-%d: %d/%d ports in use (%d%%), %d TIME_WAIT\n",
+                summary->low, summary->high, summary->ports_in_use, range_size,
+                summary->used_pct, summary->time_wait);
+        for (int i = 0; i < count; i++) {
+            emit_text(ctx, &ephemeral_schema, ephemeral_short_layout,
+                      LAYOUT_LEN(ephemeral_short_layout), &dests[i]);
+        }
+    } else {
+        print_color(ctx, COLOR_BOLD, "Ephemeral ports %d-%d (%d ports)\n", summary->low,
+                    summary->high, range_size);
+        fprintf(ctx->out, "\n");
+        print_color(ctx, COLOR_CYAN, "  In use: ");
+        fprintf(ctx->out, "%d ports (%d%%)\n", summary->ports_in_use, summary->used_pct);
+        print_color(ctx, COLOR_CYAN, "  Connections: ");
+        fprintf(ctx->out, "%d (%d ESTABLISHED, %d TIME_WAIT, %d other)\n",
+                summary->connections, summary->established, summary->time_wait,
+                summary->other);
+        fprintf(ctx->out, "\n");
+
+        if (count == 0) {
+            fprintf(ctx->out, "No outgoing connections from the ephemeral range\n");
+            return 0;
+        }
+
+        emit_table_header(ctx, &ephemeral_schema, ephemeral_table_layout,
+                          LAYOUT_LEN(ephemeral_table_layout));
+        int crowded = 0;
+        for (int i = 0; i < count; i++) {
+            emit_text(ctx, &ephemeral_schema, ephemeral_table_layout,
+                      LAYOUT_LEN(ephemeral_table_layout), &dests[i]);
+            if (dests[i].used_pct >= EPHEMERAL_WARN_PCT) {
+                crowded++;
+            }
+        }
+
+        if (crowded > 0) {
+            fprintf(ctx->out, "\n");
+            print_color(ctx, COLOR_YELLOW,
+                        "Warning: %d destination%s above %d%% of the range; new connections "
+                        "to %s may fail with EADDRNOTAVAIL\n",
+                        crowded, crowded == 1 ? " is" : "s are", EPHEMERAL_WARN_PCT,
+                        crowded == 1 ? "it" : "them");
+        }
+    }
+
+    return 0;
+}
+
+/* ============================================================================
+ * PER-USER SUMMARY OUTPUT
+ * ============================================================================ */
+
+/**
+ * Output the --by-user resource summary with format selection
+ *
+ * One row per user, in the order given (the caller sorts). The text table
+ * ends with the process total across all users.
+ *
+ * Format selection:
+ * - CSV/TSV format if args->csv_output or args->tsv_output is true
+ * - CBOR format if args->cbor_output is true
  * - JSON format if args->json_output is true
  * - Short (one-line) format if args->short_output is true
  * - Normal (table) format otherwise
  *
- * @param processes Array of process_info_t structures
- * @param count Number of processes in array
+ * Table columns (normal format):
+ * - USER, UID: Owner
+ * - PROCS, ZOMBIES: Process counts
+ * - SOCKETS: TCP/UDP sockets owned by the UID
+ * - VSZ, RSS: Memory totals in kilobytes
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param users Array of per-user totals
+ * @param count Number of users in array
  * @param args Pointer to cli_args_t structure containing output format flags
- * @return 0 on success, -1 if no processes found
+ * @return 0 on success, -1 if there are no users or memory is exhausted
  */
-int output_process_list(const process_info_t *processes, int count,
+int output_user_summary(const wir_ctx_t *ctx, const user_usage_t *users, int count,
                         const cli_args_t *args) {
     if (count == 0) {
-        print_error("No processes found");
+        print_error(ctx, "No processes found");
+        return -1;
+    }
+
+    const char sep = delimited_separator(args);
+
+    if (sep) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        emit_delimited_header(w, &user_schema, user_json_layout,
+                              LAYOUT_LEN(user_json_layout), sep);
+        writer_putc(w, '\n');
+        for (int i = 0; i < count; i++) {
+            emit_delimited(w, &user_schema, user_json_layout,
+                           LAYOUT_LEN(user_json_layout), &users[i], sep);
+            writer_putc(w, '\n');
+        }
+        output_writer_close(w);
+    } else if (args->cbor_output) {
+        writer_t *w = output_writer_open(ctx);
+        if (!w) {
+            return -1;
+        }
+        cbor_put_map(w, 2);
+        cbor_put_text(w, "user_count");
+        cbor_put_int(w, count);
+        cbor_put_text(w, "users");
+        cbor_put_array(w, (size_t)count);
+        for (int i = 0; i < count; i++) {
+            emit_cbor_map(w, &user_schema, user_json_layout,
+                          LAYOUT_LEN(user_json_layout), &users[i]);
+        }
+        output_writer_close(w);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"user_count\": %d,\n", count);
+        fprintf(ctx->out, "  \"users\": [\n");
+        for (int i = 0; i < count; i++) {
+            fprintf(ctx->out, "    {\n");
+            emit_json_members(ctx, &user_schema, user_json_layout,
+                              LAYOUT_LEN(user_json_layout), &users[i], 6);
+            fprintf(ctx->out, "\n");
+            fprintf(ctx->out, "    }%s\n", i < count - 1 ? "," : "");
+        }
+        fprintf(ctx->out, "  ]\n");
+        fprintf(ctx->out, "}\n");
+    } else if (args->short_output) {
+        for (int i = 0; i < count; i++) {
+            emit_text(ctx, &user_schema, user_short_layout, LAYOUT_LEN(user_short_layout),
+                      &users[i]);
+        }
+    } else {
+        int processes = 0;
+        for (int i = 0; i < count; i++) {
+            processes += users[i].processes;
+        }
+
+        print_color(ctx, COLOR_BOLD, "Processes by User (%d users)\n", count);
+        fprintf(ctx->out, "\n");
+        emit_table_header(ctx, &user_schema, user_table_layout, LAYOUT_LEN(user_table_layout));
+        for (int i = 0; i < count; i++) {
+            emit_text(ctx, &user_schema, user_table_layout, LAYOUT_LEN(user_table_layout),
+                      &users[i]);
+        }
+        fprintf(ctx->out, "\n");
+        print_color(ctx, COLOR_BOLD, "Total: %d processes\n", processes);
+    }
+
+    return 0;
+}
+
+/* ============================================================================
+ * HISTORY REPLAY OUTPUT
+ * ============================================================================ */
+
+/**
+ * Start a --replay listing of recorded samples
+ *
+ * Records are streamed straight out of the ring file, so the count is only
+ * known at the end: JSON and CBOR put "record_count" after the "records"
+ * array (indefinite-length in CBOR), like a streamed --all list.
+ *
+ * @param s Stream state to initialize
+ * @param ctx Context holding the report stream and color setting
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if memory is exhausted (message printed; do not
+ *         continue the stream)
+ */
+int output_history_begin(history_stream_t *s, const wir_ctx_t *ctx,
+                         const cli_args_t *args) {
+    s->ctx = ctx;
+    s->args = args;
+    s->writer = NULL;
+    s->sep = delimited_separator(args);
+    s->count = 0;
+
+    if (s->sep) {
+        s->writer = output_writer_open(ctx);
+        if (!s->writer) {
+            return -1;
+        }
+        emit_delimited_header(s->writer, &history_schema, history_delimited_layout,
+                              LAYOUT_LEN(history_delimited_layout), s->sep);
+        writer_putc(s->writer, '\n');
+    } else if (args->cbor_output) {
+        s->writer = output_writer_open(ctx);
+        if (!s->writer) {
+            return -1;
+        }
+        cbor_put_map(s->writer, 2);
+        cbor_put_text(s->writer, "records");
+        cbor_put_array_indefinite(s->writer);
+    } else if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"records\": [\n");
+    } else if (!args->short_output) {
+        emit_table_header(ctx, &history_schema, history_table_layout,
+                          LAYOUT_LEN(history_table_layout));
+    }
+    return 0;
+}
+
+/**
+ * Emit one recorded sample of a --replay listing
+ *
+ * @param s Stream state from output_history_begin()
+ * @param record Sample to emit
+ * @return void
+ */
+void output_history_row(history_stream_t *s, const history_record_t *record) {
+    const wir_ctx_t *ctx = s->ctx;
+    const cli_args_t *args = s->args;
+
+    if (s->sep) {
+        emit_delimited(s->writer, &history_schema, history_delimited_layout,
+                       LAYOUT_LEN(history_delimited_layout), record, s->sep);
+        writer_putc(s->writer, '\n');
+    } else if (args->cbor_output) {
+        emit_cbor_map(s->writer, &history_schema, history_json_layout,
+                      LAYOUT_LEN(history_json_layout), record);
+    } else if (args->json_output) {
+        if (s->count > 0) {
+            fprintf(ctx->out, ",\n");
+        }
+        fprintf(ctx->out, "    {\n");
+        emit_json_members(ctx, &history_schema, history_json_layout,
+                          LAYOUT_LEN(history_json_layout), record, 6);
+        fprintf(ctx->out, "\n");
+        fprintf(ctx->out, "    }");
+    } else if (args->short_output) {
+        emit_text(ctx, &history_schema, history_short_layout,
+                  LAYOUT_LEN(history_short_layout), record);
+    } else {
+        emit_text(ctx, &history_schema, history_table_layout,
+                  LAYOUT_LEN(history_table_layout), record);
+    }
+
+    s->count++;
+}
+
+/**
+ * Finish a --replay listing
+ *
+ * @param s Stream state from output_history_begin()
+ * @return 0 on success, -1 if no records were emitted
+ */
+int output_history_end(history_stream_t *s) {
+    const wir_ctx_t *ctx = s->ctx;
+    const cli_args_t *args = s->args;
+
+    if (s->sep) {
+        output_writer_close(s->writer);
+    } else if (args->cbor_output) {
+        cbor_put_break(s->writer);
+        cbor_put_text(s->writer, "record_count");
+        cbor_put_int(s->writer, s->count);
+        output_writer_close(s->writer);
+    } else if (args->json_output) {
+        if (s->count > 0) {
+            fprintf(ctx->out, "\n");
+        }
+        fprintf(ctx->out, "  ],\n");
+        fprintf(ctx->out, "  \"record_count\": %d\n", s->count);
+        fprintf(ctx->out, "}\n");
+    } else if (!args->short_output) {
+        fprintf(ctx->out, "\n");
+        print_color(ctx, COLOR_BOLD, "Total: %d records\n", s->count);
+    }
+
+    s->writer = NULL;
+
+    if (s->count == 0) {
+        print_error(ctx, "No matching records");
         return -1;
     }
+    return 0;
+}
+
+/* ============================================================================
+ * SIGNAL OUTPUT
+ * ============================================================================ */
+
+/**
+ * Format a signal for display ("SIGTERM", or "signal 35" if it has no name)
+ *
+ * @param sig Signal number
+ * @param buf Output buffer
+ * @param size Size of buf
+ * @return buf
+ */
+static const char *format_signal(int sig, char *buf, size_t size) {
+    const char *name = kill_signal_name(sig);
+    if (name) {
+        snprintf(buf, size, "SIG%s", name);
+    } else {
+        snprintf(buf, size, "signal %d", sig);
+    }
+    return buf;
+}
+
+/**
+ * Color used for a kill outcome in the summary
+ *
+ * @param outcome Outcome
+ * @return COLOR_* escape sequence
+ */
+static const char *outcome_color(kill_outcome_t outcome) {
+    switch (outcome) {
+        case KILL_EXITED:
+        case KILL_SIGNALLED:
+        case KILL_GONE:
+            return COLOR_GREEN;
+        case KILL_ESCALATED:
+            return COLOR_YELLOW;
+        default:
+            return COLOR_RED;
+    }
+}
+
+/**
+ * Output the per-process summary of a --signal operation
+ *
+ * Normal format lists each process with its outcome and the time from the
+ * first signal until that outcome, followed by the total time until every
+ * process had exited (or the wait gave up).
+ *
+ * JSON format:
+ * - signal: Signal name (e.g. "SIGTERM")
+ * - processes: Array of {pid, name, outcome, elapsed_ms}
+ * - count: Number of processes
+ * - total_ms: Total time until quiescence
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param procs Processes that were signalled (for names)
+ * @param targets Outcomes, parallel to procs
+ * @param count Number of processes
+ * @param sig Signal that was sent
+ * @param total_ms Milliseconds from the first signal until the last outcome
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 if every process was signalled or already gone, -1 otherwise
+ */
+int output_signal_summary(const wir_ctx_t *ctx, const process_info_t *procs,
+                          const kill_target_t *targets, int count, int sig, long total_ms,
+                          const cli_args_t *args) {
+    char sig_buf[32];
+    const char *sig_name = format_signal(sig, sig_buf, sizeof(sig_buf));
+    int failed = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (!kill_outcome_ok(targets[i].outcome)) {
+            failed++;
+        }
+    }
 
     if (args->json_output) {
-        output_process_list_json(processes, count);
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"signal\": ");
+        print_json_string(ctx, sig_name);
+        fprintf(ctx->out, ",\n");
+        fprintf(ctx->out, "  \"processes\": [");
+        for (int i = 0; i < count; i++) {
+            fprintf(ctx->out, "%s\n    {\"pid\": %d, \"name\": ", i > 0 ? "," : "", procs[i].pid);
+            print_json_string(ctx, procs[i].name);
+            fprintf(ctx->out, ", \"outcome\": ");
+            print_json_string(ctx, kill_outcome_name(targets[i].outcome));
+            fprintf(ctx->out, ", \"elapsed_ms\": %ld}", targets[i].elapsed_ms);
+        }
+        fprintf(ctx->out, "%s],\n", count > 0 ? "\n  " : "");
+        fprintf(ctx->out, "  \"count\": %d,\n", count);
+        fprintf(ctx->out, "  \"total_ms\": %ld\n", total_ms);
+        fprintf(ctx->out, "}\n");
+        return failed == 0 ? 0 : -1;
+    }
+
+    print_color(ctx, COLOR_BOLD, "Sent %s to %d process%s\n", sig_name, count,
+                count == 1 ? "" : "es");
+
+    for (int i = 0; i < count; i++) {
+        const kill_target_t *t = &targets[i];
+        fprintf(ctx->out, "  PID %-7d %-20s ", procs[i].pid, procs[i].name);
+        print_color(ctx, outcome_color(t->outcome), "%s", kill_outcome_name(t->outcome));
+        if (t->outcome == KILL_FAILED) {
+            fprintf(ctx->out, " (%s)", strerror(t->error));
+        }
+        fprintf(ctx->out, " after %ld ms\n", t->elapsed_ms);
+    }
+
+    if (failed == 0) {
+        print_success(ctx, "All %d process%s handled in %ld ms", count, count == 1 ? "" : "es",
+                      total_ms);
+    } else {
+        print_error(ctx, "%d of %d process%s not handled (%ld ms)", failed, count,
+                    count == 1 ? "" : "es", total_ms);
+    }
+
+    return failed == 0 ? 0 : -1;
+}
+
+/* ============================================================================
+ * PORT WAIT OUTPUT
+ * ============================================================================ */
+
+/**
+ * Output the outcome of --wait-listen or --wait-free
+ *
+ * Normal format is one success or error line; --short prints
+ * "Port N: <state> (<ms> ms)" with "timeout" in front of the state the port
+ * was stuck in.
+ *
+ * JSON format:
+ * - port: Port number
+ * - wanted: "bound" (--wait-listen) or "free" (--wait-free)
+ * - reached: Whether the port got there before the timeout
+ * - waited_ms: Milliseconds waited
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param port Port number waited on
+ * @param wait_free True for --wait-free, false for --wait-listen
+ * @param reached Whether the wanted state was reached
+ * @param waited_ms Milliseconds waited
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 if the wanted state was reached, -1 on timeout
+ */
+int output_port_wait(const wir_ctx_t *ctx, int port, bool wait_free, bool reached, long waited_ms,
+                     const cli_args_t *args) {
+    const char *wanted = wait_free ? "free" : "bound";
+    const char *current = reached == wait_free ? "free" : "bound";
+
+    if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"port\": %d,\n", port);
+        fprintf(ctx->out, "  \"wanted\": \"%s\",\n", wanted);
+        fprintf(ctx->out, "  \"reached\": %s,\n", reached ? "true" : "false");
+        fprintf(ctx->out, "  \"waited_ms\": %ld\n", waited_ms);
+        fprintf(ctx->out, "}\n");
     } else if (args->short_output) {
-        output_process_list_short(processes, count);
+        fprintf(ctx->out, "Port %d: %s%s (%ld ms)\n", port, reached ? "" : "timeout, still ",
+               current, waited_ms);
+    } else if (reached) {
+        print_success(ctx, "Port %d is %s after %ld ms", port, wanted, waited_ms);
     } else {
-        output_process_list_normal(processes, count);
+        print_error(ctx, "Timed out after %ld ms: port %d is still %s", waited_ms, port, current);
+    }
+
+    return reached ? 0 : -1;
+}
+
+/* ============================================================================
+ * BACKEND CALIBRATION OUTPUT
+ * ============================================================================ */
+
+/**
+ * Output the timings measured by --calibrate
+ *
+ * Normal format is a table of operation, backend and time, with the chosen
+ * backend of each operation marked, followed by where the choices were
+ * saved. --json prints the same rows:
+ *
+ * - state_file: Path the choices were written to
+ * - timings: One object per operation and backend with operation, backend,
+ *   available, usec and chosen
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param timings Rows from backend_calibrate()
+ * @param count Number of rows
+ * @param path State file the choices were written to
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success
+ */
+int output_calibration(const wir_ctx_t *ctx, const backend_timing_t *timings, int count,
+                       const char *path, const cli_args_t *args) {
+    if (args->json_output) {
+        fprintf(ctx->out, "{\n");
+        fprintf(ctx->out, "  \"state_file\": ");
+        print_json_string(ctx, path);
+        fprintf(ctx->out, ",\n");
+        fprintf(ctx->out, "  \"timings\": [\n");
+        for (int i = 0; i < count; i++) {
+            const backend_timing_t *t = &timings[i];
+            fprintf(ctx->out, "    {\n");
+            fprintf(ctx->out, "      \"operation\": \"%s\",\n", backend_op_name(t->op));
+            fprintf(ctx->out, "      \"backend\": \"%s\",\n", t->backend->name);
+            fprintf(ctx->out, "      \"available\": %s,\n", t->available ? "true" : "false");
+            fprintf(ctx->out, "      \"usec\": %ld,\n", t->usec);
+            fprintf(ctx->out, "      \"chosen\": %s\n", t->chosen ? "true" : "false");
+            fprintf(ctx->out, "    }%s\n", i < count - 1 ? "," : "");
+        }
+        fprintf(ctx->out, "  ]\n");
+        fprintf(ctx->out, "}\n");
+        return 0;
     }
 
+    print_color(ctx, COLOR_BOLD, "Socket backends on this host (fastest of each)\n");
+    fprintf(ctx->out, "\n");
+    print_color(ctx, COLOR_BOLD, "%-12s %-9s %10s\n", "OPERATION", "BACKEND", "TIME");
+    for (int i = 0; i < count; i++) {
+        const backend_timing_t *t = &timings[i];
+        fprintf(ctx->out, "%-12s ", backend_op_name(t->op));
+        print_color(ctx, t->chosen ? COLOR_GREEN : NULL, "%-9s", t->backend->name);
+        if (t->available) {
+            fprintf(ctx->out, " %7ld us%s\n", t->usec, t->chosen ? "  (chosen)" : "");
+        } else {
+            fprintf(ctx->out, " %10s\n", "unavailable");
+        }
+    }
+    fprintf(ctx->out, "\n");
+    print_success(ctx, "Saved to %s", path);
     return 0;
 }
+
+
+/* ============================================================================
+ * SERVE (NDJSON) OUTPUT
+ * ============================================================================ */
+
+/**
+ * Open a --serve-stdio response: {"id":<id>,"ok":<ok>
+ *
+ * @param ctx Context holding the report stream
+ * @param id The query's "id" as JSON text (empty if it had none)
+ * @param ok Whether the query was answered
+ * @return void
+ */
+static void begin_serve_response(const wir_ctx_t *ctx, const char *id, bool ok) {
+    fputc('{', ctx->out);
+    if (id[0] != '\0') {
+        fprintf(ctx->out, "\"id\":%s,", id);
+    }
+    fprintf(ctx->out, "\"ok\":%s", ok ? "true" : "false");
+}
+
+/**
+ * Answer a --serve-stdio port query
+ *
+ * One line with the members of --port --json (port, connection_count and
+ * connections, each with its owners and the process shown for it),
+ * preceded by id and ok.
+ *
+ * @param ctx Context holding the report stream
+ * @param id The query's "id" as JSON text (empty if it had none)
+ * @param port Port number queried
+ * @param connections Array of connection_info_t structures
+ * @param count Number of connections in array
+ * @return void
+ */
+void output_serve_connections(const wir_ctx_t *ctx, const char *id, int port,
+                              const connection_info_t *connections, int count) {
+    const unsigned int sources =
+        field_layout_sources(&process_schema, port_process_json_layout,
+                             LAYOUT_LEN(port_process_json_layout));
+
+    begin_serve_response(ctx, id, true);
+    fprintf(ctx->out, ",\"port\":%d,\"connection_count\":%d,\"connections\":[", port, count);
+
+    for (int i = 0; i < count; i++) {
+        const connection_info_t *conn = &connections[i];
+
+        fprintf(ctx->out, "%s{", i > 0 ? "," : "");
+        emit_json_line_members(ctx, &connection_schema, connection_json_layout,
+                               LAYOUT_LEN(connection_json_layout), conn);
+        if (conn->has_tcp_info) {
+            fputc(',', ctx->out);
+            emit_json_line_members(ctx, &connection_schema, connection_tcp_info_json_layout,
+                                   LAYOUT_LEN(connection_tcp_info_json_layout), conn);
+        }
+        if (conn->owner_count > 0) {
+            fprintf(ctx->out, ",\"owners\":[");
+            for (int k = 0; k < conn->owner_count; k++) {
+                fprintf(ctx->out, "%s%d", k > 0 ? "," : "", conn->owners[k]);
+            }
+            fputc(']', ctx->out);
+        }
+
+        if (conn->pid > 0) {
+            const owner_family_t family = owner_family(ctx, conn);
+            process_info_t proc;
+            if (lookup_process(ctx, shown_owner(conn, &family), &proc, sources) == 0) {
+                fprintf(ctx->out, ",\"process\":{");
+                emit_json_line_members(ctx, &process_schema, port_process_json_layout,
+                                       LAYOUT_LEN(port_process_json_layout), &proc);
+                fputc('}', ctx->out);
+            }
+        }
+        fputc('}', ctx->out);
+    }
+
+    fprintf(ctx->out, "]}\n");
+}
+
+/**
+ * Answer a --serve-stdio pid query
+ *
+ * One line with id, ok and a "process" object holding the members of
+ * --pid --json.
+ *
+ * @param ctx Context holding the report stream
+ * @param id The query's "id" as JSON text (empty if it had none)
+ * @param info Process information
+ * @return void
+ */
+void output_serve_process(const wir_ctx_t *ctx, const char *id, const process_info_t *info) {
+    begin_serve_response(ctx, id, true);
+    fprintf(ctx->out, ",\"process\":{");
+    emit_json_line_members(ctx, &process_schema, process_json_layout,
+                           LAYOUT_LEN(process_json_layout), info);
+    fprintf(ctx->out, "}}\n");
+}
+
+/**
+ * Answer a --serve-stdio bound query: {"id":..,"ok":true,"port":n,"bound":b}
+ *
+ * @param ctx Context holding the report stream
+ * @param id The query's "id" as JSON text (empty if it had none)
+ * @param port Port number queried
+ * @param bound Whether a TCP listener or a UDP socket uses the port
+ * @return void
+ */
+void output_serve_bound(const wir_ctx_t *ctx, const char *id, int port, bool bound) {
+    begin_serve_response(ctx, id, true);
+    fprintf(ctx->out, ",\"port\":%d,\"bound\":%s}\n", port, bound ? "true" : "false");
+}
+
+/**
+ * Answer a --serve-stdio check query: {"id":..,"ok":true,"match":b}
+ *
+ * @param ctx Context holding the report stream
+ * @param id The query's "id" as JSON text (empty if it had none)
+ * @param match Whether some socket satisfies the condition
+ * @return void
+ */
+void output_serve_match(const wir_ctx_t *ctx, const char *id, bool match) {
+    begin_serve_response(ctx, id, true);
+    fprintf(ctx->out, ",\"match\":%s}\n", match ? "true" : "false");
+}
+
+/**
+ * Answer a --serve-stdio query that failed: {"id":..,"ok":false,"error":".."}
+ *
+ * @param ctx Context holding the report stream
+ * @param id The query's "id" as JSON text (empty if it had none or it was
+ *        unreadable)
+ * @param message Why the query failed
+ * @return void
+ */
+void output_serve_error(const wir_ctx_t *ctx, const char *id, const char *message) {
+    begin_serve_response(ctx, id, false);
+    fprintf(ctx->out, ",\"error\":");
+    print_json_string(ctx, message);
+    fprintf(ctx->out, "}\n");
+}
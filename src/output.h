@@ -1,8 +1,17 @@
 #ifndef OUTPUT_H
 #define OUTPUT_H
 
+#include "context.h"
 #include "platform.h"
 #include "args.h"
+#include "kill.h"
+#include "usage.h"
+#include "group.h"
+#include "ephemeral.h"
+#include "backend.h"
+#include "history.h"
+#include "forest.h"
+#include "writer.h"
 
 /**
  * Output process information with format selection
@@ -10,11 +19,13 @@
  * Main entry point for displaying process information. Selects output format
  * based on args flags (JSON, short, or normal). See src/output.c for detailed documentation.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param info Pointer to process_info_t structure containing process details
  * @param args Pointer to cli_args_t structure containing output format flags
  * @return 0 on success
  */
-int output_process_info(const process_info_t *info, const cli_args_t *args);
+int output_process_info(const wir_ctx_t *ctx, const process_info_t *info,
+                        const cli_args_t *args);
 
 /**
  * Output process tree with format selection
@@ -22,11 +33,27 @@ int output_process_info(const process_info_t *info, const cli_args_t *args);
  * Displays process ancestry tree from target process to root ancestor.
  * See src/output.c for detailed documentation.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param tree Pointer to process_tree_node_t representing the target process
+ * @param forest Finished forest of the same scan, or NULL to show the ancestry only
  * @param args Pointer to cli_args_t structure containing output format flags
  * @return 0 on success, -1 if tree is NULL
  */
-int output_process_tree(const process_tree_node_t *tree, const cli_args_t *args);
+int output_process_tree(const wir_ctx_t *ctx, const process_tree_node_t *tree,
+                        const process_forest_t *forest, const cli_args_t *args);
+
+/**
+ * Output the whole process forest with subtree totals
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param forest Finished forest
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if the forest is empty
+ */
+int output_process_forest(const wir_ctx_t *ctx, const process_forest_t *forest,
+                          const cli_args_t *args);
 
 /**
  * Output environment variables for a process
@@ -34,12 +61,14 @@ int output_process_tree(const process_tree_node_t *tree, const cli_args_t *args)
  * Displays all environment variables in normal or JSON format.
  * See src/output.c for detailed documentation.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param env_vars Array of environment variable strings (format: "NAME=value")
  * @param count Number of environment variables in array
  * @param args Pointer to cli_args_t structure containing output format flags
  * @return 0 on success
  */
-int output_process_env(char **env_vars, int count, const cli_args_t *args);
+int output_process_env(const wir_ctx_t *ctx, char **env_vars, int count,
+                       const cli_args_t *args);
 
 /**
  * Output port information with format selection
@@ -47,13 +76,14 @@ int output_process_env(char **env_vars, int count, const cli_args_t *args);
  * Displays port connection information in normal, short, JSON, or warnings-only format.
  * See src/output.c for detailed documentation.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param port Port number being queried
  * @param connections Array of connection_info_t structures
  * @param count Number of connections in array
  * @param args Pointer to cli_args_t structure containing output format flags
  * @return 0 on success, -1 if no connections found
  */
-int output_port_info(int port, const connection_info_t *connections,
+int output_port_info(const wir_ctx_t *ctx, int port, const connection_info_t *connections,
                      int count, const cli_args_t *args);
 
 /**
@@ -62,12 +92,191 @@ int output_port_info(int port, const connection_info_t *connections,
  * Displays system-wide process list in table, short, or JSON format.
  * See src/output.c for detailed documentation.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param processes Array of process_info_t structures
  * @param count Number of processes in array
  * @param args Pointer to cli_args_t structure containing output format flags
  * @return 0 on success, -1 if no processes found
  */
-int output_process_list(const process_info_t *processes, int count,
+int output_process_list(const wir_ctx_t *ctx, const process_info_t *processes, int count,
                         const cli_args_t *args);
 
+/**
+ * Incremental --all process list emitter
+ *
+ * Lets rows be written as they are produced (e.g. by the pipelined scanner)
+ * instead of from a finished array. Used as begin, any number of rows, end.
+ *
+ * Fields:
+ * - ctx: Context holding the report stream and color setting
+ * - args: Output format flags
+ * - writer: Buffered writer for CSV/TSV/CBOR (NULL for the text formats)
+ * - sep: Field separator for CSV/TSV, 0 otherwise
+ * - expected: Row count announced at begin, -1 if it is only known at the end
+ * - count: Rows emitted so far
+ */
+typedef struct {
+    const wir_ctx_t *ctx;
+    const cli_args_t *args;
+    writer_t *writer;
+    char sep;
+    int expected;
+    int count;
+} process_list_stream_t;
+
+/**
+ * Process list stream functions
+ *
+ * See src/output.c for detailed documentation of each function.
+ */
+int output_process_list_begin(process_list_stream_t *s, const wir_ctx_t *ctx,
+                              int expected, const cli_args_t *args);
+void output_process_list_row(process_list_stream_t *s, const process_info_t *proc);
+int output_process_list_end(process_list_stream_t *s);
+
+/**
+ * Compute the process sources needed by the selected --all format
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return Bitmask of PROC_SRC_* flags
+ */
+unsigned int output_process_list_sources(const cli_args_t *args);
+
+/**
+ * Incremental --replay listing of recorded samples
+ *
+ * Used as begin, any number of rows, end, while walking the ring file.
+ *
+ * Fields:
+ * - ctx: Context holding the report stream and color setting
+ * - args: Output format flags
+ * - writer: Buffered writer for CSV/TSV/CBOR (NULL for the text formats)
+ * - sep: Field separator for CSV/TSV, 0 otherwise
+ * - count: Rows emitted so far
+ */
+typedef struct {
+    const wir_ctx_t *ctx;
+    const cli_args_t *args;
+    writer_t *writer;
+    char sep;
+    int count;
+} history_stream_t;
+
+/**
+ * History stream functions
+ *
+ * See src/output.c for detailed documentation of each function.
+ */
+int output_history_begin(history_stream_t *s, const wir_ctx_t *ctx,
+                         const cli_args_t *args);
+void output_history_row(history_stream_t *s, const history_record_t *record);
+int output_history_end(history_stream_t *s);
+
+/**
+ * Output connection counts per group for --port --group-by
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param port Port number the connections are on
+ * @param groups Array of groups, in display order
+ * @param count Number of groups in array
+ * @param args Pointer to cli_args_t structure containing the grouping and output flags
+ * @return 0 on success, -1 if there are no connections
+ */
+int output_port_groups(const wir_ctx_t *ctx, int port, const conn_group_t *groups, int count,
+                       const cli_args_t *args);
+
+/**
+ * Output the --ephemeral port exhaustion report
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param summary Totals over the range
+ * @param dests Array of destinations, in display order
+ * @param count Number of destinations in array
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success
+ */
+int output_ephemeral(const wir_ctx_t *ctx, const ephemeral_summary_t *summary,
+                     const ephemeral_dest_t *dests, int count, const cli_args_t *args);
+
+/**
+ * Output the --by-user resource summary
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param users Array of per-user totals, in display order
+ * @param count Number of users in array
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success, -1 if there are no users
+ */
+int output_user_summary(const wir_ctx_t *ctx, const user_usage_t *users, int count,
+                        const cli_args_t *args);
+
+/**
+ * Output the per-process summary of a --signal operation
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param procs Processes that were signalled (for names)
+ * @param targets Outcomes, parallel to procs
+ * @param count Number of processes
+ * @param sig Signal that was sent
+ * @param total_ms Milliseconds from the first signal until the last outcome
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 if every process was signalled or already gone, -1 otherwise
+ */
+int output_signal_summary(const wir_ctx_t *ctx, const process_info_t *procs,
+                          const kill_target_t *targets, int count, int sig, long total_ms,
+                          const cli_args_t *args);
+
+/**
+ * Output the outcome of --wait-listen or --wait-free
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param port Port number waited on
+ * @param wait_free True for --wait-free, false for --wait-listen
+ * @param reached Whether the wanted state was reached
+ * @param waited_ms Milliseconds waited
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 if the wanted state was reached, -1 on timeout
+ */
+int output_port_wait(const wir_ctx_t *ctx, int port, bool wait_free, bool reached,
+                     long waited_ms, const cli_args_t *args);
+
+/**
+ * Output the timings measured by --calibrate
+ *
+ * See src/output.c for detailed documentation.
+ *
+ * @param ctx Context holding the report stream and color setting
+ * @param timings Rows from backend_calibrate()
+ * @param count Number of rows
+ * @param path State file the choices were written to
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return 0 on success
+ */
+int output_calibration(const wir_ctx_t *ctx, const backend_timing_t *timings, int count,
+                       const char *path, const cli_args_t *args);
+
+/**
+ * --serve-stdio responses (one NDJSON line each)
+ *
+ * See src/output.c for detailed documentation of each function.
+ */
+void output_serve_connections(const wir_ctx_t *ctx, const char *id, int port,
+                              const connection_info_t *connections, int count);
+void output_serve_process(const wir_ctx_t *ctx, const char *id, const process_info_t *info);
+void output_serve_bound(const wir_ctx_t *ctx, const char *id, int port, bool bound);
+void output_serve_match(const wir_ctx_t *ctx, const char *id, bool match);
+void output_serve_error(const wir_ctx_t *ctx, const char *id, const char *message);
+
 #endif /* OUTPUT_H */
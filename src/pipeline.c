@@ -0,0 +1,347 @@
+#include "pipeline.h"
+#include "usercache.h"
+#include "utils.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Cache line size; keeps the producer and consumer indices apart */
+#define PIPELINE_CACHE_LINE 64
+
+/* Idle rounds spent yielding before backing off to short sleeps */
+#define PIPELINE_SPIN_LIMIT 64
+
+/* Sleep between idle rounds once past PIPELINE_SPIN_LIMIT */
+#define PIPELINE_IDLE_SLEEP_NS 50000
+
+/*
+ * One scanned process in flight.
+ *
+ * seq is the record's index in the PID list; it is what ordered delivery
+ * sorts on. Processes that exit before they can be read still produce a
+ * record (valid = false) so the consumer never waits for a missing seq.
+ */
+typedef struct {
+    int seq;
+    bool valid;
+    process_info_t info;
+} pipeline_item_t;
+
+/*
+ * Single-producer/single-consumer ring.
+ *
+ * head and tail increase forever and are masked on use. The producer owns
+ * tail and the slot it points at; the consumer owns head. Each index is
+ * published with a release store and read with an acquire load, so a slot's
+ * contents are visible before the index that hands it over. The padding puts
+ * the two indices on separate cache lines.
+ */
+typedef struct {
+    atomic_size_t head;
+    char pad_head[PIPELINE_CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t tail;
+    char pad_tail[PIPELINE_CACHE_LINE - sizeof(atomic_size_t)];
+    pipeline_item_t slots[PIPELINE_RING_SIZE];
+} spsc_ring_t;
+
+/* State shared by all scanners: the PID list and the next index to claim */
+typedef struct {
+    const pid_t *pids;
+    int pid_count;
+    unsigned int sources;
+    atomic_int next;
+} scan_shared_t;
+
+/* One scanner thread and the ring it produces into */
+typedef struct {
+    scan_shared_t *shared;
+    pthread_t thread;
+    spsc_ring_t ring;
+} scanner_t;
+
+/**
+ * Wait a little after a round that made no progress
+ *
+ * Yields for the first PIPELINE_SPIN_LIMIT idle rounds, then sleeps briefly
+ * so a thread stuck behind slow /proc reads does not burn a CPU.
+ *
+ * @param idle Number of consecutive idle rounds so far
+ * @return void
+ */
+static void idle_wait(int idle) {
+    if (idle < PIPELINE_SPIN_LIMIT) {
+        sched_yield();
+    } else {
+        const struct timespec ts = { 0, PIPELINE_IDLE_SLEEP_NS };
+        nanosleep(&ts, NULL);
+    }
+}
+
+/**
+ * Get the next free slot of a ring, waiting while it is full (producer)
+ *
+ * @param r Ring
+ * @return Slot to fill; hand it over with ring_publish()
+ */
+static pipeline_item_t *ring_reserve(spsc_ring_t *r) {
+    const size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    for (int idle = 0;
+         tail - atomic_load_explicit(&r->head, memory_order_acquire) == PIPELINE_RING_SIZE;
+         idle++) {
+        idle_wait(idle);
+    }
+
+    return &r->slots[tail & (PIPELINE_RING_SIZE - 1)];
+}
+
+/**
+ * Hand the slot from ring_reserve() to the consumer (producer)
+ *
+ * @param r Ring
+ * @return void
+ */
+static void ring_publish(spsc_ring_t *r) {
+    const size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+/**
+ * Look at the oldest record of a ring without removing it (consumer)
+ *
+ * @param r Ring
+ * @return Oldest record, or NULL if the ring is empty
+ */
+static pipeline_item_t *ring_peek(spsc_ring_t *r) {
+    const size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&r->tail, memory_order_acquire)) {
+        return NULL;
+    }
+    return &r->slots[head & (PIPELINE_RING_SIZE - 1)];
+}
+
+/**
+ * Release the record returned by ring_peek() back to the producer (consumer)
+ *
+ * @param r Ring
+ * @return void
+ */
+static void ring_pop(spsc_ring_t *r) {
+    const size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/**
+ * Scanner thread: claim PIDs and read them straight into ring slots
+ *
+ * PIDs are claimed one at a time from a shared counter, so a thread held up
+ * by one slow process does not hold up the others' share of the list.
+ *
+ * @param arg scanner_t for this thread
+ * @return NULL
+ */
+static void *scanner_main(void *arg) {
+    scanner_t *sc = arg;
+    scan_shared_t *shared = sc->shared;
+
+    for (;;) {
+        const int i = atomic_fetch_add_explicit(&shared->next, 1, memory_order_relaxed);
+        if (i >= shared->pid_count) {
+            break;
+        }
+
+        pipeline_item_t *item = ring_reserve(&sc->ring);
+        item->seq = i;
+        item->valid = platform_get_process_fields(shared->pids[i], &item->info,
+                                                  shared->sources) == 0;
+        ring_publish(&sc->ring);
+    }
+
+    return NULL;
+}
+
+/* Consumer-side state */
+typedef struct {
+    pipeline_emit_fn emit;
+    void *ctx;
+    bool resolve_users;
+    int delivered;                 /* records consumed, valid or not */
+    pipeline_item_t *window;       /* ordered mode: out-of-order records */
+    bool *filled;                  /* ordered mode: window slot occupancy */
+} consumer_t;
+
+/**
+ * Pass one record to the callback
+ *
+ * Usernames are filled in here, on the consumer thread, so the user cache
+ * is only ever touched by one thread.
+ *
+ * @param c Consumer state
+ * @param item Record to deliver
+ * @return void
+ */
+static void deliver(consumer_t *c, pipeline_item_t *item) {
+    c->delivered++;
+
+    if (!item->valid) {
+        return;
+    }
+    if (c->resolve_users) {
+        usercache_lookup((uid_t)item->info.uid, item->info.username,
+                         sizeof(item->info.username));
+    }
+    c->emit(c->ctx, &item->info);
+}
+
+/**
+ * Deliver window records that have become next in order
+ *
+ * @param c Consumer state
+ * @return true if anything was delivered
+ */
+static bool drain_window(consumer_t *c) {
+    bool progress = false;
+
+    while (c->filled[c->delivered % PIPELINE_REORDER_WINDOW]) {
+        const int slot = c->delivered % PIPELINE_REORDER_WINDOW;
+        c->filled[slot] = false;
+        deliver(c, &c->window[slot]);
+        progress = true;
+    }
+
+    return progress;
+}
+
+/**
+ * Scan all processes on worker threads and hand them to a callback
+ *
+ * Overlaps /proc reads with formatting: `jobs` scanner threads read process
+ * records directly into their own lock-free SPSC ring, and the calling
+ * thread drains the rings and invokes emit for every process, so the caller
+ * can serialise rows while later processes are still being read. Memory is
+ * bounded by the rings (and the reorder window), not by the process count.
+ *
+ * Delivery order:
+ * - Unordered: records are delivered as soon as they are drained
+ * - Ordered: records are delivered in PID-list order. Records that arrive
+ *   early are parked in a PIPELINE_REORDER_WINDOW-record window; a record
+ *   further ahead than that is left in its ring until the window catches up.
+ *   This cannot stall: the next record in order is always at the head of
+ *   its scanner's ring once read, because everything that scanner produced
+ *   before it has already been delivered.
+ *
+ * Usernames (PROC_SRC_USER) are resolved on the calling thread.
+ *
+ * @param pids PIDs to scan (from platform_list_pids())
+ * @param pid_count Number of PIDs
+ * @param sources Bitmask of PROC_SRC_* flags to read for each process
+ * @param jobs Number of scanner threads (1..PIPELINE_MAX_JOBS)
+ * @param ordered Deliver records in PID-list order rather than as completed
+ * @param emit Callback invoked for every process, on the calling thread
+ * @param ctx Context passed to emit
+ * @return 0 on success, -1 if memory is exhausted or no scanner thread could
+ *         be started (errno says which)
+ */
+int pipeline_scan_processes(const pid_t *pids, int pid_count, unsigned int sources,
+                            int jobs, bool ordered, pipeline_emit_fn emit, void *ctx) {
+    scan_shared_t shared = {
+        .pids = pids,
+        .pid_count = pid_count,
+        /* Scanners read the UID; the consumer turns it into a name */
+        .sources = (sources & PROC_SRC_USER) ? (sources & ~PROC_SRC_USER) | PROC_SRC_STATUS
+                                             : sources,
+    };
+    atomic_init(&shared.next, 0);
+
+    consumer_t c = {
+        .emit = emit,
+        .ctx = ctx,
+        .resolve_users = (sources & PROC_SRC_USER) != 0,
+    };
+    if (ordered) {
+        c.window = counted_malloc(PIPELINE_REORDER_WINDOW * sizeof(pipeline_item_t));
+        c.filled = counted_calloc(PIPELINE_REORDER_WINDOW, sizeof(bool));
+    }
+
+    scanner_t *scanners = counted_malloc((size_t)jobs * sizeof(scanner_t));
+    if (!scanners || (ordered && (!c.window || !c.filled))) {
+        free(scanners);
+        free(c.window);
+        free(c.filled);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int started = 0;
+    int error = 0;
+    for (int k = 0; k < jobs; k++) {
+        scanners[started].shared = &shared;
+        atomic_init(&scanners[started].ring.head, 0);
+        atomic_init(&scanners[started].ring.tail, 0);
+
+        error = pthread_create(&scanners[started].thread, NULL, scanner_main,
+                               &scanners[started]);
+        if (error == 0) {
+            started++;
+        }
+    }
+
+    if (started == 0) {
+        free(scanners);
+        free(c.window);
+        free(c.filled);
+        errno = error;
+        return -1;
+    }
+
+    int idle = 0;
+    while (c.delivered < pid_count) {
+        bool progress = false;
+
+        for (int k = 0; k < started; k++) {
+            pipeline_item_t *item;
+            while ((item = ring_peek(&scanners[k].ring)) != NULL) {
+                if (ordered && item->seq != c.delivered) {
+                    if (item->seq >= c.delivered + PIPELINE_REORDER_WINDOW) {
+                        break;
+                    }
+                    const int slot = item->seq % PIPELINE_REORDER_WINDOW;
+                    c.window[slot] = *item;
+                    c.filled[slot] = true;
+                } else {
+                    deliver(&c, item);
+                    if (ordered) {
+                        drain_window(&c);
+                    }
+                }
+
+                ring_pop(&scanners[k].ring);
+                progress = true;
+            }
+        }
+
+        if (ordered && drain_window(&c)) {
+            progress = true;
+        }
+
+        if (progress) {
+            idle = 0;
+        } else {
+            idle_wait(idle++);
+        }
+    }
+
+    for (int k = 0; k < started; k++) {
+        pthread_join(scanners[k].thread, NULL);
+    }
+
+    free(c.window);
+    free(c.filled);
+    free(scanners);
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include "platform.h"
+
+/* Upper bound for --jobs */
+#define PIPELINE_MAX_JOBS 64
+
+/* Records each scanner can have in flight (power of two) */
+#define PIPELINE_RING_SIZE 64
+
+/* Records the consumer holds back to restore PID order in ordered mode */
+#define PIPELINE_REORDER_WINDOW 256
+
+/**
+ * Callback receiving each scanned process, on the calling thread
+ *
+ * @param ctx Caller context
+ * @param info Process record (only valid for the duration of the call)
+ */
+typedef void (*pipeline_emit_fn)(void *ctx, const process_info_t *info);
+
+/**
+ * Scan all processes on worker threads and hand them to a callback
+ *
+ * See src/pipeline.c for detailed documentation.
+ *
+ * @param pids PIDs to scan (from platform_list_pids())
+ * @param pid_count Number of PIDs
+ * @param sources Bitmask of PROC_SRC_* flags to read for each process
+ * @param jobs Number of scanner threads (1..PIPELINE_MAX_JOBS)
+ * @param ordered Deliver records in PID-list order rather than as completed
+ * @param emit Callback invoked for every process, on the calling thread
+ * @param ctx Context passed to emit
+ * @return 0 on success, -1 if memory is exhausted or no scanner thread could be started
+ */
+int pipeline_scan_processes(const pid_t *pids, int pid_count, unsigned int sources,
+                            int jobs, bool ordered, pipeline_emit_fn emit, void *ctx);
+
+#endif /* PIPELINE_H */
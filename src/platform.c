@@ -1,11 +1,12 @@
 #include "platform.h"
 #include "utils.h"
+#include "usercache.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
-#include <pwd.h>
 
 /* Platform-specific includes */
 #ifdef __APPLE__
@@ -14,353 +15,2060 @@
 #include <sys/proc_info.h>
 #elif __linux__
 #include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <sys/stat.h>
+#include <arpa/inet.h>
+#include <linux/sock_diag.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "sockdiag.h"
+#include "backend.h"
+#include "bpfiter.h"
+#include "workq.h"
 #endif
 
+#ifdef __linux__
+/* System boot time (btime from /proc/stat), read once by platform_init() */
+static time_t boot_time = 0;
+static pthread_once_t boot_time_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Read the system boot time into boot_time (pthread_once routine)
+ *
+ * @return void
+ */
+static void read_boot_time(void) {
+    FILE *fp = fopen("/proc/stat", "r");
+    if (fp) {
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, "btime ", 6) == 0) {
+                sscanf(line + 6, "%ld", &boot_time);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+}
+#endif
+
+/**
+ * Initialize platform-specific resources
+ *
+ * Performs any necessary platform-specific initialization before the application
+ * can query process and network information. On Linux this reads the system
+ * boot time once, so start times do not re-read /proc/stat for every process
+ * (and scanner threads only ever read the cached value). macOS needs no setup.
+ *
+ * Safe to call any number of times from any thread: the boot time is read on
+ * the first call only, and later calls wait for it to be in place.
+ *
+ * @return 0 on success (always succeeds in current implementation)
+ */
+int platform_init(void) {
+#ifdef __linux__
+    pthread_once(&boot_time_once, read_boot_time);
+#endif
+    return 0;
+}
+
+/**
+ * Clean up platform-specific resources
+ *
+ * Releases any platform-specific resources allocated during application execution,
+ * currently the UID to username cache. Should be called before application exit,
+ * once no other thread is querying.
+ *
+ * @return void
+ */
+void platform_cleanup(void) {
+    usercache_free();
+}
+
+/**
+ * Get username from UID using system password database
+ *
+ * Converts a numeric user ID to a human-readable username through the user
+ * cache, which answers from /etc/passwd and only asks NSS about UIDs that are
+ * not in it. Falls back to displaying the numeric UID if username lookup fails.
+ *
+ * @param uid User ID to look up
+ * @param username Buffer to store the username string
+ * @param size Size of username buffer
+ * @return void (username is always populated, either with name or numeric UID)
+ */
+static void get_username_from_uid(const int uid, char *username, size_t size) {
+    usercache_lookup((uid_t)uid, username, size);
+}
+
+/**
+ * Move the owner lists of collected connections behind the records
+ *
+ * While a port is scanned, each record's owners point into the scanner's
+ * own lookup. Copying the lists to the tail of the connection array lets
+ * callers release the whole result with a single free(), as before owners
+ * were reported. The array is trimmed to its final size on the way.
+ *
+ * @param connections In/out: connection array (may move; left as it was
+ *        if memory is exhausted)
+ * @param count Number of connections in the array
+ * @return 0 on success, -1 if memory is exhausted
+ */
+static int pack_connection_owners(connection_info_t **connections, int count) {
+    size_t owners = 0;
+    for (int i = 0; i < count; i++) {
+        owners += (size_t)(*connections)[i].owner_count;
+    }
+
+    const size_t records = (size_t)(count > 0 ? count : 1) * sizeof(connection_info_t);
+    connection_info_t *conns = counted_realloc(*connections, records + owners * sizeof(pid_t));
+    if (!conns) {
+        return -1;
+    }
+
+    /* connection_info_t is at least int-aligned, so the tail is too */
+    pid_t *tail = (pid_t *)((char *)conns + records);
+    for (int i = 0; i < count; i++) {
+        if (conns[i].owner_count > 0) {
+            memcpy(tail, conns[i].owners, (size_t)conns[i].owner_count * sizeof(pid_t));
+            conns[i].owners = tail;
+            tail += conns[i].owner_count;
+        }
+    }
+
+    *connections = conns;
+    return 0;
+}
+
+/* ============================================================================
+ * LINUX IMPLEMENTATION
+ * ============================================================================ */
+#ifdef __linux__
+
+/**
+ * Read one counter from a /proc/net/sockstat-style file (Linux)
+ *
+ * The files hold one line per protocol ("TCP: inuse 5 orphan 0 tw 2 ...");
+ * this returns the value following `key` on the `proto` line.
+ *
+ * @param path File to read (/proc/net/sockstat or /proc/net/sockstat6)
+ * @param proto Protocol label including the colon (e.g. "TCP:")
+ * @param key Counter name (e.g. "inuse")
+ * @return Counter value, or 0 if the file, line or key is missing
+ */
+static long read_sockstat_counter(const char *path, const char *proto, const char *key) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return 0;
+    }
+
+    long value = 0;
+    char line[256];
+    const size_t proto_len = strlen(proto);
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, proto, proto_len) != 0 || line[proto_len] != ' ') {
+            continue;
+        }
+
+        char *save = NULL;
+        for (char *tok = strtok_r(line + proto_len, " \n", &save); tok;
+             tok = strtok_r(NULL, " \n", &save)) {
+            if (strcmp(tok, key) == 0) {
+                char *num = strtok_r(NULL, " \n", &save);
+                value = num ? strtol(num, NULL, 10) : 0;
+                break;
+            }
+        }
+        break;
+    }
+
+    fclose(fp);
+    return value;
+}
+
+/**
+ * Estimate the number of processes without listing /proc (Linux)
+ *
+ * The link count of /proc is the number of processes plus a small fixed
+ * number of subdirectories, which makes it a cheap upper bound. If the
+ * filesystem reports no useful link count, the scheduling-entity total from
+ * /proc/loadavg (which counts threads, so it also over-estimates) is used.
+ *
+ * @return Estimated upper bound on the number of /proc/<pid> directories
+ */
+static int estimate_process_count(void) {
+    long estimate = 0;
+
+    struct stat st;
+    if (stat("/proc", &st) == 0 && st.st_nlink > 2) {
+        estimate = (long)st.st_nlink;
+    } else {
+        FILE *fp = fopen("/proc/loadavg", "r");
+        if (fp) {
+            if (fscanf(fp, "%*f %*f %*f %*d/%ld", &estimate) != 1) {
+                estimate = 0;
+            }
+            fclose(fp);
+        }
+    }
+
+    /* Headroom for processes spawned while the scan is running */
+    return (int)(estimate + estimate / 8 + 16);
+}
+
+/**
+ * Estimate the number of open sockets system-wide (Linux)
+ *
+ * /proc/net/tcp and friends report a size of 0, so their length cannot be
+ * used to size buffers; the kernel's socket counters in /proc/net/sockstat
+ * are used instead.
+ *
+ * @param inet_only Count only TCP/UDP rows (the /proc/net tables) instead of
+ *                  every socket (the fd links inode_map_build() records)
+ * @return Estimated upper bound on the number of sockets
+ */
+static int estimate_socket_count(bool inet_only) {
+    long estimate;
+
+    if (inet_only) {
+        estimate = read_sockstat_counter("/proc/net/sockstat", "TCP:", "alloc") +
+                   read_sockstat_counter("/proc/net/sockstat", "TCP:", "tw") +
+                   read_sockstat_counter("/proc/net/sockstat", "UDP:", "inuse") +
+                   read_sockstat_counter("/proc/net/sockstat6", "TCP6:", "inuse") +
+                   read_sockstat_counter("/proc/net/sockstat6", "UDP6:", "inuse");
+    } else {
+        estimate = read_sockstat_counter("/proc/net/sockstat", "sockets:", "used");
+    }
+
+    /* Headroom for sockets opened during the scan (and fds sharing a socket) */
+    return (int)(estimate + estimate / 8 + 16);
+}
+
+/*
+ * Mapping from socket inode to the PIDs holding it.
+ *
+ * Building this once and reusing it for every parsed connection avoids the
+ * previous O(connections x processes x fds) behaviour, where /proc/<pid>/fd
+ * was rescanned in full for each connection found.
+ *
+ * The fd scan yields one inode/PID link per fd; the map keeps them as a
+ * compressed sparse row table: the distinct inodes in ascending order, and
+ * for each an offset into one array of PIDs. A listener shared by a master
+ * and 64 workers then costs one index entry and 65 PIDs rather than 65
+ * links, and every owner of a socket is found with one binary search.
+ */
+typedef struct {
+    unsigned long inode;
+    pid_t pid;
+} inode_pid_entry_t;
+
+typedef struct {
+    unsigned long *inodes;  /* distinct socket inodes, ascending */
+    uint32_t *starts;       /* owners of inodes[i]: pids[starts[i]] .. pids[starts[i + 1] - 1] */
+    pid_t *pids;            /* owners, ascending within each inode */
+    int count;              /* number of inodes */
+} inode_map_t;
+
+/* Bytes of directory entries read per getdents64() call (one fd chunk) */
+#define FD_CHUNK_BYTES 16384
+
+/* Layout of the records returned by getdents64() */
+struct fd_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Socket links found by one worker, merged once the scan is done */
+typedef struct {
+    inode_pid_entry_t *entries;
+    int count;
+    int capacity;
+    bool failed;            /* memory ran out; later links were dropped */
+} inode_shard_t;
+
+/* Shared state of an inode map scan */
+typedef struct {
+    const pid_t *pids;
+    inode_shard_t *shards;  /* one per worker */
+} inode_scan_t;
+
+/**
+ * Record one socket link found by a worker
+ */
+static void inode_shard_add(inode_shard_t *shard, unsigned long inode, pid_t pid) {
+    if (shard->failed) {
+        return;
+    }
+    if (shard->count >= shard->capacity) {
+        const int capacity = shard->capacity * 2 + 16;
+        inode_pid_entry_t *grown = counted_realloc(shard->entries,
+                                                   capacity * sizeof(inode_pid_entry_t));
+        if (!grown) {
+            shard->failed = true;
+            return;
+        }
+        shard->entries = grown;
+        shard->capacity = capacity;
+    }
+    shard->entries[shard->count].inode = inode;
+    shard->entries[shard->count].pid = pid;
+    shard->count++;
+}
+
+/**
+ * Scan a process's fd directory from a getdents offset onwards (Linux)
+ *
+ * Reads the directory one FD_CHUNK_BYTES getdents64() chunk at a time and
+ * readlinkat()s each entry, recording "socket:[inode]" links. When a chunk
+ * comes back full there is probably more, so the remainder (from the last
+ * entry's d_off) is pushed as a separate task before this chunk's links are
+ * resolved: on a process with 100k fds, idle workers steal the continuation
+ * and the walk spreads across cores chunk by chunk. Without a scheduler
+ * (the incremental scan) the whole directory is read in this call.
+ *
+ * @param q Scheduler, or NULL to scan without splitting
+ * @param worker Worker running this task
+ * @param scan Scan state
+ * @param pid Process whose fds to scan
+ * @param offset Directory offset to resume from (0 for the start)
+ * @return void
+ */
+static void inode_scan_fds(workq_t *q, int worker, inode_scan_t *scan, pid_t pid,
+                           uint32_t offset) {
+    char fd_path[32];
+    snprintf(fd_path, sizeof(fd_path), "/proc/%d/fd", pid);
+
+    const int dfd = open(fd_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0) {
+        return;
+    }
+    if (offset > 0 && lseek(dfd, (off_t)offset, SEEK_SET) < 0) {
+        close(dfd);
+        return;
+    }
+
+    /* getdents64 records are 8-byte aligned */
+    union {
+        uint64_t align;
+        char bytes[FD_CHUNK_BYTES];
+    } buf;
+    inode_shard_t *shard = &scan->shards[worker];
+
+    for (;;) {
+        const long n = syscall(SYS_getdents64, dfd, buf.bytes, sizeof(buf.bytes));
+        if (n <= 0) {
+            break;
+        }
+
+        /* Hand the rest of a large directory to whoever is idle */
+        bool split = false;
+        if (q && n > FD_CHUNK_BYTES / 2) {
+            int64_t last_off = 0;
+            for (long pos = 0; pos < n;) {
+                const struct fd_dirent64 *d = (const struct fd_dirent64 *)(buf.bytes + pos);
+                last_off = d->d_off;
+                pos += d->d_reclen;
+            }
+            if (last_off > 0 && last_off <= (int64_t)UINT32_MAX) {
+                workq_push(q, worker, (uint64_t)(uint32_t)pid << 32 | (uint64_t)last_off);
+                split = true;
+            }
+        }
+
+        for (long pos = 0; pos < n;) {
+            const struct fd_dirent64 *d = (const struct fd_dirent64 *)(buf.bytes + pos);
+            pos += d->d_reclen;
+
+            if (d->d_name[0] < '0' || d->d_name[0] > '9') {
+                continue;
+            }
+
+            char link_target[64];
+            const ssize_t len = readlinkat(dfd, d->d_name, link_target,
+                                           sizeof(link_target) - 1);
+            if (len <= 8 || strncmp(link_target, "socket:[", 8) != 0) {
+                continue;
+            }
+            link_target[len] = '\0';
+
+            inode_shard_add(shard, strtoul(link_target + 8, NULL, 10), pid);
+        }
+
+        if (split) {
+            break;
+        }
+    }
+
+    close(dfd);
+}
+
+/**
+ * workq root task: scan one process from the PID list
+ */
+static void inode_scan_root(workq_t *q, int worker, int index, void *ctx) {
+    inode_scan_t *scan = ctx;
+    inode_scan_fds(q, worker, scan, scan->pids[index], 0);
+}
+
+/**
+ * workq subtask: continue a large fd directory (pid << 32 | offset)
+ */
+static void inode_scan_chunk(workq_t *q, int worker, uint64_t task, void *ctx) {
+    inode_scan_fds(q, worker, ctx, (pid_t)(task >> 32), (uint32_t)task);
+}
+
+/**
+ * qsort comparator: socket links by inode, then PID
+ */
+static int compare_links(const void *a, const void *b) {
+    const inode_pid_entry_t *x = a;
+    const inode_pid_entry_t *y = b;
+    if (x->inode != y->inode) {
+        return x->inode < y->inode ? -1 : 1;
+    }
+    return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+/**
+ * Free an inode->PID map built by inode_map_build
+ */
+static void inode_map_free(inode_map_t *map) {
+    free(map->inodes);
+    free(map->starts);
+    free(map->pids);
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * Turn the socket links found by an fd scan into an inode map (Linux)
+ *
+ * Sorts the links in place, then stores each inode once with the distinct
+ * PIDs holding it (a process with the socket on several fds counts once).
+ * The links are left sorted and still owned by the caller.
+ *
+ * @param links Socket links, one per fd
+ * @param count Number of links
+ * @param map Output map (caller must free with inode_map_free; left empty
+ *        if memory is exhausted)
+ * @return 0 on success, -1 if memory is exhausted
+ */
+static int inode_map_from_links(inode_pid_entry_t *links, int count, inode_map_t *map) {
+    if (count > 0) {
+        qsort(links, (size_t)count, sizeof(*links), compare_links);
+    }
+
+    int inodes = 0;
+    int owners = 0;
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || links[i].inode != links[i - 1].inode) {
+            inodes++;
+            owners++;
+        } else if (links[i].pid != links[i - 1].pid) {
+            owners++;
+        }
+    }
+
+    map->inodes = counted_malloc((size_t)(inodes > 0 ? inodes : 1) * sizeof(unsigned long));
+    map->starts = counted_malloc((size_t)(inodes + 1) * sizeof(uint32_t));
+    map->pids = counted_malloc((size_t)(owners > 0 ? owners : 1) * sizeof(pid_t));
+    map->count = inodes;
+    if (!map->inodes || !map->starts || !map->pids) {
+        inode_map_free(map);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int n = -1;
+    uint32_t o = 0;
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || links[i].inode != links[i - 1].inode) {
+            n++;
+            map->inodes[n] = links[i].inode;
+            map->starts[n] = o;
+        } else if (links[i].pid == links[i - 1].pid) {
+            continue;
+        }
+        map->pids[o++] = links[i].pid;
+    }
+    map->starts[inodes] = o;
+    return 0;
+}
+
+/**
+ * bpfiter callback: record one socket fd reported by the kernel
+ */
+static void collect_socket_fd(void *ctx, pid_t pid, unsigned long inode) {
+    inode_shard_add(ctx, inode, pid);
+}
+
+/**
+ * Build a socket-inode -> PID map by scanning the fd links under /proc (Linux)
+ *
+ * Lists every process and reads its fd symlinks, recording an entry for each
+ * "socket:[inode]" link. The resulting map is used to resolve the owning
+ * processes of a connection in one lookup instead of rescanning /proc per
+ * connection.
+ *
+ * Where a BPF task_file iterator can be loaded (see src/bpfiter.c), the fd
+ * tables are walked inside the kernel in a single pass instead, with no
+ * readlink() per fd; the /proc walk below is the fallback.
+ *
+ * Per-process cost is very uneven (a kernel thread has no fds, a database
+ * may have 100k), so the scan runs on the work-stealing scheduler with
+ * scan_jobs workers: processes are handed out one by one,
+ * large fd directories split into getdents chunks that idle workers steal
+ * (see inode_scan_fds()), and each worker collects its links separately
+ * until they are merged at the end.
+ *
+ * @param scan_jobs Worker threads (values below 1 mean the calling thread only)
+ * @param map Output map to populate (caller must free with inode_map_free;
+ *        left empty if memory is exhausted)
+ * @return 0 on success, -1 if memory is exhausted
+ */
+static int inode_map_build(int scan_jobs, inode_map_t *map) {
+    memset(map, 0, sizeof(*map));
+
+    /* Sized from the kernel's socket count; doubling is only a fallback */
+    const int capacity = estimate_socket_count(false);
+
+    inode_shard_t kernel = { counted_malloc(capacity * sizeof(inode_pid_entry_t)), 0, capacity,
+                             false };
+    if (!kernel.entries) {
+        return -1;
+    }
+    const bool from_kernel = bpfiter_socket_fds(collect_socket_fd, &kernel) == 0;
+    int result = 0;
+    if (from_kernel) {
+        result = kernel.failed ? -1 : inode_map_from_links(kernel.entries, kernel.count, map);
+    }
+    free(kernel.entries);
+    if (from_kernel) {
+        if (result < 0) {
+            errno = ENOMEM;
+        }
+        return result;
+    }
+
+    pid_t *pids = NULL;
+    int pid_count = 0;
+    if (platform_list_pids(&pids, &pid_count) < 0) {
+        return errno == ENOMEM ? -1 : inode_map_from_links(NULL, 0, map);
+    }
+
+    if (scan_jobs < 1) {
+        scan_jobs = 1;
+    }
+
+    inode_scan_t scan = { .pids = pids };
+    scan.shards = counted_calloc((size_t)scan_jobs, sizeof(inode_shard_t));
+    bool failed = !scan.shards;
+    for (int k = 0; !failed && k < scan_jobs; k++) {
+        scan.shards[k].capacity = k == 0 ? capacity : capacity / scan_jobs;
+        scan.shards[k].entries = counted_malloc(scan.shards[k].capacity *
+                                                sizeof(inode_pid_entry_t));
+        failed = !scan.shards[k].entries && scan.shards[k].capacity > 0;
+    }
+
+    if (!failed) {
+        failed = workq_run(scan_jobs, pid_count, inode_scan_root, inode_scan_chunk, &scan) < 0;
+    }
+
+    /* The other shards are appended to worker 0's, then indexed */
+    int total = 0;
+    for (int k = 0; !failed && k < scan_jobs; k++) {
+        total += scan.shards[k].count;
+        failed = scan.shards[k].failed;
+    }
+    if (!failed && total > scan.shards[0].capacity) {
+        inode_pid_entry_t *grown = counted_realloc(scan.shards[0].entries,
+                                                   total * sizeof(inode_pid_entry_t));
+        if (grown) {
+            scan.shards[0].entries = grown;
+        } else {
+            failed = true;
+        }
+    }
+    if (!failed) {
+        inode_pid_entry_t *links = scan.shards[0].entries;
+        total = scan.shards[0].count;
+        for (int k = 1; k < scan_jobs; k++) {
+            memcpy(links + total, scan.shards[k].entries,
+                   scan.shards[k].count * sizeof(inode_pid_entry_t));
+            total += scan.shards[k].count;
+        }
+        failed = inode_map_from_links(links, total, map) < 0;
+    }
+
+    for (int k = 0; scan.shards && k < scan_jobs; k++) {
+        free(scan.shards[k].entries);
+    }
+    free(scan.shards);
+    free(pids);
+
+    if (failed) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Find every PID holding a socket inode
+ *
+ * @param map Inode map
+ * @param inode Socket inode
+ * @param pids Output: the owners, ascending (NULL if there are none)
+ * @return Number of owners, 0 if no process holds the socket
+ */
+static int inode_map_owners(const inode_map_t *map, unsigned long inode, const pid_t **pids) {
+    int low = 0;
+    int high = map->count - 1;
+
+    while (low <= high) {
+        const int mid = low + (high - low) / 2;
+        if (map->inodes[mid] == inode) {
+            *pids = map->pids + map->starts[mid];
+            return (int)(map->starts[mid + 1] - map->starts[mid]);
+        }
+        if (map->inodes[mid] < inode) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    *pids = NULL;
+    return 0;
+}
+
+/**
+ * Fill in the owners of a connection from the inode map
+ *
+ * The lowest owning PID becomes conn->pid; owners points into the map
+ * until pack_connection_owners() moves it. The inode is kept so the owners
+ * can be resolved again (see inode_cache_revalidate()).
+ *
+ * @param imap Inode map, or NULL to leave the owners unresolved
+ * @param inode Socket inode
+ * @param conn Connection to update
+ * @return void
+ */
+static void resolve_owners(const inode_map_t *imap, unsigned long inode,
+                           connection_info_t *conn) {
+    conn->inode = inode;
+    conn->owner_count = imap ? inode_map_owners(imap, inode, &conn->owners) : 0;
+    conn->pid = conn->owner_count > 0 ? conn->owners[0] : -1;
+}
+
+/*
+ * Socket owner map kept between queries.
+ *
+ * A caller answering many port lookups in a row (wir --serve-stdio) would
+ * otherwise pay for a full fd scan on every one. The cached map is reused
+ * for ttl_ms; within that window a socket the map has no owner for is
+ * usually one opened since the scan, so a miss rebuilds the map early and
+ * the owners are resolved again. Sockets still unowned right after a
+ * rebuild (held in another namespace, or by processes whose fds cannot be
+ * read) are remembered so they do not force a rebuild on every query.
+ * Owners of sockets the map already knows may be up to ttl_ms stale.
+ */
+struct platform_inode_cache {
+    int ttl_ms;
+    bool valid;
+    bool fresh;                 /* built during the current query */
+    struct timespec built;      /* CLOCK_MONOTONIC */
+    inode_map_t map;
+    unsigned long *unowned;     /* ascending */
+    int unowned_count;
+};
+
+/**
+ * Create a socket owner cache
+ *
+ * Nothing is scanned until the first port lookup that uses it.
+ *
+ * @param ttl_ms How long a map is reused, in milliseconds
+ * @return New cache (free with platform_inode_cache_free())
+ */
+platform_inode_cache_t *platform_inode_cache_new(int ttl_ms) {
+    platform_inode_cache_t *cache = counted_calloc(1, sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->ttl_ms = ttl_ms;
+    return cache;
+}
+
+/**
+ * Free a socket owner cache
+ *
+ * @param cache Cache to free (NULL is ignored)
+ * @return void
+ */
+void platform_inode_cache_free(platform_inode_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    if (cache->valid) {
+        inode_map_free(&cache->map);
+    }
+    free(cache->unowned);
+    free(cache);
+}
+
+/**
+ * Rebuild the cached map now (it is dropped if memory is exhausted)
+ */
+static int inode_cache_rebuild(platform_inode_cache_t *cache, int scan_jobs) {
+    if (cache->valid) {
+        inode_map_free(&cache->map);
+        cache->valid = false;
+    }
+    if (inode_map_build(scan_jobs, &cache->map) < 0) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &cache->built);
+    cache->valid = true;
+    cache->fresh = true;
+    cache->unowned_count = 0;
+    return 0;
+}
+
+/**
+ * Get the inode map for one query: the cached one, or a new one
+ *
+ * @param opts Query settings (inode_cache, scan_jobs)
+ * @param local Storage for a map built for this query only
+ * @return Map to resolve owners with (release with inode_map_release()),
+ *         or NULL if memory is exhausted
+ */
+static const inode_map_t *inode_map_acquire(const platform_options_t *opts,
+                                            inode_map_t *local) {
+    platform_inode_cache_t *cache = opts->inode_cache;
+    if (!cache) {
+        return inode_map_build(opts->scan_jobs, local) == 0 ? local : NULL;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const long long age_ms = (now.tv_sec - cache->built.tv_sec) * 1000LL +
+                             (now.tv_nsec - cache->built.tv_nsec) / 1000000;
+
+    cache->fresh = false;
+    if ((!cache->valid || age_ms >= cache->ttl_ms) &&
+        inode_cache_rebuild(cache, opts->scan_jobs) < 0) {
+        return NULL;
+    }
+    return &cache->map;
+}
+
+/**
+ * Release a map from inode_map_acquire()
+ */
+static void inode_map_release(const platform_options_t *opts, inode_map_t *local) {
+    if (!opts->inode_cache) {
+        inode_map_free(local);
+    }
+}
+
+/**
+ * Compare two inodes for qsort() and bsearch()
+ */
+static int compare_inodes(const void *a, const void *b) {
+    const unsigned long x = *(const unsigned long *)a;
+    const unsigned long y = *(const unsigned long *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Check whether a connection lacks owners the cached map could not know
+ *
+ * @param cache Cache
+ * @param conn Connection resolved against cache->map
+ * @return true if the socket is neither owned nor known to be unowned
+ */
+static bool inode_cache_misses(const platform_inode_cache_t *cache,
+                               const connection_info_t *conn) {
+    /* TIME_WAIT and other orphaned sockets have no inode */
+    if (conn->owner_count > 0 || conn->inode == 0) {
+        return false;
+    }
+    return !cache->unowned_count ||
+           !bsearch(&conn->inode, cache->unowned, (size_t)cache->unowned_count,
+                    sizeof(unsigned long), compare_inodes);
+}
+
+/**
+ * Re-resolve a query's connections if the cached map missed any of them
+ *
+ * When a connection is unowned and the map was reused from an earlier
+ * query, the map is rebuilt and every owner resolved again. Whatever is
+ * still unowned against a map built during this query is remembered as
+ * unowned until the next rebuild (if memory allows; otherwise they are
+ * looked for again next time).
+ *
+ * @param opts Query settings (inode_cache, scan_jobs)
+ * @param conns Connections resolved against the cached map
+ * @param count Number of connections
+ * @return 0 on success, -1 if memory is exhausted while rebuilding the map
+ */
+static int inode_cache_revalidate(const platform_options_t *opts, connection_info_t *conns,
+                                   int count) {
+    platform_inode_cache_t *cache = opts->inode_cache;
+    if (!cache) {
+        return 0;
+    }
+
+    int misses = 0;
+    for (int i = 0; i < count; i++) {
+        if (inode_cache_misses(cache, &conns[i])) {
+            misses++;
+        }
+    }
+    if (misses == 0) {
+        return 0;
+    }
+
+    if (!cache->fresh) {
+        if (inode_cache_rebuild(cache, opts->scan_jobs) < 0) {
+            return -1;
+        }
+        misses = 0;
+        for (int i = 0; i < count; i++) {
+            resolve_owners(&cache->map, conns[i].inode, &conns[i]);
+            if (inode_cache_misses(cache, &conns[i])) {
+                misses++;
+            }
+        }
+    }
+
+    unsigned long *unowned = counted_realloc(cache->unowned,
+                                             (size_t)(cache->unowned_count + misses) *
+                                                 sizeof(unsigned long));
+    if (!unowned) {
+        return 0;
+    }
+    cache->unowned = unowned;
+    for (int i = 0; i < count; i++) {
+        if (inode_cache_misses(cache, &conns[i])) {
+            cache->unowned[cache->unowned_count++] = conns[i].inode;
+        }
+    }
+    qsort(cache->unowned, (size_t)cache->unowned_count, sizeof(unsigned long),
+          compare_inodes);
+    return 0;
+}
+
+/**
+ * Name a kernel TCP state (the st column of /proc/net/tcp, idiag_state)
+ *
+ * @param state Kernel state number
+ * @return State name (e.g. "LISTEN"), "UNKNOWN" if out of range
+ */
+static const char *tcp_state_name(int state) {
+    switch (state) {
+        case 0x01: return "ESTABLISHED";
+        case 0x02: return "SYN_SENT";
+        case 0x03: return "SYN_RECV";
+        case 0x04: return "FIN_WAIT1";
+        case 0x05: return "FIN_WAIT2";
+        case 0x06: return "TIME_WAIT";
+        case 0x07: return "CLOSE";
+        case 0x08: return "CLOSE_WAIT";
+        case 0x09: return "LAST_ACK";
+        case 0x0A: return "LISTEN";
+        case 0x0B: return "CLOSING";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * Listen backlogs of the TCP listeners on one port, keyed by socket inode
+ *
+ * /proc/net/tcp shows a listener's accept queue (rx_queue) but not the
+ * backlog it is measured against; sock_diag reports both. A port rarely
+ * has more than a handful of listeners (one per SO_REUSEPORT worker), so
+ * a flat array searched linearly is enough.
+ */
+typedef struct {
+    unsigned long *inodes;
+    int *backlogs;
+    int count;
+    int capacity;
+    bool failed;            /* memory ran out during the dump */
+} backlog_list_t;
+
+/**
+ * sock_diag callback: record the backlog of one listener
+ *
+ * @param ctx backlog_list_t being filled
+ * @param sock Listening socket
+ * @return true to continue the dump, false if memory is exhausted
+ */
+static bool collect_backlog(void *ctx, const sockdiag_socket_t *sock) {
+    backlog_list_t *list = ctx;
+
+    if (list->count >= list->capacity) {
+        const int capacity = list->capacity > 0 ? list->capacity * 2 : 8;
+        unsigned long *inodes = counted_realloc(list->inodes, capacity * sizeof(unsigned long));
+        if (inodes) {
+            list->inodes = inodes;
+        }
+        int *backlogs = inodes ? counted_realloc(list->backlogs, capacity * sizeof(int)) : NULL;
+        if (!backlogs) {
+            list->failed = true;
+            return false;
+        }
+        list->backlogs = backlogs;
+        list->capacity = capacity;
+    }
+    list->inodes[list->count] = sock->inode;
+    list->backlogs[list->count] = (int)sock->wqueue;
+    list->count++;
+    return true;
+}
+
+/**
+ * Collect the listen backlogs of every TCP listener on a port
+ *
+ * Only the listening hash is walked and only sockets on the port are
+ * returned (see sockdiag_dump()). Without sock_diag the list stays empty
+ * and backlogs are reported as unknown.
+ *
+ * @param port Port number
+ * @param list Output list (free with backlog_list_free())
+ * @return 0 on success, -1 if memory is exhausted
+ */
+static int backlog_list_build(int port, backlog_list_t *list) {
+    memset(list, 0, sizeof(*list));
+    sockdiag_dump(AF_INET, IPPROTO_TCP, SOCKDIAG_STATE(SOCKDIAG_LISTEN), 0, port,
+                  collect_backlog, list);
+    sockdiag_dump(AF_INET6, IPPROTO_TCP, SOCKDIAG_STATE(SOCKDIAG_LISTEN), 0, port,
+                  collect_backlog, list);
+    if (list->failed) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Release a backlog list
+ *
+ * @param list List to free
+ * @return void
+ */
+static void backlog_list_free(backlog_list_t *list) {
+    free(list->inodes);
+    free(list->backlogs);
+    memset(list, 0, sizeof(*list));
+}
+
+/**
+ * Find the backlog of a listener
+ *
+ * @param list Backlogs collected by backlog_list_build()
+ * @param inode Socket inode of the listener
+ * @return Listen backlog, or 0 if unknown
+ */
+static int backlog_lookup(const backlog_list_t *list, unsigned long inode) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->inodes[i] == inode) {
+            return list->backlogs[i];
+        }
+    }
+    return 0;
+}
+
+/* Connection tables, TCP before UDP (sock_diag can replace the TCP ones) */
+static const char *const proc_net_files[] = {
+    "/proc/net/tcp", "/proc/net/tcp6",
+    "/proc/net/udp", "/proc/net/udp6",
+};
+#define PROC_NET_FILE_COUNT ((int)(sizeof(proc_net_files) / sizeof(proc_net_files[0])))
+#define PROC_NET_FIRST_UDP 2
+
+/**
+ * Parse one /proc/net/{tcp,tcp6,udp,udp6} row for a connection on a port (Linux)
+ *
+ * The function:
+ * 1. Parses the row (format: sl, local_address, rem_address, st, ..., inode)
+ * 2. Skips it unless its local port is the target port
+ * 3. Converts hex addresses to text (IPv4 and IPv6)
+ * 4. Decodes TCP connection states; UDP has no connection state ("-")
+ * 5. Keeps the queue columns; TCP listeners also get their backlog
+ * 6. Resolves the owning PIDs via the inode map (no rescan)
+ *
+ * The record is written in place, so a caller collecting connections can
+ * point it at the next free slot of its array and nothing is copied.
+ *
+ * @param line Table row (not the header)
+ * @param is_udp Row comes from a UDP table
+ * @param is_v6 Row comes from an IPv6 table
+ * @param target_port Port number to search for
+ * @param imap Prebuilt inode->PID map used to resolve owning processes, or
+ *        NULL to leave the owners unresolved (pid -1)
+ * @param backlogs Listen backlogs of the port's TCP listeners
+ * @param conn Output record (written only if the row matches)
+ * @return true if the row is a connection on the port
+ */
+static bool parse_proc_net_row(const char *line, bool is_udp, bool is_v6, int target_port,
+                               const inode_map_t *imap, const backlog_list_t *backlogs,
+                               connection_info_t *conn) {
+    char local_hex[33], remote_hex[33];
+    unsigned long inode;
+    int local_port, remote_port, state;
+    unsigned int tx_queue, rx_queue;
+    int uid;
+
+    /* Parse the line - format varies but generally:
+     * sl local_address rem_address st tx_queue rx_queue tr tm->when retrnsmt uid timeout inode
+     */
+    int matched = sscanf(line, "%*d: %32[0-9A-Fa-f]:%x %32[0-9A-Fa-f]:%x %x %x:%x %*x:%*x %*x %d %*d %lu",
+                         local_hex, &local_port, remote_hex, &remote_port,
+                         &state, &tx_queue, &rx_queue, &uid, &inode);
+
+    if (matched < 9) {
+        return false;
+    }
+
+    /* Check if this matches our target port */
+    if (local_port != target_port) {
+        return false;
+    }
+
+    memset(conn, 0, sizeof(*conn));
+
+    /* Convert addresses from the kernel's hex words to text */
+    const int family = is_v6 ? AF_INET6 : AF_INET;
+    uint8_t addr[16];
+    backend_procfs_addr(local_hex, addr);
+    inet_ntop(family, addr, conn->local_addr, sizeof(conn->local_addr));
+    backend_procfs_addr(remote_hex, addr);
+    inet_ntop(family, addr, conn->remote_addr, sizeof(conn->remote_addr));
+
+    conn->local_port = local_port;
+    conn->remote_port = remote_port;
+    conn->tx_queue = tx_queue;
+    conn->rx_queue = rx_queue;
+    if (!is_udp && state == SOCKDIAG_LISTEN) {
+        conn->backlog = backlog_lookup(backlogs, inode);
+    }
+
+    /* Decode connection state (TCP only; UDP is connectionless) */
+    strcpy(conn->state, is_udp ? "-" : tcp_state_name(state));
+
+    snprintf(conn->protocol, sizeof(conn->protocol), "%s%s",
+             is_udp ? "UDP" : "TCP", is_v6 ? "6" : "");
+
+    /* Resolve the owning PIDs via the prebuilt inode map */
+    resolve_owners(imap, inode, conn);
+    return true;
+}
+
+/**
+ * Parse one /proc/net row, appending a connection on the port to an array
+ *
+ * Matches are appended to a caller-owned array shared by all four files, so
+ * results are never copied between per-file buffers.
+ *
+ * @param line Table row (not the header)
+ * @param is_udp Row comes from a UDP table
+ * @param is_v6 Row comes from an IPv6 table
+ * @param target_port Port number to search for
+ * @param imap Prebuilt inode->PID map used to resolve owning processes
+ * @param backlogs Listen backlogs of the port's TCP listeners
+ * @param connections In/out pointer to the dynamically allocated result array
+ * @param count In/out number of connections stored in the array
+ * @param capacity In/out allocated capacity of the array (in elements)
+ * @return 0 on success, -1 if memory is exhausted (the array is unchanged)
+ */
+static int append_proc_net_row(const char *line, bool is_udp, bool is_v6, int target_port,
+                               const inode_map_t *imap, const backlog_list_t *backlogs,
+                               connection_info_t **connections, int *count, int *capacity) {
+    /* Expand array if needed (only when the estimate was exceeded) */
+    if (*count >= *capacity) {
+        connection_info_t *grown = counted_realloc(*connections, (size_t)*capacity * 2 *
+                                                                     sizeof(connection_info_t));
+        if (!grown) {
+            return -1;
+        }
+        *connections = grown;
+        *capacity *= 2;
+    }
+
+    if (parse_proc_net_row(line, is_udp, is_v6, target_port, imap, backlogs,
+                           &(*connections)[*count])) {
+        (*count)++;
+    }
+    return 0;
+}
+
+/**
+ * Copy the TCP internals delivered with a sock_diag socket
+ *
+ * The kernel's tcp_info has grown over the years; a shorter one from an
+ * older kernel leaves the missing fields zero.
+ *
+ * @param sock Socket with tcp_info and/or meminfo attached
+ * @param tcp Output internals
+ * @return true if any internals were present
+ */
+static bool fill_tcp_internals(const sockdiag_socket_t *sock, tcp_internals_t *tcp) {
+    memset(tcp, 0, sizeof(*tcp));
+
+    if (sock->tcp_info) {
+        struct tcp_info info;
+        memset(&info, 0, sizeof(info));
+        memcpy(&info, sock->tcp_info,
+               sock->tcp_info_len < sizeof(info) ? sock->tcp_info_len : sizeof(info));
+
+        tcp->rtt_us = info.tcpi_rtt;
+        tcp->rttvar_us = info.tcpi_rttvar;
+        tcp->retransmits = info.tcpi_retransmits;
+        tcp->total_retrans = info.tcpi_total_retrans;
+        tcp->snd_cwnd = info.tcpi_snd_cwnd;
+        tcp->unacked = info.tcpi_unacked;
+    }
+
+    if (sock->meminfo) {
+        const uint32_t *m = sock->meminfo;
+        const size_t n = sock->meminfo_count;
+
+        tcp->rmem_alloc = n > SK_MEMINFO_RMEM_ALLOC ? m[SK_MEMINFO_RMEM_ALLOC] : 0;
+        tcp->rcvbuf = n > SK_MEMINFO_RCVBUF ? m[SK_MEMINFO_RCVBUF] : 0;
+        tcp->wmem_alloc = n > SK_MEMINFO_WMEM_ALLOC ? m[SK_MEMINFO_WMEM_ALLOC] : 0;
+        tcp->sndbuf = n > SK_MEMINFO_SNDBUF ? m[SK_MEMINFO_SNDBUF] : 0;
+        tcp->wmem_queued = n > SK_MEMINFO_WMEM_QUEUED ? m[SK_MEMINFO_WMEM_QUEUED] : 0;
+        tcp->drops = n > SK_MEMINFO_DROPS ? m[SK_MEMINFO_DROPS] : 0;
+    }
+
+    return sock->tcp_info || sock->meminfo;
+}
+
+/**
+ * Describe one socket from a dump as a connection
+ *
+ * Produces the same record parse_proc_net_row() does for the socket's
+ * /proc/net row, with IPv6 addresses in full and the TCP internals if the
+ * dump carried them.
+ *
+ * @param sock Socket from the dump
+ * @param imap Inode->PID map to resolve the owners with, or NULL to leave
+ *        them unresolved (pid -1)
+ * @param backlogs Listen backlogs to look listeners up in, or NULL if the
+ *        dump reports them (in wqueue)
+ * @param conn Output record
+ * @return void
+ */
+static void fill_connection(const sockdiag_socket_t *sock, const inode_map_t *imap,
+                            const backlog_list_t *backlogs, connection_info_t *conn) {
+    const bool udp = sock->protocol == IPPROTO_UDP;
+
+    memset(conn, 0, sizeof(*conn));
+    inet_ntop(sock->family, sock->local_addr, conn->local_addr, sizeof(conn->local_addr));
+    inet_ntop(sock->family, sock->remote_addr, conn->remote_addr, sizeof(conn->remote_addr));
+    conn->local_port = sock->local_port;
+    conn->remote_port = sock->remote_port;
+    strcpy(conn->state, udp ? "-" : tcp_state_name(sock->state));
+    snprintf(conn->protocol, sizeof(conn->protocol), "%s%s", udp ? "UDP" : "TCP",
+             sock->family == AF_INET6 ? "6" : "");
+
+    /* For a listener, rqueue is the accept queue and wqueue the backlog */
+    conn->rx_queue = sock->rqueue;
+    if (!udp && sock->state == SOCKDIAG_LISTEN) {
+        conn->backlog = backlogs ? backlog_lookup(backlogs, sock->inode) : (int)sock->wqueue;
+    } else {
+        conn->tx_queue = sock->wqueue;
+    }
+
+    conn->has_tcp_info = fill_tcp_internals(sock, &conn->tcp);
+    resolve_owners(imap, sock->inode, conn);
+}
+
+/**
+ * Connections being collected from a dump
+ */
+typedef struct {
+    const inode_map_t *imap;
+    const backlog_list_t *backlogs;
+    connection_info_t **connections;
+    int *count;
+    int *capacity;
+    bool failed;            /* memory ran out; the dump was stopped */
+} conn_collect_t;
+
+/**
+ * Dump callback: append one socket as a connection
+ *
+ * @param ctx conn_collect_t being filled
+ * @param sock Socket from the dump
+ * @return true to continue the dump, false if memory is exhausted
+ */
+static bool collect_connection(void *ctx, const sockdiag_socket_t *sock) {
+    conn_collect_t *c = ctx;
+
+    if (*c->count >= *c->capacity) {
+        connection_info_t *grown = counted_realloc(*c->connections, (size_t)*c->capacity * 2 *
+                                                                        sizeof(connection_info_t));
+        if (!grown) {
+            c->failed = true;
+            return false;
+        }
+        *c->connections = grown;
+        *c->capacity *= 2;
+    }
+
+    fill_connection(sock, c->imap, c->backlogs, &(*c->connections)[*c->count]);
+    (*c->count)++;
+    return true;
+}
+
+/**
+ * Read the TCP connections on a port from sock_diag, with their internals
+ *
+ * One dump per address family returns every TCP socket on the port together
+ * with its tcp_info and memory counters, so the cost does not grow with
+ * per-socket system calls even with tens of thousands of connections.
+ * Nothing is appended unless both dumps succeed.
+ *
+ * @param port Port number to query
+ * @param collect Result array and inode map to resolve owners with (the
+ *        backlogs are not used; collect->failed is set if memory runs out)
+ * @return 0 on success, -1 if sock_diag is unavailable or memory is exhausted
+ */
+static int diag_tcp_connections(int port, conn_collect_t *collect) {
+    static const int families[] = { AF_INET, AF_INET6 };
+    const int start = *collect->count;
+
+    for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+        if (sockdiag_dump(families[f], IPPROTO_TCP, SOCKDIAG_ALL_STATES,
+                          SOCKDIAG_EXT_TCP_INFO | SOCKDIAG_EXT_MEMINFO, port,
+                          collect_connection, collect) < 0 || collect->failed) {
+            *collect->count = start;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Socket tables a port's connections come from, TCP before UDP */
+static const struct {
+    int family;
+    int protocol;
+} port_tables[] = {
+    {AF_INET, IPPROTO_TCP}, {AF_INET6, IPPROTO_TCP},
+    {AF_INET, IPPROTO_UDP}, {AF_INET6, IPPROTO_UDP},
+};
+#define PORT_TABLE_COUNT ((int)(sizeof(port_tables) / sizeof(port_tables[0])))
+#define PORT_TABLE_FIRST_UDP 2
+
+/**
+ * Get all connections on a specific port (Linux)
+ *
+ * Retrieves all TCP and UDP (IPv4 and IPv6) endpoints using the specified
+ * port into a single array, reading the socket tables through the
+ * port-scan backend (see src/backend.c).
+ *
+ * The function:
+ * 1. Allocates the connection array once, sized from /proc/net/sockstat
+ * 2. Builds the socket-inode -> PID map, or reuses opts->inode_cache's
+ *    (rebuilt early if it misses a socket, see inode_cache_revalidate())
+ * 3. If the backend cannot see listen backlogs, asks sock_diag for those
+ *    of the port's TCP listeners
+ * 4. Dumps TCP and UDP (IPv4/IPv6) sockets on the port, appending them to
+ *    that array
+ * 5. Copies the owner lists behind the records and returns the array
+ *    (caller must free)
+ *
+ * With TCP internals requested (opts->tcp_info), TCP sockets come
+ * from sock_diag whatever the backend, in the same dump that carries their
+ * internals; if sock_diag is unavailable the backend is used as usual and
+ * the connections have no internals.
+ *
+ * @param port Port number to query (0 = every port)
+ * @param opts Query settings (socket-owner scan threads, TCP internals)
+ * @param connections Output pointer to dynamically allocated array of connections
+ * @param count Output pointer to total number of connections found
+ * @return 0 on success, -1 if memory is exhausted (errno ENOMEM)
+ */
+int platform_get_port_connections(int port, const platform_options_t *opts,
+                                  connection_info_t **connections, int *count) {
+    int total = 0;
+
+    /*
+     * Size the result once from the kernel's TCP/UDP socket counters. This
+     * over-allocates for typical ports, but pages that are never written are
+     * never faulted in, so the unused tail costs address space only.
+     */
+    int capacity = estimate_socket_count(true);
+    connection_info_t *all_conns = counted_malloc(capacity * sizeof(connection_info_t));
+    if (!all_conns) {
+        return -1;
+    }
+
+    /* Build the socket-inode -> PID map once (or reuse a cached one) for every table */
+    inode_map_t local;
+    const inode_map_t *imap = inode_map_acquire(opts, &local);
+    if (!imap) {
+        free(all_conns);
+        return -1;
+    }
+
+    conn_collect_t collect = { imap, NULL, &all_conns, &total, &capacity, false };
+    const bool tcp_from_diag = opts->tcp_info && diag_tcp_connections(port, &collect) == 0;
+
+    const socket_backend_t *backend = backend_for(BACKEND_OP_PORT_SCAN);
+    const bool lookup_backlogs = !tcp_from_diag && backend && !backend->listen_backlog;
+    backlog_list_t backlogs;
+    memset(&backlogs, 0, sizeof(backlogs));
+    bool failed = collect.failed || (lookup_backlogs && backlog_list_build(port, &backlogs) < 0);
+
+    collect.backlogs = lookup_backlogs ? &backlogs : NULL;
+    for (int t = tcp_from_diag ? PORT_TABLE_FIRST_UDP : 0;
+         !failed && !collect.failed && t < PORT_TABLE_COUNT; t++) {
+        backend_dump(BACKEND_OP_PORT_SCAN, port_tables[t].family, port_tables[t].protocol,
+                     SOCKDIAG_ALL_STATES, port, port, collect_connection, &collect);
+    }
+
+    failed = failed || collect.failed || inode_cache_revalidate(opts, all_conns, total) < 0 ||
+             pack_connection_owners(&all_conns, total) < 0;
+    backlog_list_free(&backlogs);
+    inode_map_release(opts, &local);
+
+    if (failed) {
+        free(all_conns);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    *connections = all_conns;
+    *count = total;
+
+    return 0;
+}
+
+/**
+ * Connections being walked for platform_for_each_port_connection()
+ */
+typedef struct {
+    const inode_map_t *imap;
+    platform_connection_fn fn;
+    void *ctx;
+} conn_walk_t;
+
+/**
+ * Dump callback: hand one socket to the caller as a connection
+ *
+ * @param ctx conn_walk_t
+ * @param sock Socket from the dump
+ * @return true to continue the dump
+ */
+static bool walk_connection(void *ctx, const sockdiag_socket_t *sock) {
+    const conn_walk_t *walk = ctx;
+
+    connection_info_t conn;
+    fill_connection(sock, walk->imap, NULL, &conn);
+    walk->fn(walk->ctx, &conn);
+    return true;
+}
+
+/**
+ * Walk the connections on a port without collecting them (Linux)
+ *
+ * Reads the same tables as platform_get_port_connections() but hands each
+ * connection to fn in a reused record instead of appending it to an array,
+ * so memory stays constant however many connections the port has; an
+ * aggregating caller keeps only its totals. The socket-owner scan only runs
+ * when owners are asked for. TCP internals are not filled in, and backlogs
+ * only where the backend reports them.
+ *
+ * @param port Port number to query
+ * @param opts Query settings (socket-owner scan threads)
+ * @param owners Resolve the owners of each connection (else pid is -1)
+ * @param fn Callback invoked once per connection
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if none of the tables could be read or memory is
+ *         exhausted
+ */
+int platform_for_each_port_connection(int port, const platform_options_t *opts, bool owners,
+                                      platform_connection_fn fn, void *ctx) {
+    inode_map_t imap = { NULL, NULL, NULL, 0 };
+    if (owners && inode_map_build(opts->scan_jobs, &imap) < 0) {
+        return -1;
+    }
+
+    const conn_walk_t walk = { owners ? &imap : NULL, fn, ctx };
+    int tables_read = 0;
+    for (int t = 0; t < PORT_TABLE_COUNT; t++) {
+        if (backend_dump(BACKEND_OP_PORT_SCAN, port_tables[t].family, port_tables[t].protocol,
+                         SOCKDIAG_ALL_STATES, port, port, walk_connection,
+                         (void *)&walk) == 0) {
+            tables_read++;
+        }
+    }
+
+    inode_map_free(&imap);
+    return tables_read > 0 ? 0 : -1;
+}
+
+/* Phases of an incremental port scan, in order */
+typedef enum {
+    PORT_SCAN_LIST,    /* list the PIDs to scan */
+    PORT_SCAN_FDS,     /* read the fd links of one process per unit */
+    PORT_SCAN_SOCKETS, /* sock_diag dumps (TCP internals or backlogs) */
+    PORT_SCAN_TABLES,  /* parse one /proc/net row per unit */
+    PORT_SCAN_DONE
+} port_scan_phase_t;
+
+/**
+ * Incremental port scan (Linux)
+ *
+ * Fields:
+ * - port, tcp_info: Query
+ * - phase: Next piece of work
+ * - pids, pid_count, next_pid: Processes whose fds are still to be read
+ * - links: Socket links found so far; becomes the inode map
+ * - imap, backlogs: Lookups for the table phase
+ * - tcp_from_diag: TCP connections came from sock_diag (skip the TCP tables)
+ * - table, fp: Table being parsed and its open stream (NULL between tables)
+ * - connections, count, capacity: Result array
+ * - failed: Memory ran out; the scan stopped early
+ */
+struct platform_port_scan {
+    int port;
+    bool tcp_info;
+    port_scan_phase_t phase;
+    pid_t *pids;
+    int pid_count;
+    int next_pid;
+    inode_shard_t links;
+    inode_map_t imap;
+    backlog_list_t backlogs;
+    bool tcp_from_diag;
+    int table;
+    FILE *fp;
+    connection_info_t *connections;
+    int count;
+    int capacity;
+    bool failed;
+};
+
+/**
+ * Start an incremental port scan (Linux)
+ *
+ * Nothing is read yet; all work happens in platform_port_scan_step(), so
+ * this returns immediately. The scan gives the same result as
+ * platform_get_port_connections() but runs on the calling thread only
+ * (opts->scan_jobs is ignored).
+ *
+ * @param port Port number to query
+ * @param opts Query settings (only tcp_info is used)
+ * @return New scan (finish with platform_port_scan_end()), or NULL if
+ *         memory is exhausted
+ */
+platform_port_scan_t *platform_port_scan_begin(int port, const platform_options_t *opts) {
+    platform_port_scan_t *scan = counted_calloc(1, sizeof(*scan));
+    if (!scan) {
+        return NULL;
+    }
+    scan->port = port;
+    scan->tcp_info = opts->tcp_info;
+    scan->phase = PORT_SCAN_LIST;
+    return scan;
+}
+
+/**
+ * Parse up to budget rows of the connection tables
+ *
+ * Tables are opened one after another as the previous one runs out; the
+ * open stream is kept between steps.
+ *
+ * @param scan Scan in the table phase
+ * @param budget Most rows to parse
+ * @return Rows parsed (less than budget only once the last table is done,
+ *         or if memory ran out)
+ */
+static int port_scan_tables(platform_port_scan_t *scan, int budget) {
+    int done = 0;
+    char line[512];
+
+    while (done < budget && scan->table < PROC_NET_FILE_COUNT) {
+        const char *filename = proc_net_files[scan->table];
+
+        if (!scan->fp) {
+            scan->fp = fopen(filename, "r");
+            /* Skip header line (and tables that cannot be read) */
+            if (!scan->fp || !fgets(line, sizeof(line), scan->fp)) {
+                if (scan->fp) {
+                    fclose(scan->fp);
+                    scan->fp = NULL;
+                }
+                scan->table++;
+                continue;
+            }
+        }
+
+        if (!fgets(line, sizeof(line), scan->fp)) {
+            fclose(scan->fp);
+            scan->fp = NULL;
+            scan->table++;
+            continue;
+        }
+
+        if (append_proc_net_row(line, strstr(filename, "udp") != NULL,
+                                str_ends_with(filename, "6"), scan->port, &scan->imap,
+                                &scan->backlogs, &scan->connections, &scan->count,
+                                &scan->capacity) < 0) {
+            scan->failed = true;
+            break;
+        }
+        done++;
+    }
+
+    return done;
+}
+
+/**
+ * Do a bounded slice of an incremental port scan (Linux)
+ *
+ * One unit of budget is one process whose fd links are read or one
+ * /proc/net row parsed; listing the PIDs and the sock_diag dumps count as
+ * one unit each. A slice therefore takes time roughly proportional to
+ * budget however large the host is, which lets an event loop interleave a
+ * scan with its other work.
+ *
+ * @param scan Scan from platform_port_scan_begin()
+ * @param budget Units of work to do (values below 1 count as 1)
+ * @return 1 if work remains, 0 once the scan is complete (or has stopped
+ *         because memory ran out, which platform_port_scan_end() reports)
+ */
+int platform_port_scan_step(platform_port_scan_t *scan, int budget) {
+    if (budget < 1) {
+        budget = 1;
+    }
+
+    while (budget > 0 && scan->phase != PORT_SCAN_DONE) {
+        switch (scan->phase) {
+            case PORT_SCAN_LIST:
+                /* Same sizing as platform_get_port_connections() */
+                scan->capacity = estimate_socket_count(true);
+                scan->connections = counted_malloc(scan->capacity * sizeof(connection_info_t));
+                scan->links.capacity = estimate_socket_count(false);
+                scan->links.entries = counted_malloc(scan->links.capacity *
+                                                     sizeof(inode_pid_entry_t));
+                if (platform_list_pids(&scan->pids, &scan->pid_count) < 0) {
+                    scan->failed = errno == ENOMEM;
+                    scan->pid_count = 0;
+                }
+                if (!scan->connections || !scan->links.entries) {
+                    scan->failed = true;
+                }
+                scan->phase = PORT_SCAN_FDS;
+                budget--;
+                break;
+
+            case PORT_SCAN_FDS: {
+                inode_scan_t fds = { scan->pids, &scan->links };
+                while (budget > 0 && scan->next_pid < scan->pid_count) {
+                    inode_scan_fds(NULL, 0, &fds, scan->pids[scan->next_pid++], 0);
+                    budget--;
+                }
+                if (scan->next_pid >= scan->pid_count) {
+                    if (scan->links.failed ||
+                        inode_map_from_links(scan->links.entries, scan->links.count,
+                                             &scan->imap) < 0) {
+                        scan->failed = true;
+                    }
+                    free(scan->links.entries);
+                    scan->links.entries = NULL;
+                    free(scan->pids);
+                    scan->pids = NULL;
+                    scan->phase = PORT_SCAN_SOCKETS;
+                }
+                break;
+            }
+
+            case PORT_SCAN_SOCKETS: {
+                conn_collect_t collect = { &scan->imap, NULL, &scan->connections,
+                                           &scan->count, &scan->capacity, false };
+                scan->tcp_from_diag = scan->tcp_info &&
+                    diag_tcp_connections(scan->port, &collect) == 0;
+                if (collect.failed ||
+                    (!scan->tcp_from_diag &&
+                     backlog_list_build(scan->port, &scan->backlogs) < 0)) {
+                    scan->failed = true;
+                }
+                scan->table = scan->tcp_from_diag ? PROC_NET_FIRST_UDP : 0;
+                scan->phase = PORT_SCAN_TABLES;
+                budget--;
+                break;
+            }
+
+            case PORT_SCAN_TABLES: {
+                const int done = port_scan_tables(scan, budget);
+                budget -= done;
+                if (scan->table >= PROC_NET_FILE_COUNT) {
+                    scan->phase = PORT_SCAN_DONE;
+                }
+                break;
+            }
+
+            case PORT_SCAN_DONE:
+                break;
+        }
+
+        if (scan->failed) {
+            scan->phase = PORT_SCAN_DONE;
+        }
+    }
+
+    return scan->phase == PORT_SCAN_DONE ? 0 : 1;
+}
+
 /**
- * Initialize platform-specific resources
+ * Finish an incremental port scan (Linux)
  *
- * Performs any necessary platform-specific initialization before the application
- * can query process and network information. Currently, both Linux and macOS
- * implementations require no initialization, but this function exists to provide
- * a hook for future platform-specific setup if needed.
+ * Hands over the connections found so far (all of them once
+ * platform_port_scan_step() returned 0) and frees the scan. Passing NULL
+ * for connections abandons the scan and discards them.
  *
- * @return 0 on success (always succeeds in current implementation)
+ * @param scan Scan to finish
+ * @param connections Output: array of connections (caller must free), or NULL
+ * @param count Output: number of connections (ignored if connections is NULL)
+ * @return 0 on success (the tables that can be read always give a result),
+ *         -1 if memory ran out (errno ENOMEM; *connections is NULL)
  */
-int platform_init(void) {
-    /* Currently no initialization needed for either platform */
-    return 0;
+int platform_port_scan_end(platform_port_scan_t *scan, connection_info_t **connections,
+                           int *count) {
+    int result = 0;
+    if (connections) {
+        /* Abandoned before the first step: nothing was allocated yet */
+        *connections = scan->connections ? scan->connections
+                                         : counted_malloc(sizeof(connection_info_t));
+        *count = scan->count;
+        if (scan->failed || !*connections || pack_connection_owners(connections, *count) < 0) {
+            free(*connections);
+            *connections = NULL;
+            *count = 0;
+            result = -1;
+        }
+    } else {
+        free(scan->connections);
+    }
+
+    if (scan->fp) {
+        fclose(scan->fp);
+    }
+    free(scan->pids);
+    free(scan->links.entries);
+    inode_map_free(&scan->imap);
+    backlog_list_free(&scan->backlogs);
+    free(scan);
+    if (result < 0) {
+        errno = ENOMEM;
+    }
+    return result;
 }
 
+/* The TCP/UDP tables walked for per-user and per-process socket counts */
+static const struct {
+    int family;
+    int protocol;
+} inet_tables[] = {
+    {AF_INET, IPPROTO_TCP}, {AF_INET6, IPPROTO_TCP},
+    {AF_INET, IPPROTO_UDP}, {AF_INET6, IPPROTO_UDP},
+};
+
 /**
- * Clean up platform-specific resources
- *
- * Releases any platform-specific resources allocated during application execution.
- * Currently, both Linux and macOS implementations require no cleanup, but this
- * function exists to provide a hook for future platform-specific teardown if needed.
- * Should be called before application exit.
+ * Walk in progress for platform_for_each_socket_uid()
+ */
+typedef struct {
+    platform_socket_uid_fn fn;
+    void *ctx;
+} socket_uid_walk_t;
+
+/**
+ * Table-walk callback: hand the owning UID of one socket to the caller
  *
- * @return void
+ * @param ctx socket_uid_walk_t
+ * @param sock Socket from the dump
+ * @return true to continue the dump
  */
-void platform_cleanup(void) {
-    /* Currently no cleanup needed */
+static bool walk_socket_uid(void *ctx, const sockdiag_socket_t *sock) {
+    const socket_uid_walk_t *walk = ctx;
+    walk->fn(walk->ctx, (int)sock->uid);
+    return true;
 }
 
 /**
- * Get username from UID using system password database
+ * Report the owning UID of every TCP/UDP socket (Linux)
  *
- * Converts a numeric user ID to a human-readable username by querying the
- * system password database. Falls back to displaying the numeric UID if
- * username lookup fails.
+ * Walks every socket through the table-walk backend (see src/backend.c)
+ * and reports the user that created it. No inode resolution is needed, so
+ * this is far cheaper than the fd scan behind port lookups.
  *
- * @param uid User ID to look up
- * @param username Buffer to store the username string
- * @param size Size of username buffer
- * @return void (username is always populated, either with name or numeric UID)
+ * @param fn Callback invoked once per socket with its UID
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if none of the tables could be read
  */
-static void get_username_from_uid(const int uid, char *username, size_t size) {
-    const struct passwd *pw = getpwuid(uid);
-    if (pw) {
-        snprintf(username, size, "%s", pw->pw_name);
-    } else {
-        snprintf(username, size, "%d", uid);
+int platform_for_each_socket_uid(platform_socket_uid_fn fn, void *ctx) {
+    socket_uid_walk_t walk = { fn, ctx };
+    int readable = 0;
+
+    for (size_t t = 0; t < sizeof(inet_tables) / sizeof(inet_tables[0]); t++) {
+        if (backend_dump(BACKEND_OP_TABLE_WALK, inet_tables[t].family, inet_tables[t].protocol,
+                         SOCKDIAG_ALL_STATES, 0, 0, walk_socket_uid, &walk) == 0) {
+            readable++;
+        }
     }
+
+    return readable > 0 ? 0 : -1;
 }
 
-/* ============================================================================
- * LINUX IMPLEMENTATION
- * ============================================================================ */
-#ifdef __linux__
+/**
+ * Walk in progress for platform_for_each_socket_pid()
+ */
+typedef struct {
+    const inode_map_t *imap;
+    platform_socket_pid_fn fn;
+    void *ctx;
+} socket_pid_walk_t;
 
-/*
- * Mapping from socket inode to owning PID.
+/**
+ * Table-walk callback: hand every owner of one socket to the caller
  *
- * Building this once and reusing it for every parsed connection avoids the
- * previous O(connections x processes x fds) behaviour, where /proc/<pid>/fd
- * was rescanned in full for each connection found.
+ * @param ctx socket_pid_walk_t
+ * @param sock Socket from the dump
+ * @return true to continue the dump
  */
-typedef struct {
-    unsigned long inode;
-    pid_t pid;
-} inode_pid_entry_t;
+static bool walk_socket_pid(void *ctx, const sockdiag_socket_t *sock) {
+    const socket_pid_walk_t *walk = ctx;
+    const pid_t *owners = NULL;
+    const int count = inode_map_owners(walk->imap, sock->inode, &owners);
 
-typedef struct {
-    inode_pid_entry_t *entries;
-    int count;
-} inode_map_t;
+    for (int i = 0; i < count; i++) {
+        walk->fn(walk->ctx, owners[i]);
+    }
+    return true;
+}
 
 /**
- * Build a socket-inode -> PID map by scanning the fd links under /proc (Linux)
+ * Report every process holding each TCP/UDP socket (Linux)
  *
- * Walks every numeric /proc directory and reads its fd symlinks, recording an
- * entry for each "socket:[inode]" link. The resulting map is used to resolve
- * the owning process of a connection in a single linear lookup instead of
- * rescanning /proc per connection.
+ * Builds the socket inode map once (see inode_map_build()), then walks the
+ * same tables as platform_for_each_socket_uid() and reports each socket
+ * once per process holding it. Sockets no process holds (TIME_WAIT) are
+ * not reported.
  *
- * @param map Output map to populate (caller must free with inode_map_free)
+ * @param opts Query settings (scan_jobs for the fd scan)
+ * @param fn Callback invoked once per socket and owning process
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if none of the tables could be read or memory is
+ *         exhausted
  */
-static void inode_map_build(inode_map_t *map) {
-    map->entries = NULL;
-    map->count = 0;
-
-    DIR *proc_dir = opendir("/proc");
-    if (!proc_dir) {
-        return;
+int platform_for_each_socket_pid(const platform_options_t *opts, platform_socket_pid_fn fn,
+                                 void *ctx) {
+    inode_map_t imap;
+    if (inode_map_build(opts->scan_jobs, &imap) < 0) {
+        return -1;
     }
 
-    int capacity = 64;
-    map->entries = safe_malloc(capacity * sizeof(inode_pid_entry_t));
-
-    struct dirent *proc_entry;
-    while ((proc_entry = readdir(proc_dir)) != NULL) {
-        /* Skip non-numeric directories */
-        if (proc_entry->d_name[0] < '0' || proc_entry->d_name[0] > '9') {
-            continue;
-        }
-
-        /* Sized so d_name (up to 255 bytes) can never truncate (-Wformat-truncation) */
-        char fd_path[512];
-        snprintf(fd_path, sizeof(fd_path), "/proc/%s/fd", proc_entry->d_name);
-
-        DIR *fd_dir = opendir(fd_path);
-        if (!fd_dir) {
-            continue;
-        }
-
-        const pid_t pid = atoi(proc_entry->d_name);
-
-        struct dirent *fd_entry;
-        while ((fd_entry = readdir(fd_dir)) != NULL) {
-            char link_path[1024];
-            char link_target[512];
-            snprintf(link_path, sizeof(link_path), "%s/%s", fd_path, fd_entry->d_name);
-
-            ssize_t len = readlink(link_path, link_target, sizeof(link_target) - 1);
-            if (len <= 0) {
-                continue;
-            }
-            link_target[len] = '\0';
-
-            unsigned long inode;
-            if (sscanf(link_target, "socket:[%lu]", &inode) != 1) {
-                continue;
-            }
+    socket_pid_walk_t walk = { &imap, fn, ctx };
+    int readable = 0;
 
-            if (map->count >= capacity) {
-                capacity *= 2;
-                map->entries = safe_realloc(map->entries,
-                                            capacity * sizeof(inode_pid_entry_t));
-            }
-            map->entries[map->count].inode = inode;
-            map->entries[map->count].pid = pid;
-            map->count++;
+    for (size_t t = 0; t < sizeof(inet_tables) / sizeof(inet_tables[0]); t++) {
+        if (backend_dump(BACKEND_OP_TABLE_WALK, inet_tables[t].family, inet_tables[t].protocol,
+                         SOCKDIAG_ALL_STATES, 0, 0, walk_socket_pid, &walk) == 0) {
+            readable++;
         }
-        closedir(fd_dir);
     }
 
-    closedir(proc_dir);
+    inode_map_free(&imap);
+    return readable > 0 ? 0 : -1;
 }
 
 /**
- * Free an inode->PID map built by inode_map_build
+ * Stop a dump at the first socket (port probe)
+ *
+ * @param ctx bool set to true once a socket is seen
+ * @param sock Socket found (unused)
+ * @return false, ending the dump
  */
-static void inode_map_free(inode_map_t *map) {
-    free(map->entries);
-    map->entries = NULL;
-    map->count = 0;
+static bool note_bound(void *ctx, const sockdiag_socket_t *sock) {
+    (void)sock;
+    *(bool *)ctx = true;
+    return false;
 }
 
 /**
- * Resolve the PID owning a given socket inode, or -1 if not found
+ * Check whether anything is bound to a port (Linux)
+ *
+ * A port counts as bound while a TCP socket listens on it or a UDP socket
+ * is bound to it, i.e. while a server could not take it over. Sockets in
+ * TIME_WAIT or accepted connections left behind by a stopped server do not
+ * count: they do not keep a new listener (with SO_REUSEADDR) from binding.
+ *
+ * Cheap enough to poll every few milliseconds: no socket inode is ever
+ * resolved to a process. Each family/protocol is asked through the
+ * port-probe backend (see src/backend.c); with sock_diag the port filter is
+ * applied in the kernel and TCP asks for listeners only, so the kernel never
+ * walks the established-connection table. The /proc/net backend reads every
+ * row, without the inode map.
+ *
+ * @param port Port number to check
+ * @param bound Output: true if the port is bound
+ * @return 0 on success, -1 if the socket tables cannot be read
  */
-static pid_t inode_map_lookup(const inode_map_t *map, unsigned long inode) {
-    for (int i = 0; i < map->count; i++) {
-        if (map->entries[i].inode == inode) {
-            return map->entries[i].pid;
+int platform_port_bound(int port, bool *bound) {
+    static const struct {
+        int family;
+        int protocol;
+        unsigned int states;
+    } queries[] = {
+        {AF_INET, IPPROTO_TCP, SOCKDIAG_STATE(SOCKDIAG_LISTEN)},
+        {AF_INET6, IPPROTO_TCP, SOCKDIAG_STATE(SOCKDIAG_LISTEN)},
+        {AF_INET, IPPROTO_UDP, SOCKDIAG_ALL_STATES},
+        {AF_INET6, IPPROTO_UDP, SOCKDIAG_ALL_STATES},
+    };
+
+    *bound = false;
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]) && !*bound; q++) {
+        if (backend_dump(BACKEND_OP_PORT_PROBE, queries[q].family, queries[q].protocol,
+                         queries[q].states, port, port, note_bound, bound) < 0) {
+            return -1;
         }
     }
-    return -1;
+
+    return 0;
 }
 
 /**
- * Parse a /proc/net/{tcp,tcp6,udp,udp6} file for connections on a port (Linux)
- *
- * Reads and parses one Linux /proc/net protocol file to find all network
- * endpoints using a specific local port. For each matching entry the socket
- * inode is resolved to the owning PID via a prebuilt inode->PID map.
- *
- * The function:
- * 1. Parses each line (format: sl, local_address, rem_address, st, ..., inode)
- * 2. Filters entries matching the target local port
- * 3. Converts hex addresses to dotted decimal notation (IPv4)
- * 4. Decodes TCP connection states; UDP has no connection state ("-")
- * 5. Resolves the owning PID via inode_map_lookup (O(1) amortized, no rescan)
+ * Map a state name to its kernel TCP state number
  *
- * @param filename Path to /proc/net file (tcp, tcp6, udp or udp6)
- * @param target_port Port number to search for
- * @param imap Prebuilt inode->PID map used to resolve owning processes
- * @param connections Output pointer to dynamically allocated array of connections
- * @param count Output pointer to number of connections found
- * @return 0 on success, -1 if file cannot be opened
+ * @param name State name as printed (e.g. "LISTEN")
+ * @return State number, or -1 if no TCP state has that name
  */
-static int parse_proc_net(const char *filename, int target_port,
-                          const inode_map_t *imap,
-                          connection_info_t **connections, int *count) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        return -1;
+static int tcp_state_number(const char *name) {
+    for (int state = 0x01; state <= 0x0B; state++) {
+        if (strcmp(tcp_state_name(state), name) == 0) {
+            return state;
+        }
     }
+    return -1;
+}
 
-    const bool is_udp = strstr(filename, "udp") != NULL;
-    const bool is_v6 = str_ends_with(filename, "6");
+/**
+ * Dump in progress for platform_for_each_port_socket()
+ */
+typedef struct {
+    platform_port_socket_fn fn;
+    void *ctx;
+    bool stopped;
+} port_socket_walk_t;
 
-    *connections = NULL;
-    *count = 0;
-    int capacity = 10;
-    *connections = safe_malloc(capacity * sizeof(connection_info_t));
+/**
+ * Backend callback: hand one socket to the caller's callback
+ *
+ * @param ctx port_socket_walk_t
+ * @param sock Socket from the dump
+ * @return false once the caller asked to stop
+ */
+static bool walk_port_socket(void *ctx, const sockdiag_socket_t *sock) {
+    port_socket_walk_t *walk = ctx;
+    const bool udp = sock->protocol == IPPROTO_UDP;
+
+    port_socket_t ps;
+    memset(&ps, 0, sizeof(ps));
+    snprintf(ps.protocol, sizeof(ps.protocol), "%s%s", udp ? "UDP" : "TCP",
+             sock->family == AF_INET6 ? "6" : "");
+    strcpy(ps.state, udp ? "-" : tcp_state_name(sock->state));
+    ps.uid = (int)sock->uid;
+    ps.inode = sock->inode;
+    ps.pid = -1;
+
+    walk->stopped = !walk->fn(walk->ctx, &ps);
+    return !walk->stopped;
+}
 
-    char line[512];
-    /* Skip header line */
-    if (!fgets(line, sizeof(line), fp)) {
-        fclose(fp);
+/**
+ * Walk the sockets bound to a port, stopping when the callback says so (Linux)
+ *
+ * Built for yes/no probes: sockets are produced one at a time through the
+ * port-probe backend (see src/backend.c) and nothing is resolved to a
+ * process. Through sock_diag the port (and, for TCP, the state) is filtered
+ * in the kernel, so a probe for a listener never walks the
+ * established-connection table; /proc/net is only read until the callback
+ * stops the walk. The owning PID is left at -1; see
+ * platform_process_has_socket().
+ *
+ * @param port Port number
+ * @param state TCP state name to match (NULL for any); UDP sockets, which
+ *              have no state ("-"), are only reported for NULL
+ * @param fn Callback invoked per socket; returning false ends the walk
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if the socket tables cannot be read
+ */
+int platform_for_each_port_socket(int port, const char *state,
+                                  platform_port_socket_fn fn, void *ctx) {
+    const int state_number = state ? tcp_state_number(state) : -1;
+    if (state && state_number < 0) {
         return 0;
     }
 
-    while (fgets(line, sizeof(line), fp)) {
-        unsigned long local_addr, remote_addr, inode;
-        int local_port, remote_port, state;
-        int uid;
-
-        /* Parse the line - format varies but generally:
-         * sl local_address rem_address st tx_queue rx_queue tr tm->when retrnsmt uid timeout inode
-         */
-        int matched = sscanf(line, "%*d: %lx:%x %lx:%x %x %*x:%*x %*x:%*x %*x %d %*d %lu",
-                           &local_addr, &local_port, &remote_addr, &remote_port,
-                           &state, &uid, &inode);
-
-        if (matched < 7) {
-            continue;
-        }
+    static const struct {
+        int family;
+        int protocol;
+    } queries[] = {
+        {AF_INET, IPPROTO_TCP}, {AF_INET6, IPPROTO_TCP},
+        {AF_INET, IPPROTO_UDP}, {AF_INET6, IPPROTO_UDP},
+    };
+    const unsigned int states = state ? SOCKDIAG_STATE(state_number) : SOCKDIAG_ALL_STATES;
+    port_socket_walk_t walk = { fn, ctx, false };
+    int readable = 0;
 
-        /* Check if this matches our target port */
-        if (local_port != target_port) {
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]) && !walk.stopped; q++) {
+        if (queries[q].protocol == IPPROTO_UDP && state) {
             continue;
         }
 
-        /* Expand array if needed */
-        if (*count >= capacity) {
-            capacity *= 2;
-            *connections = safe_realloc(*connections, capacity * sizeof(connection_info_t));
+        if (backend_dump(BACKEND_OP_PORT_PROBE, queries[q].family, queries[q].protocol,
+                         states, port, port, walk_port_socket, &walk) == 0) {
+            readable++;
         }
+    }
 
-        connection_info_t *conn = &(*connections)[*count];
-        memset(conn, 0, sizeof(*conn));
-
-        /* Convert addresses from hex to dotted decimal (IPv4) */
-        snprintf(conn->local_addr, sizeof(conn->local_addr),
-                "%lu.%lu.%lu.%lu",
-                (local_addr) & 0xFF,
-                (local_addr >> 8) & 0xFF,
-                (local_addr >> 16) & 0xFF,
-                (local_addr >> 24) & 0xFF);
-
-        snprintf(conn->remote_addr, sizeof(conn->remote_addr),
-                "%lu.%lu.%lu.%lu",
-                (remote_addr) & 0xFF,
-                (remote_addr >> 8) & 0xFF,
-                (remote_addr >> 16) & 0xFF,
-                (remote_addr >> 24) & 0xFF);
+    return readable > 0 || walk.stopped ? 0 : -1;
+}
 
-        conn->local_port = local_port;
-        conn->remote_port = remote_port;
+/**
+ * Read the ephemeral port range from ip_local_port_range (Linux)
+ *
+ * The IPv4 setting applies to IPv6 as well.
+ *
+ * @param low Output: first port handed out for outgoing connections
+ * @param high Output: last port
+ * @return 0 on success, -1 if the setting cannot be read
+ */
+int platform_ephemeral_port_range(int *low, int *high) {
+    FILE *fp = fopen("/proc/sys/net/ipv4/ip_local_port_range", "r");
+    if (!fp) {
+        return -1;
+    }
 
-        /* Decode connection state (TCP only; UDP is connectionless) */
-        if (is_udp) {
-            strcpy(conn->state, "-");
-        } else {
-            switch (state) {
-                case 0x01: strcpy(conn->state, "ESTABLISHED"); break;
-                case 0x02: strcpy(conn->state, "SYN_SENT"); break;
-                case 0x03: strcpy(conn->state, "SYN_RECV"); break;
-                case 0x04: strcpy(conn->state, "FIN_WAIT1"); break;
-                case 0x05: strcpy(conn->state, "FIN_WAIT2"); break;
-                case 0x06: strcpy(conn->state, "TIME_WAIT"); break;
-                case 0x07: strcpy(conn->state, "CLOSE"); break;
-                case 0x08: strcpy(conn->state, "CLOSE_WAIT"); break;
-                case 0x09: strcpy(conn->state, "LAST_ACK"); break;
-                case 0x0A: strcpy(conn->state, "LISTEN"); break;
-                case 0x0B: strcpy(conn->state, "CLOSING"); break;
-                default: strcpy(conn->state, "UNKNOWN"); break;
-            }
-        }
+    const int matched = fscanf(fp, "%d %d", low, high);
+    fclose(fp);
+    return matched == 2 && *low > 0 && *low <= *high && *high <= 65535 ? 0 : -1;
+}
 
-        snprintf(conn->protocol, sizeof(conn->protocol), "%s%s",
-                 is_udp ? "UDP" : "TCP", is_v6 ? "6" : "");
+/**
+ * TCP endpoint walk in progress
+ */
+typedef struct {
+    platform_tcp_endpoint_fn fn;
+    void *ctx;
+} tcp_endpoint_walk_t;
 
-        /* Resolve the owning PID via the prebuilt inode map */
-        conn->pid = inode_map_lookup(imap, inode);
+/**
+ * Backend callback: report one TCP socket as an endpoint
+ *
+ * @param ctx tcp_endpoint_walk_t
+ * @param sock Socket from the dump
+ * @return true to continue the dump
+ */
+static bool walk_tcp_endpoint(void *ctx, const sockdiag_socket_t *sock) {
+    const tcp_endpoint_walk_t *walk = ctx;
+
+    tcp_endpoint_t ep;
+    ep.family = sock->family;
+    memcpy(ep.local_addr, sock->local_addr, sizeof(ep.local_addr));
+    memcpy(ep.remote_addr, sock->remote_addr, sizeof(ep.remote_addr));
+    ep.local_port = sock->local_port;
+    ep.remote_port = sock->remote_port;
+    ep.state = tcp_state_name(sock->state);
+
+    walk->fn(walk->ctx, &ep);
+    return true;
+}
 
-        (*count)++;
+/**
+ * Walk every TCP socket whose local port is in a range (Linux)
+ *
+ * One streaming pass per address family through the table-walk backend
+ * (see src/backend.c): with sock_diag the range is filtered in the kernel
+ * and addresses arrive in binary, so nothing is formatted or parsed as text
+ * and no record outlives its callback.
+ *
+ * @param low Lowest local port to report
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if neither family could be read
+ */
+int platform_for_each_tcp_endpoint(int low, int high, platform_tcp_endpoint_fn fn, void *ctx) {
+    static const int families[] = { AF_INET, AF_INET6 };
+    const tcp_endpoint_walk_t walk = { fn, ctx };
+    int readable = 0;
+
+    for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+        if (backend_dump(BACKEND_OP_TABLE_WALK, families[f], IPPROTO_TCP, SOCKDIAG_ALL_STATES,
+                         low, high, walk_tcp_endpoint, (void *)&walk) == 0) {
+            readable++;
+        }
     }
 
-    fclose(fp);
-    return 0;
+    return readable > 0 ? 0 : -1;
 }
 
 /**
- * Get all connections on a specific port (Linux)
+ * Check whether a process holds a socket (Linux)
  *
- * Retrieves all TCP and TCP6 network connections using the specified port by
- * parsing /proc/net/tcp and /proc/net/tcp6 files. Combines results from both
- * IPv4 and IPv6 connections into a single array.
- *
- * The function:
- * 1. Parses /proc/net/tcp for IPv4 connections
- * 2. Parses /proc/net/tcp6 for IPv6 connections
- * 3. Merges both results into a single output array
- * 4. Allocates memory for the connection array (caller must free)
+ * Reads only that process's fd links, stopping at the first link to the
+ * socket's inode, instead of building the system-wide inode map.
  *
- * @param port Port number to query
- * @param connections Output pointer to dynamically allocated array of connections
- * @param count Output pointer to total number of connections found
- * @return 0 on success
+ * @param pid Process to check
+ * @param sock Socket from platform_for_each_port_socket()
+ * @return true if one of the process's descriptors is the socket
  */
-int platform_get_port_connections(int port, connection_info_t **connections, int *count) {
-    int total = 0;
-    connection_info_t *all_conns = NULL;
+bool platform_process_has_socket(pid_t pid, const port_socket_t *sock) {
+    char fd_path[32];
+    snprintf(fd_path, sizeof(fd_path), "/proc/%d/fd", pid);
 
-    /* Build the socket-inode -> PID map once and reuse it for every file */
-    inode_map_t imap;
-    inode_map_build(&imap);
+    DIR *dir = opendir(fd_path);
+    if (!dir) {
+        return false;
+    }
 
-    /* Parse TCP (IPv4/IPv6) and UDP (IPv4/IPv6) endpoints on the target port */
-    static const char *proc_files[] = {
-        "/proc/net/tcp", "/proc/net/tcp6",
-        "/proc/net/udp", "/proc/net/udp6",
-    };
+    char want[32];
+    const int want_len = snprintf(want, sizeof(want), "socket:[%lu]", sock->inode);
 
-    for (size_t f = 0; f < sizeof(proc_files) / sizeof(proc_files[0]); f++) {
-        connection_info_t *conns = NULL;
-        int conn_count = 0;
-        if (parse_proc_net(proc_files[f], port, &imap, &conns, &conn_count) == 0) {
-            all_conns = safe_realloc(all_conns,
-                                     (total + conn_count) * sizeof(connection_info_t));
-            memcpy(all_conns + total, conns, conn_count * sizeof(connection_info_t));
-            total += conn_count;
+    bool found = false;
+    struct dirent *entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
         }
-        free(conns);
-    }
-
-    inode_map_free(&imap);
 
-    *connections = all_conns;
-    *count = total;
+        char link_target[64];
+        const ssize_t len = readlinkat(dirfd(dir), entry->d_name, link_target,
+                                       sizeof(link_target));
+        found = len == want_len && memcmp(link_target, want, (size_t)len) == 0;
+    }
 
-    return 0;
+    closedir(dir);
+    return found;
 }
 
 /**
- * Get information about a process (Linux)
+ * Get selected information about a process (Linux)
  *
  * Retrieves comprehensive process information by reading multiple files in /proc/<pid>/.
  * Gathers details about process state, parent, user, memory usage, command line, and
@@ -368,10 +2076,11 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
  *
  * Data sources:
  * - /proc/<pid>/stat: PID, name, state, PPID, start time (in ticks)
- * - /proc/stat: System boot time (btime) for calculating absolute start time
+ * - /proc/stat: System boot time (btime, cached by platform_init) for
+ *   calculating absolute start time
  * - /proc/<pid>/status: UID, virtual memory size (VmSize), resident memory (VmRSS)
  * - /proc/<pid>/cmdline: Full command line with arguments
- * - getpwuid(): Username lookup from UID
+ * - usercache_lookup(): Username lookup from UID (/etc/passwd, then NSS)
  *
  * The function handles:
  * - Converting tick-based start time to Unix timestamp
@@ -379,11 +2088,15 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
  * - Trimming trailing whitespace
  * - Graceful handling of missing or inaccessible files
  *
+ * Only the files backing the requested sources are read; fields whose source
+ * was not requested are left zeroed. /proc/<pid>/stat is always read.
+ *
  * @param pid Process ID to query
  * @param info Pointer to process_info_t structure to populate
+ * @param sources Bitmask of PROC_SRC_* flags to read
  * @return 0 on success, -1 if process doesn't exist or /proc/<pid>/stat cannot be read
  */
-int platform_get_process_info(pid_t pid, process_info_t *info) {
+int platform_get_process_fields(pid_t pid, process_info_t *info, unsigned int sources) {
     memset(info, 0, sizeof(*info));
     info->pid = pid;
 
@@ -411,34 +2124,26 @@ int platform_get_process_info(pid_t pid, process_info_t *info) {
 
     snprintf(info->name, sizeof(info->name), "%s", name);
 
-    /* Calculate process start time */
-    /* Get system boot time from /proc/stat */
-    time_t boot_time = 0;
-    fp = fopen("/proc/stat", "r");
-    if (fp) {
-        char line[256];
-        while (fgets(line, sizeof(line), fp)) {
-            if (strncmp(line, "btime ", 6) == 0) {
-                sscanf(line + 6, "%ld", &boot_time);
-                break;
-            }
-        }
-        fclose(fp);
+    if (sources & PROC_SRC_USER) {
+        sources |= PROC_SRC_STATUS;
     }
 
-    /* Convert ticks to seconds and add to boot time */
-    long ticks_per_sec = sysconf(_SC_CLK_TCK);
-    if (ticks_per_sec > 0 && boot_time > 0) {
-        info->start_time = boot_time + (starttime_ticks / ticks_per_sec);
-    } else {
-        info->start_time = 0;
+    /* Calculate process start time */
+    if (sources & PROC_SRC_START) {
+        /* Convert ticks to seconds and add to boot time (see platform_init) */
+        long ticks_per_sec = sysconf(_SC_CLK_TCK);
+        if (ticks_per_sec > 0 && boot_time > 0) {
+            info->start_time = boot_time + (starttime_ticks / ticks_per_sec);
+        } else {
+            info->start_time = 0;
+        }
     }
 
     /* Read /proc/[pid]/status for UID and memory info */
     char status_path[64];
     snprintf(status_path, sizeof(status_path), "/proc/%d/status", pid);
 
-    fp = fopen(status_path, "r");
+    fp = (sources & PROC_SRC_STATUS) ? fopen(status_path, "r") : NULL;
     if (fp) {
         char line[256];
         while (fgets(line, sizeof(line), fp)) {
@@ -454,13 +2159,15 @@ int platform_get_process_info(pid_t pid, process_info_t *info) {
     }
 
     /* Get username */
-    get_username_from_uid(info->uid, info->username, sizeof(info->username));
+    if (sources & PROC_SRC_USER) {
+        get_username_from_uid(info->uid, info->username, sizeof(info->username));
+    }
 
     /* Read /proc/[pid]/cmdline */
     char cmdline_path[64];
     snprintf(cmdline_path, sizeof(cmdline_path), "/proc/%d/cmdline", pid);
 
-    fp = fopen(cmdline_path, "r");
+    fp = (sources & PROC_SRC_CMDLINE) ? fopen(cmdline_path, "r") : NULL;
     if (fp) {
         size_t n = fread(info->cmdline, 1, sizeof(info->cmdline) - 1, fp);
         info->cmdline[n] = '\0';
@@ -501,6 +2208,7 @@ int platform_get_process_info(pid_t pid, process_info_t *info) {
  * @param env_vars Output pointer to dynamically allocated array of environment variable strings
  * @param count Output pointer to number of environment variables found
  * @return 0 on success, -1 if /proc/<pid>/environ cannot be opened (permission denied or process doesn't exist)
+ *         or memory is exhausted (errno ENOMEM)
  */
 int platform_get_process_env(pid_t pid, char ***env_vars, int *count) {
     char env_path[64];
@@ -514,12 +2222,22 @@ int platform_get_process_env(pid_t pid, char ***env_vars, int *count) {
     /* Read procfs files incrementally: ftell() is not reliable for /proc */
     size_t capacity = 4096;
     size_t n = 0;
-    char *buffer = safe_malloc(capacity);
+    char *buffer = counted_malloc(capacity);
+    if (!buffer) {
+        fclose(fp);
+        return -1;
+    }
 
     while (!feof(fp)) {
         if (n == capacity) {
+            char *grown = counted_realloc(buffer, capacity * 2);
+            if (!grown) {
+                free(buffer);
+                fclose(fp);
+                return -1;
+            }
+            buffer = grown;
             capacity *= 2;
-            buffer = safe_realloc(buffer, capacity);
         }
 
         size_t bytes_read = fread(buffer + n, 1, capacity - n, fp);
@@ -532,11 +2250,16 @@ int platform_get_process_env(pid_t pid, char ***env_vars, int *count) {
         }
     }
 
+    fclose(fp);
     if (n == capacity) {
-        buffer = safe_realloc(buffer, capacity + 1);
+        char *grown = counted_realloc(buffer, capacity + 1);
+        if (!grown) {
+            free(buffer);
+            return -1;
+        }
+        buffer = grown;
     }
     buffer[n] = '\0';
-    fclose(fp);
 
     /* Count environment variables (separated by null bytes) */
     *count = 0;
@@ -547,7 +2270,11 @@ int platform_get_process_env(pid_t pid, char ***env_vars, int *count) {
     }
 
     /* Allocate array */
-    *env_vars = safe_malloc(*count * sizeof(char *));
+    *env_vars = counted_malloc((size_t)(*count > 0 ? *count : 1) * sizeof(char *));
+    if (!*env_vars) {
+        free(buffer);
+        return -1;
+    }
 
     /* Split into individual strings */
     int idx = 0;
@@ -555,7 +2282,14 @@ int platform_get_process_env(pid_t pid, char ***env_vars, int *count) {
     for (size_t i = 0; i <= n; i++) {
         if (buffer[i] == '\0' && start < buffer + n) {
             if (*start) {
-                (*env_vars)[idx++] = safe_strdup(start);
+                (*env_vars)[idx] = counted_strdup(start);
+                if (!(*env_vars)[idx]) {
+                    platform_free_env_vars(*env_vars, idx);
+                    free(buffer);
+                    errno = ENOMEM;
+                    return -1;
+                }
+                idx++;
             }
             start = buffer + i + 1;
         }
@@ -615,14 +2349,129 @@ static void parse_lsof_name(const char *name, connection_info_t *conn) {
     }
 }
 
-static void append_lsof_connection(connection_info_t **connections, int *count,
-                                   int *capacity, const connection_info_t *current) {
+static int append_lsof_connection(connection_info_t **connections, int *count,
+                                  int *capacity, const connection_info_t *current) {
     if (*count >= *capacity) {
+        connection_info_t *grown = counted_realloc(*connections, (size_t)*capacity * 2 *
+                                                                     sizeof(connection_info_t));
+        if (!grown) {
+            return -1;
+        }
+        *connections = grown;
         *capacity *= 2;
-        *connections = safe_realloc(*connections, *capacity * sizeof(connection_info_t));
     }
 
     memcpy(&(*connections)[(*count)++], current, sizeof(*current));
+    return 0;
+}
+
+/**
+ * Order lsof connections by protocol, endpoints and state
+ *
+ * @return 0 if both rows describe the same socket
+ */
+static int compare_lsof_sockets(const connection_info_t *x, const connection_info_t *y) {
+    int cmp;
+
+    if ((cmp = strcmp(x->protocol, y->protocol)) != 0 ||
+        (cmp = strcmp(x->local_addr, y->local_addr)) != 0 ||
+        (cmp = strcmp(x->remote_addr, y->remote_addr)) != 0 ||
+        (cmp = strcmp(x->state, y->state)) != 0) {
+        return cmp;
+    }
+    if (x->local_port != y->local_port) {
+        return x->local_port - y->local_port;
+    }
+    return x->remote_port - y->remote_port;
+}
+
+/**
+ * qsort comparator: lsof connections by socket, then PID
+ */
+static int compare_lsof_connections(const void *a, const void *b) {
+    const connection_info_t *x = a;
+    const connection_info_t *y = b;
+    const int cmp = compare_lsof_sockets(x, y);
+    return cmp != 0 ? cmp : (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+/**
+ * Merge the lsof rows of sockets held by several processes (macOS)
+ *
+ * lsof prints a shared socket once per process holding it. lsof's field
+ * output has no socket identity to merge on, so rows with the same
+ * protocol, endpoints and state are taken to be one socket, with one owner
+ * per row; the owner lists are then packed behind the records.
+ *
+ * @param connections In/out: connection array (may move)
+ * @param count In/out: number of connections
+ * @return 0 on success, -1 if memory is exhausted
+ */
+static int merge_lsof_owners(connection_info_t **connections, int *count) {
+    connection_info_t *conns = *connections;
+    pid_t *pids = counted_malloc((size_t)(*count > 0 ? *count : 1) * sizeof(pid_t));
+    if (!pids) {
+        return -1;
+    }
+
+    qsort(conns, (size_t)*count, sizeof(*conns), compare_lsof_connections);
+
+    int merged = 0;
+    int owners = 0;
+    for (int i = 0; i < *count; i++) {
+        if (merged > 0 && compare_lsof_sockets(&conns[merged - 1], &conns[i]) == 0) {
+            /* Same socket, another owner (rows are sorted by PID) */
+            if (pids[owners - 1] != conns[i].pid) {
+                pids[owners++] = conns[i].pid;
+                conns[merged - 1].owner_count++;
+            }
+            continue;
+        }
+
+        conns[merged] = conns[i];
+        conns[merged].owners = &pids[owners];
+        conns[merged].owner_count = 1;
+        pids[owners++] = conns[i].pid;
+        merged++;
+    }
+
+    *count = merged;
+    const int result = pack_connection_owners(connections, merged);
+    free(pids);
+    return result;
+}
+
+/* lsof resolves owners itself, so there is no map to keep (macOS) */
+struct platform_inode_cache {
+    int ttl_ms;
+};
+
+/**
+ * Create a socket owner cache (macOS)
+ *
+ * Port lookups ask lsof for the owners directly, so the cache holds
+ * nothing; it exists so callers need no platform checks.
+ *
+ * @param ttl_ms How long a map would be reused, in milliseconds
+ * @return New cache (free with platform_inode_cache_free())
+ */
+platform_inode_cache_t *platform_inode_cache_new(int ttl_ms) {
+    platform_inode_cache_t *cache = counted_malloc(sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->ttl_ms = ttl_ms;
+    return cache;
+}
+
+/**
+ * Free a socket owner cache (macOS)
+ *
+ * @param cache Cache to free (NULL is ignored)
+ * @return void
+ */
+void platform_inode_cache_free(platform_inode_cache_t *cache) {
+    free(cache);
 }
 
 /**
@@ -637,21 +2486,35 @@ static void append_lsof_connection(connection_info_t **connections, int *count,
  *    - 'p' lines: Process ID
  *    - 'c' lines: Command name (not used)
  *    - 'n' lines: Network address
+ *    - 'T' lines: TCP state (ST=) and queue lengths (QR=, QS=, from -T qs)
  * 3. Builds connection_info_t structures from parsed data
- * 4. Returns dynamically allocated array (caller must free)
+ * 4. Merges the rows of a socket shared by several processes
+ * 5. Returns dynamically allocated array (caller must free)
  *
  * Note: This is a simplified implementation using lsof as a fallback since
  * direct sysctl access for network connections on macOS is complex.
  *
- * @param port Port number to query
+ * None of the settings in opts apply: lsof does the owner lookup itself
+ * and has no TCP internals to offer.
+ *
+ * @param port Port number to query (0 = every port)
+ * @param opts Query settings (unused on macOS)
  * @param connections Output pointer to dynamically allocated array of connections
  * @param count Output pointer to number of connections found
- * @return 0 on success, -1 if popen fails
+ * @return 0 on success, -1 if popen fails or memory is exhausted
  */
-int platform_get_port_connections(int port, connection_info_t **connections, int *count) {
+int platform_get_port_connections(int port, const platform_options_t *opts,
+                                  connection_info_t **connections, int *count) {
+    (void)opts;
+
     /* On macOS, we use lsof as a fallback since direct sysctl for network is complex */
     char cmd[256];
-    snprintf(cmd, sizeof(cmd), "lsof -nP -iTCP:%d -iUDP:%d -F pPnT 2>/dev/null", port, port);
+    if (port > 0) {
+        snprintf(cmd, sizeof(cmd), "lsof -nP -iTCP:%d -iUDP:%d -T qs -F pPnT 2>/dev/null",
+                 port, port);
+    } else {
+        snprintf(cmd, sizeof(cmd), "lsof -nP -iTCP -iUDP -T qs -F pPnT 2>/dev/null");
+    }
 
     FILE *fp = popen(cmd, "r");
     if (!fp) {
@@ -661,7 +2524,8 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
     *connections = NULL;
     *count = 0;
     int capacity = 10;
-    *connections = safe_malloc(capacity * sizeof(connection_info_t));
+    *connections = counted_malloc(capacity * sizeof(connection_info_t));
+    bool failed = !*connections;
 
     connection_info_t current;
     memset(&current, 0, sizeof(current));
@@ -672,10 +2536,14 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
         /* Remove newline */
         line[strcspn(line, "\n")] = '\0';
 
+        if (failed) {
+            /* Keep reading so lsof is not killed by SIGPIPE */
+            continue;
+        }
         if (line[0] == 'p') {
             /* PID */
-            if (has_data) {
-                append_lsof_connection(connections, count, &capacity, &current);
+            if (has_data && append_lsof_connection(connections, count, &capacity, &current) < 0) {
+                failed = true;
             }
             memset(&current, 0, sizeof(current));
             current.pid = atoi(line + 1);
@@ -687,6 +2555,10 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
             snprintf(current.protocol, sizeof(current.protocol), "%s", line + 1);
         } else if (line[0] == 'T' && strncmp(line + 1, "ST=", 3) == 0) {
             snprintf(current.state, sizeof(current.state), "%s", line + 4);
+        } else if (line[0] == 'T' && strncmp(line + 1, "QR=", 3) == 0) {
+            current.rx_queue = (unsigned int)strtoul(line + 4, NULL, 10);
+        } else if (line[0] == 'T' && strncmp(line + 1, "QS=", 3) == 0) {
+            current.tx_queue = (unsigned int)strtoul(line + 4, NULL, 10);
         } else if (line[0] == 'n') {
             /* Network address */
             parse_lsof_name(line + 1, &current);
@@ -694,8 +2566,391 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
     }
 
     /* Add the last entry */
-    if (has_data) {
-        append_lsof_connection(connections, count, &capacity, &current);
+    if (!failed && has_data &&
+        append_lsof_connection(connections, count, &capacity, &current) < 0) {
+        failed = true;
+    }
+
+    pclose(fp);
+    if (failed || merge_lsof_owners(connections, count) < 0) {
+        free(*connections);
+        *connections = NULL;
+        *count = 0;
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Walk the connections on a port without collecting them (macOS)
+ *
+ * lsof reports owners with every socket, so this is a walk over the result
+ * of platform_get_port_connections(); owners and opts make no difference.
+ *
+ * @param port Port number to query
+ * @param opts Query settings
+ * @param owners Resolve the owning PID of each connection (always done)
+ * @param fn Callback invoked once per connection
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if lsof could not be run
+ */
+int platform_for_each_port_connection(int port, const platform_options_t *opts, bool owners,
+                                      platform_connection_fn fn, void *ctx) {
+    (void)owners;
+
+    connection_info_t *connections = NULL;
+    int count = 0;
+    if (platform_get_port_connections(port, opts, &connections, &count) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        fn(ctx, &connections[i]);
+    }
+
+    free(connections);
+    return 0;
+}
+
+/**
+ * Incremental port scan (macOS)
+ *
+ * Fields:
+ * - port, opts: Query
+ * - done, status: The query has run, and its result
+ * - connections, count: Result array
+ */
+struct platform_port_scan {
+    int port;
+    platform_options_t opts;
+    bool done;
+    int status;
+    connection_info_t *connections;
+    int count;
+};
+
+/**
+ * Start an incremental port scan (macOS)
+ *
+ * @param port Port number to query
+ * @param opts Query settings
+ * @return New scan (finish with platform_port_scan_end()), or NULL if
+ *         memory is exhausted
+ */
+platform_port_scan_t *platform_port_scan_begin(int port, const platform_options_t *opts) {
+    platform_port_scan_t *scan = counted_calloc(1, sizeof(*scan));
+    if (!scan) {
+        return NULL;
+    }
+    scan->port = port;
+    scan->opts = *opts;
+    return scan;
+}
+
+/**
+ * Do a slice of an incremental port scan (macOS)
+ *
+ * The connections come from a single lsof run, which cannot be split, so
+ * the first step does the whole query whatever the budget.
+ *
+ * @param scan Scan from platform_port_scan_begin()
+ * @param budget Units of work to do (unused)
+ * @return 0 (the scan is always complete after one step)
+ */
+int platform_port_scan_step(platform_port_scan_t *scan, int budget) {
+    (void)budget;
+
+    if (!scan->done) {
+        scan->status = platform_get_port_connections(scan->port, &scan->opts,
+                                                     &scan->connections, &scan->count);
+        scan->done = true;
+    }
+    return 0;
+}
+
+/**
+ * Finish an incremental port scan (macOS)
+ *
+ * @param scan Scan to finish
+ * @param connections Output: array of connections (caller must free), or NULL
+ * @param count Output: number of connections (ignored if connections is NULL)
+ * @return 0 on success, -1 if lsof could not be run or memory is exhausted (no
+ *         array is returned)
+ */
+int platform_port_scan_end(platform_port_scan_t *scan, connection_info_t **connections,
+                           int *count) {
+    int status = scan->done ? scan->status : 0;
+
+    if (connections && status == 0) {
+        *connections = scan->connections ? scan->connections
+                                         : counted_malloc(sizeof(**connections));
+        *count = scan->count;
+        if (!*connections) {
+            status = -1;
+        }
+    } else {
+        free(scan->connections);
+    }
+    free(scan);
+    return status;
+}
+
+/**
+ * Report the owning UID of every TCP/UDP socket (macOS)
+ *
+ * Runs "lsof -i -F u": each process block starts with its 'u' (UID) line and
+ * lists one 'f' line per internet socket it holds. Sockets are attributed to
+ * the UID of the process holding them, the closest match to the Linux
+ * tables' creator UID.
+ *
+ * @param fn Callback invoked once per socket with its UID
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if popen fails
+ */
+int platform_for_each_socket_uid(platform_socket_uid_fn fn, void *ctx) {
+    FILE *fp = popen("lsof -nP -iTCP -iUDP -F u 2>/dev/null", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    int uid = -1;
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == 'u') {
+            uid = atoi(line + 1);
+        } else if (line[0] == 'f' && uid >= 0) {
+            fn(ctx, uid);
+        }
+    }
+
+    pclose(fp);
+    return 0;
+}
+
+/**
+ * Report every process holding each TCP/UDP socket (macOS)
+ *
+ * Runs "lsof -i -F p": each process block starts with its 'p' (PID) line
+ * and lists one 'f' line per internet socket it holds, so a socket shared
+ * by several processes is reported once for each of them.
+ *
+ * @param opts Query settings (unused)
+ * @param fn Callback invoked once per socket and owning process
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if popen fails
+ */
+int platform_for_each_socket_pid(const platform_options_t *opts, platform_socket_pid_fn fn,
+                                 void *ctx) {
+    (void)opts;
+
+    FILE *fp = popen("lsof -nP -iTCP -iUDP -F p 2>/dev/null", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    pid_t pid = -1;
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == 'p') {
+            pid = (pid_t)atoi(line + 1);
+        } else if (line[0] == 'f' && pid > 0) {
+            fn(ctx, pid);
+        }
+    }
+
+    pclose(fp);
+    return 0;
+}
+
+/**
+ * Check whether anything is bound to a port (macOS)
+ *
+ * Asks lsof for a TCP listener or a UDP socket on the port and only checks
+ * whether it printed a PID; nothing else about the owners is read. Each
+ * check runs lsof, so polling is far coarser than on Linux.
+ *
+ * @param port Port number to check
+ * @param bound Output: true if a TCP listener or UDP socket holds the port
+ * @return 0 on success, -1 if popen fails
+ */
+int platform_port_bound(int port, bool *bound) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd),
+             "lsof -nP -iTCP:%d -sTCP:LISTEN -iUDP:%d -t 2>/dev/null", port, port);
+
+    FILE *fp = popen(cmd, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    char line[64];
+    *bound = fgets(line, sizeof(line), fp) != NULL;
+
+    pclose(fp);
+    return 0;
+}
+
+/**
+ * Walk the sockets bound to a port, stopping when the callback says so (macOS)
+ *
+ * Runs lsof for the port; each socket is reported with the PID and UID of
+ * the process holding it (lsof knows these anyway), so
+ * platform_process_has_socket() needs no further lookup.
+ *
+ * @param port Port number
+ * @param state TCP state name to match (NULL for any); UDP sockets are only
+ *              reported for NULL
+ * @param fn Callback invoked per socket; returning false ends the walk
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if popen fails
+ */
+int platform_for_each_port_socket(int port, const char *state,
+                                  platform_port_socket_fn fn, void *ctx) {
+    char cmd[256];
+    if (state) {
+        snprintf(cmd, sizeof(cmd), "lsof -nP -iTCP:%d -F puPT 2>/dev/null", port);
+    } else {
+        snprintf(cmd, sizeof(cmd), "lsof -nP -iTCP:%d -iUDP:%d -F puPT 2>/dev/null",
+                 port, port);
+    }
+
+    FILE *fp = popen(cmd, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    port_socket_t current;
+    memset(&current, 0, sizeof(current));
+    pid_t pid = -1;
+    int uid = -1;
+    bool has_data = false;
+    bool stopped = false;
+
+    char line[512];
+    while (!stopped && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (line[0] == 'p' || line[0] == 'f') {
+            if (has_data && (!state || strcmp(current.state, state) == 0)) {
+                stopped = !fn(ctx, &current);
+            }
+            has_data = false;
+            if (line[0] == 'p') {
+                pid = atoi(line + 1);
+            }
+        } else if (line[0] == 'u') {
+            uid = atoi(line + 1);
+        } else if (line[0] == 'P') {
+            memset(&current, 0, sizeof(current));
+            snprintf(current.protocol, sizeof(current.protocol), "%s", line + 1);
+            strcpy(current.state, "-");
+            current.pid = pid;
+            current.uid = uid;
+            has_data = true;
+        } else if (line[0] == 'T' && strncmp(line + 1, "ST=", 3) == 0) {
+            snprintf(current.state, sizeof(current.state), "%s", line + 4);
+        }
+    }
+    if (!stopped && has_data && (!state || strcmp(current.state, state) == 0)) {
+        fn(ctx, &current);
+    }
+
+    pclose(fp);
+    return 0;
+}
+
+/**
+ * Read the ephemeral port range from sysctl (macOS)
+ *
+ * @param low Output: first port handed out for outgoing connections
+ * @param high Output: last port
+ * @return 0 on success, -1 if the setting cannot be read
+ */
+int platform_ephemeral_port_range(int *low, int *high) {
+    size_t size = sizeof(*low);
+    if (sysctlbyname("net.inet.ip.portrange.first", low, &size, NULL, 0) < 0) {
+        return -1;
+    }
+    size = sizeof(*high);
+    if (sysctlbyname("net.inet.ip.portrange.last", high, &size, NULL, 0) < 0) {
+        return -1;
+    }
+    return *low > 0 && *low <= *high && *high <= 65535 ? 0 : -1;
+}
+
+/**
+ * Report one endpoint parsed from lsof if its local port is in range
+ *
+ * @param conn Parsed endpoint (addresses as text)
+ * @param low Lowest local port to report
+ * @param high Highest local port to report
+ * @param fn Callback
+ * @param ctx Context passed to fn
+ * @return void
+ */
+static void emit_lsof_endpoint(const connection_info_t *conn, int low, int high,
+                               platform_tcp_endpoint_fn fn, void *ctx) {
+    if (conn->local_port < low || conn->local_port > high) {
+        return;
+    }
+
+    tcp_endpoint_t ep;
+    memset(&ep, 0, sizeof(ep));
+    ep.family = strchr(conn->local_addr, ':') ? AF_INET6 : AF_INET;
+    ep.local_port = conn->local_port;
+    ep.remote_port = conn->remote_port;
+    ep.state = conn->state;
+
+    /* lsof brackets IPv6 addresses */
+    char addr[64];
+    snprintf(addr, sizeof(addr), "%s", conn->local_addr + (conn->local_addr[0] == '['));
+    addr[strcspn(addr, "]")] = '\0';
+    inet_pton(ep.family, addr, ep.local_addr);
+    snprintf(addr, sizeof(addr), "%s", conn->remote_addr + (conn->remote_addr[0] == '['));
+    addr[strcspn(addr, "]")] = '\0';
+    inet_pton(ep.family, addr, ep.remote_addr);
+
+    fn(ctx, &ep);
+}
+
+/**
+ * Walk every TCP socket whose local port is in a range (macOS)
+ *
+ * Streams "lsof -iTCP -F nT" one socket at a time.
+ *
+ * @param low Lowest local port to report
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if lsof could not be run
+ */
+int platform_for_each_tcp_endpoint(int low, int high, platform_tcp_endpoint_fn fn, void *ctx) {
+    FILE *fp = popen("lsof -nP -iTCP -T s -F nT 2>/dev/null", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    connection_info_t current;
+    bool pending = false;
+
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        if (line[0] == 'n') {
+            if (pending) {
+                emit_lsof_endpoint(&current, low, high, fn, ctx);
+            }
+            memset(&current, 0, sizeof(current));
+            parse_lsof_name(line + 1, &current);
+            pending = true;
+        } else if (line[0] == 'T' && strncmp(line + 1, "ST=", 3) == 0 && pending) {
+            snprintf(current.state, sizeof(current.state), "%s", line + 4);
+        }
+    }
+    if (pending) {
+        emit_lsof_endpoint(&current, low, high, fn, ctx);
     }
 
     pclose(fp);
@@ -703,7 +2958,18 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
 }
 
 /**
- * Get information about a process (macOS)
+ * Check whether a process holds a socket (macOS)
+ *
+ * @param pid Process to check
+ * @param sock Socket from platform_for_each_port_socket() (carries its PID)
+ * @return true if sock belongs to pid
+ */
+bool platform_process_has_socket(pid_t pid, const port_socket_t *sock) {
+    return sock->pid == pid;
+}
+
+/**
+ * Get selected information about a process (macOS)
  *
  * Retrieves comprehensive process information using macOS-specific proc_pidinfo()
  * system calls. Gathers details about process state, parent, user, memory usage,
@@ -713,7 +2979,7 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
  * - proc_pidinfo(PROC_PIDTBSDINFO): PPID, UID, status, process name, start time
  * - proc_pidpath(): Full path to process executable
  * - proc_pidinfo(PROC_PIDTASKINFO): Memory usage (virtual and resident size)
- * - getpwuid(): Username lookup from UID
+ * - usercache_lookup(): Username lookup from UID (/etc/passwd, then NSS)
  *
  * State mapping:
  * - BSD SIDL (1) -> 'I' (Idle/being created)
@@ -722,11 +2988,15 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
  * - BSD SSTOP (4) -> 'T' (Stopped)
  * - BSD SZOMB (5) -> 'Z' (Zombie)
  *
+ * Only the calls backing the requested sources are made; PROC_SRC_STATUS
+ * maps to the task info (memory) query, PROC_SRC_CMDLINE to proc_pidpath().
+ *
  * @param pid Process ID to query
  * @param info Pointer to process_info_t structure to populate
+ * @param sources Bitmask of PROC_SRC_* flags to read
  * @return 0 on success, -1 if proc_pidinfo fails (process doesn't exist or no permission)
  */
-int platform_get_process_info(pid_t pid, process_info_t *info) {
+int platform_get_process_fields(pid_t pid, process_info_t *info, unsigned int sources) {
     memset(info, 0, sizeof(*info));
     info->pid = pid;
 
@@ -768,17 +3038,20 @@ int platform_get_process_info(pid_t pid, process_info_t *info) {
     info->start_time = bsd_info.pbi_start_tvsec;
 
     /* Get the username */
-    get_username_from_uid(info->uid, info->username, sizeof(info->username));
+    if (sources & PROC_SRC_USER) {
+        get_username_from_uid(info->uid, info->username, sizeof(info->username));
+    }
 
     /* Get the command line using proc_pidpath and PROC_PIDPATHINFO */
     char pathbuf[PROC_PIDPATHINFO_MAXSIZE];
-    if (proc_pidpath(pid, pathbuf, sizeof(pathbuf)) > 0) {
+    if ((sources & PROC_SRC_CMDLINE) && proc_pidpath(pid, pathbuf, sizeof(pathbuf)) > 0) {
         snprintf(info->cmdline, sizeof(info->cmdline), "%s", pathbuf);
     }
 
     /* Get task info for memory */
     struct proc_taskinfo task_info;
-    if (proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &task_info, sizeof(task_info)) > 0) {
+    if ((sources & PROC_SRC_STATUS) &&
+        proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &task_info, sizeof(task_info)) > 0) {
         info->vsz = task_info.pti_virtual_size / 1024;
         info->rss = task_info.pti_resident_size / 1024;
     }
@@ -814,6 +3087,7 @@ int platform_get_process_info(pid_t pid, process_info_t *info) {
  * @param env_vars Output pointer to a dynamically allocated array of environment variable strings
  * @param count Output pointer to the number of environment variables found
  * @return 0 on success, -1 if sysctl fails (permission denied, the process doesn't exist, or buffer too small)
+ *         or memory is exhausted (errno ENOMEM)
  */
 int platform_get_process_env(const pid_t pid, char ***env_vars, int *count) {
     int mib[3];
@@ -831,7 +3105,10 @@ int platform_get_process_env(const pid_t pid, char ***env_vars, int *count) {
     }
 
     /* Allocate buffer */
-    char* buffer = safe_malloc(size);
+    char* buffer = counted_malloc(size);
+    if (!buffer) {
+        return -1;
+    }
 
     /* Get the actual data */
     if (sysctl(mib, 3, buffer, &size, NULL, 0) < 0) {
@@ -881,7 +3158,11 @@ int platform_get_process_env(const pid_t pid, char ***env_vars, int *count) {
     }
 
     /* Allocate array for environment variable pointers */
-    *env_vars = safe_malloc(*count * sizeof(char *));
+    *env_vars = counted_malloc((size_t)(*count > 0 ? *count : 1) * sizeof(char *));
+    if (!*env_vars) {
+        free(buffer);
+        return -1;
+    }
 
     /* Copy environment variables */
     int idx = 0;
@@ -892,7 +3173,14 @@ int platform_get_process_env(const pid_t pid, char ***env_vars, int *count) {
         }
         /* Only copy strings that contain '=' (valid env vars) */
         if (strchr(ptr, '=')) {
-            (*env_vars)[idx++] = safe_strdup(ptr);
+            (*env_vars)[idx] = counted_strdup(ptr);
+            if (!(*env_vars)[idx]) {
+                platform_free_env_vars(*env_vars, idx);
+                free(buffer);
+                errno = ENOMEM;
+                return -1;
+            }
+            idx++;
         }
         ptr += strlen(ptr) + 1;
     }
@@ -912,11 +3200,23 @@ int platform_get_process_env(const pid_t pid, char ***env_vars, int *count) {
  * COMMON (PLATFORM-INDEPENDENT) FUNCTIONS
  * ============================================================================ */
 
+/**
+ * Get information about a process
+ *
+ * Reads every available source; see platform_get_process_fields().
+ */
+int platform_get_process_info(pid_t pid, process_info_t *info) {
+    return platform_get_process_fields(pid, info, PROC_SRC_ALL);
+}
+
 /**
  * Build process ancestry tree
  */
 int platform_get_process_tree(const pid_t pid, process_tree_node_t **tree) {
-    process_tree_node_t *node = safe_calloc(1, sizeof(process_tree_node_t));
+    process_tree_node_t *node = counted_calloc(1, sizeof(process_tree_node_t));
+    if (!node) {
+        return -1;
+    }
 
     if (platform_get_process_info(pid, &node->info) < 0) {
         free(node);
@@ -972,21 +3272,35 @@ void platform_free_env_vars(char **env_vars, int count) {
 }
 
 /**
- * Get list of all running processes
+ * List the PIDs of all running processes
+ *
+ * On Linux this is one pass over the numeric entries of /proc; on macOS one
+ * sysctl(KERN_PROC_ALL) snapshot. Nothing beyond the PID is read, so callers
+ * can decide how (and on which thread) to fetch the details.
+ *
+ * @param pids Output: array of PIDs (caller must free)
+ * @param count Output: number of PIDs
+ * @return 0 on success, -1 if the process list cannot be read or memory is
+ *         exhausted (errno ENOMEM)
  */
-int platform_get_all_processes(process_info_t **processes, int *count) {
-    *processes = NULL;
+int platform_list_pids(pid_t **pids, int *count) {
+    *pids = NULL;
     *count = 0;
 
 #ifdef __linux__
-    /* On Linux, scan /proc for numeric directories */
     DIR *proc_dir = opendir("/proc");
     if (!proc_dir) {
         return -1;
     }
 
-    int capacity = 100;
-    *processes = safe_malloc(capacity * sizeof(process_info_t));
+    /* Sized once from the /proc link count; doubling is only a fallback */
+    int capacity = estimate_process_count();
+    *pids = counted_malloc(capacity * sizeof(pid_t));
+    if (!*pids) {
+        closedir(proc_dir);
+        errno = ENOMEM;
+        return -1;
+    }
 
     struct dirent *entry;
     while ((entry = readdir(proc_dir)) != NULL) {
@@ -1002,20 +3316,25 @@ int platform_get_all_processes(process_info_t **processes, int *count) {
 
         /* Expand array if needed */
         if (*count >= capacity) {
+            pid_t *grown = counted_realloc(*pids, (size_t)capacity * 2 * sizeof(pid_t));
+            if (!grown) {
+                free(*pids);
+                *pids = NULL;
+                *count = 0;
+                closedir(proc_dir);
+                errno = ENOMEM;
+                return -1;
+            }
+            *pids = grown;
             capacity *= 2;
-            *processes = safe_realloc(*processes, capacity * sizeof(process_info_t));
         }
 
-        /* Get process info - skip if it fails (process may have exited) */
-        if (platform_get_process_info(pid, &(*processes)[*count]) == 0) {
-            (*count)++;
-        }
+        (*pids)[(*count)++] = pid;
     }
 
     closedir(proc_dir);
 
 #elif __APPLE__
-    /* On macOS, use sysctl to get all processes */
     int mib[4] = {CTL_KERN, KERN_PROC, KERN_PROC_ALL, 0};
     size_t size;
 
@@ -1024,33 +3343,63 @@ int platform_get_all_processes(process_info_t **processes, int *count) {
         return -1;
     }
 
-    /* Allocate buffer */
-    struct kinfo_proc *proc_list = safe_malloc(size);
-
     /* Get process list */
+    struct kinfo_proc *proc_list = counted_malloc(size);
+    if (!proc_list) {
+        return -1;
+    }
     if (sysctl(mib, 4, proc_list, &size, NULL, 0) < 0) {
         free(proc_list);
         return -1;
     }
 
-    /* Calculate number of processes */
-    int num_procs = size / sizeof(struct kinfo_proc);
+    const int num_procs = size / sizeof(struct kinfo_proc);
+    *pids = counted_malloc((num_procs > 0 ? num_procs : 1) * sizeof(pid_t));
+    if (!*pids) {
+        free(proc_list);
+        return -1;
+    }
+    for (int i = 0; i < num_procs; i++) {
+        (*pids)[(*count)++] = proc_list[i].kp_proc.p_pid;
+    }
+
+    free(proc_list);
+#endif
 
-    /* Allocate output array */
-    *processes = safe_malloc(num_procs * sizeof(process_info_t));
+    return 0;
+}
 
-    /* Convert each process */
-    for (int i = 0; i < num_procs; i++) {
-        pid_t pid = proc_list[i].kp_proc.p_pid;
+/**
+ * Get list of all running processes
+ *
+ * Lists the PIDs with platform_list_pids() and reads the requested fields of
+ * each. Processes that exit between the two steps are skipped.
+ */
+int platform_get_all_processes(process_info_t **processes, int *count,
+                               unsigned int sources) {
+    pid_t *pids = NULL;
+    int pid_count = 0;
+
+    *processes = NULL;
+    *count = 0;
+
+    if (platform_list_pids(&pids, &pid_count) < 0) {
+        return -1;
+    }
+
+    *processes = counted_malloc((pid_count > 0 ? pid_count : 1) * sizeof(process_info_t));
+    if (!*processes) {
+        free(pids);
+        return -1;
+    }
 
-        /* Get detailed info - skip if it fails */
-        if (platform_get_process_info(pid, &(*processes)[*count]) == 0) {
+    for (int i = 0; i < pid_count; i++) {
+        /* Get process info - skip if it fails (process may have exited) */
+        if (platform_get_process_fields(pids[i], &(*processes)[*count], sources) == 0) {
             (*count)++;
         }
     }
 
-    free(proc_list);
-#endif
-
+    free(pids);
     return 0;
 }
@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
 /* Maximum lengths for various fields */
@@ -11,6 +12,57 @@
 #define MAX_USERNAME 64
 #define MAX_PATH 1024
 
+/*
+ * Data sources behind process_info_t fields
+ *
+ * Callers that only print a subset of fields pass the OR of the sources those
+ * fields need (see field_layout_sources() in src/fields.h), and the platform
+ * layer skips reading everything else. The basic stat record (pid, name,
+ * state, ppid) is always read since it also proves the process exists.
+ */
+#define PROC_SRC_STAT    0x01u  /* /proc/<pid>/stat: name, state, ppid */
+#define PROC_SRC_START   0x02u  /* start time (stat starttime + boot time) */
+#define PROC_SRC_STATUS  0x04u  /* /proc/<pid>/status: uid, VmSize, VmRSS */
+#define PROC_SRC_CMDLINE 0x08u  /* /proc/<pid>/cmdline */
+#define PROC_SRC_USER    0x10u  /* username (implies PROC_SRC_STATUS) */
+#define PROC_SRC_ALL     0x1Fu
+
+/* Data sources behind connection_info_t fields */
+#define CONN_SRC_NET     0x01u  /* /proc/net/{tcp,udp}[6] row */
+#define CONN_SRC_DIAG    0x02u  /* sock_diag (listen backlog, TCP internals) */
+
+/**
+ * TCP internals of one connection (--tcp-info, Linux only)
+ *
+ * Taken from the kernel's tcp_info and socket memory counters, reported
+ * through sock_diag together with the socket itself.
+ *
+ * Fields:
+ * - rtt_us, rttvar_us: Smoothed round-trip time and its variance (microseconds)
+ * - retransmits: Retransmissions of the current unacknowledged segment
+ * - total_retrans: Segments retransmitted over the connection's lifetime
+ * - snd_cwnd: Congestion window (segments)
+ * - unacked: Segments sent but not yet acknowledged
+ * - rmem_alloc, rcvbuf: Receive memory in use and its limit (bytes)
+ * - wmem_alloc, sndbuf: Send memory in use and its limit (bytes)
+ * - wmem_queued: Bytes queued for sending, including unsent data
+ * - drops: Packets dropped before reaching the socket
+ */
+typedef struct {
+    unsigned int rtt_us;
+    unsigned int rttvar_us;
+    unsigned int retransmits;
+    unsigned int total_retrans;
+    unsigned int snd_cwnd;
+    unsigned int unacked;
+    unsigned int rmem_alloc;
+    unsigned int rcvbuf;
+    unsigned int wmem_alloc;
+    unsigned int sndbuf;
+    unsigned int wmem_queued;
+    unsigned int drops;
+} tcp_internals_t;
+
 /**
  * Network connection/socket information structure
  *
@@ -24,8 +76,22 @@
  * - remote_addr: Remote IP address (dotted decimal for IPv4)
  * - remote_port: Remote port number (0 if not applicable)
  * - state: Connection state (LISTEN, ESTABLISHED, etc.)
- * - pid: Process ID using this connection
+ * - pid: Process ID using this connection (the lowest owner's when the
+ *   socket is shared, -1 if unknown)
+ * - inode: Socket inode (Linux; 0 if unknown or orphaned, e.g. TIME_WAIT)
+ * - owner_count: Number of processes holding the socket (0 if unknown);
+ *   prefork servers share one listener between a master and its workers
+ * - owners: Every owning PID in ascending order (owner_count entries).
+ *   Arrays returned by platform_get_port_connections() keep the lists in
+ *   the same allocation, after the records, so they stay valid until the
+ *   array is freed; records handed to a callback only during the call.
  * - protocol: Protocol name (TCP, TCP6, UDP)
+ * - rx_queue: Bytes received but not yet read; for a TCP listener, the
+ *   number of connections waiting to be accepted (accept queue)
+ * - tx_queue: Bytes sent but not yet acknowledged (TCP) or queued (UDP)
+ * - backlog: Listen backlog of a TCP listener (0 if not a listener or unknown)
+ * - has_tcp_info: Whether tcp holds data (TCP sockets with --tcp-info)
+ * - tcp: TCP internals (RTT, retransmits, congestion window, socket memory)
  */
 typedef struct {
     char local_addr[64];    /* Local IP address */
@@ -34,7 +100,15 @@ typedef struct {
     int remote_port;        /* Remote port number */
     char state[16];         /* Connection state (LISTEN, ESTABLISHED, etc.) */
     pid_t pid;              /* Process ID using this connection */
+    unsigned long inode;    /* Socket inode (Linux) */
+    int owner_count;        /* Processes holding the socket */
+    const pid_t *owners;    /* Their PIDs, ascending */
     char protocol[8];       /* Protocol (TCP, UDP) */
+    unsigned int rx_queue;  /* Receive queue (accept queue when listening) */
+    unsigned int tx_queue;  /* Send queue */
+    int backlog;            /* Listen backlog (0 = n/a) */
+    bool has_tcp_info;      /* tcp is filled in */
+    tcp_internals_t tcp;    /* TCP internals (--tcp-info) */
 } connection_info_t;
 
 /**
@@ -90,17 +164,277 @@ typedef struct process_tree_node {
     int num_children;
 } process_tree_node_t;
 
+/**
+ * Socket-owner map kept between port lookups (opaque)
+ */
+typedef struct platform_inode_cache platform_inode_cache_t;
+
+/**
+ * Settings for one platform query
+ *
+ * Passed with each call instead of being kept in globals, so concurrent
+ * queries can use different settings.
+ *
+ * Fields:
+ * - scan_jobs: Worker threads for the socket-owner scan behind port lookups
+ *   on Linux (values below 1 scan on the calling thread only)
+ * - tcp_info: Read TCP sockets from sock_diag along with their tcp_info and
+ *   socket memory (Linux; elsewhere has_tcp_info stays unset)
+ * - inode_cache: Socket-owner map reused across port lookups for a short
+ *   time instead of being rebuilt by each (NULL to always rebuild)
+ */
+typedef struct {
+    int scan_jobs;
+    bool tcp_info;
+    platform_inode_cache_t *inode_cache;
+} platform_options_t;
+
+/**
+ * Create / free a socket-owner cache for platform_options_t.inode_cache
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ * A cache may be used by one query at a time.
+ */
+platform_inode_cache_t *platform_inode_cache_new(int ttl_ms);
+void platform_inode_cache_free(platform_inode_cache_t *cache);
+
 /**
  * Get all connections on a specific port
  *
  * Platform-specific implementation. See src/platform.c for detailed documentation.
  *
- * @param port Port number to query
+ * @param port Port number to query (0 = every port)
+ * @param opts Query settings
  * @param connections Output pointer to dynamically allocated array (caller must free)
  * @param count Output pointer to number of connections found
  * @return 0 on success, -1 on error
  */
-int platform_get_port_connections(int port, connection_info_t **connections, int *count);
+int platform_get_port_connections(int port, const platform_options_t *opts,
+                                  connection_info_t **connections, int *count);
+
+/**
+ * Callback receiving one connection on a port
+ *
+ * The record is reused for the next connection once the callback returns.
+ *
+ * @param ctx Caller context
+ * @param conn Connection
+ */
+typedef void (*platform_connection_fn)(void *ctx, const connection_info_t *conn);
+
+/**
+ * Walk the connections on a port without collecting them
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param port Port number to query
+ * @param opts Query settings
+ * @param owners Resolve the owning PID of each connection
+ * @param fn Callback invoked once per connection
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 on error
+ */
+int platform_for_each_port_connection(int port, const platform_options_t *opts, bool owners,
+                                      platform_connection_fn fn, void *ctx);
+
+/**
+ * One TCP socket as seen by platform_for_each_tcp_endpoint()
+ *
+ * Fields:
+ * - family: AF_INET or AF_INET6
+ * - local_addr, remote_addr: Addresses in network byte order (4 bytes used
+ *   for IPv4)
+ * - local_port, remote_port: Ports (remote_port is 0 for listeners)
+ * - state: TCP state name ("ESTABLISHED", "TIME_WAIT", ...)
+ */
+typedef struct {
+    int family;
+    uint8_t local_addr[16];
+    uint8_t remote_addr[16];
+    int local_port;
+    int remote_port;
+    const char *state;
+} tcp_endpoint_t;
+
+/**
+ * Callback receiving one TCP endpoint
+ *
+ * The record is only valid until the callback returns.
+ *
+ * @param ctx Caller context
+ * @param ep Endpoint
+ */
+typedef void (*platform_tcp_endpoint_fn)(void *ctx, const tcp_endpoint_t *ep);
+
+/**
+ * Walk every TCP socket whose local port is in a range
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param low Lowest local port to report
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 on error
+ */
+int platform_for_each_tcp_endpoint(int low, int high, platform_tcp_endpoint_fn fn, void *ctx);
+
+/**
+ * Read the range of local ports used for outgoing connections
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param low Output: first ephemeral port
+ * @param high Output: last ephemeral port
+ * @return 0 on success, -1 on error
+ */
+int platform_ephemeral_port_range(int *low, int *high);
+
+/**
+ * Incremental port scan (opaque)
+ *
+ * Gives the result of platform_get_port_connections() in bounded slices of
+ * work on the calling thread, for callers that cannot block.
+ */
+typedef struct platform_port_scan platform_port_scan_t;
+
+/**
+ * Start an incremental port scan
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param port Port number to query
+ * @param opts Query settings
+ * @return New scan (finish with platform_port_scan_end())
+ */
+platform_port_scan_t *platform_port_scan_begin(int port, const platform_options_t *opts);
+
+/**
+ * Do a bounded slice of an incremental port scan
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param scan Scan from platform_port_scan_begin()
+ * @param budget Units of work to do (processes or table rows)
+ * @return 1 if work remains, 0 once the scan is complete
+ */
+int platform_port_scan_step(platform_port_scan_t *scan, int budget);
+
+/**
+ * Finish an incremental port scan and take its connections
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param scan Scan to finish (freed)
+ * @param connections Output: array of connections (caller must free), or NULL to discard
+ * @param count Output: number of connections
+ * @return 0 on success, -1 on error
+ */
+int platform_port_scan_end(platform_port_scan_t *scan, connection_info_t **connections,
+                           int *count);
+
+/**
+ * Callback receiving the owning UID of one socket
+ *
+ * @param ctx Caller context
+ * @param uid UID that owns the socket
+ */
+typedef void (*platform_socket_uid_fn)(void *ctx, int uid);
+
+/**
+ * Report the owning UID of every TCP/UDP socket
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 on error
+ */
+int platform_for_each_socket_uid(platform_socket_uid_fn fn, void *ctx);
+
+/**
+ * Callback receiving one process holding a socket
+ *
+ * @param ctx Caller context
+ * @param pid Process holding the socket
+ */
+typedef void (*platform_socket_pid_fn)(void *ctx, pid_t pid);
+
+/**
+ * Report every process holding each TCP/UDP socket
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param opts Query settings
+ * @param fn Callback invoked once per socket and owning process
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 on error
+ */
+int platform_for_each_socket_pid(const platform_options_t *opts, platform_socket_pid_fn fn,
+                                 void *ctx);
+
+/**
+ * Check whether a TCP listener or UDP socket is bound to a port
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param port Port number to check
+ * @param bound Output: true if the port is bound
+ * @return 0 on success, -1 on error
+ */
+int platform_port_bound(int port, bool *bound);
+
+/**
+ * One socket bound to a port, as reported by platform_for_each_port_socket()
+ *
+ * Fields:
+ * - protocol: Protocol name (TCP, TCP6, UDP, UDP6)
+ * - state: Connection state (LISTEN, ESTABLISHED, ...; "-" for UDP)
+ * - uid: UID that owns the socket
+ * - inode: Socket inode (Linux; 0 elsewhere)
+ * - pid: Owning process if known without a lookup (macOS), otherwise -1
+ */
+typedef struct {
+    char protocol[8];
+    char state[16];
+    int uid;
+    unsigned long inode;
+    pid_t pid;
+} port_socket_t;
+
+/**
+ * Callback receiving one socket bound to a port
+ *
+ * @param ctx Caller context
+ * @param sock Socket (only valid during the call)
+ * @return false to stop the walk, true to continue
+ */
+typedef bool (*platform_port_socket_fn)(void *ctx, const port_socket_t *sock);
+
+/**
+ * Walk the sockets bound to a port without resolving their owners
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param port Port number
+ * @param state TCP state name to match (NULL for any)
+ * @param fn Callback invoked per socket; returning false ends the walk
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 on error
+ */
+int platform_for_each_port_socket(int port, const char *state,
+                                  platform_port_socket_fn fn, void *ctx);
+
+/**
+ * Check whether a process holds a socket
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param pid Process to check
+ * @param sock Socket from platform_for_each_port_socket()
+ * @return true if the process holds the socket
+ */
+bool platform_process_has_socket(pid_t pid, const port_socket_t *sock);
 
 /**
  * Get information about a specific process
@@ -113,6 +447,19 @@ int platform_get_port_connections(int port, connection_info_t **connections, int
  */
 int platform_get_process_info(pid_t pid, process_info_t *info);
 
+/**
+ * Get selected information about a specific process
+ *
+ * Like platform_get_process_info(), but only reads the requested sources.
+ * See src/platform.c for detailed documentation.
+ *
+ * @param pid Process ID to query
+ * @param info Pointer to process_info_t structure to populate
+ * @param sources Bitmask of PROC_SRC_* flags to read
+ * @return 0 on success, -1 on error (process doesn't exist or access denied)
+ */
+int platform_get_process_fields(pid_t pid, process_info_t *info, unsigned int sources);
+
 /**
  * Build process ancestry tree recursively
  *
@@ -157,6 +504,17 @@ int platform_get_process_env(pid_t pid, char ***env_vars, int *count);
  */
 void platform_free_env_vars(char **env_vars, int count);
 
+/**
+ * List the PIDs of all running processes
+ *
+ * Platform-specific implementation. See src/platform.c for detailed documentation.
+ *
+ * @param pids Output: array of PIDs (caller must free)
+ * @param count Output: number of PIDs
+ * @return 0 on success, -1 on error
+ */
+int platform_list_pids(pid_t **pids, int *count);
+
 /**
  * Get list of all running processes
  *
@@ -164,9 +522,11 @@ void platform_free_env_vars(char **env_vars, int count);
  *
  * @param processes Output pointer to dynamically allocated array (caller must free)
  * @param count Output pointer to number of processes found
+ * @param sources Bitmask of PROC_SRC_* flags to read for each process
  * @return 0 on success, -1 on error
  */
-int platform_get_all_processes(process_info_t **processes, int *count);
+int platform_get_all_processes(process_info_t **processes, int *count,
+                               unsigned int sources);
 
 /**
  * Initialize platform-specific resources
@@ -0,0 +1,293 @@
+#include "wir.h"
+#include "context.h"
+#include "export.h"
+#include "platform.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Kinds of asynchronous query */
+typedef enum {
+    QUERY_PROCESSES,
+    QUERY_PORT_CONNECTIONS
+} query_kind_t;
+
+/**
+ * One asynchronous query (opaque in src/wir.h)
+ *
+ * The fd handed out is the read end of a pipe holding one byte for as long
+ * as work remains, so it polls readable until the query completes; the byte
+ * is drained when the callback runs.
+ *
+ * Fields:
+ * - kind: What is being queried
+ * - pipe_fds: Readiness pipe (read end, write end)
+ * - finished: The callback has run
+ * - user: Opaque pointer passed to the callback
+ * - processes_done, pids, pid_count, next_pid, processes, count: Process
+ *   query (PIDs are listed by the first step, then read budget at a time)
+ * - connections_done, scan: Port query (an incremental platform scan)
+ */
+struct wir_query {
+    query_kind_t kind;
+    int pipe_fds[2];
+    bool finished;
+    void *user;
+
+    wir_processes_cb processes_done;
+    pid_t *pids;
+    int pid_count;
+    int next_pid;
+    bool listed;
+    process_info_t *processes;
+    int count;
+
+    wir_connections_cb connections_done;
+    platform_port_scan_t *scan;
+};
+
+/**
+ * Allocate a query and arm its readiness pipe
+ *
+ * @param ctx Context errors are reported to
+ * @param kind Kind of query
+ * @param user Opaque pointer passed to the callback
+ * @return New query, or NULL if memory is exhausted or no pipe could be
+ *         created (message printed)
+ */
+static wir_query_t *query_new(const wir_ctx_t *ctx, query_kind_t kind, void *user) {
+    wir_query_t *query = counted_calloc(1, sizeof(*query));
+    if (!query) {
+        print_error(ctx, "Cannot create query: %s", strerror(errno));
+        return NULL;
+    }
+    query->kind = kind;
+    query->user = user;
+
+    if (pipe(query->pipe_fds) < 0) {
+        print_error(ctx, "Cannot create query fd: %s", strerror(errno));
+        free(query);
+        return NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(query->pipe_fds[i], F_SETFD, FD_CLOEXEC);
+        fcntl(query->pipe_fds[i], F_SETFL, O_NONBLOCK);
+    }
+
+    /* Readable until the query completes */
+    const char pending = 1;
+    if (write(query->pipe_fds[1], &pending, 1) != 1) {
+        print_error(ctx, "Cannot arm query fd: %s", strerror(errno));
+        close(query->pipe_fds[0]);
+        close(query->pipe_fds[1]);
+        free(query);
+        return NULL;
+    }
+    return query;
+}
+
+/**
+ * Start listing every process without blocking
+ *
+ * Same result as wir_processes(), delivered to done. The first step lists
+ * the PIDs; each later step reads the details of up to budget processes.
+ * Processes that exit in between are skipped.
+ *
+ * @param ctx Context
+ * @param done Callback receiving the processes (it must free the array)
+ * @param user Opaque pointer passed to done
+ * @return New query (free with wir_query_free()), or NULL on error
+ */
+wir_query_t *wir_query_processes(wir_ctx_t *ctx, wir_processes_cb done, void *user) {
+    (void)ctx;
+
+    wir_query_t *query = query_new(ctx, QUERY_PROCESSES, user);
+    if (query) {
+        query->processes_done = done;
+    }
+    return query;
+}
+
+/**
+ * Start finding the connections on a port without blocking
+ *
+ * Same result as wir_port_connections(), delivered to done. Each step
+ * reads the fd links of up to budget processes or parses up to budget
+ * /proc/net rows (see platform_port_scan_step()). Everything runs on the
+ * calling thread: the context's --jobs setting does not apply, its
+ * --tcp-info setting does.
+ *
+ * @param ctx Context
+ * @param port Port number
+ * @param done Callback receiving the connections (it must free the array)
+ * @param user Opaque pointer passed to done
+ * @return New query (free with wir_query_free()), or NULL on error
+ */
+wir_query_t *wir_query_port_connections(wir_ctx_t *ctx, int port, wir_connections_cb done,
+                                        void *user) {
+    wir_query_t *query = query_new(ctx, QUERY_PORT_CONNECTIONS, user);
+    if (!query) {
+        return NULL;
+    }
+
+    query->connections_done = done;
+    query->scan = platform_port_scan_begin(port, &ctx->platform);
+    if (!query->scan) {
+        print_error(ctx, "Cannot create query: %s", strerror(errno));
+        wir_query_free(query);
+        return NULL;
+    }
+    return query;
+}
+
+/**
+ * Get the fd to watch for a query
+ *
+ * The fd polls readable (POLLIN/EPOLLIN, level-triggered) while the query
+ * has work left, and stops being readable once the callback has run.
+ * Never read from or close it; wir_query_free() does.
+ *
+ * @param query Query
+ * @return File descriptor
+ */
+int wir_query_fd(const wir_query_t *query) {
+    return query->pipe_fds[0];
+}
+
+/**
+ * Read the details of up to budget processes
+ *
+ * @param query Process query
+ * @param budget Units of work to do
+ * @return 1 if work remains, 0 once every process has been read, -1 if the
+ *         processes cannot be listed or memory is exhausted
+ */
+static int step_processes(wir_query_t *query, int budget) {
+    if (!query->listed) {
+        query->listed = true;
+        if (platform_list_pids(&query->pids, &query->pid_count) < 0) {
+            return -1;
+        }
+        query->processes = counted_malloc((query->pid_count > 0 ? query->pid_count : 1) *
+                                          sizeof(process_info_t));
+        if (!query->processes) {
+            return -1;
+        }
+        budget--;
+    }
+
+    while (budget > 0 && query->next_pid < query->pid_count) {
+        /* Skip processes that exited since they were listed */
+        if (platform_get_process_fields(query->pids[query->next_pid++],
+                                        &query->processes[query->count], PROC_SRC_ALL) == 0) {
+            query->count++;
+        }
+        budget--;
+    }
+
+    return query->next_pid < query->pid_count ? 1 : 0;
+}
+
+/**
+ * Complete a query: drain its fd and deliver the result
+ *
+ * @param query Query whose work is done (or failed)
+ * @param status 0 on success, -1 on error
+ * @return void
+ */
+static void finish(wir_query_t *query, int status) {
+    char pending;
+    while (read(query->pipe_fds[0], &pending, 1) == 1) {
+    }
+    query->finished = true;
+
+    if (query->kind == QUERY_PROCESSES) {
+        free(query->pids);
+        query->pids = NULL;
+        wir_process_t *processes = NULL;
+        int count = 0;
+        if (status == 0 && export_processes(query->processes, query->count, &processes) == 0) {
+            count = query->count;
+        } else {
+            status = -1;
+        }
+        free(query->processes);
+        query->processes = NULL;
+        query->processes_done(query->user, status, processes, count);
+    } else {
+        connection_info_t *connections = NULL;
+        int count = 0;
+        if (platform_port_scan_end(query->scan, &connections, &count) < 0) {
+            status = -1;
+        }
+        query->scan = NULL;
+
+        wir_connection_t *exported = NULL;
+        if (status == 0 && export_connections(connections, count, &exported) < 0) {
+            status = -1;
+        }
+        free(connections);
+        query->connections_done(query->user, status, exported, status == 0 ? count : 0);
+    }
+}
+
+/**
+ * Do a bounded slice of a query's work
+ *
+ * Call whenever the query's fd is readable. A slice does about budget
+ * units of work (see the start functions for what a unit is), so the time
+ * one call takes stays bounded however many processes or sockets the host
+ * has; pick budget to fit the loop's latency target (a few hundred units
+ * take on the order of a millisecond). The step that finishes the work
+ * calls the callback before returning.
+ *
+ * @param query Query
+ * @param budget Units of work to do (values below 1 count as 1)
+ * @return 1 if work remains, 0 once the callback has run (further calls
+ *         do nothing)
+ */
+int wir_query_step(wir_query_t *query, int budget) {
+    if (query->finished) {
+        return 0;
+    }
+    if (budget < 1) {
+        budget = 1;
+    }
+
+    const int result = query->kind == QUERY_PROCESSES
+                           ? step_processes(query, budget)
+                           : platform_port_scan_step(query->scan, budget);
+    if (result > 0) {
+        return 1;
+    }
+
+    finish(query, result < 0 ? -1 : 0);
+    return 0;
+}
+
+/**
+ * Free a query, abandoning it if the callback has not run yet
+ *
+ * An abandoned query never calls its callback. Safe to call from the
+ * callback itself.
+ *
+ * @param query Query (NULL is ignored)
+ * @return void
+ */
+void wir_query_free(wir_query_t *query) {
+    if (!query) {
+        return;
+    }
+
+    if (query->scan) {
+        platform_port_scan_end(query->scan, NULL, NULL);
+    }
+    free(query->pids);
+    free(query->processes);
+    close(query->pipe_fds[0]);
+    close(query->pipe_fds[1]);
+    free(query);
+}
@@ -0,0 +1,275 @@
+#include "serve.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Skip JSON whitespace
+ *
+ * @param p Cursor to advance
+ * @return void
+ */
+static void skip_space(const char **p) {
+    while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n') {
+        (*p)++;
+    }
+}
+
+/**
+ * Read four hex digits of a \u escape
+ *
+ * @param p First digit
+ * @param value Output code unit
+ * @return 0 on success, -1 if the digits are not hex
+ */
+static int parse_hex4(const char *p, unsigned int *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        const int c = (unsigned char)p[i];
+        if (!isxdigit(c)) {
+            return -1;
+        }
+        *value = *value * 16 + (unsigned int)(isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+    }
+    return 0;
+}
+
+/**
+ * Read a JSON string, decoding its escapes
+ *
+ * \u escapes of the Basic Multilingual Plane are stored as UTF-8;
+ * surrogate pairs are rejected (nothing a query carries needs them).
+ *
+ * @param p Cursor on the opening quote, left after the closing quote
+ * @param out Output buffer
+ * @param size Size of out
+ * @return 0 on success, -1 if the string is malformed or too long
+ */
+static int parse_string(const char **p, char *out, size_t size) {
+    size_t n = 0;
+
+    if (**p != '"') {
+        return -1;
+    }
+    (*p)++;
+
+    while (**p != '"') {
+        unsigned int c = (unsigned char)**p;
+        if (c == '\0' || c < 0x20) {
+            return -1;
+        }
+        (*p)++;
+
+        if (c == '\\') {
+            const char e = **p;
+            (*p)++;
+            switch (e) {
+                case '"': c = '"'; break;
+                case '\\': c = '\\'; break;
+                case '/': c = '/'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case 'u':
+                    if (parse_hex4(*p, &c) < 0 || (c >= 0xD800 && c <= 0xDFFF) || c == 0) {
+                        return -1;
+                    }
+                    *p += 4;
+                    break;
+                default:
+                    return -1;
+            }
+        }
+
+        /* Room for the longest (3-byte) sequence and the terminator */
+        if (n + 4 > size) {
+            return -1;
+        }
+        if (c < 0x80) {
+            out[n++] = (char)c;
+        } else if (c < 0x800) {
+            out[n++] = (char)(0xC0 | (c >> 6));
+            out[n++] = (char)(0x80 | (c & 0x3F));
+        } else {
+            out[n++] = (char)(0xE0 | (c >> 12));
+            out[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            out[n++] = (char)(0x80 | (c & 0x3F));
+        }
+    }
+
+    (*p)++;
+    out[n] = '\0';
+    return 0;
+}
+
+/**
+ * Read a JSON integer
+ *
+ * @param p Cursor on the first character, left after the number
+ * @param value Output value
+ * @return 0 on success, -1 if there is no integer (fractions and exponents
+ *         are not accepted)
+ */
+static int parse_integer(const char **p, long long *value) {
+    char *end = NULL;
+
+    if (**p != '-' && !isdigit((unsigned char)**p)) {
+        return -1;
+    }
+
+    errno = 0;
+    *value = strtoll(*p, &end, 10);
+    if (errno != 0 || end == *p || *end == '.' || *end == 'e' || *end == 'E') {
+        return -1;
+    }
+    *p = end;
+    return 0;
+}
+
+/**
+ * Copy the "id" value verbatim, as JSON text
+ *
+ * A string is checked (and its escapes kept as written) so the copy is
+ * valid JSON wherever it is echoed; a number is copied as an integer.
+ *
+ * @param p Cursor on the value, left after it
+ * @param id Output JSON text
+ * @return 0 on success, -1 if the value is neither or too long
+ */
+static int copy_id(const char **p, char id[SERVE_ID_SIZE]) {
+    const char *start = *p;
+
+    if (**p == '"') {
+        char scratch[SERVE_ID_SIZE];
+        if (parse_string(p, scratch, sizeof(scratch)) < 0) {
+            return -1;
+        }
+    } else {
+        long long ignored;
+        if (parse_integer(p, &ignored) < 0) {
+            return -1;
+        }
+    }
+
+    const size_t len = (size_t)(*p - start);
+    if (len >= SERVE_ID_SIZE) {
+        return -1;
+    }
+    memcpy(id, start, len);
+    id[len] = '\0';
+    return 0;
+}
+
+/**
+ * Parse one --serve-stdio query line
+ *
+ * A query is a single-line JSON object with an optional "id" (a string or
+ * an integer, echoed back so a client can match responses to queries) and
+ * exactly one of:
+ *
+ * - "port": n     connections on the port, with every owner
+ * - "pid": n      one process
+ * - "bound": n    whether a TCP listener or UDP socket holds the port
+ * - "check": "c"  a --check condition ("port=8080,state=LISTEN,user=app")
+ *
+ * For example: {"id": 7, "port": 8080}. Unknown keys are rejected rather
+ * than ignored, so a typo does not silently run a different query.
+ *
+ * @param line Query text, without the trailing newline
+ * @param req Output query (id is filled in as far as it was read, even on error)
+ * @param error Output: why the line was rejected (static string)
+ * @return 0 on success, -1 if the line is not a valid query
+ */
+int serve_parse(const char *line, serve_request_t *req, const char **error) {
+    const char *p = line;
+    int ops = 0;
+
+    memset(req, 0, sizeof(*req));
+    *error = "invalid JSON";
+
+    skip_space(&p);
+    if (*p != '{') {
+        *error = "query must be a JSON object";
+        return -1;
+    }
+    p++;
+    skip_space(&p);
+
+    while (*p != '}') {
+        char key[16];
+        if (parse_string(&p, key, sizeof(key)) < 0) {
+            *error = "unknown key";
+            return -1;
+        }
+        skip_space(&p);
+        if (*p != ':') {
+            return -1;
+        }
+        p++;
+        skip_space(&p);
+
+        if (strcmp(key, "id") == 0) {
+            if (copy_id(&p, req->id) < 0) {
+                *error = "id must be a string or an integer (at most 127 bytes)";
+                return -1;
+            }
+        } else if (strcmp(key, "check") == 0) {
+            req->op = SERVE_CHECK;
+            ops++;
+            if (parse_string(&p, req->check, sizeof(req->check)) < 0) {
+                *error = "check must be a string (at most 255 bytes)";
+                return -1;
+            }
+        } else if (strcmp(key, "port") == 0 || strcmp(key, "bound") == 0 ||
+                   strcmp(key, "pid") == 0) {
+            long long value;
+            if (parse_integer(&p, &value) < 0) {
+                *error = "port, bound and pid must be integers";
+                return -1;
+            }
+            ops++;
+            if (strcmp(key, "pid") == 0) {
+                if (value < 1 || value > INT_MAX) {
+                    *error = "pid out of range";
+                    return -1;
+                }
+                req->op = SERVE_PID;
+                req->pid = (pid_t)value;
+            } else {
+                if (value < 1 || value > 65535) {
+                    *error = "port out of range (1-65535)";
+                    return -1;
+                }
+                req->op = strcmp(key, "port") == 0 ? SERVE_PORT : SERVE_BOUND;
+                req->port = (int)value;
+            }
+        } else {
+            *error = "unknown key";
+            return -1;
+        }
+
+        skip_space(&p);
+        if (*p == ',') {
+            p++;
+            skip_space(&p);
+        } else if (*p != '}') {
+            return -1;
+        }
+    }
+    p++;
+    skip_space(&p);
+
+    if (*p != '\0') {
+        *error = "trailing characters after the query";
+        return -1;
+    }
+    if (ops != 1) {
+        *error = "query needs exactly one of port, pid, bound or check";
+        return -1;
+    }
+    return 0;
+}
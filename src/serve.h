@@ -0,0 +1,57 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* How long --serve-stdio reuses a socket-owner map between port queries */
+#define SERVE_INODE_TTL_MS 1000
+
+/* Longest "id" echoed back (as JSON text, quotes included) */
+#define SERVE_ID_SIZE 128
+
+/* Longest "check" condition */
+#define SERVE_CHECK_SIZE 256
+
+/**
+ * What a --serve-stdio query asks for
+ */
+typedef enum {
+    SERVE_PORT,     /* {"port": n}: connections on a port, with owners */
+    SERVE_PID,      /* {"pid": n}: one process */
+    SERVE_BOUND,    /* {"bound": n}: whether anything is bound to a port */
+    SERVE_CHECK     /* {"check": "port=n,..."}: --check condition */
+} serve_op_t;
+
+/**
+ * One parsed --serve-stdio query line
+ *
+ * Fields:
+ * - id: The query's "id" value as JSON text, copied verbatim into the
+ *   response (empty if the query had none)
+ * - op: What is asked for
+ * - port: Port (SERVE_PORT, SERVE_BOUND)
+ * - pid: Process ID (SERVE_PID)
+ * - check: Condition in --check syntax (SERVE_CHECK)
+ */
+typedef struct {
+    char id[SERVE_ID_SIZE];
+    serve_op_t op;
+    int port;
+    pid_t pid;
+    char check[SERVE_CHECK_SIZE];
+} serve_request_t;
+
+/**
+ * Parse one query line (a flat JSON object)
+ *
+ * See src/serve.c for detailed documentation.
+ *
+ * @param line Query text, without the trailing newline
+ * @param req Output query (id is filled in as far as it was read, even on error)
+ * @param error Output: why the line was rejected (static string)
+ * @return 0 on success, -1 if the line is not a valid query
+ */
+int serve_parse(const char *line, serve_request_t *req, const char **error);
+
+#endif /* SERVE_H */
@@ -0,0 +1,751 @@
+#include "snapshot.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(snapshot_process_t) == 768, "snapshot process records must stay 768 bytes");
+_Static_assert(sizeof(snapshot_socket_t) == 192, "snapshot socket records must stay 192 bytes");
+_Static_assert(sizeof(snapshot_buffer_t) == 64, "snapshot buffer header must stay 64 bytes");
+_Static_assert(sizeof(snapshot_header_t) == 128, "snapshot header must stay 128 bytes");
+
+/* Attempts at a consistent copy before a reader gives up (EAGAIN) */
+#define SNAPSHOT_READ_ATTEMPTS 64
+
+/**
+ * Turn a --publish-shm/--from-shm name into a shared-memory object name
+ *
+ * "wir" and "/wir" name the same segment; the name may not contain any
+ * other '/' (POSIX leaves those implementation-defined).
+ *
+ * @param name Name as given
+ * @param out Output object name
+ * @param size Size of out
+ * @return 0 on success, -1 if the name is empty, too long or has a '/' (errno EINVAL)
+ */
+static int segment_name(const char *name, char *out, size_t size) {
+    const int n = snprintf(out, size, "%s%s", name[0] == '/' ? "" : "/", name);
+    if (n < 2 || (size_t)n >= size || strchr(out + 1, '/')) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Check that a mapped header describes a complete segment of this version
+ *
+ * @param header Header at the start of the segment
+ * @param size Size of the segment in bytes
+ * @return true if the segment can be read with this layout
+ */
+static bool header_valid(const snapshot_header_t *header, size_t size) {
+    const uint64_t contents = sizeof(snapshot_buffer_t) +
+                              (uint64_t)header->process_capacity * sizeof(snapshot_process_t) +
+                              (uint64_t)header->socket_capacity * sizeof(snapshot_socket_t) +
+                              (uint64_t)header->owner_capacity * sizeof(int32_t);
+
+    return memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+           header->version == SNAPSHOT_VERSION &&
+           header->process_size == sizeof(snapshot_process_t) &&
+           header->socket_size == sizeof(snapshot_socket_t) &&
+           header->buffer_size >= contents &&
+           size == sizeof(snapshot_header_t) + 2 * header->buffer_size;
+}
+
+/**
+ * Locate one of the two buffers and its record arrays
+ *
+ * @param snap Mapped segment
+ * @param index Buffer (0 or 1)
+ * @return Buffer header; its processes, sockets and owners follow it
+ */
+static snapshot_buffer_t *buffer_at(const snapshot_t *snap, uint32_t index) {
+    return (snapshot_buffer_t *)((char *)snap->header + sizeof(snapshot_header_t) +
+                                 index * snap->header->buffer_size);
+}
+
+/* Record arrays of a buffer, in segment order: processes, sockets, owners */
+static snapshot_process_t *buffer_processes(snapshot_buffer_t *buffer) {
+    return (snapshot_process_t *)(buffer + 1);
+}
+
+static snapshot_socket_t *buffer_sockets(const snapshot_t *snap, snapshot_buffer_t *buffer) {
+    return (snapshot_socket_t *)(buffer_processes(buffer) + snap->header->process_capacity);
+}
+
+static int32_t *buffer_owners(const snapshot_t *snap, snapshot_buffer_t *buffer) {
+    return (int32_t *)(buffer_sockets(snap, buffer) + snap->header->socket_capacity);
+}
+
+/**
+ * Copy a string field, truncating it to the destination
+ *
+ * The source need not be terminated within its field (a reader may be
+ * copying a record that is being rewritten).
+ *
+ * @param dst Destination field
+ * @param size Size of dst
+ * @param src Source field
+ * @param src_size Size of src
+ * @return void
+ */
+static void copy_text(char *dst, size_t size, const char *src, size_t src_size) {
+    size_t n = strnlen(src, src_size);
+    if (n >= size) {
+        n = size - 1;
+    }
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+/**
+ * Create the segment and publish into it (publisher only)
+ *
+ * The segment holds two buffers of max_bytes / 2, each split between
+ * process records (half), socket records (three eighths) and owner PIDs
+ * (one eighth); what does not fit is left out and the snapshot is flagged
+ * SNAPSHOT_TRUNCATED. Memory is only used as far as snapshots fill it.
+ *
+ * A segment of the same name left by a publisher that has exited is
+ * replaced (readers that still map it keep their copy until they unmap).
+ * One whose publisher is still running, or that is not a wir snapshot, is
+ * refused. The segment is locked (flock, where the system supports it on
+ * shared memory) for as long as it is published.
+ *
+ * The segment holds every process's command line, owner and sockets, so it
+ * is created with mode 0600: only the publisher's user (and root) can read
+ * it, as with /proc mounted hidepid=.
+ *
+ * @param name Segment name ("/wir" or "wir")
+ * @param max_bytes Segment size in bytes
+ * @param interval Seconds between snapshots, stored for readers
+ * @param snap Output segment
+ * @return 0 on success, -1 on error (errno set; EINVAL for a bad name,
+ *         EEXIST for a foreign segment, EWOULDBLOCK if another publisher
+ *         holds it)
+ */
+int snapshot_create(const char *name, size_t max_bytes, int interval, snapshot_t *snap) {
+    memset(snap, 0, sizeof(*snap));
+    snap->fd = -1;
+    if (segment_name(name, snap->name, sizeof(snap->name)) < 0) {
+        return -1;
+    }
+
+    int fd = shm_open(snap->name, O_RDWR | O_CLOEXEC, 0);
+    if (fd >= 0) {
+        struct stat st;
+        bool ours = false;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(snapshot_header_t)) {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                ours = header_valid(map, (size_t)st.st_size);
+                munmap(map, (size_t)st.st_size);
+            }
+        }
+        const bool busy = flock(fd, LOCK_EX | LOCK_NB) < 0 && errno == EWOULDBLOCK;
+        close(fd);
+
+        if (!ours) {
+            errno = EEXIST;
+            return -1;
+        }
+        if (busy) {
+            errno = EWOULDBLOCK;
+            return -1;
+        }
+        shm_unlink(snap->name);
+    }
+
+    size_t share = sizeof(snapshot_buffer_t);
+    if (max_bytes > sizeof(snapshot_header_t) + 2 * share) {
+        share = (max_bytes - sizeof(snapshot_header_t)) / 2 - sizeof(snapshot_buffer_t);
+    }
+    const size_t process_capacity = share / 2 / sizeof(snapshot_process_t);
+    const size_t socket_capacity = share * 3 / 8 / sizeof(snapshot_socket_t);
+    const size_t owner_capacity = share / 8 / sizeof(int32_t);
+
+    /* Keep both buffers cache-line aligned */
+    const size_t buffer_size =
+        (sizeof(snapshot_buffer_t) + process_capacity * sizeof(snapshot_process_t) +
+         socket_capacity * sizeof(snapshot_socket_t) + owner_capacity * sizeof(int32_t) + 63) &
+        ~(size_t)63;
+    const size_t size = sizeof(snapshot_header_t) + 2 * buffer_size;
+
+    fd = shm_open(snap->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    flock(fd, LOCK_EX | LOCK_NB);
+
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        const int saved = errno;
+        shm_unlink(snap->name);
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    /* The segment is zero-filled: both sequences are 0, nothing is published yet */
+    snapshot_header_t *header = map;
+    header->version = SNAPSHOT_VERSION;
+    header->process_size = sizeof(snapshot_process_t);
+    header->socket_size = sizeof(snapshot_socket_t);
+    header->process_capacity = (uint32_t)process_capacity;
+    header->socket_capacity = (uint32_t)socket_capacity;
+    header->owner_capacity = (uint32_t)owner_capacity;
+    header->buffer_size = buffer_size;
+    header->publisher = (int32_t)getpid();
+    header->interval = (uint32_t)interval;
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+
+    snap->header = header;
+    snap->map_size = size;
+    snap->fd = fd;
+    return 0;
+}
+
+/**
+ * Start filling the buffer readers are not using (publisher only)
+ *
+ * Makes the buffer's sequence odd first, so a reader still copying from it
+ * (one that started a whole interval ago) sees the change and retries.
+ *
+ * @param snap Segment from snapshot_create()
+ * @return void
+ */
+void snapshot_begin(snapshot_t *snap) {
+    snapshot_header_t *header = snap->header;
+    snap->writing = 1 - atomic_load_explicit(&header->current, memory_order_relaxed);
+
+    const uint64_t sequence =
+        atomic_load_explicit(&header->sequence[snap->writing], memory_order_relaxed);
+    atomic_store_explicit(&header->sequence[snap->writing], sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    snapshot_buffer_t *buffer = buffer_at(snap, snap->writing);
+    buffer->process_count = 0;
+    buffer->socket_count = 0;
+    buffer->owner_count = 0;
+    buffer->flags = 0;
+}
+
+/**
+ * Add one process to the snapshot being filled (publisher only)
+ *
+ * @param snap Segment between snapshot_begin() and snapshot_commit()
+ * @param info Process (every field is stored)
+ * @return true if stored, false if the buffer is full
+ */
+bool snapshot_add_process(snapshot_t *snap, const process_info_t *info) {
+    snapshot_buffer_t *buffer = buffer_at(snap, snap->writing);
+    if (buffer->process_count >= snap->header->process_capacity) {
+        buffer->flags |= SNAPSHOT_TRUNCATED;
+        return false;
+    }
+
+    snapshot_process_t *r = &buffer_processes(buffer)[buffer->process_count++];
+    memset(r, 0, sizeof(*r));
+    r->start_time = (int64_t)info->start_time;
+    r->vsz = info->vsz;
+    r->rss = info->rss;
+    r->pid = (int32_t)info->pid;
+    r->ppid = (int32_t)info->ppid;
+    r->uid = (int32_t)info->uid;
+    r->state = info->state;
+    copy_text(r->name, sizeof(r->name), info->name, sizeof(info->name));
+    copy_text(r->username, sizeof(r->username), info->username, sizeof(info->username));
+    copy_text(r->cmdline, sizeof(r->cmdline), info->cmdline, sizeof(info->cmdline));
+    return true;
+}
+
+/**
+ * Add one socket, with its owners, to the snapshot being filled (publisher only)
+ *
+ * If the owner array is full the socket is still stored, with its lowest
+ * owner as pid but no owner list, and the snapshot is flagged truncated.
+ *
+ * @param snap Segment between snapshot_begin() and snapshot_commit()
+ * @param conn Socket (TCP internals are not stored)
+ * @return true if stored, false if the buffer is full
+ */
+bool snapshot_add_socket(snapshot_t *snap, const connection_info_t *conn) {
+    snapshot_buffer_t *buffer = buffer_at(snap, snap->writing);
+    if (buffer->socket_count >= snap->header->socket_capacity) {
+        buffer->flags |= SNAPSHOT_TRUNCATED;
+        return false;
+    }
+
+    snapshot_socket_t *r = &buffer_sockets(snap, buffer)[buffer->socket_count++];
+    memset(r, 0, sizeof(*r));
+    copy_text(r->local_addr, sizeof(r->local_addr), conn->local_addr, sizeof(conn->local_addr));
+    copy_text(r->remote_addr, sizeof(r->remote_addr), conn->remote_addr,
+              sizeof(conn->remote_addr));
+    copy_text(r->state, sizeof(r->state), conn->state, sizeof(conn->state));
+    copy_text(r->protocol, sizeof(r->protocol), conn->protocol, sizeof(conn->protocol));
+    r->local_port = conn->local_port;
+    r->remote_port = conn->remote_port;
+    r->rx_queue = conn->rx_queue;
+    r->tx_queue = conn->tx_queue;
+    r->backlog = conn->backlog;
+    r->pid = (int32_t)conn->pid;
+
+    const uint32_t owners = conn->owner_count > 0 ? (uint32_t)conn->owner_count : 0;
+    if (buffer->owner_count + owners > snap->header->owner_capacity) {
+        buffer->flags |= SNAPSHOT_TRUNCATED;
+        return true;
+    }
+    int32_t *pool = buffer_owners(snap, buffer);
+    for (uint32_t i = 0; i < owners; i++) {
+        pool[buffer->owner_count + i] = (int32_t)conn->owners[i];
+    }
+    r->owner_first = buffer->owner_count;
+    r->owner_count = owners;
+    buffer->owner_count += owners;
+    return true;
+}
+
+/**
+ * Compare two process records by PID for qsort()
+ */
+static int compare_process_pids(const void *a, const void *b) {
+    const int32_t x = ((const snapshot_process_t *)a)->pid;
+    const int32_t y = ((const snapshot_process_t *)b)->pid;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Compare two socket records by local port, then protocol, for qsort()
+ *
+ * "TCP" < "TCP6" < "UDP" < "UDP6", the order a live port query reports.
+ */
+static int compare_socket_ports(const void *a, const void *b) {
+    const snapshot_socket_t *x = a;
+    const snapshot_socket_t *y = b;
+    if (x->local_port != y->local_port) {
+        return (x->local_port > y->local_port) - (x->local_port < y->local_port);
+    }
+    const int cmp = strcmp(x->protocol, y->protocol);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (x->remote_port > y->remote_port) - (x->remote_port < y->remote_port);
+}
+
+/**
+ * Publish the filled buffer (publisher only)
+ *
+ * Sorts the records for in-place lookup, completes the buffer's sequence
+ * and points readers at it. The other buffer stays intact until the next
+ * snapshot_begin(), so readers already copying from it finish undisturbed.
+ *
+ * @param snap Segment after snapshot_begin() and the adds
+ * @param time Snapshot time (seconds since epoch)
+ * @return void
+ */
+void snapshot_commit(snapshot_t *snap, int64_t time) {
+    snapshot_header_t *header = snap->header;
+    snapshot_buffer_t *buffer = buffer_at(snap, snap->writing);
+
+    qsort(buffer_processes(buffer), buffer->process_count, sizeof(snapshot_process_t),
+          compare_process_pids);
+    qsort(buffer_sockets(snap, buffer), buffer->socket_count, sizeof(snapshot_socket_t),
+          compare_socket_ports);
+    buffer->time = time;
+
+    const uint64_t sequence =
+        atomic_load_explicit(&header->sequence[snap->writing], memory_order_relaxed);
+    atomic_store_explicit(&header->sequence[snap->writing], sequence + 1, memory_order_release);
+    atomic_store_explicit(&header->current, snap->writing, memory_order_release);
+}
+
+/**
+ * Map a published segment for reading
+ *
+ * Maps the segment read-only. Nothing is parsed: after the header check
+ * lookups run on the records in place and copy out only their answer.
+ *
+ * @param name Segment name ("/wir" or "wir")
+ * @param snap Output segment
+ * @return 0 on success, -1 on error (errno set; ENOENT if nothing is
+ *         published under the name, EINVAL if it is not a wir snapshot)
+ */
+int snapshot_open(const char *name, snapshot_t *snap) {
+    memset(snap, 0, sizeof(*snap));
+    snap->fd = -1;
+    if (segment_name(name, snap->name, sizeof(snap->name)) < 0) {
+        return -1;
+    }
+
+    const int fd = shm_open(snap->name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    void *map = MAP_FAILED;
+    if ((size_t)st.st_size >= sizeof(snapshot_header_t)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED || !header_valid(map, (size_t)st.st_size)) {
+        if (map != MAP_FAILED) {
+            munmap(map, (size_t)st.st_size);
+        }
+        errno = EINVAL;
+        return -1;
+    }
+
+    snap->header = map;
+    snap->map_size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * Start a read: pick the published buffer and note its sequence
+ *
+ * @param snap Open segment
+ * @param index Output: buffer read
+ * @param sequence Output: its sequence (0 if nothing is published yet)
+ * @return Buffer, or NULL if nothing is published or it is being rewritten
+ */
+static snapshot_buffer_t *read_begin(const snapshot_t *snap, uint32_t *index,
+                                     uint64_t *sequence) {
+    snapshot_header_t *header = snap->header;
+
+    *index = atomic_load_explicit(&header->current, memory_order_acquire) & 1u;
+    *sequence = atomic_load_explicit(&header->sequence[*index], memory_order_acquire);
+    return *sequence != 0 && (*sequence & 1) == 0 ? buffer_at(snap, *index) : NULL;
+}
+
+/**
+ * Finish a read: check the buffer was not rewritten while it was copied
+ *
+ * @param snap Open segment
+ * @param index Buffer from read_begin()
+ * @param sequence Sequence from read_begin()
+ * @return true if the copy is consistent
+ */
+static bool read_end(const snapshot_t *snap, uint32_t index, uint64_t sequence) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&snap->header->sequence[index], memory_order_relaxed) == sequence;
+}
+
+/* Counts as stored, bounded by the capacities (a torn read may see anything) */
+static uint32_t bounded(uint32_t value, uint32_t capacity) {
+    return value < capacity ? value : capacity;
+}
+
+/**
+ * Copy a process record into a process_info_t
+ *
+ * The record may be torn (the copy is validated afterwards), so strings
+ * are copied with their field size as the limit.
+ *
+ * @param r Record in the segment
+ * @param info Output process
+ * @return void
+ */
+static void to_process_info(const snapshot_process_t *r, process_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    info->pid = r->pid;
+    info->ppid = r->ppid;
+    info->uid = r->uid;
+    info->state = r->state;
+    info->vsz = (unsigned long)r->vsz;
+    info->rss = (unsigned long)r->rss;
+    info->start_time = (time_t)r->start_time;
+    copy_text(info->name, sizeof(info->name), r->name, sizeof(r->name));
+    copy_text(info->username, sizeof(info->username), r->username, sizeof(r->username));
+    copy_text(info->cmdline, sizeof(info->cmdline), r->cmdline, sizeof(r->cmdline));
+}
+
+/**
+ * Look up one process in the published snapshot
+ *
+ * Binary search over the records in place; only the match is copied.
+ *
+ * @param snap Open segment
+ * @param pid Process ID
+ * @param info Output process
+ * @return 0 on success, -1 on error (errno ESRCH if the snapshot has no
+ *         such process, EAGAIN if nothing is published or no consistent
+ *         copy could be made)
+ */
+int snapshot_get_process(const snapshot_t *snap, pid_t pid, process_info_t *info) {
+    for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++) {
+        uint32_t index;
+        uint64_t sequence;
+        snapshot_buffer_t *buffer = read_begin(snap, &index, &sequence);
+        if (!buffer) {
+            if (sequence == 0) {
+                break;
+            }
+            continue;
+        }
+
+        const snapshot_process_t *procs = buffer_processes(buffer);
+        int low = 0;
+        int high = (int)bounded(buffer->process_count, snap->header->process_capacity) - 1;
+        int found = -1;
+        while (low <= high) {
+            const int mid = low + (high - low) / 2;
+            if (procs[mid].pid == pid) {
+                found = mid;
+                break;
+            }
+            if (procs[mid].pid < pid) {
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+
+        snapshot_process_t copy;
+        if (found >= 0) {
+            memcpy(&copy, &procs[found], sizeof(copy));
+        }
+        if (!read_end(snap, index, sequence)) {
+            continue;
+        }
+
+        if (found < 0) {
+            errno = ESRCH;
+            return -1;
+        }
+        to_process_info(&copy, info);
+        return 0;
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+/**
+ * Copy every process of the published snapshot, in PID order
+ *
+ * @param snap Open segment
+ * @param processes Output: array of processes (caller must free)
+ * @param count Output: number of processes
+ * @return 0 on success, -1 on error (errno EAGAIN if nothing is published
+ *         or no consistent copy could be made, ENOMEM if memory is exhausted)
+ */
+int snapshot_get_processes(const snapshot_t *snap, process_info_t **processes, int *count) {
+    for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++) {
+        uint32_t index;
+        uint64_t sequence;
+        snapshot_buffer_t *buffer = read_begin(snap, &index, &sequence);
+        if (!buffer) {
+            if (sequence == 0) {
+                break;
+            }
+            continue;
+        }
+
+        const snapshot_process_t *procs = buffer_processes(buffer);
+        const uint32_t n = bounded(buffer->process_count, snap->header->process_capacity);
+        process_info_t *out = counted_malloc((n > 0 ? n : 1) * sizeof(process_info_t));
+        if (!out) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            to_process_info(&procs[i], &out[i]);
+        }
+
+        if (!read_end(snap, index, sequence)) {
+            free(out);
+            continue;
+        }
+
+        *processes = out;
+        *count = (int)n;
+        return 0;
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+/**
+ * Copy the sockets on a port from the published snapshot
+ *
+ * Finds the port's run of records by binary search and copies only that
+ * run. The result has the layout of platform_get_port_connections(): the
+ * owner lists follow the records in the same allocation, so one free()
+ * releases everything. Sockets carry no TCP internals or inode.
+ *
+ * @param snap Open segment
+ * @param port Port number, or 0 for every socket
+ * @param connections Output: array of connections (caller must free)
+ * @param count Output: number of connections
+ * @return 0 on success, -1 on error (errno EAGAIN if nothing is published
+ *         or no consistent copy could be made, ENOMEM if memory is exhausted)
+ */
+int snapshot_get_port_connections(const snapshot_t *snap, int port,
+                                  connection_info_t **connections, int *count) {
+    const uint32_t owner_capacity = snap->header->owner_capacity;
+
+    for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++) {
+        uint32_t index;
+        uint64_t sequence;
+        snapshot_buffer_t *buffer = read_begin(snap, &index, &sequence);
+        if (!buffer) {
+            if (sequence == 0) {
+                break;
+            }
+            continue;
+        }
+
+        const snapshot_socket_t *socks = buffer_sockets(snap, buffer);
+        const int32_t *pool = buffer_owners(snap, buffer);
+        const uint32_t total = bounded(buffer->socket_count, snap->header->socket_capacity);
+
+        /* The port's run: [first, end) */
+        uint32_t first = 0;
+        uint32_t end = total;
+        if (port > 0) {
+            uint32_t low = 0;
+            uint32_t high = total;
+            while (low < high) {
+                const uint32_t mid = low + (high - low) / 2;
+                if (socks[mid].local_port < port) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            first = low;
+            end = first;
+            while (end < total && socks[end].local_port == port) {
+                end++;
+            }
+        }
+
+        size_t owners = 0;
+        for (uint32_t i = first; i < end; i++) {
+            owners += bounded(socks[i].owner_count, owner_capacity);
+        }
+
+        const size_t n = end - first;
+        const size_t records = (n > 0 ? n : 1) * sizeof(connection_info_t);
+        connection_info_t *conns = counted_malloc(records + owners * sizeof(pid_t));
+        if (!conns) {
+            return -1;
+        }
+        pid_t *tail = (pid_t *)((char *)conns + records);
+        size_t used = 0;
+
+        for (size_t k = 0; k < n; k++) {
+            const snapshot_socket_t *r = &socks[first + k];
+            connection_info_t *conn = &conns[k];
+            memset(conn, 0, sizeof(*conn));
+            copy_text(conn->local_addr, sizeof(conn->local_addr), r->local_addr,
+                      sizeof(r->local_addr));
+            copy_text(conn->remote_addr, sizeof(conn->remote_addr), r->remote_addr,
+                      sizeof(r->remote_addr));
+            copy_text(conn->state, sizeof(conn->state), r->state, sizeof(r->state));
+            copy_text(conn->protocol, sizeof(conn->protocol), r->protocol, sizeof(r->protocol));
+            conn->local_port = r->local_port;
+            conn->remote_port = r->remote_port;
+            conn->rx_queue = r->rx_queue;
+            conn->tx_queue = r->tx_queue;
+            conn->backlog = r->backlog;
+            conn->pid = r->pid;
+
+            /* Bounds re-checked here: the sum above may have seen other values */
+            const uint32_t from = r->owner_first;
+            const uint32_t len = bounded(r->owner_count, owner_capacity);
+            if (len > 0 && from <= owner_capacity - len && used + len <= owners) {
+                for (uint32_t i = 0; i < len; i++) {
+                    tail[used + i] = pool[from + i];
+                }
+                conn->owners = tail + used;
+                conn->owner_count = (int)len;
+                used += len;
+            }
+        }
+
+        if (!read_end(snap, index, sequence)) {
+            free(conns);
+            continue;
+        }
+
+        *connections = conns;
+        *count = (int)n;
+        return 0;
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+/**
+ * Get the time of the published snapshot
+ *
+ * Readers compare it with the publishing interval to notice a publisher
+ * that has stopped.
+ *
+ * @param snap Open segment
+ * @param flags Output: the snapshot's flags (SNAPSHOT_TRUNCATED), may be NULL
+ * @return Snapshot time (seconds since epoch), -1 if nothing is published
+ */
+int64_t snapshot_time(const snapshot_t *snap, uint32_t *flags) {
+    for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++) {
+        uint32_t index;
+        uint64_t sequence;
+        snapshot_buffer_t *buffer = read_begin(snap, &index, &sequence);
+        if (!buffer) {
+            if (sequence == 0) {
+                break;
+            }
+            continue;
+        }
+
+        const int64_t time = buffer->time;
+        const uint32_t bits = buffer->flags;
+        if (read_end(snap, index, sequence)) {
+            if (flags) {
+                *flags = bits;
+            }
+            return time;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Unmap a segment; a publisher also removes it and releases its lock
+ *
+ * Readers that still map a removed segment keep reading its last
+ * snapshot; new readers get ENOENT.
+ *
+ * @param snap Segment to close
+ * @return void
+ */
+void snapshot_close(snapshot_t *snap) {
+    if (snap->header) {
+        munmap(snap->header, snap->map_size);
+    }
+    if (snap->fd >= 0) {
+        shm_unlink(snap->name);
+        close(snap->fd);
+    }
+    memset(snap, 0, sizeof(*snap));
+    snap->fd = -1;
+}
@@ -0,0 +1,160 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+/* Segment signature and layout version */
+#define SNAPSHOT_MAGIC "WIRSNAP"
+#define SNAPSHOT_VERSION 1
+
+/* Default segment size for --publish-shm (--max-size), in MiB */
+#define SNAPSHOT_DEFAULT_MAX_MB 64
+
+/* Default time between snapshots (--interval), in seconds */
+#define SNAPSHOT_DEFAULT_INTERVAL 1
+
+/* Buffer flag: some processes, sockets or owners did not fit */
+#define SNAPSHOT_TRUNCATED 0x1u
+
+/**
+ * One process, exactly as stored in the segment
+ *
+ * Fixed 768-byte records in native byte order, sorted by PID, so a reader
+ * binary-searches them in place. Strings are NUL-terminated and truncated
+ * to their field.
+ */
+typedef struct {
+    int64_t start_time;
+    uint64_t vsz;
+    uint64_t rss;
+    int32_t pid;
+    int32_t ppid;
+    int32_t uid;
+    char state;
+    char reserved[3];
+    char name[64];
+    char username[32];
+    char cmdline[632];
+} snapshot_process_t;
+
+/**
+ * One socket, exactly as stored in the segment
+ *
+ * Fixed 192-byte records sorted by local port (TCP before UDP within a
+ * port, as platform_get_port_connections() lists them). The owning PIDs
+ * are owner_count entries of the buffer's owner array from owner_first.
+ */
+typedef struct {
+    char local_addr[64];
+    char remote_addr[64];
+    char state[16];
+    char protocol[8];
+    int32_t local_port;
+    int32_t remote_port;
+    uint32_t rx_queue;
+    uint32_t tx_queue;
+    int32_t backlog;
+    int32_t pid;
+    uint32_t owner_first;
+    uint32_t owner_count;
+    char reserved[8];
+} snapshot_socket_t;
+
+/**
+ * Header of one of the two snapshot buffers (64 bytes)
+ *
+ * Followed by process_capacity process records, socket_capacity socket
+ * records and owner_capacity owner PIDs (see snapshot_header_t).
+ */
+typedef struct {
+    int64_t time;
+    uint32_t process_count;
+    uint32_t socket_count;
+    uint32_t owner_count;
+    uint32_t flags;
+    char pad[40];
+} snapshot_buffer_t;
+
+/**
+ * Segment header (first 128 bytes of the segment)
+ *
+ * The segment holds two buffers. The publisher fills the one readers are
+ * not pointed at, then points `current` at it, so a reader is only ever
+ * disturbed if a whole publishing interval passes while it copies its
+ * answer. Each buffer has its own sequence counter (a seqlock): odd while
+ * the buffer is being written, bumped again when it is complete.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t process_size;
+    uint32_t socket_size;
+    uint32_t process_capacity;
+    uint32_t socket_capacity;
+    uint32_t owner_capacity;
+    uint64_t buffer_size;
+    int32_t publisher;
+    uint32_t interval;
+    _Atomic uint32_t current;
+    uint32_t reserved;
+    _Atomic uint64_t sequence[2];
+    char pad[56];
+} snapshot_header_t;
+
+/**
+ * Mapped snapshot segment
+ *
+ * Fields:
+ * - header: Mapped header
+ * - map_size: Size of the mapping
+ * - fd: Locked descriptor of a publisher, -1 for a reader
+ * - name: Shared-memory object name (with its leading '/')
+ * - writing: Buffer being filled between snapshot_begin() and
+ *   snapshot_commit() (publisher only)
+ */
+typedef struct {
+    snapshot_header_t *header;
+    size_t map_size;
+    int fd;
+    char name[256];
+    uint32_t writing;
+} snapshot_t;
+
+/**
+ * Publisher functions
+ *
+ * See src/snapshot.c for detailed documentation of each function.
+ */
+int snapshot_create(const char *name, size_t max_bytes, int interval, snapshot_t *snap);
+void snapshot_begin(snapshot_t *snap);
+bool snapshot_add_process(snapshot_t *snap, const process_info_t *info);
+bool snapshot_add_socket(snapshot_t *snap, const connection_info_t *conn);
+void snapshot_commit(snapshot_t *snap, int64_t time);
+
+/**
+ * Reader functions
+ *
+ * See src/snapshot.c for detailed documentation of each function.
+ */
+int snapshot_open(const char *name, snapshot_t *snap);
+int snapshot_get_process(const snapshot_t *snap, pid_t pid, process_info_t *info);
+int snapshot_get_processes(const snapshot_t *snap, process_info_t **processes, int *count);
+int snapshot_get_port_connections(const snapshot_t *snap, int port,
+                                  connection_info_t **connections, int *count);
+int64_t snapshot_time(const snapshot_t *snap, uint32_t *flags);
+
+/**
+ * Unmap a segment (and, for a publisher, remove it)
+ *
+ * See src/snapshot.c for detailed documentation.
+ *
+ * @param snap Segment to close
+ * @return void
+ */
+void snapshot_close(snapshot_t *snap);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,234 @@
+#include "sockdiag.h"
+#include <errno.h>
+
+#ifdef __linux__
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Receive buffer for dump replies; the kernel fills it with as many messages as fit */
+#define SOCKDIAG_RECV_BYTES 32768
+
+/**
+ * Dump request: header, inet_diag request and an optional port filter
+ *
+ * The filter is inet_diag bytecode for "sport >= low && sport <= high",
+ * the same form ss(8) builds for "sport = :port" when low == high. Each comparison is an op
+ * followed by a second op whose `no` field carries the port; `yes`/`no` are
+ * byte offsets to jump by, landing exactly on the end to accept a socket and
+ * 4 bytes past it to reject it.
+ */
+typedef struct {
+    struct nlmsghdr nlh;
+    struct inet_diag_req_v2 req;
+    struct rtattr bytecode;
+    struct inet_diag_bc_op ops[4];
+} sockdiag_request_t;
+
+/**
+ * Copy one inet_diag reply into the portable socket record
+ *
+ * The requested extensions arrive as netlink attributes after the fixed
+ * message; the record points into the receive buffer rather than copying them.
+ *
+ * @param nlh Reply message (header, inet_diag_msg, attributes)
+ * @param protocol Protocol the dump was for
+ * @param sock Output record
+ * @return void
+ */
+static void fill_socket(const struct nlmsghdr *nlh, int protocol, sockdiag_socket_t *sock) {
+    const struct inet_diag_msg *msg = NLMSG_DATA(nlh);
+
+    memset(sock, 0, sizeof(*sock));
+    sock->family = msg->idiag_family;
+    sock->protocol = protocol;
+    sock->state = msg->idiag_state;
+    sock->local_port = ntohs(msg->id.idiag_sport);
+    sock->remote_port = ntohs(msg->id.idiag_dport);
+    memcpy(sock->local_addr, msg->id.idiag_src, sizeof(sock->local_addr));
+    memcpy(sock->remote_addr, msg->id.idiag_dst, sizeof(sock->remote_addr));
+    sock->uid = msg->idiag_uid;
+    sock->inode = msg->idiag_inode;
+    sock->rqueue = msg->idiag_rqueue;
+    sock->wqueue = msg->idiag_wqueue;
+
+    int len = (int)(nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*msg)));
+    for (const struct rtattr *attr = (const struct rtattr *)(msg + 1); RTA_OK(attr, len);
+         attr = RTA_NEXT(attr, len)) {
+        if (attr->rta_type == INET_DIAG_INFO) {
+            sock->tcp_info = RTA_DATA(attr);
+            sock->tcp_info_len = RTA_PAYLOAD(attr);
+        } else if (attr->rta_type == INET_DIAG_SKMEMINFO) {
+            sock->meminfo = RTA_DATA(attr);
+            sock->meminfo_count = RTA_PAYLOAD(attr) / sizeof(uint32_t);
+        }
+    }
+}
+
+/**
+ * Dump the sockets of one family and protocol through NETLINK_SOCK_DIAG
+ *
+ * Asks the kernel for the matching sockets directly instead of formatting
+ * and parsing /proc/net text. Both filters run in the kernel: the state mask
+ * decides which hash tables are walked at all (a TCP dump for LISTEN only
+ * never touches established connections), and a non-zero port attaches a
+ * bytecode filter so only sockets bound to that port are copied out. On a
+ * host with 100k connections, checking one listener costs microseconds.
+ * sockdiag_dump_range() filters on a range of local ports the same way.
+ *
+ * Extensions (TCP internals, socket memory) are filled in by the kernel in
+ * the same dump, so they cost no extra system call per socket.
+ *
+ * Works unprivileged. Fails with ENOENT when the protocol's diag module is
+ * missing (udp_diag is not always loaded), in which case callers fall back
+ * to /proc/net.
+ *
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param ext Mask of SOCKDIAG_EXT_* attributes to include with each socket
+ * @param port Only report sockets bound to this local port (0 = all)
+ * @param fn Callback invoked once per socket; returning false ends the dump
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if sock_diag is unavailable (errno set)
+ */
+int sockdiag_dump(int family, int protocol, unsigned int states, unsigned int ext,
+                  int port, sockdiag_fn fn, void *ctx) {
+    return sockdiag_dump_range(family, protocol, states, ext, port, port, fn, ctx);
+}
+
+/**
+ * Dump the sockets whose local port is in a range through NETLINK_SOCK_DIAG
+ *
+ * Same as sockdiag_dump() with the kernel filter widened to low..high.
+ *
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param ext Mask of SOCKDIAG_EXT_* attributes to include with each socket
+ * @param low Lowest local port to report (0 = no filter)
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket; returning false ends the dump
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if sock_diag is unavailable (errno set)
+ */
+int sockdiag_dump_range(int family, int protocol, unsigned int states, unsigned int ext,
+                        int low, int high, sockdiag_fn fn, void *ctx) {
+    const int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sockdiag_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.nlh.nlmsg_len = offsetof(sockdiag_request_t, bytecode);
+    request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.req.sdiag_family = (uint8_t)family;
+    request.req.sdiag_protocol = (uint8_t)protocol;
+    request.req.idiag_states = states;
+    if (ext & SOCKDIAG_EXT_TCP_INFO) {
+        request.req.idiag_ext |= 1u << (INET_DIAG_INFO - 1);
+    }
+    if (ext & SOCKDIAG_EXT_MEMINFO) {
+        request.req.idiag_ext |= 1u << (INET_DIAG_SKMEMINFO - 1);
+    }
+
+    if (low > 0) {
+        request.bytecode.rta_type = INET_DIAG_REQ_BYTECODE;
+        request.bytecode.rta_len = RTA_LENGTH(sizeof(request.ops));
+        request.ops[0] = (struct inet_diag_bc_op){INET_DIAG_BC_S_GE, 8, 20};
+        request.ops[1] = (struct inet_diag_bc_op){0, 0, (unsigned short)low};
+        request.ops[2] = (struct inet_diag_bc_op){INET_DIAG_BC_S_LE, 8, 12};
+        request.ops[3] = (struct inet_diag_bc_op){0, 0, (unsigned short)high};
+        request.nlh.nlmsg_len = sizeof(request);
+    }
+
+    struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+    if (sendto(fd, &request, request.nlh.nlmsg_len, 0,
+               (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+        const int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    uint32_t buf[SOCKDIAG_RECV_BYTES / sizeof(uint32_t)];
+    for (;;) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            const int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                close(fd);
+                return 0;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = NLMSG_DATA(nlh);
+                close(fd);
+                errno = err->error < 0 ? -err->error : EIO;
+                return -1;
+            }
+            if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+                continue;
+            }
+
+            sockdiag_socket_t sock;
+            fill_socket(nlh, protocol, &sock);
+            if (!fn(ctx, &sock)) {
+                /* Closing the socket abandons the rest of the dump */
+                close(fd);
+                return 0;
+            }
+        }
+    }
+}
+
+#else
+
+/**
+ * Dump sockets through NETLINK_SOCK_DIAG (not available on this platform)
+ *
+ * @return -1 with errno ENOSYS
+ */
+int sockdiag_dump(int family, int protocol, unsigned int states, unsigned int ext,
+                  int port, sockdiag_fn fn, void *ctx) {
+    (void)family;
+    (void)protocol;
+    (void)states;
+    (void)ext;
+    (void)port;
+    (void)fn;
+    (void)ctx;
+    errno = ENOSYS;
+    return -1;
+}
+
+/**
+ * Dump sockets in a port range through NETLINK_SOCK_DIAG (not available on this platform)
+ *
+ * @return -1 with errno ENOSYS
+ */
+int sockdiag_dump_range(int family, int protocol, unsigned int states, unsigned int ext,
+                        int low, int high, sockdiag_fn fn, void *ctx) {
+    (void)low;
+    (void)high;
+    return sockdiag_dump(family, protocol, states, ext, 0, fn, ctx);
+}
+
+#endif
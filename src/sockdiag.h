@@ -0,0 +1,101 @@
+#ifndef SOCKDIAG_H
+#define SOCKDIAG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel socket states (include/net/tcp_states.h), as used by sock_diag */
+#define SOCKDIAG_ESTABLISHED 1
+#define SOCKDIAG_CLOSE       7
+#define SOCKDIAG_LISTEN      10
+
+/* State masks for sockdiag_dump() */
+#define SOCKDIAG_STATE(st)   (1u << (st))
+#define SOCKDIAG_ALL_STATES  0xFFFu
+
+/* Extra per-socket attributes for sockdiag_dump() (TCP only) */
+#define SOCKDIAG_EXT_TCP_INFO 0x01u  /* struct tcp_info (INET_DIAG_INFO) */
+#define SOCKDIAG_EXT_MEMINFO  0x02u  /* socket memory (INET_DIAG_SKMEMINFO) */
+
+/**
+ * One socket as reported by a sock_diag dump
+ *
+ * Fields:
+ * - family: AF_INET or AF_INET6
+ * - protocol: IPPROTO_TCP or IPPROTO_UDP
+ * - state: Kernel socket state (SOCKDIAG_LISTEN, ...); UDP sockets report
+ *   SOCKDIAG_CLOSE when unconnected
+ * - local_port, remote_port: Ports in host byte order
+ * - local_addr, remote_addr: Addresses in network byte order (4 or 16 bytes used)
+ * - uid: UID that created the socket
+ * - inode: Socket inode
+ * - rqueue, wqueue: Receive/send queue bytes; for a listener, the accept
+ *   queue length and the listen backlog
+ * - tcp_info, tcp_info_len: Kernel struct tcp_info as sent (may be shorter
+ *   than the caller's definition on older kernels), NULL unless requested
+ * - meminfo, meminfo_count: SK_MEMINFO_* counters, NULL unless requested
+ */
+typedef struct {
+    int family;
+    int protocol;
+    int state;
+    int local_port;
+    int remote_port;
+    uint8_t local_addr[16];
+    uint8_t remote_addr[16];
+    unsigned int uid;
+    unsigned long inode;
+    unsigned int rqueue;
+    unsigned int wqueue;
+    const void *tcp_info;
+    size_t tcp_info_len;
+    const uint32_t *meminfo;
+    size_t meminfo_count;
+} sockdiag_socket_t;
+
+/**
+ * Callback receiving one socket of a dump
+ *
+ * @param ctx Caller context
+ * @param sock Socket (only valid during the call)
+ * @return false to stop the dump early, true to continue
+ */
+typedef bool (*sockdiag_fn)(void *ctx, const sockdiag_socket_t *sock);
+
+/**
+ * Dump the sockets of one family and protocol through NETLINK_SOCK_DIAG
+ *
+ * See src/sockdiag.c for detailed documentation.
+ *
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param ext Mask of SOCKDIAG_EXT_* attributes to include with each socket
+ * @param port Only report sockets bound to this local port (0 = all)
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if sock_diag is unavailable (errno set)
+ */
+int sockdiag_dump(int family, int protocol, unsigned int states, unsigned int ext,
+                  int port, sockdiag_fn fn, void *ctx);
+
+/**
+ * Dump the sockets whose local port is in a range through NETLINK_SOCK_DIAG
+ *
+ * See src/sockdiag.c for detailed documentation.
+ *
+ * @param family AF_INET or AF_INET6
+ * @param protocol IPPROTO_TCP or IPPROTO_UDP
+ * @param states Mask of SOCKDIAG_STATE() bits to report
+ * @param ext Mask of SOCKDIAG_EXT_* attributes to include with each socket
+ * @param low Lowest local port to report (0 = no filter)
+ * @param high Highest local port to report
+ * @param fn Callback invoked once per socket
+ * @param ctx Context passed to fn
+ * @return 0 on success, -1 if sock_diag is unavailable (errno set)
+ */
+int sockdiag_dump_range(int family, int protocol, unsigned int states, unsigned int ext,
+                        int low, int high, sockdiag_fn fn, void *ctx);
+
+#endif /* SOCKDIAG_H */
@@ -0,0 +1,273 @@
+#include "usage.h"
+#include "fields.h"
+#include "usercache.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Initial number of hash slots (power of two) */
+#define USAGE_MIN_SLOTS 64
+
+/**
+ * Hash a UID to a slot index (Fibonacci hashing)
+ *
+ * @param table Usage table
+ * @param uid User ID
+ * @return Slot index in [0, table->slot_count)
+ */
+static size_t slot_for(const usage_table_t *table, int uid) {
+    return (size_t)(((uint32_t)uid * 2654435769u) & (table->slot_count - 1));
+}
+
+/**
+ * Find the slot holding a UID, or the empty slot where it would go
+ *
+ * @param table Usage table
+ * @param uid User ID
+ * @return Slot index
+ */
+static size_t find_slot(const usage_table_t *table, int uid) {
+    size_t i = slot_for(table, uid);
+    while (table->used[i] && table->slots[i].uid != uid) {
+        i = (i + 1) & (table->slot_count - 1);
+    }
+    return i;
+}
+
+/**
+ * Resize the table to hold at least `entries` UIDs at half load
+ *
+ * @param table Usage table
+ * @param entries Number of entries the table must accommodate
+ * @return 0 on success, -1 if memory is exhausted (table unchanged)
+ */
+static int reserve(usage_table_t *table, size_t entries) {
+    size_t slot_count = USAGE_MIN_SLOTS;
+    while (slot_count < entries * 2) {
+        slot_count *= 2;
+    }
+    if (slot_count <= table->slot_count) {
+        return 0;
+    }
+
+    usage_table_t grown = {
+        .slots = counted_malloc(slot_count * sizeof(user_usage_t)),
+        .used = counted_calloc(slot_count, sizeof(bool)),
+        .slot_count = slot_count,
+        .count = table->count,
+    };
+    if (!grown.slots || !grown.used) {
+        free(grown.slots);
+        free(grown.used);
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->slot_count; i++) {
+        if (table->used[i]) {
+            const size_t j = find_slot(&grown, table->slots[i].uid);
+            grown.slots[j] = table->slots[i];
+            grown.used[j] = true;
+        }
+    }
+
+    free(table->slots);
+    free(table->used);
+    *table = grown;
+    return 0;
+}
+
+/**
+ * Get the totals of a UID, adding a zeroed entry on first sight
+ *
+ * @param table Usage table
+ * @param uid User ID
+ * @return Entry for uid, or NULL if memory is exhausted (table->failed set)
+ */
+static user_usage_t *entry_for(usage_table_t *table, int uid) {
+    if (table->failed) {
+        return NULL;
+    }
+
+    size_t i = find_slot(table, uid);
+    if (table->used[i]) {
+        return &table->slots[i];
+    }
+
+    if (reserve(table, table->count + 1) < 0) {
+        table->failed = true;
+        return NULL;
+    }
+    i = find_slot(table, uid);
+
+    memset(&table->slots[i], 0, sizeof(user_usage_t));
+    table->slots[i].uid = uid;
+    table->used[i] = true;
+    table->count++;
+    return &table->slots[i];
+}
+
+/**
+ * Initialize an empty usage table
+ *
+ * @param table Table to initialize (free with usage_table_free() either way)
+ * @return 0 on success, -1 if memory is exhausted
+ */
+int usage_table_init(usage_table_t *table) {
+    memset(table, 0, sizeof(*table));
+    return reserve(table, USAGE_MIN_SLOTS / 2);
+}
+
+/**
+ * Add one scanned process to its owner's totals
+ *
+ * The record must have been read with at least USAGE_PROCESS_SOURCES and
+ * can be reused for the next process as soon as this returns.
+ *
+ * @param table Usage table
+ * @param info Process to count
+ * @return void
+ */
+void usage_add_process(usage_table_t *table, const process_info_t *info) {
+    user_usage_t *u = entry_for(table, info->uid);
+    if (!u) {
+        return;
+    }
+
+    u->processes++;
+    if (info->state == 'Z') {
+        u->zombies++;
+    }
+    u->vsz += info->vsz;
+    u->rss += info->rss;
+}
+
+/**
+ * Add one socket to its owner's totals
+ *
+ * @param table Usage table
+ * @param uid UID that owns the socket
+ * @return void
+ */
+void usage_add_socket(usage_table_t *table, int uid) {
+    user_usage_t *u = entry_for(table, uid);
+    if (u) {
+        u->sockets++;
+    }
+}
+
+/**
+ * Compare two user totals on one column
+ *
+ * The identity columns (user, uid) sort ascending, counts and sizes
+ * descending (largest first, which is what triage wants); ties fall back to
+ * ascending UID so the order is stable across runs.
+ *
+ * @param a First record
+ * @param b Second record
+ * @param field Column (user_field_t)
+ * @return <0, 0 or >0 as for qsort()
+ */
+static int compare_on(const user_usage_t *a, const user_usage_t *b, int field) {
+    const field_value_t va = user_schema.get(a, field, NULL, 0);
+    const field_value_t vb = user_schema.get(b, field, NULL, 0);
+    int cmp = 0;
+
+    switch (user_schema.fields[field].type) {
+        case FIELD_INT:
+            cmp = field == UF_UID ? (va.i > vb.i) - (va.i < vb.i)
+                                  : (vb.i > va.i) - (vb.i < va.i);
+            break;
+        case FIELD_UINT:
+            cmp = (vb.u > va.u) - (vb.u < va.u);
+            break;
+        case FIELD_CHAR:
+            cmp = (va.c > vb.c) - (va.c < vb.c);
+            break;
+        case FIELD_STR:
+            cmp = strcmp(va.s ? va.s : "", vb.s ? vb.s : "");
+            break;
+    }
+
+    return cmp != 0 ? cmp : (a->uid > b->uid) - (a->uid < b->uid);
+}
+
+/* One qsort() comparator per column, generated from USER_FIELDS */
+#define USAGE_COMPARATOR(id, key, header, type, source, group, getter)  \
+    static int compare_##id(const void *a, const void *b) {             \
+        return compare_on(a, b, id);                                    \
+    }
+USER_FIELDS(USAGE_COMPARATOR)
+
+#define USAGE_COMPARATOR_ENTRY(id, key, header, type, source, group, getter) \
+    [id] = compare_##id,
+
+static int (*const comparators[])(const void *, const void *) = {
+    USER_FIELDS(USAGE_COMPARATOR_ENTRY)
+};
+
+/**
+ * Resolve a --sort column name for the per-user summary
+ *
+ * Accepts a column's JSON key or its table heading, in any case, so
+ * "rss", "RSS" and "rss_kb" all select the resident memory column.
+ *
+ * @param name Column key or heading (e.g. "rss", "sockets", "user")
+ * @return Field id (user_field_t), or -1 if there is no such column
+ */
+int usage_sort_field(const char *name) {
+    for (int f = 0; f < user_schema.count; f++) {
+        if (strcasecmp(name, user_schema.fields[f].key) == 0 ||
+            strcasecmp(name, user_schema.fields[f].header) == 0) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Extract the totals as a sorted array
+ *
+ * Usernames are resolved here, once per user rather than once per process.
+ *
+ * @param table Usage table
+ * @param sort_field Column to sort on (user_field_t)
+ * @param users Output: array of totals (caller must free)
+ * @return Number of users, or -1 if memory ran out while the table was
+ *         filled or now (errno ENOMEM)
+ */
+int usage_table_list(const usage_table_t *table, int sort_field, user_usage_t **users) {
+    const size_t count = table->count;
+    *users = table->failed ? NULL
+                           : counted_malloc((count > 0 ? count : 1) * sizeof(user_usage_t));
+    if (!*users) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < table->slot_count; i++) {
+        if (table->used[i]) {
+            user_usage_t *u = &(*users)[n++];
+            *u = table->slots[i];
+            usercache_lookup((uid_t)u->uid, u->username, sizeof(u->username));
+        }
+    }
+
+    qsort(*users, n, sizeof(user_usage_t), comparators[sort_field]);
+    return (int)n;
+}
+
+/**
+ * Release a usage table
+ *
+ * @param table Table to free
+ * @return void
+ */
+void usage_table_free(usage_table_t *table) {
+    free(table->slots);
+    free(table->used);
+    memset(table, 0, sizeof(*table));
+}
@@ -0,0 +1,71 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "platform.h"
+
+/* Process sources the per-user tally needs (uid and memory; stat gives state) */
+#define USAGE_PROCESS_SOURCES PROC_SRC_STATUS
+
+/**
+ * Resource totals of one user
+ *
+ * Fields:
+ * - uid: User ID
+ * - username: Resolved name (filled in by usage_table_list())
+ * - processes: Number of processes
+ * - zombies: Number of those in state Z
+ * - sockets: Number of TCP/UDP sockets owned by the UID
+ * - vsz: Total virtual memory size in kilobytes
+ * - rss: Total resident set size in kilobytes
+ */
+typedef struct {
+    int uid;
+    char username[MAX_USERNAME];
+    int processes;
+    int zombies;
+    int sockets;
+    unsigned long vsz;
+    unsigned long rss;
+} user_usage_t;
+
+/**
+ * Per-UID accumulator
+ *
+ * Open-addressing hash table (linear probing, power-of-two size, kept at
+ * most half full) of user_usage_t keyed by UID. Processes and sockets are
+ * added one at a time as they are scanned, so no per-process record is kept.
+ * If the table cannot grow, failed is set, later additions are dropped and
+ * usage_table_list() fails.
+ */
+typedef struct {
+    user_usage_t *slots;
+    bool *used;
+    size_t slot_count;
+    size_t count;
+    bool failed;
+} usage_table_t;
+
+/**
+ * Usage table functions
+ *
+ * See src/usage.c for detailed documentation of each function.
+ */
+int usage_table_init(usage_table_t *table);
+void usage_add_process(usage_table_t *table, const process_info_t *info);
+void usage_add_socket(usage_table_t *table, int uid);
+int usage_table_list(const usage_table_t *table, int sort_field, user_usage_t **users);
+void usage_table_free(usage_table_t *table);
+
+/**
+ * Resolve a --sort column name for the per-user summary
+ *
+ * See src/usage.c for detailed documentation.
+ *
+ * @param name Column key or heading (e.g. "rss", "sockets", "user")
+ * @return Field id (user_field_t), or -1 if there is no such column
+ */
+int usage_sort_field(const char *name);
+
+#endif /* USAGE_H */
@@ -0,0 +1,319 @@
+#include "usercache.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Initial number of hash slots (power of two) */
+#define USERCACHE_MIN_SLOTS 64
+
+/* Buffer for getpwuid_r() when sysconf() gives no hint */
+#define USERCACHE_PWBUF_SIZE 1024
+
+/*
+ * One cached UID.
+ *
+ * Names from /etc/passwd point into the mapping and are not NUL-terminated,
+ * hence the explicit length; names from NSS are heap copies (owned). A NULL
+ * name records a UID that NSS does not know either.
+ */
+typedef struct {
+    uid_t uid;
+    bool used;
+    bool owned;
+    const char *name;
+    size_t len;
+} usercache_entry_t;
+
+/*
+ * Cache state for the run: the open-addressing table (linear probing,
+ * power-of-two size, kept at most half full) and the /etc/passwd mapping
+ * its names point into. One cache serves every thread and libwir context,
+ * so it stays warm across queries; `lock` serialises access to it.
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    bool loaded;
+    usercache_entry_t *slots;
+    size_t slot_count;
+    size_t used;
+    void *map;
+    size_t map_size;
+} cache;
+
+/**
+ * Hash a UID to a slot index (Fibonacci hashing)
+ *
+ * @param uid User ID
+ * @return Slot index in [0, cache.slot_count)
+ */
+static size_t slot_for(uid_t uid) {
+    return (size_t)(((uint32_t)uid * 2654435769u) & (cache.slot_count - 1));
+}
+
+/**
+ * Find the slot holding a UID, or the empty slot where it would go
+ *
+ * @param uid User ID
+ * @return Pointer to the slot
+ */
+static usercache_entry_t *find_slot(uid_t uid) {
+    size_t i = slot_for(uid);
+    while (cache.slots[i].used && cache.slots[i].uid != uid) {
+        i = (i + 1) & (cache.slot_count - 1);
+    }
+    return &cache.slots[i];
+}
+
+/**
+ * Resize the table to hold at least `entries` UIDs at half load
+ *
+ * @param entries Number of entries the table must accommodate
+ * @return true on success, false if memory is exhausted (the table is kept)
+ */
+static bool reserve(size_t entries) {
+    size_t slot_count = USERCACHE_MIN_SLOTS;
+    while (slot_count < entries * 2) {
+        slot_count *= 2;
+    }
+    if (slot_count <= cache.slot_count) {
+        return true;
+    }
+
+    usercache_entry_t *slots = counted_calloc(slot_count, sizeof(usercache_entry_t));
+    if (!slots) {
+        return false;
+    }
+
+    usercache_entry_t *old = cache.slots;
+    const size_t old_count = cache.slot_count;
+
+    cache.slots = slots;
+    cache.slot_count = slot_count;
+
+    for (size_t i = 0; i < old_count; i++) {
+        if (old[i].used) {
+            *find_slot(old[i].uid) = old[i];
+        }
+    }
+
+    free(old);
+    return true;
+}
+
+/**
+ * Add a UID to the cache unless it is already present
+ *
+ * The first entry wins, matching getpwuid() on a file with duplicate UIDs.
+ *
+ * @param uid User ID
+ * @param name Username (not necessarily NUL-terminated), or NULL for unknown
+ * @param len Length of name
+ * @param owned Whether the cache should free name
+ * @return The entry for uid, or NULL if memory is exhausted (an owned name
+ *         is freed)
+ */
+static usercache_entry_t *insert(uid_t uid, const char *name, size_t len, bool owned) {
+    if (!reserve(cache.used + 1)) {
+        if (owned) {
+            free((char *)name);
+        }
+        return NULL;
+    }
+
+    usercache_entry_t *e = find_slot(uid);
+    if (e->used) {
+        if (owned) {
+            free((char *)name);
+        }
+        return e;
+    }
+
+    *e = (usercache_entry_t){ uid, true, owned, name, len };
+    cache.used++;
+    return e;
+}
+
+/**
+ * Map /etc/passwd and index every user in it
+ *
+ * Each line is "name:password:uid:gid:gecos:home:shell". Lines that do not
+ * parse, and NIS compat entries ("+..." / "-..."), are skipped. The mapping
+ * stays in place for the rest of the run because the cached names point into
+ * it. A missing or unreadable file (or a table that cannot be allocated)
+ * leaves the cache empty, so every lookup falls through to NSS.
+ *
+ * @return void
+ */
+static void load_passwd(void) {
+    cache.loaded = true;
+    if (!reserve(USERCACHE_MIN_SLOTS / 2)) {
+        return;
+    }
+
+    const int fd = open(USERCACHE_PASSWD_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    cache.map = map;
+    cache.map_size = (size_t)st.st_size;
+
+    /* One line per user; size the table once up front */
+    const char *p = map;
+    const char *end = p + cache.map_size;
+    size_t lines = 0;
+    for (const char *q = p; (q = memchr(q, '\n', (size_t)(end - q))) != NULL; q++) {
+        lines++;
+    }
+    reserve(lines + 1);
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) {
+            eol = end;
+        }
+
+        const char *name_end = memchr(p, ':', (size_t)(eol - p));
+        const char *pw_end = name_end ? memchr(name_end + 1, ':', (size_t)(eol - name_end - 1))
+                                      : NULL;
+
+        if (pw_end && name_end > p && *p != '+' && *p != '-') {
+            unsigned long uid = 0;
+            const char *d = pw_end + 1;
+            while (d < eol && *d >= '0' && *d <= '9') {
+                uid = uid * 10 + (unsigned long)(*d - '0');
+                d++;
+            }
+
+            if (d > pw_end + 1 && d < eol && *d == ':') {
+                insert((uid_t)uid, p, (size_t)(name_end - p), false);
+            }
+        }
+
+        p = eol + 1;
+    }
+}
+
+/**
+ * Look a UID up through NSS and cache the answer
+ *
+ * @param uid User ID
+ * @return The new cache entry (name is NULL if the UID is unknown), or NULL
+ *         if memory is exhausted (nothing is cached)
+ */
+static usercache_entry_t *lookup_nss(uid_t uid) {
+    long hint = sysconf(_SC_GETPW_R_SIZE_MAX);
+    size_t buf_size = hint > 0 ? (size_t)hint : USERCACHE_PWBUF_SIZE;
+    char *buf = counted_malloc(buf_size);
+    if (!buf) {
+        return NULL;
+    }
+
+    struct passwd pw;
+    struct passwd *result = NULL;
+    while (getpwuid_r(uid, &pw, buf, buf_size, &result) == ERANGE) {
+        char *grown = counted_realloc(buf, buf_size * 2);
+        if (!grown) {
+            free(buf);
+            return NULL;
+        }
+        buf = grown;
+        buf_size *= 2;
+    }
+
+    usercache_entry_t *e;
+    if (result) {
+        char *name = counted_strdup(result->pw_name);
+        e = name ? insert(uid, name, strlen(name), true) : NULL;
+    } else {
+        e = insert(uid, NULL, 0, false);
+    }
+
+    free(buf);
+    return e;
+}
+
+/**
+ * Resolve a UID to a username
+ *
+ * The first call maps and indexes /etc/passwd. UIDs found there are answered
+ * from the hash; others go to NSS (getpwuid_r) once and are cached, including
+ * negative results, so a slow directory service is consulted at most once per
+ * unknown UID per run. If memory runs out the numeric UID is written and
+ * nothing is cached.
+ *
+ * Thread-safe: lookups take the cache lock. A hit costs one uncontended
+ * lock and a probe; the lock is held across an NSS miss, so concurrent
+ * lookups of the same unknown UID ask NSS only once.
+ *
+ * @param uid User ID to look up
+ * @param username Buffer to store the username string
+ * @param size Size of username buffer
+ * @return true if the UID has a name, false if the numeric UID was written instead
+ */
+bool usercache_lookup(uid_t uid, char *username, size_t size) {
+    pthread_mutex_lock(&lock);
+
+    if (!cache.loaded) {
+        load_passwd();
+    }
+
+    const usercache_entry_t *e = cache.slot_count > 0 ? find_slot(uid) : NULL;
+    if (!e || !e->used) {
+        e = lookup_nss(uid);
+    }
+
+    const bool named = e && e->name != NULL;
+    if (named) {
+        snprintf(username, size, "%.*s", (int)e->len, e->name);
+    } else {
+        snprintf(username, size, "%u", (unsigned int)uid);
+    }
+
+    pthread_mutex_unlock(&lock);
+    return named;
+}
+
+/**
+ * Release the cache and unmap /etc/passwd
+ *
+ * @return void
+ */
+void usercache_free(void) {
+    pthread_mutex_lock(&lock);
+
+    for (size_t i = 0; i < cache.slot_count; i++) {
+        if (cache.slots[i].used && cache.slots[i].owned) {
+            free((char *)cache.slots[i].name);
+        }
+    }
+    free(cache.slots);
+
+    if (cache.map) {
+        munmap(cache.map, cache.map_size);
+    }
+
+    memset(&cache, 0, sizeof(cache));
+    pthread_mutex_unlock(&lock);
+}
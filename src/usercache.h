@@ -0,0 +1,24 @@
+#ifndef USERCACHE_H
+#define USERCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Local password file parsed by the fast path */
+#define USERCACHE_PASSWD_PATH "/etc/passwd"
+
+/**
+ * UID to username cache
+ *
+ * Resolves UIDs from a hash built over an mmap()ed /etc/passwd, so the
+ * common case never initialises NSS or touches a directory service. UIDs
+ * missing from the file are looked up once with getpwuid_r() and the answer,
+ * including "no such user", is kept for the rest of the run.
+ *
+ * See src/usercache.c for detailed documentation of each function.
+ */
+bool usercache_lookup(uid_t uid, char *username, size_t size);
+void usercache_free(void);
+
+#endif /* USERCACHE_H */
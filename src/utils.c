@@ -1,250 +1,285 @@
 #include "utils.h"
+#include "context.h"
+#include "kill.h"
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
 #include <termios.h>
 #include <unistd.h>
-#include <signal.h>
 #include <sys/types.h>
 #include <time.h>
+#include <stdatomic.h>
 
-/* Global flag for controlling color output */
-bool use_colors = true;
+/* Allocation counters (see alloc_stats_t) */
+static atomic_ulong alloc_calls;
+static atomic_ulong realloc_calls;
+static atomic_ullong alloc_bytes;
+static atomic_ullong realloc_bytes;
+
+/**
+ * Record one allocation in the counters
+ *
+ * @param calls Call counter to bump
+ * @param bytes Byte counter to add to
+ * @param size Number of bytes requested
+ * @return void
+ */
+static void count_alloc(atomic_ulong *calls, atomic_ullong *bytes, size_t size) {
+    atomic_fetch_add_explicit(calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(bytes, size, memory_order_relaxed);
+}
+
+/**
+ * Print a diagnostic line to the context's error stream
+ *
+ * @param ctx Context holding the error stream and its color setting
+ * @param color ANSI color code for the whole line
+ * @param prefix Label printed before the message ("Error: ", "Warning: ")
+ * @param format printf-style format string
+ * @param args Arguments for format
+ * @return void
+ */
+static void print_diagnostic(const wir_ctx_t *ctx, const char *color, const char *prefix,
+                             const char *format, va_list args) {
+    if (ctx->err_colors) {
+        fputs(color, ctx->err);
+    }
+
+    fputs(prefix, ctx->err);
+    vfprintf(ctx->err, format, args);
+    fputc('\n', ctx->err);
+
+    if (ctx->err_colors) {
+        fputs(COLOR_RESET, ctx->err);
+    }
+}
 
 /**
  * Print text with color support
  *
- * Prints formatted text to stdout with optional ANSI color codes. If colors are
- * enabled globally (use_colors), wraps output in the specified color code and
- * resets afterward. Supports printf-style format strings with variable arguments.
+ * Prints formatted text to the context's report stream with optional ANSI
+ * color codes. If the context has colors enabled, wraps output in the
+ * specified color code and resets afterward. Supports printf-style format
+ * strings with variable arguments.
  *
  * Behavior:
- * - If use_colors is false, prints without color codes
+ * - If ctx->colors is false, prints without color codes
  * - If color is NULL or empty, prints without color
  * - Otherwise, wraps output with color code and COLOR_RESET
  *
+ * @param ctx Context holding the report stream and color setting
  * @param color ANSI color code string (e.g., COLOR_RED, COLOR_GREEN) or NULL for no color
  * @param format printf-style format string
  * @param ... Variable arguments for format string
  * @return void
  */
-void print_color(const char *color, const char *format, ...) {
+void print_color(const wir_ctx_t *ctx, const char *color, const char *format, ...) {
     va_list args;
+    const bool colored = ctx->colors && color && *color;
 
-    if (use_colors && color && *color) {
-        printf("%s", color);
+    if (colored) {
+        fputs(color, ctx->out);
     }
 
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(ctx->out, format, args);
     va_end(args);
 
-    if (use_colors && color && *color) {
-        printf("%s", COLOR_RESET);
+    if (colored) {
+        fputs(COLOR_RESET, ctx->out);
     }
 }
 
 /**
- * Print error message in red to stderr
+ * Print error message in red to the error stream
  *
- * Outputs an error message with "Error: " prefix to stderr. If colors are enabled,
- * displays in red (COLOR_RED). Uses printf-style format strings with variable arguments.
- * Automatically adds newline at the end.
+ * Outputs an error message with "Error: " prefix to the context's error
+ * stream (stderr unless changed with wir_ctx_set_error_output()). If the
+ * context colors diagnostics, displays in red (COLOR_RED). Uses printf-style
+ * format strings with variable arguments. Automatically adds newline at the end.
  *
+ * @param ctx Context holding the error stream and its color setting
  * @param format printf-style format string for the error message
  * @param ... Variable arguments for format string
  * @return void
  */
-void print_error(const char *format, ...) {
+void print_error(const wir_ctx_t *ctx, const char *format, ...) {
     va_list args;
-
-    if (use_colors) {
-        fprintf(stderr, "%s", COLOR_RED);
-    }
-
-    fprintf(stderr, "Error: ");
-
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    print_diagnostic(ctx, COLOR_RED, "Error: ", format, args);
     va_end(args);
-
-    fprintf(stderr, "\n");
-
-    if (use_colors) {
-        fprintf(stderr, "%s", COLOR_RESET);
-    }
 }
 
 /**
- * Print warning message in yellow to stderr
+ * Print warning message in yellow to the error stream
  *
- * Outputs a warning message with "Warning: " prefix to stderr. If colors are enabled,
- * displays in yellow (COLOR_YELLOW). Uses printf-style format strings with variable
- * arguments. Automatically adds newline at the end.
+ * Outputs a warning message with "Warning: " prefix to the context's error
+ * stream. If the context colors diagnostics, displays in yellow
+ * (COLOR_YELLOW). Uses printf-style format strings with variable arguments.
+ * Automatically adds newline at the end.
  *
+ * @param ctx Context holding the error stream and its color setting
  * @param format printf-style format string for the warning message
  * @param ... Variable arguments for format string
  * @return void
  */
-void print_warning(const char *format, ...) {
+void print_warning(const wir_ctx_t *ctx, const char *format, ...) {
     va_list args;
-
-    if (use_colors) {
-        fprintf(stderr, "%s", COLOR_YELLOW);
-    }
-
-    fprintf(stderr, "Warning: ");
-
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    print_diagnostic(ctx, COLOR_YELLOW, "Warning: ", format, args);
     va_end(args);
-
-    fprintf(stderr, "\n");
-
-    if (use_colors) {
-        fprintf(stderr, "%s", COLOR_RESET);
-    }
 }
 
 /**
- * Print success message in green to stdout
+ * Print success message in green to the report stream
  *
- * Outputs a success message to stdout. If colors are enabled, displays in green
- * (COLOR_GREEN). Uses printf-style format strings with variable arguments.
- * Automatically adds newline at the end.
+ * Outputs a success message to the context's report stream. If the context
+ * has colors enabled, displays in green (COLOR_GREEN). Uses printf-style
+ * format strings with variable arguments. Automatically adds newline at the end.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param format printf-style format string for the success message
  * @param ... Variable arguments for format string
  * @return void
  */
-void print_success(const char *format, ...) {
+void print_success(const wir_ctx_t *ctx, const char *format, ...) {
     va_list args;
 
-    if (use_colors) {
-        printf("%s", COLOR_GREEN);
+    if (ctx->colors) {
+        fputs(COLOR_GREEN, ctx->out);
     }
 
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(ctx->out, format, args);
     va_end(args);
 
-    printf("\n");
+    fputc('\n', ctx->out);
 
-    if (use_colors) {
-        printf("%s", COLOR_RESET);
+    if (ctx->colors) {
+        fputs(COLOR_RESET, ctx->out);
     }
 }
 
 /**
- * Print informational message in cyan to stdout
+ * Print informational message in cyan to the report stream
  *
- * Outputs an informational message to stdout. If colors are enabled, displays in cyan
- * (COLOR_CYAN). Uses printf-style format strings with variable arguments.
- * Automatically adds newline at the end.
+ * Outputs an informational message to the context's report stream. If the
+ * context has colors enabled, displays in cyan (COLOR_CYAN). Uses printf-style
+ * format strings with variable arguments. Automatically adds newline at the end.
  *
+ * @param ctx Context holding the report stream and color setting
  * @param format printf-style format string for the info message
  * @param ... Variable arguments for format string
  * @return void
  */
-void print_info(const char *format, ...) {
+void print_info(const wir_ctx_t *ctx, const char *format, ...) {
     va_list args;
 
-    if (use_colors) {
-        printf("%s", COLOR_CYAN);
+    if (ctx->colors) {
+        fputs(COLOR_CYAN, ctx->out);
     }
 
     va_start(args, format);
-    vprintf(format, args);
+    vfprintf(ctx->out, format, args);
     va_end(args);
 
-    printf("\n");
+    fputc('\n', ctx->out);
 
-    if (use_colors) {
-        printf("%s", COLOR_RESET);
+    if (ctx->colors) {
+        fputs(COLOR_RESET, ctx->out);
     }
 }
 
 /**
- * Safe malloc wrapper with error checking
+ * Counted malloc
  *
- * Allocates memory using malloc() and terminates the program if allocation fails.
- * Provides guaranteed memory allocation with automatic error handling, eliminating
- * the need for null checks at every allocation site.
+ * Allocates memory using malloc() and counts the call for print_alloc_stats().
+ * Failure is left to the caller, which must check for NULL: libwir never
+ * ends the process it is embedded in.
  *
  * @param size Number of bytes to allocate
- * @return Pointer to allocated memory (never returns NULL)
- * @note Calls DIE() and terminates program if allocation fails
+ * @return Pointer to allocated memory, or NULL if memory is exhausted (errno ENOMEM)
  */
-void *safe_malloc(size_t size) {
-    void *ptr = malloc(size);
-    if (!ptr) {
-        DIE("Memory allocation failed: %s", strerror(errno));
-    }
-    return ptr;
+void *counted_malloc(size_t size) {
+    count_alloc(&alloc_calls, &alloc_bytes, size);
+    return malloc(size);
 }
 
 /**
- * Safe calloc wrapper with error checking
+ * Counted calloc
  *
- * Allocates zero-initialized memory using calloc() and terminates the program if
- * allocation fails. Provides guaranteed memory allocation with automatic error
- * handling. Memory is initialized to zero.
+ * Allocates zero-initialized memory using calloc() and counts the call for
+ * print_alloc_stats().
  *
  * @param nmemb Number of elements to allocate
  * @param size Size of each element in bytes
- * @return Pointer to allocated zero-initialized memory (never returns NULL)
- * @note Calls DIE() and terminates program if allocation fails
+ * @return Pointer to allocated zero-initialized memory, or NULL if memory is
+ *         exhausted (errno ENOMEM)
  */
-void *safe_calloc(size_t nmemb, size_t size) {
-    void *ptr = calloc(nmemb, size);
-    if (!ptr) {
-        DIE("Memory allocation failed: %s", strerror(errno));
-    }
-    return ptr;
+void *counted_calloc(size_t nmemb, size_t size) {
+    count_alloc(&alloc_calls, &alloc_bytes, nmemb * size);
+    return calloc(nmemb, size);
 }
 
 /**
- * Safe realloc wrapper with error checking
+ * Counted realloc
  *
- * Reallocates memory using realloc() and terminates the program if reallocation fails.
- * Provides guaranteed memory reallocation with automatic error handling. Only fails
- * and terminates if size > 0 and reallocation fails.
+ * Reallocates memory using realloc() and counts the call for
+ * print_alloc_stats(). As with realloc(), ptr is left untouched on failure,
+ * so assign the result to a temporary before replacing ptr.
  *
  * @param ptr Pointer to previously allocated memory (or NULL for initial allocation)
  * @param size New size in bytes
- * @return Pointer to reallocated memory (never returns NULL if size > 0)
- * @note Calls DIE() and terminates program if allocation fails and size > 0
+ * @return Pointer to reallocated memory, or NULL if memory is exhausted
+ *         (errno ENOMEM; ptr is still valid)
  */
-void *safe_realloc(void *ptr, size_t size) {
-    void *new_ptr = realloc(ptr, size);
-    if (!new_ptr && size > 0) {
-        DIE("Memory reallocation failed: %s", strerror(errno));
-    }
-    return new_ptr;
+void *counted_realloc(void *ptr, size_t size) {
+    count_alloc(&realloc_calls, &realloc_bytes, size);
+    return realloc(ptr, size);
 }
 
 /**
- * Safe strdup wrapper with error checking
+ * Counted strdup
  *
- * Duplicates a string using strdup() and terminates the program if allocation fails.
- * Provides guaranteed string duplication with automatic error handling. Returns NULL
- * if input is NULL (does not allocate).
+ * Duplicates a string using strdup() and counts the call for
+ * print_alloc_stats().
  *
- * @param s String to duplicate (NULL returns NULL without allocating)
- * @return Pointer to duplicated string (never returns NULL for non-NULL input)
- * @note Calls DIE() and terminates program if allocation fails for non-NULL input
+ * @param s String to duplicate (must not be NULL)
+ * @return Pointer to duplicated string, or NULL if memory is exhausted (errno ENOMEM)
  */
-char *safe_strdup(const char *s) {
-    if (!s) {
-        return NULL;
-    }
+char *counted_strdup(const char *s) {
+    count_alloc(&alloc_calls, &alloc_bytes, strlen(s) + 1);
+    return strdup(s);
+}
 
-    char *dup = strdup(s);
-    if (!dup) {
-        DIE("String duplication failed: %s", strerror(errno));
-    }
-    return dup;
+/**
+ * Snapshot the allocation counters
+ *
+ * @param stats Output structure to fill
+ * @return void
+ */
+void get_alloc_stats(alloc_stats_t *stats) {
+    stats->allocs = atomic_load_explicit(&alloc_calls, memory_order_relaxed);
+    stats->reallocs = atomic_load_explicit(&realloc_calls, memory_order_relaxed);
+    stats->alloc_bytes = atomic_load_explicit(&alloc_bytes, memory_order_relaxed);
+    stats->realloc_bytes = atomic_load_explicit(&realloc_bytes, memory_order_relaxed);
+}
+
+/**
+ * Print the allocation counters to stderr
+ *
+ * Called at exit in debug builds to make allocation and realloc traffic
+ * visible when tuning buffer sizing.
+ *
+ * @return void
+ */
+void print_alloc_stats(void) {
+    alloc_stats_t stats;
+    get_alloc_stats(&stats);
+
+    fprintf(stderr, "[alloc] %lu allocations (%llu bytes), %lu reallocations (%llu bytes)\n",
+            stats.allocs, stats.alloc_bytes, stats.reallocs, stats.realloc_bytes);
 }
 
 /**
@@ -382,60 +417,79 @@ char read_single_char(void) {
  *
  * Displays an interactive prompt asking the user whether to kill a specific process.
  * Reads a single character and performs the appropriate action:
- * - 'k'/'K': Sends SIGTERM to the process, waits 100ms, then checks if it terminated
+ * - 'k'/'K': Terminates the process with kill_process_gracefully(): SIGTERM,
+ *   a wait of up to grace_ms for it to exit, then SIGKILL if it is still alive
  * - 'q'/'Q': Quits without killing the process
  * - Any other key: Exits interactive mode
  *
+ * The outcome is reported as soon as it is known, so a process that exits
+ * promptly on SIGTERM returns immediately rather than after the full grace
+ * period. If the PID was recycled while the prompt was shown (its start time
+ * no longer matches), nothing is signalled.
+ *
  * Error handling:
  * - EPERM: Permission denied (suggests using sudo)
  * - ESRCH: Process no longer exists
  * - Other errors: Displays error message with strerror()
  *
- * After sending SIGTERM, checks if process still exists and informs user if
- * SIGKILL (-9) may be needed for forceful termination.
- *
+ * @param ctx Context holding the report stream and color setting
  * @param pid Process ID to potentially kill
  * @param process_name Name of process (for display in messages)
+ * @param start_time Start time of the displayed process (0 to skip the identity check)
+ * @param grace_ms Milliseconds to wait after SIGTERM before sending SIGKILL
  * @return 0 if process was killed successfully, -1 otherwise (quit, error, or user declined)
  */
-int prompt_kill_process(pid_t pid, const char *process_name) {
-    printf("\n");
-    print_color(COLOR_YELLOW, "Press 'k' to kill process, 'q' to quit, or any other key to exit: ");
-    fflush(stdout);
+int prompt_kill_process(const wir_ctx_t *ctx, pid_t pid, const char *process_name,
+                        time_t start_time, int grace_ms) {
+    fputc('\n', ctx->out);
+    print_color(ctx, COLOR_YELLOW,
+                "Press 'k' to kill process, 'q' to quit, or any other key to exit: ");
+    fflush(ctx->out);
 
     char ch = read_single_char();
-    printf("\n");
+    fputc('\n', ctx->out);
 
     if (ch == 'k' || ch == 'K') {
-        /* Attempt to kill the process */
-        if (kill(pid, SIGTERM) == 0) {
-            print_success("Successfully sent SIGTERM to process %d (%s)", pid, process_name);
-
-            /* Give the process a moment to terminate gracefully */
-            usleep(100000); /* 100ms */
-
-            /* Check if process still exists */
-            if (kill(pid, 0) == 0) {
-                print_info("Process is still running. You may need to use SIGKILL (kill -9) if it doesn't terminate.");
-            } else {
-                print_success("Process %d has been terminated", pid);
-            }
-            return 0;
-        } else {
-            if (errno == EPERM) {
-                print_error("Permission denied. You may need to run with sudo to kill this process.");
-            } else if (errno == ESRCH) {
-                print_error("Process %d no longer exists", pid);
-            } else {
-                print_error("Failed to kill process %d: %s", pid, strerror(errno));
-            }
-            return -1;
+        long elapsed_ms = 0;
+        const kill_outcome_t outcome = kill_process_gracefully(pid, start_time, grace_ms,
+                                                               &elapsed_ms);
+
+        switch (outcome) {
+            case KILL_EXITED:
+                print_success(ctx, "Process %d (%s) terminated after %ld ms", pid, process_name,
+                              elapsed_ms);
+                return 0;
+            case KILL_ESCALATED:
+                print_info(ctx, "Process %d did not exit within %d ms of SIGTERM; sent SIGKILL",
+                           pid, grace_ms);
+                print_success(ctx, "Process %d (%s) has been killed", pid, process_name);
+                return 0;
+            case KILL_SIGNALLED:
+            case KILL_RUNNING:
+                print_error(ctx, "Process %d is still running after SIGKILL "
+                            "(uninterruptible sleep?)", pid);
+                return -1;
+            case KILL_GONE:
+                print_error(ctx, "Process %d no longer exists", pid);
+                return -1;
+            case KILL_REPLACED:
+                print_error(ctx, "PID %d now belongs to a different process; not killing it", pid);
+                return -1;
+            case KILL_DENIED:
+                print_error(ctx, "Permission denied. You may need to run with sudo to kill "
+                            "this process.");
+                return -1;
+            case KILL_FAILED:
+                break;
         }
+
+        print_error(ctx, "Failed to kill process %d: %s", pid, strerror(errno));
+        return -1;
     } else if (ch == 'q' || ch == 'Q') {
-        print_info("Quit without killing process");
+        print_info(ctx, "Quit without killing process");
         return -1;
     } else {
-        print_info("Exiting interactive mode");
+        print_info(ctx, "Exiting interactive mode");
         return -1;
     }
 }
@@ -579,3 +633,20 @@ void format_uptime(const time_t start_time, char *buffer, size_t buffer_size) {
 
     #undef UPTIME_APPEND
 }
+
+/**
+ * Format a Unix timestamp as local date and time ("YYYY-MM-DD HH:MM:SS")
+ *
+ * @param when Unix timestamp (0 for unknown)
+ * @param buffer Output buffer for formatted string
+ * @param buffer_size Size of output buffer
+ * @return void (result written to buffer; "Unknown" for 0)
+ */
+void format_timestamp(const time_t when, char *buffer, size_t buffer_size) {
+    struct tm tm;
+
+    if (when == 0 || !localtime_r(&when, &tm) ||
+        strftime(buffer, buffer_size, "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+        snprintf(buffer, buffer_size, "Unknown");
+    }
+}
@@ -7,19 +7,14 @@
 #include <time.h>
 #include <sys/types.h> /* pid_t */
 
-/**
- * Global flag for controlling colored output
- *
- * When true, output functions use ANSI color codes. When false, output is plain text.
- * Can be disabled with --no-color flag. Defaults to true.
- */
-extern bool use_colors;
+/* Report and error streams and their color settings (see src/context.h) */
+typedef struct wir_ctx wir_ctx_t;
 
 /**
  * ANSI Color codes for terminal output
  *
- * Standard ANSI escape sequences for coloring terminal text. Used throughout
- * the application for colored output when use_colors is enabled.
+ * Standard ANSI escape sequences for coloring terminal text. Reports and
+ * diagnostics use them when their context enables colors for that stream.
  */
 #define COLOR_RESET   "\033[0m"
 #define COLOR_RED     "\033[31m"
@@ -35,22 +30,49 @@ extern bool use_colors;
  *
  * See src/utils.c for detailed documentation of each function.
  */
-void print_color(const char *color, const char *format, ...);
-void print_error(const char *format, ...);
-void print_warning(const char *format, ...);
-void print_success(const char *format, ...);
-void print_info(const char *format, ...);
+void print_color(const wir_ctx_t *ctx, const char *color, const char *format, ...);
+void print_error(const wir_ctx_t *ctx, const char *format, ...);
+void print_warning(const wir_ctx_t *ctx, const char *format, ...);
+void print_success(const wir_ctx_t *ctx, const char *format, ...);
+void print_info(const wir_ctx_t *ctx, const char *format, ...);
 
 /**
- * Memory allocation wrappers with error checking
+ * Counted memory allocation
  *
- * Safe wrappers around standard allocation functions. Terminate the program
- * with error message if allocation fails. See src/utils.c for detailed documentation.
+ * The standard allocation functions, counted for print_alloc_stats(). Like
+ * them, they return NULL (errno ENOMEM) when memory runs out: libwir reports
+ * the failure to its caller instead of ending the host process. See
+ * src/utils.c for detailed documentation.
  */
-void *safe_malloc(size_t size);
-void *safe_calloc(size_t nmemb, size_t size);
-void *safe_realloc(void *ptr, size_t size);
-char *safe_strdup(const char *s);
+void *counted_malloc(size_t size);
+void *counted_calloc(size_t nmemb, size_t size);
+void *counted_realloc(void *ptr, size_t size);
+char *counted_strdup(const char *s);
+
+/**
+ * Allocation counters
+ *
+ * Every counted_* allocation bumps these counters, so the number of calls and
+ * bytes requested (and in particular the realloc traffic of growing arrays)
+ * can be reported with print_alloc_stats(). Counters are atomic so scanner
+ * threads can allocate concurrently.
+ *
+ * Fields:
+ * - allocs: Number of counted_malloc/counted_calloc/counted_strdup calls
+ * - reallocs: Number of counted_realloc calls
+ * - alloc_bytes: Total bytes requested by the allocating calls
+ * - realloc_bytes: Total bytes requested by counted_realloc (an upper bound on
+ *   the bytes copied when arrays grow)
+ */
+typedef struct {
+    unsigned long allocs;
+    unsigned long reallocs;
+    unsigned long long alloc_bytes;
+    unsigned long long realloc_bytes;
+} alloc_stats_t;
+
+void get_alloc_stats(alloc_stats_t *stats);
+void print_alloc_stats(void);
 
 /**
  * String utility functions
@@ -70,6 +92,7 @@ bool str_ends_with(const char *str, const char *suffix);
  */
 const char *get_state_name(char state);
 void format_uptime(time_t start_time, char *buffer, size_t buffer_size);
+void format_timestamp(time_t when, char *buffer, size_t buffer_size);
 
 /**
  * Interactive utility functions
@@ -78,25 +101,19 @@ void format_uptime(time_t start_time, char *buffer, size_t buffer_size);
  * See src/utils.c for detailed documentation.
  */
 char read_single_char(void);
-int prompt_kill_process(pid_t pid, const char *process_name);
+int prompt_kill_process(const wir_ctx_t *ctx, pid_t pid, const char *process_name,
+                        time_t start_time, int grace_ms);
 
 /**
  * Error handling macros
  *
- * DIE: Fatal error macro - prints error message to stderr and exits with failure status
  * WARN: Warning macro - prints warning message to stderr but continues execution
  * DEBUG_PRINT: Debug printing macro - only active when DEBUG is defined, includes file and line info
  *
  * Usage:
- *   DIE("Failed to open file: %s", filename);
  *   WARN("Retrying connection...");
  *   DEBUG_PRINT("Variable value: %d", value);
  */
-#define DIE(fmt, ...) do { \
-    fprintf(stderr, "Fatal error: " fmt "\n", ##__VA_ARGS__); \
-    exit(EXIT_FAILURE); \
-} while(0)
-
 #define WARN(fmt, ...) do { \
     fprintf(stderr, "Warning: " fmt "\n", ##__VA_ARGS__); \
 } while(0)
@@ -0,0 +1,1781 @@
+#include "wir.h"
+#include "context.h"
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "args.h"
+#include "check.h"
+#include "platform.h"
+#include "output.h"
+#include "kill.h"
+#include "pipeline.h"
+#include "usage.h"
+#include "forest.h"
+#include "fields.h"
+#include "history.h"
+#include "ephemeral.h"
+#include "export.h"
+#include "backend.h"
+#include "serve.h"
+#include "snapshot.h"
+#include "utils.h"
+
+/**
+ * Settings for the platform queries of one run
+ *
+ * The context's settings, overridden by what the arguments ask for: --jobs
+ * also sets the socket-owner scan threads, --tcp-info turns TCP internals on.
+ *
+ * @param ctx Context holding the defaults
+ * @param args Parsed arguments of the run
+ * @return Settings to pass to the platform layer
+ */
+static platform_options_t query_options(const wir_ctx_t *ctx, const cli_args_t *args) {
+    platform_options_t opts = ctx->platform;
+    if (args->jobs > 0) {
+        opts.scan_jobs = args->jobs;
+    }
+    if (args->tcp_info) {
+        opts.tcp_info = true;
+    }
+    return opts;
+}
+
+/**
+ * Follow up a failure message with its likely cause
+ *
+ * A query that ran out of memory says so; any other failure of the
+ * platform layer is most often a permission problem, which hint explains.
+ *
+ * @param ctx Context to report to
+ * @param error errno saved when the query failed
+ * @param hint Cause to give unless memory ran out
+ * @return void
+ */
+static void print_failure_cause(const wir_ctx_t *ctx, int error, const char *hint) {
+    print_error(ctx, "%s", error == ENOMEM ? strerror(error) : hint);
+}
+
+/**
+ * Read one process, from the snapshot with --from-shm or else the system
+ *
+ * @param ctx Context (its snapshot, if any)
+ * @param pid Process ID
+ * @param info Output process (every field)
+ * @return 0 on success, -1 if the process cannot be read
+ */
+static int query_process(const wir_ctx_t *ctx, pid_t pid, process_info_t *info) {
+    if (ctx->snapshot) {
+        return snapshot_get_process(ctx->snapshot, pid, info);
+    }
+    return platform_get_process_info(pid, info);
+}
+
+/**
+ * Read every process, from the snapshot with --from-shm or else the system
+ *
+ * @param ctx Context (its snapshot, if any)
+ * @param processes Output: array of processes (caller must free)
+ * @param count Output: number of processes
+ * @param sources Bitmask of PROC_SRC_* flags to read (a snapshot has them all)
+ * @return 0 on success, -1 on error
+ */
+static int query_all_processes(const wir_ctx_t *ctx, process_info_t **processes, int *count,
+                               unsigned int sources) {
+    if (ctx->snapshot) {
+        return snapshot_get_processes(ctx->snapshot, processes, count);
+    }
+    return platform_get_all_processes(processes, count, sources);
+}
+
+/**
+ * Read the connections on a port, from the snapshot with --from-shm or
+ * else the system
+ *
+ * @param ctx Context (its snapshot, if any)
+ * @param opts Platform settings for a live query
+ * @param port Port number
+ * @param connections Output: array of connections (caller must free)
+ * @param count Output: number of connections
+ * @return 0 on success, -1 on error
+ */
+static int query_port_connections(const wir_ctx_t *ctx, const platform_options_t *opts,
+                                  int port, connection_info_t **connections, int *count) {
+    if (ctx->snapshot) {
+        return snapshot_get_port_connections(ctx->snapshot, port, connections, count);
+    }
+    return platform_get_port_connections(port, opts, connections, count);
+}
+
+/**
+ * Socket callback: count one socket held by a process of the forest
+ *
+ * @param ctx process_forest_t being built
+ * @param pid Process holding the socket
+ * @return void
+ */
+static void count_forest_socket(void *ctx, pid_t pid) {
+    forest_add_socket(ctx, pid);
+}
+
+/**
+ * Scan every process and socket once into a process forest
+ *
+ * Socket counts are best-effort: unreadable socket tables leave them at 0.
+ * With --from-shm both come from the published snapshot.
+ *
+ * @param ctx Context to query with
+ * @param args Parsed arguments (--jobs for the socket-owner scan, --sort)
+ * @param forest Output: finished forest (caller must free with forest_free())
+ * @return 0 on success, -1 if the process list cannot be read or memory is
+ *         exhausted (nothing to free)
+ */
+static int build_process_forest(const wir_ctx_t *ctx, const cli_args_t *args,
+                                process_forest_t *forest) {
+    process_info_t *procs = NULL;
+    int count = 0;
+
+    if (query_all_processes(ctx, &procs, &count, FOREST_PROCESS_SOURCES) < 0) {
+        free(procs);
+        return -1;
+    }
+
+    if (forest_build(forest, procs, count) < 0) {
+        forest_free(forest);
+        return -1;
+    }
+
+    if (ctx->snapshot) {
+        connection_info_t *sockets = NULL;
+        int socket_count = 0;
+        if (snapshot_get_port_connections(ctx->snapshot, 0, &sockets, &socket_count) == 0) {
+            for (int i = 0; i < socket_count; i++) {
+                for (int k = 0; k < sockets[i].owner_count; k++) {
+                    forest_add_socket(forest, sockets[i].owners[k]);
+                }
+            }
+        }
+        free(sockets);
+    } else {
+        const platform_options_t opts = query_options(ctx, args);
+        platform_for_each_socket_pid(&opts, count_forest_socket, forest);
+    }
+
+    const int sort_field = args->sort_key ? forest_sort_field(args->sort_key) : FF_PID;
+    if (forest_finish(forest, sort_field) < 0) {
+        forest_free(forest);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Handle --pid operation to display process information
+ *
+ * Retrieves and displays information about a specific process identified by PID.
+ * Supports multiple output modes based on the provided arguments:
+ * - Environment variables mode (--env): Shows all environment variables
+ * - Process tree mode (--tree): Shows full process ancestry tree, then the
+ *   process's descendants with subtree totals
+ * - Default mode: Shows basic process information
+ *
+ * Error handling:
+ * - Returns EXIT_FAILURE if a process doesn't exist or access is denied
+ * - Cleans up allocated resources (env_vars, tree) before returning
+ * - Provides helpful error messages to guide the user
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing parsed arguments with PID and output mode flags
+ * @return EXIT_SUCCESS (0) on successful display, EXIT_FAILURE (1) on error
+ */
+static int handle_pid_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    /* Get basic process information */
+    process_info_t info;
+    if (query_process(ctx, args->pid, &info) < 0) {
+        const int error = errno;
+        print_error(ctx, "Failed to get information for PID %d", args->pid);
+        if (ctx->snapshot) {
+            print_error(ctx, "The process is not in the published snapshot");
+        } else {
+            print_failure_cause(ctx, error,
+                                "Process may not exist or you don't have permission to access it");
+        }
+        return EXIT_FAILURE;
+    }
+
+    /* Handle different output modes */
+    int result = 0;
+    if (args->show_env) {
+        /* Show environment variables */
+        char **env_vars = NULL;
+        int count = 0;
+
+        if (platform_get_process_env(args->pid, &env_vars, &count) < 0) {
+            const int error = errno;
+            print_error(ctx, "Failed to get environment variables for PID %d", args->pid);
+            print_failure_cause(ctx, error, "You may not have permission to access this process");
+            return EXIT_FAILURE;
+        }
+
+        result = output_process_env(ctx, env_vars, count, args);
+        platform_free_env_vars(env_vars, count);
+    }
+    else if (args->show_tree) {
+        /* Show the process ancestry tree */
+        process_tree_node_t *tree = NULL;
+
+        if (platform_get_process_tree(args->pid, &tree) < 0) {
+            const int error = errno;
+            print_error(ctx, "Failed to build process tree for PID %d", args->pid);
+            print_failure_cause(ctx, error,
+                                "Process may not exist or you don't have permission to access it");
+            return EXIT_FAILURE;
+        }
+
+        /* The target's descendants and their totals; the ancestry alone if that fails */
+        process_forest_t forest;
+        const bool have_forest = build_process_forest(ctx, args, &forest) == 0;
+
+        result = output_process_tree(ctx, tree, have_forest ? &forest : NULL, args);
+        platform_free_process_tree(tree);
+        if (have_forest) {
+            forest_free(&forest);
+        }
+    }
+    else {
+        /* Show basic process information */
+        result = output_process_info(ctx, &info, args);
+    }
+    if (result < 0) {
+        return EXIT_FAILURE;
+    }
+
+    /* Interactive mode - prompt to kill process (works with all output modes) */
+    if (args->interactive && !args->json_output) {
+        prompt_kill_process(ctx, info.pid, info.name, info.start_time, args_grace_ms(args));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Handle --port operation to display port usage information
+ *
+ * Queries the system for all network connections using a specific port number.
+ * Retrieves connection information including process IDs, connection states,
+ * and related details. The output can be filtered to show only warnings
+ * using the --warnings flag.
+ *
+ * The function:
+ * 1. Queries all connections on the specified port
+ * 2. Formats and displays the connection information
+ * 3. Properly frees allocated memory regardless of success or failure
+ *
+ * Error handling:
+ * - Returns EXIT_FAILURE if a port query fails (may need elevated privileges)
+ * - Ensures connections array is freed even on error
+ * - Provides informative error messages about privilege requirements
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the port number and output flags
+ * @return EXIT_SUCCESS (0) on successful display, EXIT_FAILURE (1) on error
+ */
+static int handle_port_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    connection_info_t *connections = NULL;
+    int count = 0;
+
+    /* Get all connections on the port */
+    const platform_options_t opts = query_options(ctx, args);
+    if (query_port_connections(ctx, &opts, args->port, &connections, &count) < 0) {
+        const int error = errno;
+        print_error(ctx, "Failed to query port %d", args->port);
+        print_failure_cause(ctx, error,
+                            "You may need elevated privileges to inspect network connections");
+        free(connections);
+        return EXIT_FAILURE;
+    }
+
+    /* Output the results */
+    const int result = output_port_info(ctx, args->port, connections, count, args);
+
+    free(connections);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Port walk callback: count one connection in its group
+ *
+ * @param ctx group_table_t being filled
+ * @param conn Connection on the port
+ * @return void
+ */
+static void count_connection(void *ctx, const connection_info_t *conn) {
+    group_add_connection(ctx, conn);
+}
+
+/**
+ * Handle --port --group-by to count the port's connections per group
+ *
+ * Connections are counted into a hash table as the /proc/net tables are
+ * parsed (see platform_for_each_port_connection()), so a port with 30k
+ * connections costs one table entry per group rather than a record per
+ * connection. The socket-owner scan only runs when grouping by PID.
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the port and grouping
+ * @return EXIT_SUCCESS (0) on successful display, EXIT_FAILURE (1) on error
+ */
+static int handle_port_group_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    group_table_t table;
+    if (group_table_init(&table, args->group_by) < 0) {
+        print_error(ctx, "Failed to group connections: %s", strerror(errno));
+        group_table_free(&table);
+        return EXIT_FAILURE;
+    }
+
+    const platform_options_t opts = query_options(ctx, args);
+    if (platform_for_each_port_connection(args->port, &opts, args->group_by == GROUP_BY_PID,
+                                          count_connection, &table) < 0) {
+        const int error = errno;
+        print_error(ctx, "Failed to query port %d", args->port);
+        print_failure_cause(ctx, error,
+                            "You may need elevated privileges to inspect network connections");
+        group_table_free(&table);
+        return EXIT_FAILURE;
+    }
+
+    conn_group_t *groups = NULL;
+    const int count = group_table_list(&table, &groups);
+    group_table_free(&table);
+    if (count < 0) {
+        print_error(ctx, "Failed to group connections: %s", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    const int result = output_port_groups(ctx, args->port, groups, count, args);
+
+    free(groups);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Pipeline callback: write one scanned process to the --all stream
+ *
+ * @param ctx process_list_stream_t being written
+ * @param info Scanned process
+ * @return void
+ */
+static void emit_process_row(void *ctx, const process_info_t *info) {
+    output_process_list_row(ctx, info);
+}
+
+/**
+ * Handle --all operation to display all running processes
+ *
+ * Retrieves a list of all currently running processes on the system and
+ * displays them according to the specified output format (short, JSON, or
+ * standard). This provides a system-wide view of process activity.
+ *
+ * The function:
+ * 1. Fetches complete list of running processes from platform layer
+ * 2. Passes the process list to output formatter
+ * 3. Cleans up allocated memory before returning
+ *
+ * With --jobs the two steps overlap instead: the PIDs are listed, then
+ * scanner threads read them while this thread formats each process as it
+ * arrives (see pipeline_scan_processes()), so output starts immediately and
+ * no full process array is held in memory.
+ *
+ * With --tree the processes are linked into a forest instead, and every
+ * subtree is totalled (see build_process_forest()) before anything prints.
+ *
+ * Error handling:
+ * - Returns EXIT_FAILURE if unable to retrieve process list
+ * - Ensures processes array is freed even on error
+ * - Provides error message if retrieval fails
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing output format flags (short_output, json_output)
+ * @return EXIT_SUCCESS (0) on successful display, EXIT_FAILURE (1) on error
+ */
+static int handle_all_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    if (args->show_tree) {
+        process_forest_t forest;
+        if (build_process_forest(ctx, args, &forest) < 0) {
+            print_error(ctx, "Failed to get process list: %s", strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        const int result = output_process_forest(ctx, &forest, args);
+        forest_free(&forest);
+        return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    const unsigned int sources = output_process_list_sources(args);
+
+    if (args->jobs > 0) {
+        pid_t *pids = NULL;
+        int pid_count = 0;
+
+        if (platform_list_pids(&pids, &pid_count) < 0) {
+            print_error(ctx, "Failed to get process list: %s", strerror(errno));
+            free(pids);
+            return EXIT_FAILURE;
+        }
+
+        process_list_stream_t stream;
+        if (output_process_list_begin(&stream, ctx, -1, args) < 0) {
+            free(pids);
+            return EXIT_FAILURE;
+        }
+        const int scanned = pipeline_scan_processes(pids, pid_count, sources, args->jobs,
+                                                    !args->unordered, emit_process_row,
+                                                    &stream);
+        int result = output_process_list_end(&stream);
+
+        free(pids);
+        if (scanned < 0) {
+            print_error(ctx, "Failed to start scanner threads: %s", strerror(errno));
+            result = -1;
+        }
+        return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    process_info_t *processes = NULL;
+    int count = 0;
+
+    /* Get all processes, reading only what the selected format prints */
+    if (query_all_processes(ctx, &processes, &count, sources) < 0) {
+        print_error(ctx, "Failed to get process list: %s", strerror(errno));
+        free(processes);
+        return EXIT_FAILURE;
+    }
+
+    /* Output the results */
+    int result = output_process_list(ctx, processes, count, args);
+
+    free(processes);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Pipeline / scan callback: add one process to the per-user totals
+ *
+ * @param ctx usage_table_t being filled
+ * @param info Scanned process
+ * @return void
+ */
+static void tally_process(void *ctx, const process_info_t *info) {
+    usage_add_process(ctx, info);
+}
+
+/**
+ * Socket callback: add one socket to the per-user totals
+ *
+ * @param ctx usage_table_t being filled
+ * @param uid UID owning the socket
+ * @return void
+ */
+static void tally_socket(void *ctx, int uid) {
+    usage_add_socket(ctx, uid);
+}
+
+/**
+ * Handle --by-user operation to summarise resource use per user
+ *
+ * Scans every process and socket once, folding each into a per-UID hash
+ * table as it is read; no per-process record is kept or formatted. Only the
+ * summary (one row per user) is sorted and printed.
+ *
+ * The process scan reads only stat and status (state, uid, memory). With
+ * --jobs it runs on the pipelined scanner, unordered since the totals do
+ * not depend on order.
+ *
+ * Error handling:
+ * - Returns EXIT_FAILURE if the process list cannot be read
+ * - Socket counts are best-effort: unreadable socket tables leave them at 0
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing output format flags and --sort
+ * @return EXIT_SUCCESS (0) on successful display, EXIT_FAILURE (1) on error
+ */
+static int handle_by_user_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    pid_t *pids = NULL;
+    int pid_count = 0;
+
+    if (platform_list_pids(&pids, &pid_count) < 0) {
+        print_error(ctx, "Failed to get process list: %s", strerror(errno));
+        free(pids);
+        return EXIT_FAILURE;
+    }
+
+    usage_table_t table;
+    if (usage_table_init(&table) < 0) {
+        print_error(ctx, "Failed to total processes per user: %s", strerror(errno));
+        usage_table_free(&table);
+        free(pids);
+        return EXIT_FAILURE;
+    }
+
+    if (args->jobs > 0) {
+        if (pipeline_scan_processes(pids, pid_count, USAGE_PROCESS_SOURCES, args->jobs,
+                                    false, tally_process, &table) < 0) {
+            print_error(ctx, "Failed to start scanner threads: %s", strerror(errno));
+            usage_table_free(&table);
+            free(pids);
+            return EXIT_FAILURE;
+        }
+    } else {
+        for (int i = 0; i < pid_count; i++) {
+            process_info_t info;
+            if (platform_get_process_fields(pids[i], &info, USAGE_PROCESS_SOURCES) == 0) {
+                tally_process(&table, &info);
+            }
+        }
+    }
+    free(pids);
+
+    platform_for_each_socket_uid(tally_socket, &table);
+
+    user_usage_t *users = NULL;
+    const int sort_field = args->sort_key ? usage_sort_field(args->sort_key) : UF_RSS;
+    const int count = usage_table_list(&table, sort_field, &users);
+    usage_table_free(&table);
+    if (count < 0) {
+        print_error(ctx, "Failed to total processes per user: %s", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    const int result = output_user_summary(ctx, users, count, args);
+
+    free(users);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Longest uninterrupted sleep of --record, so wir_ctx_cancel() from another thread is seen */
+#define RECORD_CANCEL_CHECK_SEC 1
+
+/**
+ * Sleep until a CLOCK_MONOTONIC deadline or until the context is cancelled
+ *
+ * The CLI installs its stop signals without SA_RESTART, so they cut the
+ * sleep short instead of waiting out the interval; a cancel from another
+ * thread is noticed within RECORD_CANCEL_CHECK_SEC.
+ *
+ * @param ctx Context whose cancel flag ends the sleep
+ * @param deadline Absolute CLOCK_MONOTONIC time to wake at
+ * @return void
+ */
+static void sleep_until(const wir_ctx_t *ctx, const struct timespec *deadline) {
+    while (!atomic_load(&ctx->cancelled)) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        struct timespec left = {
+            deadline->tv_sec - now.tv_sec,
+            deadline->tv_nsec - now.tv_nsec,
+        };
+        if (left.tv_nsec < 0) {
+            left.tv_sec--;
+            left.tv_nsec += 1000000000L;
+        }
+        if (left.tv_sec < 0) {
+            return;
+        }
+        if (left.tv_sec >= RECORD_CANCEL_CHECK_SEC) {
+            left = (struct timespec){ RECORD_CANCEL_CHECK_SEC, 0 };
+        }
+        nanosleep(&left, NULL);
+    }
+}
+
+/**
+ * Handle --record operation to sample the process table into a ring file
+ *
+ * Every --interval seconds, lists all processes and appends one fixed-size
+ * record per process (name, state, parent, uid, memory, start time) to a
+ * preallocated, mmap()ed ring file, overwriting the oldest samples once it
+ * is full. Runs until the context is cancelled (the CLI does so on SIGINT
+ * or SIGTERM, see wir_ctx_cancel()).
+ *
+ * Built to run permanently: each sample reads only /proc/<pid>/stat and
+ * status, appending is a memcpy-sized store into the mapping (no write()
+ * per record, no formatting), and samples are scheduled on absolute
+ * deadlines so the period does not drift with scan time. The page cache
+ * writes the mapping back; a sync happens only when recording stops.
+ *
+ * Error handling:
+ * - Returns EXIT_FAILURE if the ring file cannot be created, is not a ring
+ *   file, or is already being recorded into
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the file and recorder settings
+ * @return EXIT_SUCCESS (0) when cancelled, EXIT_FAILURE (1) on error
+ */
+static int handle_record_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    const int interval = args->interval > 0 ? args->interval : HISTORY_DEFAULT_INTERVAL;
+    const int max_mb = args->max_mb > 0 ? args->max_mb : HISTORY_DEFAULT_MAX_MB;
+
+    history_ring_t ring;
+    if (history_create(args->record_path, (size_t)max_mb << 20, interval, &ring) < 0) {
+        if (errno == EEXIST) {
+            print_error(ctx, "%s exists and is not a wir history file", args->record_path);
+        } else if (errno == EWOULDBLOCK) {
+            print_error(ctx, "%s is already being recorded into", args->record_path);
+        } else {
+            print_error(ctx, "Cannot open %s: %s", args->record_path, strerror(errno));
+        }
+        return EXIT_FAILURE;
+    }
+
+    print_info(ctx, "Recording to %s every %ds (%llu records); stop with Ctrl-C",
+               args->record_path, interval,
+               (unsigned long long)ring.header->capacity);
+    fflush(ctx->out);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (!atomic_load(&ctx->cancelled)) {
+        pid_t *pids = NULL;
+        int pid_count = 0;
+
+        if (platform_list_pids(&pids, &pid_count) == 0) {
+            const int64_t now = (int64_t)time(NULL);
+            for (int i = 0; i < pid_count; i++) {
+                process_info_t info;
+                if (platform_get_process_fields(pids[i], &info, HISTORY_SOURCES) == 0) {
+                    history_append(&ring, &info, now);
+                }
+            }
+        }
+        free(pids);
+
+        deadline.tv_sec += interval;
+        sleep_until(ctx, &deadline);
+    }
+
+    history_close(&ring);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Handle --replay operation to print the samples held in a ring file
+ *
+ * Maps the file read-only and walks its records oldest first, straight from
+ * the mapping; with --history only records of that PID are printed. Safe to
+ * run while the file is being recorded into: records overwritten during the
+ * walk are skipped (see history_read()).
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the file, PID filter and output flags
+ * @return EXIT_SUCCESS (0) if any record was printed, EXIT_FAILURE (1) otherwise
+ */
+static int handle_replay_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    history_ring_t ring;
+    if (history_open(args->replay_path, &ring) < 0) {
+        if (errno == EINVAL) {
+            print_error(ctx, "%s is not a wir history file", args->replay_path);
+        } else {
+            print_error(ctx, "Cannot open %s: %s", args->replay_path, strerror(errno));
+        }
+        return EXIT_FAILURE;
+    }
+
+    uint64_t first, end;
+    history_range(&ring, &first, &end);
+
+    history_stream_t stream;
+    if (output_history_begin(&stream, ctx, args) < 0) {
+        history_close(&ring);
+        return EXIT_FAILURE;
+    }
+    for (uint64_t i = first; i < end; i++) {
+        history_record_t record;
+        if (!history_read(&ring, i, &record)) {
+            continue;
+        }
+        if (args->history_pid > 0 && record.pid != args->history_pid) {
+            continue;
+        }
+        output_history_row(&stream, &record);
+    }
+    const int result = output_history_end(&stream);
+
+    history_close(&ring);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Handle --publish-shm to keep a snapshot in shared memory for local readers
+ *
+ * Every --interval seconds, reads every process (all fields) and every
+ * TCP/UDP socket with its owners into the spare buffer of a POSIX
+ * shared-memory segment, then points readers at it (see snapshot_commit()).
+ * Any number of `wir --from-shm` runs, or programs mapping the segment
+ * through src/snapshot.h, then answer --pid, --port and --all from memory:
+ * a lookup is a binary search in the mapping plus a copy of its answer,
+ * with no /proc reads, socket dumps or messages to a daemon, and the
+ * publisher never waits for them.
+ *
+ * Runs until the context is cancelled (SIGINT or SIGTERM), then removes
+ * the segment so readers do not mistake the last snapshot for a live one.
+ *
+ * Error handling:
+ * - Returns EXIT_FAILURE if the segment cannot be created, is not a wir
+ *   snapshot, or is already being published
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the segment name and settings
+ * @return EXIT_SUCCESS (0) when cancelled, EXIT_FAILURE (1) on error
+ */
+static int handle_publish_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    const int interval = args->interval > 0 ? args->interval : SNAPSHOT_DEFAULT_INTERVAL;
+    const int max_mb = args->max_mb > 0 ? args->max_mb : SNAPSHOT_DEFAULT_MAX_MB;
+
+    snapshot_t snap;
+    if (snapshot_create(args->publish_name, (size_t)max_mb << 20, interval, &snap) < 0) {
+        if (errno == EEXIST) {
+            print_error(ctx, "%s exists and is not a wir snapshot", args->publish_name);
+        } else if (errno == EWOULDBLOCK) {
+            print_error(ctx, "%s is already being published", args->publish_name);
+        } else if (errno == EINVAL) {
+            print_error(ctx, "Invalid segment name: %s (expected e.g. /wir)", args->publish_name);
+        } else {
+            print_error(ctx, "Cannot create %s: %s", args->publish_name, strerror(errno));
+        }
+        return EXIT_FAILURE;
+    }
+
+    print_info(ctx, "Publishing to %s every %ds (room for %u processes, %u sockets); "
+               "stop with Ctrl-C", snap.name, interval, snap.header->process_capacity,
+               snap.header->socket_capacity);
+    fflush(ctx->out);
+
+    const platform_options_t opts = query_options(ctx, args);
+    bool warned = false;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (!atomic_load(&ctx->cancelled)) {
+        process_info_t *procs = NULL;
+        int count = 0;
+
+        snapshot_begin(&snap);
+        if (platform_get_all_processes(&procs, &count, PROC_SRC_ALL) == 0) {
+            for (int i = 0; i < count; i++) {
+                snapshot_add_process(&snap, &procs[i]);
+            }
+        }
+        free(procs);
+
+        connection_info_t *sockets = NULL;
+        int socket_count = 0;
+        if (platform_get_port_connections(0, &opts, &sockets, &socket_count) == 0) {
+            for (int i = 0; i < socket_count; i++) {
+                snapshot_add_socket(&snap, &sockets[i]);
+            }
+        }
+        free(sockets);
+        snapshot_commit(&snap, (int64_t)time(NULL));
+
+        uint32_t flags = 0;
+        snapshot_time(&snap, &flags);
+        if ((flags & SNAPSHOT_TRUNCATED) && !warned) {
+            print_warning(ctx, "The snapshot does not fit in %d MiB; raise --max-size", max_mb);
+            warned = true;
+        }
+
+        deadline.tv_sec += interval;
+        sleep_until(ctx, &deadline);
+    }
+
+    snapshot_close(&snap);
+    return EXIT_SUCCESS;
+}
+
+/* Port re-check period for --wait-listen/--wait-free, in milliseconds */
+#define WAIT_POLL_MS 5
+
+/**
+ * Handle --wait-listen/--wait-free to block until a port changes state
+ *
+ * Re-checks the port every WAIT_POLL_MS until it is bound (--wait-listen)
+ * or free (--wait-free), or the --timeout expires. Built for deploy scripts
+ * that currently loop over "wir --port": each check only asks the kernel
+ * whether a listener exists (see platform_port_bound()) and never maps
+ * sockets to processes, so the change is noticed within a few milliseconds
+ * while the wait itself costs next to no CPU.
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the port, timeout and output flags
+ * @return EXIT_SUCCESS (0) once the port is in the wanted state, EXIT_FAILURE (1)
+ *         on timeout or if the port cannot be checked
+ */
+static int handle_wait_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    const int timeout_ms = args_timeout_ms(args);
+    const struct timespec poll = {0, WAIT_POLL_MS * 1000000L};
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    bool reached = false;
+    long waited_ms = 0;
+    for (;;) {
+        bool bound;
+        if (platform_port_bound(args->wait_port, &bound) < 0) {
+            print_error(ctx, "Failed to query port %d", args->wait_port);
+            return EXIT_FAILURE;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        waited_ms = (now.tv_sec - start.tv_sec) * 1000L +
+                    (now.tv_nsec - start.tv_nsec) / 1000000L;
+
+        if (bound != args->wait_free) {
+            reached = true;
+            break;
+        }
+        if (timeout_ms > 0 && waited_ms >= timeout_ms) {
+            break;
+        }
+        nanosleep(&poll, NULL);
+    }
+
+    const int result = output_port_wait(ctx, args->wait_port, args->wait_free, reached,
+                                        waited_ms, args);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Handle --check to test a port condition for a health probe
+ *
+ * Prints nothing on success or mismatch; the answer is the exit status.
+ * See check_run() for how the probe keeps its cost down.
+ *
+ * @param ctx Context (unused: the probe prints no report)
+ * @param args Pointer to cli_args_t structure containing the parsed condition
+ * @return EXIT_SUCCESS (0) if a socket matches, EXIT_FAILURE (1) if none
+ *         does, CHECK_EXIT_ERROR (2) if the sockets cannot be read
+ */
+static int handle_check_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    (void)ctx;
+
+    const int result = check_run(&args->check);
+    if (result < 0) {
+        print_error(ctx, "Failed to query port %d", args->check.port);
+        return CHECK_EXIT_ERROR;
+    }
+    return result == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Endpoint walk callback: count one TCP socket
+ *
+ * @param ctx ephemeral_table_t being filled
+ * @param ep Socket with a local port in the ephemeral range
+ * @return void
+ */
+static void count_endpoint(void *ctx, const tcp_endpoint_t *ep) {
+    ephemeral_add_endpoint(ctx, ep);
+}
+
+/**
+ * Handle --ephemeral to report how close outgoing connections are to
+ * running out of local ports
+ *
+ * One streaming pass over the TCP sockets whose local port is in the
+ * ephemeral range (filtered in the kernel where sock_diag is available),
+ * counted per destination as they arrive; nothing is resolved to a process.
+ *
+ * @param ctx Context to report to
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return EXIT_SUCCESS (0) on successful display, EXIT_FAILURE (1) on error
+ */
+static int handle_ephemeral_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    int low, high;
+    if (platform_ephemeral_port_range(&low, &high) < 0) {
+        print_error(ctx, "Failed to read the ephemeral port range");
+        return EXIT_FAILURE;
+    }
+
+    ephemeral_table_t *table = counted_malloc(sizeof(ephemeral_table_t));
+    if (!table || ephemeral_table_init(table, low, high) < 0) {
+        print_error(ctx, "Failed to count ephemeral ports: %s", strerror(errno));
+        if (table) {
+            ephemeral_table_free(table);
+        }
+        free(table);
+        return EXIT_FAILURE;
+    }
+
+    if (platform_for_each_tcp_endpoint(low, high, count_endpoint, table) < 0) {
+        print_error(ctx, "Failed to read TCP sockets");
+        ephemeral_table_free(table);
+        free(table);
+        return EXIT_FAILURE;
+    }
+
+    ephemeral_dest_t *dests = NULL;
+    const int count = ephemeral_table_list(table, &dests);
+    if (count < 0) {
+        print_error(ctx, "Failed to count ephemeral ports: %s", strerror(errno));
+        ephemeral_table_free(table);
+        free(table);
+        return EXIT_FAILURE;
+    }
+    const int result = output_ephemeral(ctx, &table->summary, dests, count, args);
+
+    ephemeral_table_free(table);
+    free(table);
+    free(dests);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Handle --calibrate to pick the fastest socket backend per operation
+ *
+ * Times every backend that works on this host on each operation (see
+ * backend_calibrate()) and writes the fastest to the state file, which
+ * later runs read on their first socket query. The measurement reflects
+ * the host as it is now: a busier host, or a new kernel (which invalidates
+ * the file), is worth a new calibration.
+ *
+ * @param ctx Context to report to
+ * @param args Pointer to cli_args_t structure containing output format flags
+ * @return EXIT_SUCCESS (0) if the choices were saved, EXIT_FAILURE (1) otherwise
+ */
+static int handle_calibrate_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    if (backend_count() == 0) {
+        print_error(ctx, "This platform has a single socket backend; there is nothing to "
+                    "calibrate");
+        return EXIT_FAILURE;
+    }
+
+    char path[512];
+    if (backend_state_path(path, sizeof(path)) < 0) {
+        print_error(ctx, "Cannot locate the state file: set HOME or XDG_STATE_HOME");
+        return EXIT_FAILURE;
+    }
+
+    backend_timing_t timings[BACKEND_OP_COUNT * BACKEND_MAX];
+    const int count = backend_calibrate(timings, BACKEND_OP_COUNT * BACKEND_MAX);
+    if (backend_save(ctx, timings, count, path) < 0) {
+        return EXIT_FAILURE;
+    }
+
+    const int result = output_calibration(ctx, timings, count, path, args);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Answer one parsed --serve-stdio query
+ *
+ * @param ctx Context to report to
+ * @param opts Platform settings, with the session's socket-owner cache
+ * @param req Parsed query
+ * @return void
+ */
+static void serve_request(const wir_ctx_t *ctx, const platform_options_t *opts,
+                          const serve_request_t *req) {
+    switch (req->op) {
+        case SERVE_PORT: {
+            connection_info_t *connections = NULL;
+            int count = 0;
+            if (platform_get_port_connections(req->port, opts, &connections, &count) < 0) {
+                output_serve_error(ctx, req->id, "cannot read socket tables");
+            } else {
+                output_serve_connections(ctx, req->id, req->port, connections, count);
+            }
+            free(connections);
+            break;
+        }
+
+        case SERVE_PID: {
+            process_info_t info;
+            if (platform_get_process_info(req->pid, &info) < 0) {
+                output_serve_error(ctx, req->id, "no such process or access denied");
+            } else {
+                output_serve_process(ctx, req->id, &info);
+            }
+            break;
+        }
+
+        case SERVE_BOUND: {
+            bool bound = false;
+            if (platform_port_bound(req->port, &bound) < 0) {
+                output_serve_error(ctx, req->id, "cannot read socket tables");
+            } else {
+                output_serve_bound(ctx, req->id, req->port, bound);
+            }
+            break;
+        }
+
+        case SERVE_CHECK: {
+            port_check_t check;
+            if (check_parse(ctx, req->check, &check) < 0) {
+                output_serve_error(ctx, req->id, "invalid check condition");
+                break;
+            }
+            const int result = check_run(&check);
+            if (result < 0) {
+                output_serve_error(ctx, req->id, "cannot read socket tables");
+            } else {
+                output_serve_match(ctx, req->id, result == 1);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Handle --serve-stdio: answer queries read from stdin until EOF
+ *
+ * Each input line is one JSON query (see serve_parse()) and gets exactly one
+ * JSON line back, flushed at once, so a supervisor or sidecar can keep one
+ * wir as a coprocess instead of paying a process start per lookup. A bad
+ * line gets an "ok":false answer and the session goes on.
+ *
+ * Staying up is what makes the queries cheap: the user-name and boot-time
+ * caches are process-wide already, and port queries share a socket-owner
+ * map that is reused for SERVE_INODE_TTL_MS, rebuilt early when a socket
+ * it does not know about turns up.
+ *
+ * @param ctx Context to report to (stops early once cancelled)
+ * @param args Pointer to cli_args_t structure (--jobs sets the owner scan threads)
+ * @return EXIT_SUCCESS (0) at end of input, EXIT_FAILURE (1) if stdin cannot be read
+ */
+static int handle_serve_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    platform_options_t opts = query_options(ctx, args);
+    opts.inode_cache = platform_inode_cache_new(SERVE_INODE_TTL_MS);
+
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while (!atomic_load(&ctx->cancelled) && (length = getline(&line, &capacity, stdin)) >= 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length == 0) {
+            continue;
+        }
+
+        serve_request_t req;
+        const char *error = NULL;
+        if (serve_parse(line, &req, &error) < 0) {
+            output_serve_error(ctx, req.id, error);
+        } else {
+            serve_request(ctx, &opts, &req);
+        }
+        fflush(ctx->out);
+    }
+
+    const bool failed = ferror(stdin) != 0;
+    free(line);
+    platform_inode_cache_free(opts.inode_cache);
+    if (failed) {
+        print_error(ctx, "Failed to read queries: %s", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Fields needed to name and identify a process that is about to be signalled */
+#define SIGNAL_TARGET_SOURCES (PROC_SRC_STAT | PROC_SRC_START)
+
+/**
+ * Compare two pid_t values for qsort()
+ */
+static int compare_pids(const void *a, const void *b) {
+    const pid_t x = *(const pid_t *)a;
+    const pid_t y = *(const pid_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Compare two processes by parent PID for qsort()
+ */
+static int compare_by_ppid(const void *a, const void *b) {
+    const pid_t x = ((const process_info_t *)a)->ppid;
+    const pid_t y = ((const process_info_t *)b)->ppid;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Collect every process that owns a socket on the port
+ *
+ * Reads the port's connections once and resolves each distinct owner PID,
+ * including every process sharing a socket (a prefork master and all of its
+ * workers). Owners that exit before they can be read are dropped.
+ *
+ * @param port Port number
+ * @param opts Settings for the port query
+ * @param procs Output: array of owner processes (caller must free)
+ * @param count Output: number of owners
+ * @return 0 on success, -1 if the port could not be queried or memory is exhausted
+ */
+static int collect_port_owners(int port, const platform_options_t *opts,
+                               process_info_t **procs, int *count) {
+    connection_info_t *connections = NULL;
+    int conn_count = 0;
+
+    *procs = NULL;
+    *count = 0;
+
+    if (platform_get_port_connections(port, opts, &connections, &conn_count) < 0) {
+        free(connections);
+        return -1;
+    }
+
+    /* Many sockets usually share one owner: sort the PIDs and keep one of each */
+    size_t owner_total = 0;
+    for (int i = 0; i < conn_count; i++) {
+        owner_total += (size_t)connections[i].owner_count;
+    }
+    pid_t *pids = counted_malloc((owner_total > 0 ? owner_total : 1) * sizeof(pid_t));
+    if (!pids) {
+        free(connections);
+        return -1;
+    }
+    int pid_count = 0;
+    for (int i = 0; i < conn_count; i++) {
+        for (int k = 0; k < connections[i].owner_count; k++) {
+            if (connections[i].owners[k] > 0) {
+                pids[pid_count++] = connections[i].owners[k];
+            }
+        }
+    }
+    free(connections);
+
+    qsort(pids, (size_t)pid_count, sizeof(pid_t), compare_pids);
+
+    *procs = counted_malloc((size_t)(pid_count > 0 ? pid_count : 1) * sizeof(process_info_t));
+    if (!*procs) {
+        free(pids);
+        return -1;
+    }
+    for (int i = 0; i < pid_count; i++) {
+        if (i > 0 && pids[i] == pids[i - 1]) {
+            continue;
+        }
+        if (platform_get_process_fields(pids[i], &(*procs)[*count],
+                                        SIGNAL_TARGET_SOURCES) == 0) {
+            (*count)++;
+        }
+    }
+
+    free(pids);
+    return 0;
+}
+
+/**
+ * Collect a process and, optionally, all of its descendants
+ *
+ * The descendants come from a single scan of the process table: the table is
+ * sorted by parent PID so each process's children form one contiguous run,
+ * found by binary search, and the subtree is then walked breadth-first. The
+ * result lists the root first, parents before children.
+ *
+ * @param pid Root process ID
+ * @param subtree Include descendants of pid
+ * @param procs Output: array of processes (caller must free)
+ * @param count Output: number of processes
+ * @return 0 on success, -1 if the root process does not exist or memory is exhausted
+ */
+static int collect_process_subtree(pid_t pid, bool subtree, process_info_t **procs,
+                                   int *count) {
+    *procs = counted_malloc(sizeof(process_info_t));
+    *count = 0;
+    if (!*procs) {
+        return -1;
+    }
+
+    if (platform_get_process_fields(pid, &(*procs)[0], SIGNAL_TARGET_SOURCES) < 0) {
+        return -1;
+    }
+    *count = 1;
+
+    if (!subtree) {
+        return 0;
+    }
+
+    process_info_t *all = NULL;
+    int all_count = 0;
+    if (platform_get_all_processes(&all, &all_count, SIGNAL_TARGET_SOURCES) < 0) {
+        free(all);
+        return -1;
+    }
+
+    qsort(all, (size_t)all_count, sizeof(process_info_t), compare_by_ppid);
+    process_info_t *grown = counted_realloc(*procs,
+                                            (size_t)(all_count + 1) * sizeof(process_info_t));
+    if (!grown) {
+        free(all);
+        return -1;
+    }
+    *procs = grown;
+
+    /* (*procs)[0 .. *count) doubles as the BFS queue */
+    for (int head = 0; head < *count; head++) {
+        const pid_t parent = (*procs)[head].pid;
+
+        /* First process whose ppid is >= parent */
+        int lo = 0;
+        int hi = all_count;
+        while (lo < hi) {
+            const int mid = lo + (hi - lo) / 2;
+            if (all[mid].ppid < parent) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        for (int i = lo; i < all_count && all[i].ppid == parent; i++) {
+            /* PID 0 is its own parent on some systems; never loop on it */
+            if (all[i].pid != parent && *count <= all_count) {
+                (*procs)[(*count)++] = all[i];
+            }
+        }
+    }
+
+    free(all);
+    return 0;
+}
+
+/**
+ * Handle --signal: signal every owner of a port or a process subtree
+ *
+ * Collects the targets from one scan (see collect_port_owners() and
+ * collect_process_subtree()), signals them all through kill_processes(),
+ * which waits for them concurrently, then prints the per-process outcome
+ * and the total time until every process had exited.
+ *
+ * wir itself is never signalled, even when it is part of the subtree.
+ *
+ * @param ctx Context to query with and report to
+ * @param args Pointer to cli_args_t structure containing the signal and target
+ * @return EXIT_SUCCESS if every process was handled, EXIT_FAILURE otherwise
+ */
+static int handle_signal_operation(const wir_ctx_t *ctx, const cli_args_t *args) {
+    process_info_t *procs = NULL;
+    int count = 0;
+
+    if (args->mode == MODE_PORT) {
+        const platform_options_t opts = query_options(ctx, args);
+        if (collect_port_owners(args->port, &opts, &procs, &count) < 0) {
+            const int error = errno;
+            print_error(ctx, "Failed to query port %d", args->port);
+            print_failure_cause(ctx, error,
+                                "You may need elevated privileges to inspect network connections");
+            free(procs);
+            return EXIT_FAILURE;
+        }
+        if (count == 0) {
+            print_error(ctx, "No processes found on port %d", args->port);
+            free(procs);
+            return EXIT_FAILURE;
+        }
+    } else if (collect_process_subtree(args->pid, args->subtree, &procs, &count) < 0) {
+        const int error = errno;
+        print_error(ctx, "Failed to get information for PID %d", args->pid);
+        print_failure_cause(ctx, error,
+                            "Process may not exist or you don't have permission to access it");
+        free(procs);
+        return EXIT_FAILURE;
+    }
+
+    /* Drop ourselves (e.g. --subtree on the invoking shell) */
+    const pid_t self = getpid();
+    for (int i = 0; i < count; i++) {
+        if (procs[i].pid == self) {
+            procs[i--] = procs[--count];
+        }
+    }
+
+    kill_target_t *targets = counted_malloc((size_t)(count > 0 ? count : 1) *
+                                            sizeof(kill_target_t));
+    if (!targets) {
+        print_error(ctx, "Cannot signal processes: %s", strerror(errno));
+        free(procs);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < count; i++) {
+        targets[i] = (kill_target_t){ .pid = procs[i].pid, .start_time = procs[i].start_time };
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    kill_processes(targets, count, args->signal, args_grace_ms(args));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    const long total_ms = (long)(t1.tv_sec - t0.tv_sec) * 1000 +
+                          (t1.tv_nsec - t0.tv_nsec) / 1000000;
+    const int result = output_signal_summary(ctx, procs, targets, count, args->signal,
+                                             total_ms, args);
+
+    free(targets);
+    free(procs);
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* ============================================================================
+ * PUBLIC API
+ * ============================================================================ */
+
+/**
+ * Create a libwir context
+ *
+ * The context starts with the CLI's defaults: reports go to stdout in
+ * color, socket owners are scanned on the calling thread and TCP internals
+ * are off. Also sets up the shared platform state on first use, so no other
+ * initialisation call is needed.
+ *
+ * @return New context (free with wir_ctx_free()), or NULL if memory is
+ *         exhausted (errno ENOMEM)
+ */
+wir_ctx_t *wir_ctx_new(void) {
+    platform_init();
+
+    wir_ctx_t *ctx = counted_malloc(sizeof(*ctx));
+    if (!ctx) {
+        return NULL;
+    }
+    ctx->out = stdout;
+    ctx->colors = true;
+    ctx->err = stderr;
+    ctx->err_colors = true;
+    ctx->platform = (platform_options_t){ .scan_jobs = 1, .tcp_info = false };
+    atomic_init(&ctx->cancelled, false);
+    ctx->snapshot = NULL;
+    return ctx;
+}
+
+/**
+ * Free a context from wir_ctx_new()
+ *
+ * The shared caches are kept warm for other and later contexts; see
+ * wir_cleanup().
+ *
+ * @param ctx Context to free (NULL is ignored)
+ * @return void
+ */
+void wir_ctx_free(wir_ctx_t *ctx) {
+    free(ctx);
+}
+
+/**
+ * Set the stream reports are written to
+ *
+ * @param ctx Context
+ * @param out Open stream (not closed by libwir)
+ * @return void
+ */
+void wir_ctx_set_output(wir_ctx_t *ctx, FILE *out) {
+    ctx->out = out;
+}
+
+/**
+ * Enable or disable ANSI colors in text reports
+ *
+ * @param ctx Context
+ * @param colors Whether text reports are colored
+ * @return void
+ */
+void wir_ctx_set_colors(wir_ctx_t *ctx, bool colors) {
+    ctx->colors = colors;
+}
+
+/**
+ * Set the stream errors and warnings are written to, and their coloring
+ *
+ * libwir never reads NO_COLOR or other environment settings itself; the
+ * caller decides for both streams (the CLI honors --no-color and NO_COLOR).
+ *
+ * @param ctx Context
+ * @param err Open stream (not closed by libwir)
+ * @param colors Whether errors and warnings are colored
+ * @return void
+ */
+void wir_ctx_set_error_output(wir_ctx_t *ctx, FILE *err, bool colors) {
+    ctx->err = err;
+    ctx->err_colors = colors;
+}
+
+/**
+ * Set the worker threads for the socket-owner scan behind port queries
+ *
+ * @param ctx Context
+ * @param jobs Number of threads (values below 1 mean the calling thread only)
+ * @return void
+ */
+void wir_ctx_set_jobs(wir_ctx_t *ctx, int jobs) {
+    ctx->platform.scan_jobs = jobs < 1 ? 1 : jobs;
+}
+
+/**
+ * Enable or disable TCP internals (RTT, retransmits, socket memory) in port queries
+ *
+ * @param ctx Context
+ * @param enabled Whether port queries fill in wir_connection_t.tcp
+ * @return void
+ */
+void wir_ctx_set_tcp_info(wir_ctx_t *ctx, bool enabled) {
+    ctx->platform.tcp_info = enabled;
+}
+
+/**
+ * Ask a running wir_run() on this context to stop
+ *
+ * --record, --publish-shm and --serve-stdio run until stopped; they finish
+ * the current sample, snapshot or query and return. May be called from
+ * another thread or from a signal handler. The request stays in effect for
+ * later runs on the context.
+ *
+ * @param ctx Context
+ * @return void
+ */
+void wir_ctx_cancel(wir_ctx_t *ctx) {
+    atomic_store(&ctx->cancelled, true);
+}
+
+/* Snapshots older than this many publishing intervals are reported as stale */
+#define SNAPSHOT_STALE_INTERVALS 3
+
+/**
+ * Map a published snapshot for --from-shm
+ *
+ * Warns when the snapshot is incomplete (the segment was too small) or
+ * older than SNAPSHOT_STALE_INTERVALS publishing intervals, which means its
+ * publisher has stopped without removing it or cannot keep up.
+ *
+ * @param ctx Context errors are reported to
+ * @param name Segment name
+ * @param snap Output segment
+ * @return 0 on success, -1 on error (message printed)
+ */
+static int open_snapshot(const wir_ctx_t *ctx, const char *name, snapshot_t *snap) {
+    if (snapshot_open(name, snap) < 0) {
+        if (errno == ENOENT) {
+            print_error(ctx, "Nothing is published at %s (start wir --publish-shm %s)", name, name);
+        } else if (errno == EINVAL) {
+            print_error(ctx, "%s is not a wir snapshot", name);
+        } else if (errno == EACCES) {
+            print_error(ctx, "%s can only be read by the user that publishes it", name);
+        } else {
+            print_error(ctx, "Cannot open %s: %s", name, strerror(errno));
+        }
+        return -1;
+    }
+
+    uint32_t flags = 0;
+    const int64_t published = snapshot_time(snap, &flags);
+    if (published < 0) {
+        print_error(ctx, "%s has no snapshot yet; try again in a moment", name);
+        snapshot_close(snap);
+        return -1;
+    }
+
+    const int64_t age = (int64_t)time(NULL) - published;
+    if (age > (int64_t)snap->header->interval * SNAPSHOT_STALE_INTERVALS) {
+        print_warning(ctx, "The snapshot in %s is %llds old; is its publisher running?", name,
+                      (long long)age);
+    }
+    if (flags & SNAPSHOT_TRUNCATED) {
+        print_warning(ctx, "The snapshot in %s is incomplete; its publisher needs a larger "
+                      "--max-size", name);
+    }
+    return 0;
+}
+
+/**
+ * Run the operation selected by args->mode
+ *
+ * @param ctx Context to query with and report to
+ * @param args Parsed and validated arguments
+ * @return Exit status of the operation
+ */
+static int run_mode(const wir_ctx_t *ctx, const cli_args_t *args) {
+    switch (args->mode) {
+        case MODE_PID:
+            return args->signal ? handle_signal_operation(ctx, args)
+                                : handle_pid_operation(ctx, args);
+
+        case MODE_PORT:
+            if (args->group_by != GROUP_BY_NONE) {
+                return handle_port_group_operation(ctx, args);
+            }
+            return args->signal ? handle_signal_operation(ctx, args)
+                                : handle_port_operation(ctx, args);
+
+        case MODE_ALL:
+            return handle_all_operation(ctx, args);
+
+        case MODE_USERS:
+            return handle_by_user_operation(ctx, args);
+
+        case MODE_RECORD:
+            return handle_record_operation(ctx, args);
+
+        case MODE_REPLAY:
+            return handle_replay_operation(ctx, args);
+
+        case MODE_WAIT:
+            return handle_wait_operation(ctx, args);
+
+        case MODE_CHECK:
+            return handle_check_operation(ctx, args);
+
+        case MODE_EPHEMERAL:
+            return handle_ephemeral_operation(ctx, args);
+
+        case MODE_CALIBRATE:
+            return handle_calibrate_operation(ctx, args);
+
+        case MODE_SERVE:
+            return handle_serve_operation(ctx, args);
+
+        case MODE_PUBLISH:
+            return handle_publish_operation(ctx, args);
+
+        default:
+            print_error(ctx, "Invalid operation mode");
+            return EXIT_FAILURE;
+    }
+}
+
+/**
+ * Report the ABI the library was built with
+ *
+ * Callers that load libwir at run time compare it with the WIR_ABI_VERSION
+ * they were compiled against.
+ *
+ * @return WIR_ABI_VERSION of the library
+ */
+unsigned int wir_abi_version(void) {
+    return WIR_ABI_VERSION;
+}
+
+/**
+ * Parse and validate a wir command line for wir_run()
+ *
+ * Takes the arguments the wir command takes, argv[0] included, and checks
+ * them as the command does; errors are reported to the context's error
+ * stream. --help and --version print nothing here and are rejected, as is
+ * an empty command line: they belong to the caller's own interface.
+ *
+ * The result refers to strings in argv (file and segment names, --sort
+ * keys), which must stay valid until it is freed.
+ *
+ * @param ctx Context errors are reported to
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return Arguments (free with wir_args_free()), or NULL if they are invalid
+ *         (message printed) or memory is exhausted (errno ENOMEM)
+ */
+wir_args_t *wir_args_parse(wir_ctx_t *ctx, int argc, char **argv) {
+    wir_args_t *args = counted_malloc(sizeof(*args));
+    if (!args) {
+        return NULL;
+    }
+
+    if (parse_args(ctx, argc, argv, args) < 0) {
+        free(args);
+        return NULL;
+    }
+    if (args->mode == MODE_HELP || args->mode == MODE_VERSION) {
+        print_error(ctx, "Nothing to run: --help and --version are left to the caller");
+        free(args);
+        return NULL;
+    }
+    if (validate_args(ctx, args) < 0) {
+        free(args);
+        return NULL;
+    }
+    return args;
+}
+
+/**
+ * Free arguments from wir_args_parse()
+ *
+ * @param args Arguments (NULL is ignored)
+ * @return void
+ */
+void wir_args_free(wir_args_t *args) {
+    free(args);
+}
+
+/**
+ * Run one query described by parsed arguments
+ *
+ * Does what the wir command does for the same arguments, writing the report
+ * to the context's stream: the CLI is a thin client of this function. Build
+ * args with wir_args_parse(). Reports are colored per the context
+ * (the CLI maps --no-color onto it); --jobs and --tcp-info apply to this
+ * run on top of the context's settings. With --from-shm the published
+ * snapshot is mapped for the length of the run and answers the query.
+ *
+ * The context is only read, so threads may run queries on one context at
+ * the same time. A --from-shm run works on a copy of the context that also
+ * points at the mapped snapshot; --from-shm only answers --pid, --port and
+ * --all, which do not wait for wir_ctx_cancel().
+ *
+ * @param ctx Context to query with and report to
+ * @param args Parsed and validated arguments
+ * @return EXIT_SUCCESS (0) or EXIT_FAILURE (1), as the command would exit
+ */
+int wir_run(wir_ctx_t *ctx, const wir_args_t *args) {
+    if (!args->from_shm) {
+        return run_mode(ctx, args);
+    }
+
+    snapshot_t snap;
+    if (open_snapshot(ctx, args->from_shm, &snap) < 0) {
+        return EXIT_FAILURE;
+    }
+
+    wir_ctx_t run = {
+        .out = ctx->out,
+        .colors = ctx->colors,
+        .err = ctx->err,
+        .err_colors = ctx->err_colors,
+        .platform = ctx->platform,
+        .snapshot = &snap,
+    };
+    atomic_init(&run.cancelled, atomic_load(&ctx->cancelled));
+
+    const int result = run_mode(&run, args);
+    snapshot_close(&snap);
+    return result;
+}
+
+/**
+ * Get all connections on a port, with their owning PIDs
+ *
+ * @param ctx Context whose settings (scan threads, TCP internals) apply
+ * @param port Port number
+ * @param connections Output: array of connections (caller must free)
+ * @param count Output: number of connections
+ * @return 0 on success, -1 on error
+ */
+int wir_port_connections(wir_ctx_t *ctx, int port, wir_connection_t **connections,
+                         int *count) {
+    connection_info_t *conns = NULL;
+    int n = 0;
+    if (platform_get_port_connections(port, &ctx->platform, &conns, &n) < 0) {
+        return -1;
+    }
+
+    const int result = export_connections(conns, n, connections);
+    free(conns);
+    if (result < 0) {
+        return -1;
+    }
+    *count = n;
+    return 0;
+}
+
+/**
+ * Get information about one process
+ *
+ * @param ctx Context
+ * @param pid Process ID
+ * @param info Output: process information
+ * @return 0 on success, -1 if the process does not exist or cannot be read
+ */
+int wir_process(wir_ctx_t *ctx, pid_t pid, wir_process_t *info) {
+    (void)ctx;
+
+    process_info_t proc;
+    if (platform_get_process_info(pid, &proc) < 0) {
+        return -1;
+    }
+    export_process(&proc, info);
+    return 0;
+}
+
+/**
+ * Get information about every process
+ *
+ * @param ctx Context
+ * @param processes Output: array of processes (caller must free)
+ * @param count Output: number of processes
+ * @return 0 on success, -1 on error
+ */
+int wir_processes(wir_ctx_t *ctx, wir_process_t **processes, int *count) {
+    (void)ctx;
+
+    process_info_t *procs = NULL;
+    int n = 0;
+    if (platform_get_all_processes(&procs, &n, PROC_SRC_ALL) < 0) {
+        return -1;
+    }
+
+    const int result = export_processes(procs, n, processes);
+    free(procs);
+    if (result < 0) {
+        return -1;
+    }
+    *count = n;
+    return 0;
+}
+
+/**
+ * Check whether anything is bound to a port, without resolving owners
+ *
+ * @param ctx Context
+ * @param port Port number
+ * @param bound Output: true if a TCP listener or a UDP socket uses the port
+ * @return 0 on success, -1 on error
+ */
+int wir_port_bound(wir_ctx_t *ctx, int port, bool *bound) {
+    (void)ctx;
+    return platform_port_bound(port, bound);
+}
+
+/**
+ * Test a --check condition ("port=8080,state=LISTEN,user=app")
+ *
+ * @param ctx Context
+ * @param condition Condition in --check syntax
+ * @return 1 if a socket matches, 0 if none does, -1 if the condition is
+ *         invalid (message printed) or sockets cannot be read
+ */
+int wir_check(wir_ctx_t *ctx, const char *condition) {
+    port_check_t check;
+    if (check_parse(ctx, condition, &check) < 0) {
+        return -1;
+    }
+    return check_run(&check);
+}
+
+/**
+ * Read the socket backends that `wir --calibrate` chose for this host
+ *
+ * The choice lives in the user's state file ($XDG_STATE_HOME/wir/backends,
+ * see backend_state_path()). libwir does not read it unless asked, so an
+ * embedding program gets the same built-in backends on every host; the
+ * wir command asks. Process-wide, like the caches: call once before the
+ * first query.
+ *
+ * @return void
+ */
+void wir_use_calibration(void) {
+    backend_load_state();
+}
+
+/**
+ * Release the caches shared by all contexts
+ *
+ * Optional; call once before the process exits, when no context is in use.
+ *
+ * @return void
+ */
+void wir_cleanup(void) {
+    platform_cleanup();
+}
@@ -0,0 +1,187 @@
+#ifndef WIR_H
+#define WIR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * libwir - the wir scanners and reports as an embeddable library
+ *
+ * Link with libwir.a or libwir.so (see `make lib`) and -pthread. Every call
+ * takes a context created by wir_ctx_new(); settings live in the context,
+ * not in globals, so any number of contexts may be used at the same time as
+ * long as each is used by one thread at a time. Caches that make repeated
+ * queries cheap (UID to username, boot time) are shared by all contexts and
+ * stay warm for the life of the process.
+ *
+ * Errors and warnings are written to the context's error stream (stderr
+ * and colored by default, see wir_ctx_set_error_output()); libwir does not
+ * read the environment to decide either stream's coloring. Running out of
+ * memory is an error like any other (-1 or NULL, errno ENOMEM); the library
+ * never exits.
+ *
+ * This header is the library's whole interface: it includes no other wir
+ * header, and the structures below are the only ones shared with callers.
+ * They are fixed for a given WIR_ABI_VERSION, which is also the major
+ * version in the shared library's SONAME (libwir.so.0); it is bumped
+ * whenever a declaration here changes incompatibly. The functions below
+ * are the only symbols the shared library exports.
+ *
+ * See src/wir.c and src/query.c (asynchronous queries) for detailed
+ * documentation of each function.
+ */
+#define WIR_ABI_VERSION 0
+
+/* Exports a function from the shared library (built with -fvisibility=hidden) */
+#if defined(__GNUC__)
+#define WIR_API __attribute__((visibility("default")))
+#else
+#define WIR_API
+#endif
+
+/* Sizes of the string fields below, terminating NUL included */
+#define WIR_NAME_SIZE 256
+#define WIR_CMDLINE_SIZE 1024
+#define WIR_USER_SIZE 64
+#define WIR_ADDR_SIZE 64
+#define WIR_STATE_SIZE 16
+#define WIR_PROTOCOL_SIZE 8
+
+/**
+ * One process
+ *
+ * Fields:
+ * - pid, ppid: Process and parent process IDs
+ * - uid: User ID of the owner
+ * - state: State character (R=Running, S=Sleeping, Z=Zombie, ...)
+ * - vsz, rss: Virtual and resident memory (KB)
+ * - start_time: Start time (seconds since the epoch)
+ * - name: Executable name
+ * - username: Owner's user name
+ * - cmdline: Command line, arguments separated by spaces (truncated)
+ */
+typedef struct {
+    pid_t pid;
+    pid_t ppid;
+    int uid;
+    char state;
+    unsigned long vsz;
+    unsigned long rss;
+    int64_t start_time;
+    char name[WIR_NAME_SIZE];
+    char username[WIR_USER_SIZE];
+    char cmdline[WIR_CMDLINE_SIZE];
+} wir_process_t;
+
+/**
+ * TCP internals of one connection (wir_ctx_set_tcp_info(), Linux only)
+ *
+ * Fields: round-trip time and its variance (microseconds), retransmissions
+ * of the current segment and over the connection's lifetime, congestion
+ * window and unacknowledged segments, receive and send memory in use with
+ * their limits, bytes queued for sending, and packets dropped.
+ */
+typedef struct {
+    unsigned int rtt_us;
+    unsigned int rttvar_us;
+    unsigned int retransmits;
+    unsigned int total_retrans;
+    unsigned int snd_cwnd;
+    unsigned int unacked;
+    unsigned int rmem_alloc;
+    unsigned int rcvbuf;
+    unsigned int wmem_alloc;
+    unsigned int sndbuf;
+    unsigned int wmem_queued;
+    unsigned int drops;
+} wir_tcp_info_t;
+
+/**
+ * One socket on a port
+ *
+ * Fields:
+ * - protocol: TCP, TCP6, UDP or UDP6
+ * - state: TCP state (LISTEN, ESTABLISHED, ...) or UNCONN for UDP
+ * - local_addr, local_port, remote_addr, remote_port: Endpoints (remote
+ *   port 0 when not connected)
+ * - pid: Lowest owning PID (-1 if unknown)
+ * - owner_count, owners: Every owning PID in ascending order; the list
+ *   lives in the same allocation as the array holding the connection
+ * - rx_queue, tx_queue: Receive and send queues (bytes; for a listener,
+ *   rx_queue is the accept queue)
+ * - backlog: Listen backlog (0 = not a listener or unknown)
+ * - has_tcp_info, tcp: TCP internals, when requested and available
+ */
+typedef struct {
+    char protocol[WIR_PROTOCOL_SIZE];
+    char state[WIR_STATE_SIZE];
+    char local_addr[WIR_ADDR_SIZE];
+    int local_port;
+    char remote_addr[WIR_ADDR_SIZE];
+    int remote_port;
+    pid_t pid;
+    int owner_count;
+    const pid_t *owners;
+    unsigned int rx_queue;
+    unsigned int tx_queue;
+    int backlog;
+    bool has_tcp_info;
+    wir_tcp_info_t tcp;
+} wir_connection_t;
+
+typedef struct wir_ctx wir_ctx_t;
+typedef struct wir_args wir_args_t;
+
+/* ABI the library was built with (compare with WIR_ABI_VERSION) */
+WIR_API unsigned int wir_abi_version(void);
+
+/* Context lifecycle and settings */
+WIR_API wir_ctx_t *wir_ctx_new(void);
+WIR_API void wir_ctx_free(wir_ctx_t *ctx);
+WIR_API void wir_ctx_set_output(wir_ctx_t *ctx, FILE *out);
+WIR_API void wir_ctx_set_colors(wir_ctx_t *ctx, bool colors);
+WIR_API void wir_ctx_set_error_output(wir_ctx_t *ctx, FILE *err, bool colors);
+WIR_API void wir_ctx_set_jobs(wir_ctx_t *ctx, int jobs);
+WIR_API void wir_ctx_set_tcp_info(wir_ctx_t *ctx, bool enabled);
+WIR_API void wir_ctx_cancel(wir_ctx_t *ctx);
+
+/* Run one query described by command-line arguments, as the command would */
+WIR_API wir_args_t *wir_args_parse(wir_ctx_t *ctx, int argc, char **argv);
+WIR_API void wir_args_free(wir_args_t *args);
+WIR_API int wir_run(wir_ctx_t *ctx, const wir_args_t *args);
+
+/* Queries returning data instead of a report (free arrays with free()) */
+WIR_API int wir_port_connections(wir_ctx_t *ctx, int port, wir_connection_t **connections,
+                                 int *count);
+WIR_API int wir_process(wir_ctx_t *ctx, pid_t pid, wir_process_t *info);
+WIR_API int wir_processes(wir_ctx_t *ctx, wir_process_t **processes, int *count);
+WIR_API int wir_port_bound(wir_ctx_t *ctx, int port, bool *bound);
+WIR_API int wir_check(wir_ctx_t *ctx, const char *condition);
+
+/*
+ * Asynchronous queries for event loops: start a query, poll its fd and call
+ * wir_query_step() while it is readable; the callback delivers the result
+ * (status 0 or -1, and an array the callback owns and must free).
+ */
+typedef struct wir_query wir_query_t;
+typedef void (*wir_processes_cb)(void *user, int status, wir_process_t *processes,
+                                 int count);
+typedef void (*wir_connections_cb)(void *user, int status, wir_connection_t *connections,
+                                   int count);
+
+WIR_API wir_query_t *wir_query_processes(wir_ctx_t *ctx, wir_processes_cb done, void *user);
+WIR_API wir_query_t *wir_query_port_connections(wir_ctx_t *ctx, int port,
+                                                wir_connections_cb done, void *user);
+WIR_API int wir_query_fd(const wir_query_t *query);
+WIR_API int wir_query_step(wir_query_t *query, int budget);
+WIR_API void wir_query_free(wir_query_t *query);
+
+/* Use the socket backends saved by `wir --calibrate` (process-wide, off by default) */
+WIR_API void wir_use_calibration(void);
+
+/* Release the shared caches before the process exits */
+WIR_API void wir_cleanup(void);
+
+#endif /* WIR_H */
@@ -0,0 +1,321 @@
+#include "workq.h"
+#include "utils.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Cache line size; keeps the deque ends apart */
+#define WORKQ_CACHE_LINE 64
+
+/* Idle rounds spent yielding before backing off to short sleeps */
+#define WORKQ_SPIN_LIMIT 64
+
+/* Sleep between idle rounds once past WORKQ_SPIN_LIMIT */
+#define WORKQ_IDLE_SLEEP_NS 50000
+
+/*
+ * Chase-Lev work-stealing deque (fixed capacity).
+ *
+ * The owning worker pushes and takes at the bottom; other workers steal at
+ * the top. Only the last remaining item is contended, and that race is
+ * settled by a CAS on top. The memory orderings follow Le et al., "Correct
+ * and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ *
+ * The buffer does not grow: a push onto a full deque fails and the caller
+ * runs the task itself, so no buffer is ever retired while a thief might
+ * still be reading it.
+ */
+typedef struct {
+    atomic_long top;
+    char pad_top[WORKQ_CACHE_LINE - sizeof(atomic_long)];
+    atomic_long bottom;
+    char pad_bottom[WORKQ_CACHE_LINE - sizeof(atomic_long)];
+    _Atomic uint64_t slots[WORKQ_DEQUE_SIZE];
+} deque_t;
+
+struct workq {
+    int workers;
+    int root_count;
+    workq_root_fn root;
+    workq_task_fn task;
+    void *ctx;
+    atomic_int next_root;   /* next root task to hand out */
+    atomic_long pending;    /* tasks claimed or queued but not finished */
+    deque_t *deques;        /* one per worker */
+};
+
+/* Thread start argument */
+typedef struct {
+    workq_t *q;
+    int id;
+    pthread_t thread;
+} worker_t;
+
+/**
+ * Push a task at the bottom of the owner's deque (owner only)
+ *
+ * @param d Deque
+ * @param task Task value
+ * @return false if the deque is full
+ */
+static bool deque_push(deque_t *d, uint64_t task) {
+    const long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    const long t = atomic_load_explicit(&d->top, memory_order_acquire);
+
+    if (b - t >= WORKQ_DEQUE_SIZE) {
+        return false;
+    }
+
+    atomic_store_explicit(&d->slots[b & (WORKQ_DEQUE_SIZE - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Take the newest task from the bottom of the owner's deque (owner only)
+ *
+ * @param d Deque
+ * @param task Output: task value
+ * @return false if the deque was empty (or a thief won the last item)
+ */
+static bool deque_take(deque_t *d, uint64_t *task) {
+    const long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *task = atomic_load_explicit(&d->slots[b & (WORKQ_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t < b) {
+        return true;
+    }
+
+    /* Last item: race any thief for it */
+    const bool won = atomic_compare_exchange_strong_explicit(
+        &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return won;
+}
+
+/**
+ * Steal the oldest task from the top of another worker's deque
+ *
+ * @param d Deque
+ * @param task Output: task value
+ * @return false if the deque was empty or another worker got there first
+ */
+static bool deque_steal(deque_t *d, uint64_t *task) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return false;
+    }
+
+    const uint64_t value = atomic_load_explicit(&d->slots[t & (WORKQ_DEQUE_SIZE - 1)],
+                                                memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return false;
+    }
+
+    *task = value;
+    return true;
+}
+
+/**
+ * Try to steal a task from any other worker
+ *
+ * Victims are visited starting from a pseudo-random worker so thieves do
+ * not all pile onto the same deque.
+ *
+ * @param q Scheduler
+ * @param self Worker doing the stealing
+ * @param seed In/out xorshift state of the worker
+ * @param task Output: task value
+ * @return true if a task was stolen
+ */
+static bool steal_any(workq_t *q, int self, uint32_t *seed, uint64_t *task) {
+    if (q->workers < 2) {
+        return false;
+    }
+
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    const int start = (int)(*seed % (uint32_t)q->workers);
+    for (int k = 0; k < q->workers; k++) {
+        const int victim = (start + k) % q->workers;
+        if (victim != self && deque_steal(&q->deques[victim], task)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Wait a little after a round that found no work
+ *
+ * @param idle Number of consecutive idle rounds so far
+ * @return void
+ */
+static void idle_wait(int idle) {
+    if (idle < WORKQ_SPIN_LIMIT) {
+        sched_yield();
+    } else {
+        const struct timespec ts = { 0, WORKQ_IDLE_SLEEP_NS };
+        nanosleep(&ts, NULL);
+    }
+}
+
+/**
+ * Worker main loop
+ *
+ * Prefers its own subtasks, then stolen ones, then a fresh root task. A
+ * worker leaves once every root has been handed out and no task is queued or
+ * running anywhere (pending == 0); a running task keeps pending above zero,
+ * so nothing can be pushed after that point.
+ *
+ * @param q Scheduler
+ * @param id Worker index
+ * @return void
+ */
+static void worker_loop(workq_t *q, int id) {
+    uint32_t seed = (uint32_t)id * 2654435761u + 1;
+    uint64_t task;
+    int idle = 0;
+
+    for (;;) {
+        if (deque_take(&q->deques[id], &task) || steal_any(q, id, &seed, &task)) {
+            q->task(q, id, task, q->ctx);
+            atomic_fetch_sub_explicit(&q->pending, 1, memory_order_release);
+            idle = 0;
+            continue;
+        }
+
+        /* Count the root as pending before claiming it, see above */
+        atomic_fetch_add_explicit(&q->pending, 1, memory_order_relaxed);
+        const int index = atomic_fetch_add_explicit(&q->next_root, 1, memory_order_relaxed);
+        if (index < q->root_count) {
+            q->root(q, id, index, q->ctx);
+            atomic_fetch_sub_explicit(&q->pending, 1, memory_order_release);
+            idle = 0;
+            continue;
+        }
+        atomic_fetch_sub_explicit(&q->pending, 1, memory_order_relaxed);
+
+        if (atomic_load_explicit(&q->pending, memory_order_acquire) == 0) {
+            break;
+        }
+        idle_wait(idle++);
+    }
+}
+
+/**
+ * Thread entry point for workers 1..n-1
+ *
+ * @param arg worker_t for this thread
+ * @return NULL
+ */
+static void *worker_main(void *arg) {
+    worker_t *w = arg;
+    worker_loop(w->q, w->id);
+    return NULL;
+}
+
+/**
+ * Split off a subtask from inside a running task
+ *
+ * The subtask goes to the bottom of the worker's own deque, where the worker
+ * will pick it up next unless an idle worker steals it first. If the deque
+ * is full the subtask runs immediately on the calling worker instead.
+ *
+ * @param q Scheduler (as passed to the running task)
+ * @param worker Worker running the current task (as passed to it)
+ * @param task Subtask value, passed back to the task callback
+ * @return void
+ */
+void workq_push(workq_t *q, int worker, uint64_t task) {
+    atomic_fetch_add_explicit(&q->pending, 1, memory_order_relaxed);
+
+    if (!deque_push(&q->deques[worker], task)) {
+        atomic_fetch_sub_explicit(&q->pending, 1, memory_order_relaxed);
+        q->task(q, worker, task, q->ctx);
+    }
+}
+
+/**
+ * Run root tasks 0..root_count-1 and everything they push, on `workers` workers
+ *
+ * The calling thread takes part as worker 0, so workers == 1 runs everything
+ * inline without starting a thread. If some threads cannot be started the
+ * remaining workers still complete all tasks.
+ *
+ * @param workers Number of workers (values below 1 mean 1)
+ * @param root_count Number of root tasks
+ * @param root Callback running a root task
+ * @param task Callback running a pushed subtask
+ * @param ctx Context passed to both callbacks
+ * @return 0 once every task has finished, -1 if memory is exhausted (no
+ *         task is run)
+ */
+int workq_run(int workers, int root_count, workq_root_fn root, workq_task_fn task,
+              void *ctx) {
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    workq_t q = {
+        .workers = workers,
+        .root_count = root_count,
+        .root = root,
+        .task = task,
+        .ctx = ctx,
+    };
+    atomic_init(&q.next_root, 0);
+    atomic_init(&q.pending, 0);
+
+    q.deques = counted_malloc((size_t)workers * sizeof(deque_t));
+    worker_t *threads = counted_malloc((size_t)workers * sizeof(worker_t));
+    if (!q.deques || !threads) {
+        free(q.deques);
+        free(threads);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (int k = 0; k < workers; k++) {
+        atomic_init(&q.deques[k].top, 0);
+        atomic_init(&q.deques[k].bottom, 0);
+    }
+
+    int started = 0;
+    for (int k = 1; k < workers; k++) {
+        threads[started].q = &q;
+        threads[started].id = k;
+        if (pthread_create(&threads[started].thread, NULL, worker_main,
+                           &threads[started]) == 0) {
+            started++;
+        }
+    }
+
+    worker_loop(&q, 0);
+
+    for (int k = 0; k < started; k++) {
+        pthread_join(threads[k].thread, NULL);
+    }
+
+    free(threads);
+    free(q.deques);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef WORKQ_H
+#define WORKQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Tasks each worker's deque can hold (power of two) */
+#define WORKQ_DEQUE_SIZE 1024
+
+/**
+ * Work-stealing task scheduler
+ *
+ * Runs a fixed set of root tasks (numbered 0..root_count-1) on a pool of
+ * workers. Roots are handed out one at a time from a shared counter; while
+ * running, a task may split off subtasks with workq_push(). Each worker keeps
+ * its subtasks in its own Chase-Lev deque and works through them LIFO, while
+ * idle workers steal the oldest ones FIFO from the other end. Subtasks are
+ * opaque 64-bit values interpreted by the task callback.
+ *
+ * The calling thread is worker 0; workers - 1 extra threads are started.
+ *
+ * See src/workq.c for detailed documentation of each function.
+ */
+typedef struct workq workq_t;
+
+/**
+ * Callback running root task `index` on worker `worker`
+ */
+typedef void (*workq_root_fn)(workq_t *q, int worker, int index, void *ctx);
+
+/**
+ * Callback running a subtask pushed with workq_push()
+ */
+typedef void (*workq_task_fn)(workq_t *q, int worker, uint64_t task, void *ctx);
+
+int workq_run(int workers, int root_count, workq_root_fn root, workq_task_fn task,
+              void *ctx);
+void workq_push(workq_t *q, int worker, uint64_t task);
+
+#endif /* WORKQ_H */
@@ -0,0 +1,207 @@
+#include "writer.h"
+#include <errno.h>
+#include <unistd.h>
+
+/* "00" .. "99", used to emit two decimal digits per division */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * Initialize a writer for a stream
+ *
+ * @param w Writer to initialize
+ * @param stream Destination stream (typically stdout)
+ * @return void
+ */
+void writer_init(writer_t *w, FILE *stream) {
+    w->stream = stream;
+    w->len = 0;
+}
+
+/**
+ * Flush staged bytes to the underlying file descriptor
+ *
+ * Flushes the stdio stream first so anything already printed through it
+ * keeps its place in the output, then writes the staged buffer with write(),
+ * retrying on partial writes and EINTR. Write errors (e.g. a closed pipe)
+ * drop the staged data; there is nothing useful left to do with it.
+ *
+ * @param w Writer to flush
+ * @return void
+ */
+void writer_flush(writer_t *w) {
+    if (w->len == 0) {
+        return;
+    }
+
+    fflush(w->stream);
+
+    const int fd = fileno(w->stream);
+    size_t off = 0;
+    while (off < w->len) {
+        const ssize_t n = write(fd, w->buf + off, w->len - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        off += (size_t)n;
+    }
+
+    w->len = 0;
+}
+
+/**
+ * Append raw bytes to the writer
+ *
+ * Large appends that do not fit in the remaining space are copied in chunks,
+ * flushing between them.
+ *
+ * @param w Writer
+ * @param data Bytes to append
+ * @param n Number of bytes
+ * @return void
+ */
+void writer_write(writer_t *w, const void *data, size_t n) {
+    const char *p = data;
+
+    while (n > 0) {
+        if (w->len == sizeof(w->buf)) {
+            writer_flush(w);
+        }
+
+        size_t chunk = sizeof(w->buf) - w->len;
+        if (chunk > n) {
+            chunk = n;
+        }
+
+        memcpy(w->buf + w->len, p, chunk);
+        w->len += chunk;
+        p += chunk;
+        n -= chunk;
+    }
+}
+
+/**
+ * Append an unsigned integer in decimal, without printf
+ *
+ * Digits are produced two at a time from a lookup table into a small stack
+ * buffer, back to front, then copied out in one go.
+ *
+ * @param w Writer
+ * @param value Value to append
+ * @return void
+ */
+void writer_put_uint(writer_t *w, unsigned long long value) {
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p = end;
+
+    while (value >= 100) {
+        const unsigned idx = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    }
+
+    if (value >= 10) {
+        const unsigned idx = (unsigned)value * 2;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    writer_write(w, p, (size_t)(end - p));
+}
+
+/**
+ * Append a signed integer in decimal, without printf
+ *
+ * @param w Writer
+ * @param value Value to append
+ * @return void
+ */
+void writer_put_int(writer_t *w, long long value) {
+    if (value < 0) {
+        writer_putc(w, '-');
+        /* Negate in unsigned arithmetic so LLONG_MIN does not overflow */
+        writer_put_uint(w, 0ULL - (unsigned long long)value);
+    } else {
+        writer_put_uint(w, (unsigned long long)value);
+    }
+}
+
+/**
+ * Append a string as an RFC 4180 CSV field
+ *
+ * The field is quoted only when it contains a comma, double quote, CR or LF;
+ * embedded double quotes are doubled.
+ *
+ * @param w Writer
+ * @param s Field value (NULL is written as an empty field)
+ * @return void
+ */
+void writer_put_csv(writer_t *w, const char *s) {
+    if (!s) {
+        return;
+    }
+
+    const size_t n = strlen(s);
+    if (strcspn(s, ",\"\r\n") == n) {
+        writer_write(w, s, n);
+        return;
+    }
+
+    writer_putc(w, '"');
+    for (const char *p = s; *p; p++) {
+        if (*p == '"') {
+            writer_putc(w, '"');
+        }
+        writer_putc(w, *p);
+    }
+    writer_putc(w, '"');
+}
+
+/**
+ * Append a string as a TSV field
+ *
+ * Uses the backslash escapes understood by the common TSV loaders
+ * (PostgreSQL COPY, ClickHouse TabSeparated): tab, newline, carriage return
+ * and backslash are written as \t, \n, \r and \\.
+ *
+ * @param w Writer
+ * @param s Field value (NULL is written as an empty field)
+ * @return void
+ */
+void writer_put_tsv(writer_t *w, const char *s) {
+    if (!s) {
+        return;
+    }
+
+    const char *run = s;
+    for (const char *p = s; *p; p++) {
+        const char *esc = NULL;
+        switch (*p) {
+            case '\t': esc = "\\t"; break;
+            case '\n': esc = "\\n"; break;
+            case '\r': esc = "\\r"; break;
+            case '\\': esc = "\\\\"; break;
+            default: continue;
+        }
+        writer_write(w, run, (size_t)(p - run));
+        writer_write(w, esc, 2);
+        run = p + 1;
+    }
+    writer_puts(w, run);
+}
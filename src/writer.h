@@ -0,0 +1,69 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+#include <string.h>
+
+/* Size of the writer's staging buffer */
+#define WRITER_BUF_SIZE 65536
+
+/**
+ * Buffered output writer
+ *
+ * Accumulates output in a large staging buffer and hands it to the kernel in
+ * big write() calls, bypassing stdio's per-call locking and format parsing.
+ * Used by the bulk formats (CSV/TSV) where per-field printf() calls dominate
+ * the cost of serialising tens of thousands of rows.
+ *
+ * Fields:
+ * - stream: Destination stream (flushed before the writer writes to its fd)
+ * - len: Number of bytes currently staged in buf
+ * - buf: Staging buffer
+ */
+typedef struct {
+    FILE *stream;
+    size_t len;
+    char buf[WRITER_BUF_SIZE];
+} writer_t;
+
+/**
+ * Writer functions
+ *
+ * See src/writer.c for detailed documentation of each function.
+ */
+void writer_init(writer_t *w, FILE *stream);
+void writer_flush(writer_t *w);
+void writer_write(writer_t *w, const void *data, size_t n);
+void writer_put_int(writer_t *w, long long value);
+void writer_put_uint(writer_t *w, unsigned long long value);
+void writer_put_csv(writer_t *w, const char *s);
+void writer_put_tsv(writer_t *w, const char *s);
+
+/**
+ * Append a single byte to the writer
+ *
+ * @param w Writer
+ * @param c Byte to append
+ * @return void
+ */
+static inline void writer_putc(writer_t *w, char c) {
+    if (w->len == sizeof(w->buf)) {
+        writer_flush(w);
+    }
+    w->buf[w->len++] = c;
+}
+
+/**
+ * Append a NUL-terminated string to the writer
+ *
+ * @param w Writer
+ * @param s String to append (NULL appends nothing)
+ * @return void
+ */
+static inline void writer_puts(writer_t *w, const char *s) {
+    if (s) {
+        writer_write(w, s, strlen(s));
+    }
+}
+
+#endif /* WRITER_H */